@@ -0,0 +1,414 @@
+/*****************************************************************************
+* Copyright (c) 2016, Cisco Systems, Inc.
+* All rights reserved.
+
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+* USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+/*
+ * This module is not part of libacvp.  It times the libacvp algorithm
+ * handlers against synthetic vector sets, without a server and without
+ * a crypto module.  The crypto callbacks do no work, so what is left
+ * is the cost of parsing the vector set, walking it in the handler and
+ * building and serializing the response.
+ *
+ * usage: acvp_bench [-n iterations] [-t tests per group] [name ...]
+ *
+ * Only the cases whose name contains one of the given names are run.
+ * -t sets the number of tests in the group for every case, in place
+ * of each case's own default.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "acvp/acvp.h"
+#include "acvp/acvp_lcl.h" /* acvp_time_vector_set() is internal */
+
+#define BENCH_DEFAULT_ITERATIONS 10
+#define BENCH_DEFAULT_TESTS 100
+
+/*
+ * One synthetic vector set.  The group and test fields are JSON
+ * object members without the braces.  In both of them $N is
+ * replaced by N pseudo-random bytes written in hex.  A Monte Carlo
+ * test runs thousands of iterations per test case, so those cases
+ * carry their own, smaller test count.
+ */
+typedef struct bench_case_t {
+    const char *name;
+    ACVP_CIPHER cipher;
+    const char *algorithm;
+    const char *mode;
+    const char *group;
+    const char *test;
+    int tests;
+} BENCH_CASE;
+
+static BENCH_CASE bench_cases[] = {
+    { "AES-GCM", ACVP_AES_GCM, "AES-GCM", NULL,
+      "\"direction\":\"encrypt\",\"testType\":\"AFT\",\"keyLen\":128,\"ivLen\":96,"
+      "\"payloadLen\":256,\"aadLen\":128,\"tagLen\":128,\"ivGen\":\"external\","
+      "\"ivGenMode\":\"8.2.1\"",
+      "\"key\":\"$16\",\"iv\":\"$12\",\"pt\":\"$32\",\"aad\":\"$16\"" },
+    { "AES-CBC", ACVP_AES_CBC, "AES-CBC", NULL,
+      "\"direction\":\"encrypt\",\"testType\":\"AFT\",\"keyLen\":128",
+      "\"key\":\"$16\",\"iv\":\"$16\",\"pt\":\"$64\"" },
+    { "AES-CBC-MCT", ACVP_AES_CBC, "AES-CBC", NULL,
+      "\"direction\":\"encrypt\",\"testType\":\"MCT\",\"keyLen\":128",
+      "\"key\":\"$16\",\"iv\":\"$16\",\"pt\":\"$16\"", 10 },
+    { "TDES-CBC-MCT", ACVP_TDES_CBC, "TDES-CBC", NULL,
+      "\"direction\":\"encrypt\",\"testType\":\"MCT\",\"keyingOption\":1",
+      "\"key1\":\"$8\",\"key2\":\"$8\",\"key3\":\"$8\",\"iv\":\"$8\",\"pt\":\"$8\"", 1 },
+    { "SHA2-256", ACVP_HASH_SHA256, "SHA2-256", NULL,
+      "\"testType\":\"AFT\"",
+      "\"len\":512,\"msg\":\"$64\"" },
+    { "SHA2-256-MCT", ACVP_HASH_SHA256, "SHA2-256", NULL,
+      "\"testType\":\"MCT\"",
+      "\"len\":256,\"msg\":\"$32\"", 10 },
+    { "HMAC-SHA2-256", ACVP_HMAC_SHA2_256, "HMAC-SHA2-256", NULL,
+      "\"keyLen\":256,\"msgLen\":512,\"macLen\":256",
+      "\"key\":\"$32\",\"msg\":\"$64\"" },
+    { "CMAC-AES", ACVP_CMAC_AES, "CMAC-AES", NULL,
+      "\"direction\":\"gen\",\"keyLen\":128,\"msgLen\":256,\"macLen\":128",
+      "\"key\":\"$16\",\"message\":\"$32\"" },
+    { "hashDRBG", ACVP_HASHDRBG, "hashDRBG", NULL,
+      "\"mode\":\"SHA2-256\",\"derFunc\":false,\"predResistance\":false,"
+      "\"entropyInputLen\":256,\"nonceLen\":128,\"persoStringLen\":256,"
+      "\"additionalInputLen\":256,\"returnedBitsLen\":1024",
+      "\"entropyInput\":\"$32\",\"nonce\":\"$16\",\"persoString\":\"$32\","
+      "\"otherInput\":[{\"additionalInput\":\"$32\",\"entropyInput\":\"$32\"},"
+      "{\"additionalInput\":\"$32\",\"entropyInput\":\"$32\"}]" },
+    { "DSA-pqgVer", ACVP_DSA_PQGVER, "DSA", "pqgVer",
+      "\"l\":2048,\"n\":256,\"hashAlg\":\"SHA2-256\",\"pqMode\":\"probable\"",
+      "\"p\":\"$256\",\"q\":\"$32\",\"domainSeed\":\"$32\",\"counter\":5" },
+    { "RSA-sigGen", ACVP_RSA_SIGGEN, "RSA", "sigGen",
+      "\"sigType\":\"pkcs1v1.5\",\"modulo\":2048,\"hashAlg\":\"SHA2-256\"",
+      "\"message\":\"$128\"" },
+    { "RSA-sigVer", ACVP_RSA_SIGVER, "RSA", "sigVer",
+      "\"sigType\":\"pkcs1v1.5\",\"modulo\":2048,\"hashAlg\":\"SHA2-256\","
+      "\"e\":\"$3\",\"n\":\"$256\"",
+      "\"message\":\"$128\",\"signature\":\"$256\"" },
+    { "ECDSA-sigGen", ACVP_ECDSA_SIGGEN, "ECDSA", "sigGen",
+      "\"curve\":\"P-256\",\"hashAlg\":\"SHA2-256\"",
+      "\"message\":\"$128\"" },
+    { "ECDSA-sigVer", ACVP_ECDSA_SIGVER, "ECDSA", "sigVer",
+      "\"curve\":\"P-256\",\"hashAlg\":\"SHA2-256\"",
+      "\"message\":\"$128\",\"qx\":\"$32\",\"qy\":\"$32\",\"r\":\"$32\",\"s\":\"$32\"" },
+    { "KAS-ECC-CDH", ACVP_KAS_ECC_CDH, "KAS-ECC", "CDH-Component",
+      "\"curve\":\"P-256\",\"testType\":\"AFT\"",
+      "\"publicServerX\":\"$32\",\"publicServerY\":\"$32\"" },
+    { "KAS-FFC-VAL", ACVP_KAS_FFC_COMP, "KAS-FFC", "Component",
+      "\"testType\":\"VAL\",\"hashAlg\":\"SHA2-256\","
+      "\"p\":\"$256\",\"q\":\"$32\",\"g\":\"$256\"",
+      "\"ephemeralPublicServer\":\"$256\",\"ephemeralPrivateIut\":\"$32\","
+      "\"ephemeralPublicIut\":\"$256\",\"hashZIut\":\"$32\"" },
+    { "KDF-TLS", ACVP_KDF135_TLS, "kdf-components", "tls",
+      "\"tlsVersion\":\"v1.2\",\"hashAlg\":\"SHA2-256\","
+      "\"preMasterSecretLength\":384,\"keyBlockLength\":1024",
+      "\"preMasterSecret\":\"$48\",\"clientHelloRandom\":\"$32\","
+      "\"serverHelloRandom\":\"$32\",\"clientRandom\":\"$32\",\"serverRandom\":\"$32\"" },
+    { "KDF-SSH", ACVP_KDF135_SSH, "kdf-components", "ssh",
+      "\"cipher\":\"AES-128\",\"hashAlg\":\"SHA2-256\"",
+      "\"k\":\"$64\",\"h\":\"$32\",\"sessionId\":\"$32\"" },
+    { "KDF-X963", ACVP_KDF135_X963, "kdf-components", "ansix9.63",
+      "\"fieldSize\":256,\"sharedInfoLength\":128,\"keyDataLength\":256,"
+      "\"hashAlg\":\"SHA2-256\"",
+      "\"z\":\"$32\",\"sharedInfo\":\"$16\"" },
+    { "KDF108", ACVP_KDF108, "KDF", NULL,
+      "\"kdfMode\":\"counter\",\"macMode\":\"CMAC-AES128\",\"keyOutLength\":256,"
+      "\"counterLength\":8,\"counterLocation\":\"after fixed data\"",
+      "\"keyIn\":\"$16\",\"deferred\":false" },
+};
+
+#define BENCH_CASE_CNT (int)(sizeof(bench_cases) / sizeof(BENCH_CASE))
+
+typedef struct bench_buf_t {
+    char *data;
+    size_t len;
+    size_t size;
+} BENCH_BUF;
+
+static int bench_buf_put(BENCH_BUF *buf, const char *s, size_t n) {
+    if (buf->len + n + 1 > buf->size) {
+        size_t size = buf->size ? buf->size : 4096;
+        char *data;
+
+        while (buf->len + n + 1 > size) {
+            size *= 2;
+        }
+        data = realloc(buf->data, size);
+        if (!data) {
+            return 1;
+        }
+        buf->data = data;
+        buf->size = size;
+    }
+    memcpy(buf->data + buf->len, s, n);
+    buf->len += n;
+    buf->data[buf->len] = 0;
+    return 0;
+}
+
+static int bench_buf_str(BENCH_BUF *buf, const char *s) {
+    return bench_buf_put(buf, s, strlen(s));
+}
+
+/*
+ * The synthetic data only has to look like hex, so a small xorshift
+ * generator is enough and keeps the vector sets the same from run to run.
+ */
+static unsigned int bench_rand_state = 2463534242U;
+
+static unsigned int bench_rand(void) {
+    bench_rand_state ^= bench_rand_state << 13;
+    bench_rand_state ^= bench_rand_state >> 17;
+    bench_rand_state ^= bench_rand_state << 5;
+    return bench_rand_state;
+}
+
+static int bench_put_template(BENCH_BUF *buf, const char *tmpl) {
+    static const char hex[] = "0123456789ABCDEF";
+    const char *p = tmpl;
+
+    while (*p) {
+        if (*p == '$') {
+            long n = strtol(p + 1, (char **)&p, 10);
+
+            while (n-- > 0) {
+                unsigned int r = bench_rand();
+                char b[2];
+
+                b[0] = hex[r & 0xf];
+                b[1] = hex[(r >> 4) & 0xf];
+                if (bench_buf_put(buf, b, 2)) {
+                    return 1;
+                }
+            }
+        } else {
+            if (bench_buf_put(buf, p, 1)) {
+                return 1;
+            }
+            p++;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Build the vector set in the form the server sends it: the version
+ * object followed by the vector set with one test group.
+ */
+static char *bench_gen_vector_set(BENCH_CASE *bc, int vs_id, int tests) {
+    BENCH_BUF buf = { NULL, 0, 0 };
+    char tmp[128];
+    int i, err = 0;
+
+    snprintf(tmp, sizeof(tmp), "[{\"acvVersion\":\"1.0\"},{\"vsId\":%d,", vs_id);
+    err |= bench_buf_str(&buf, tmp);
+    err |= bench_buf_str(&buf, "\"algorithm\":\"");
+    err |= bench_buf_str(&buf, bc->algorithm);
+    if (bc->mode) {
+        err |= bench_buf_str(&buf, "\",\"mode\":\"");
+        err |= bench_buf_str(&buf, bc->mode);
+    }
+    err |= bench_buf_str(&buf, "\",\"testGroups\":[{\"tgId\":1,");
+    err |= bench_put_template(&buf, bc->group);
+    err |= bench_buf_str(&buf, ",\"tests\":[");
+    for (i = 0; i < tests && !err; i++) {
+        snprintf(tmp, sizeof(tmp), "%s{\"tcId\":%d,", i ? "," : "", i + 1);
+        err |= bench_buf_str(&buf, tmp);
+        err |= bench_put_template(&buf, bc->test);
+        err |= bench_buf_str(&buf, "}");
+    }
+    err |= bench_buf_str(&buf, "]}]}]");
+    if (err) {
+        free(buf.data);
+        return NULL;
+    }
+    return buf.data;
+}
+
+static ACVP_RESULT progress(char *msg) {
+    printf("%s", msg);
+    return ACVP_SUCCESS;
+}
+
+static int bench_null_handler(ACVP_TEST_CASE *test_case) {
+    return 0;
+}
+
+static ACVP_RESULT bench_enable(ACVP_CTX *ctx, ACVP_CIPHER cipher) {
+    switch (cipher) {
+    case ACVP_AES_GCM:
+    case ACVP_AES_CBC:
+    case ACVP_TDES_CBC:
+        return acvp_cap_sym_cipher_enable(ctx, cipher, &bench_null_handler);
+    case ACVP_HASH_SHA256:
+        return acvp_cap_hash_enable(ctx, cipher, &bench_null_handler);
+    case ACVP_HMAC_SHA2_256:
+        return acvp_cap_hmac_enable(ctx, cipher, &bench_null_handler);
+    case ACVP_CMAC_AES:
+        return acvp_cap_cmac_enable(ctx, cipher, &bench_null_handler);
+    case ACVP_HASHDRBG:
+        return acvp_cap_drbg_enable(ctx, cipher, &bench_null_handler);
+    case ACVP_DSA_PQGVER:
+        return acvp_cap_dsa_enable(ctx, cipher, &bench_null_handler);
+    case ACVP_RSA_SIGGEN:
+    case ACVP_RSA_SIGVER:
+        return acvp_cap_rsa_sig_enable(ctx, cipher, &bench_null_handler);
+    case ACVP_ECDSA_SIGGEN:
+    case ACVP_ECDSA_SIGVER:
+        return acvp_cap_ecdsa_enable(ctx, cipher, &bench_null_handler);
+    case ACVP_KAS_ECC_CDH:
+        return acvp_cap_kas_ecc_enable(ctx, cipher, &bench_null_handler);
+    case ACVP_KAS_FFC_COMP:
+        return acvp_cap_kas_ffc_enable(ctx, cipher, &bench_null_handler);
+    case ACVP_KDF135_TLS:
+        return acvp_cap_kdf135_tls_enable(ctx, &bench_null_handler);
+    case ACVP_KDF135_SSH:
+        return acvp_cap_kdf135_ssh_enable(ctx, &bench_null_handler);
+    case ACVP_KDF135_X963:
+        return acvp_cap_kdf135_x963_enable(ctx, &bench_null_handler);
+    case ACVP_KDF108:
+        return acvp_cap_kdf108_enable(ctx, &bench_null_handler);
+    default:
+        return ACVP_UNSUPPORTED_OP;
+    }
+}
+
+static int bench_selected(BENCH_CASE *bc, int argc, char **argv, int first) {
+    int i;
+
+    if (first >= argc) {
+        return 1;
+    }
+    for (i = first; i < argc; i++) {
+        if (strstr(bc->name, argv[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void print_usage(void) {
+    printf("usage: acvp_bench [-n iterations] [-t tests per group] [name ...]\n");
+}
+
+int main(int argc, char **argv) {
+    ACVP_CTX *ctx = NULL;
+    ACVP_RESULT rv;
+    int iterations = BENCH_DEFAULT_ITERATIONS;
+    int tests = 0;
+    int i, c, prev, first, failed = 0;
+
+    for (first = 1; first < argc && argv[first][0] == '-'; first++) {
+        if (first + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        if (!strcmp(argv[first], "-n")) {
+            iterations = atoi(argv[++first]);
+        } else if (!strcmp(argv[first], "-t")) {
+            tests = atoi(argv[++first]);
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (iterations <= 0 || tests < 0) {
+        print_usage();
+        return 1;
+    }
+
+    rv = acvp_create_test_session(&ctx, &progress, ACVP_LOG_LVL_ERR);
+    if (rv != ACVP_SUCCESS) {
+        printf("Failed to create test session\n");
+        return 1;
+    }
+    for (c = 0; c < BENCH_CASE_CNT; c++) {
+        if (!bench_selected(&bench_cases[c], argc, argv, first)) {
+            continue;
+        }
+        for (prev = 0; prev < c; prev++) {
+            if (bench_cases[prev].cipher == bench_cases[c].cipher &&
+                bench_selected(&bench_cases[prev], argc, argv, first)) {
+                break;
+            }
+        }
+        if (prev < c) {
+            continue;
+        }
+        rv = bench_enable(ctx, bench_cases[c].cipher);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to enable %s (%d)\n", bench_cases[c].name, rv);
+            failed = 1;
+            goto end;
+        }
+    }
+
+    printf("%-14s %8s %10s %10s %10s %12s\n", "case", "tests",
+           "parse ms", "handler ms", "serial ms", "tests/s");
+    for (c = 0; c < BENCH_CASE_CNT; c++) {
+        BENCH_CASE *bc = &bench_cases[c];
+        ACVP_VS_TIMING total, t;
+        long long ns;
+        char *vs;
+
+        if (!bench_selected(bc, argc, argv, first)) {
+            continue;
+        }
+        if (tests) {
+            vs = bench_gen_vector_set(bc, c + 1, tests);
+        } else {
+            vs = bench_gen_vector_set(bc, c + 1, bc->tests ? bc->tests : BENCH_DEFAULT_TESTS);
+        }
+        if (!vs) {
+            printf("Failed to build the %s vector set\n", bc->name);
+            failed = 1;
+            goto end;
+        }
+        memset(&total, 0, sizeof(total));
+        for (i = 0; i < iterations; i++) {
+            rv = acvp_time_vector_set(ctx, vs, &t);
+            if (rv != ACVP_SUCCESS) {
+                break;
+            }
+            total.parse_ns += t.parse_ns;
+            total.handler_ns += t.handler_ns;
+            total.serialize_ns += t.serialize_ns;
+            total.tc_count += t.tc_count;
+        }
+        free(vs);
+        if (rv != ACVP_SUCCESS) {
+            printf("%-14s failed (%d)\n", bc->name, rv);
+            failed = 1;
+            continue;
+        }
+        ns = total.parse_ns + total.handler_ns + total.serialize_ns;
+        printf("%-14s %8d %10.3f %10.3f %10.3f %12.0f\n", bc->name, total.tc_count,
+               total.parse_ns / 1e6, total.handler_ns / 1e6, total.serialize_ns / 1e6,
+               ns ? total.tc_count * 1e9 / ns : 0.0);
+    }
+
+end:
+    acvp_cleanup(ctx);
+    return failed;
+}
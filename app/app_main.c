@@ -70,6 +70,8 @@ extern int fips_selftest_fail;
 extern int fips_mode;
 #endif
 static ACVP_RESULT totp(char **token, int token_max);
+static int app_group_begin(ACVP_CIPHER cipher, void *vs_ctx, void **group_ctx);
+static void app_group_end(ACVP_CIPHER cipher, void *vs_ctx, void *group_ctx);
 static int enable_aes(ACVP_CTX *ctx);
 static int enable_tdes(ACVP_CTX *ctx);
 static int enable_hash(ACVP_CTX *ctx);
@@ -134,6 +136,9 @@ typedef struct app_config {
     int dev;
     int json;
     char json_file[JSON_FILENAME_LENGTH + 1];
+    int offline;
+    char *vs_dir;
+    char *rsp_dir;
 
     /*
      * Algorithm Flags
@@ -164,10 +169,14 @@ char value[] = "same";
 
 static EVP_CIPHER_CTX *glb_cipher_ctx = NULL; /* need to maintain across calls for MCT */
 
-/* RSA group values */
-int rsa_current_tg = 0;
-BIGNUM *group_n = NULL;
-RSA *group_rsa = NULL;
+/*
+ * RSA SigGen key shared by the tests of one group.  Kept in the
+ * group's module_group_ctx rather than a global so that several
+ * test sessions can sign at the same time.
+ */
+typedef struct app_rsa_group_t {
+    RSA *rsa; /* generated by the first test of the group */
+} APP_RSA_GROUP;
 
 /* ECDSA group values */
 int ecdsa_current_tg = 0;
@@ -294,6 +303,10 @@ static void print_usage(int err) {
     printf("To register a formatted JSON file use:\n");
     printf("      --json <file>\n");
     printf("\n");
+    printf("To process vector sets saved in <vs_dir> without a server, writing\n");
+    printf("the responses to <rsp_dir>, use:\n");
+    printf("      --offline <vs_dir> <rsp_dir>\n");
+    printf("\n");
     printf("If you are running a sample registration (querying for correct answers\n");
     printf("in addition to the normal registration flow) use:\n");
     printf("      --sample\n");
@@ -514,6 +527,22 @@ static int ingest_cli(APP_CONFIG *cfg, int argc, char **argv) {
             strcpy_s(cfg->json_file, JSON_FILENAME_LENGTH + 1, *argv);
         }
 
+        strcmp_s("--offline", strnlen_s("--offline", OPTION_STR_MAX), *argv, &diff);
+        if (!diff) {
+            if (argc < 3) {
+                printf(ANSI_COLOR_RED "Command error... [%s]"ANSI_COLOR_RESET
+                       "\nMissing <vs_dir> <rsp_dir>.\n", "--offline");
+                print_usage(1);
+                return 1;
+            }
+            cfg->offline = 1;
+            cfg->vs_dir = argv[1];
+            cfg->rsp_dir = argv[2];
+            argc -= 2;
+            argv += 2;
+            goto next;
+        }
+
         strcmp_s("--sample", strnlen_s("--sample", OPTION_STR_MAX), *argv, &diff);
         if (!diff) {
             cfg->sample = 1;
@@ -930,6 +959,16 @@ int main(int argc, char **argv) {
         goto end;
     }
 
+    /*
+     * Keep one cipher/digest context per test group instead of
+     * allocating one for every test case
+     */
+    rv = acvp_set_group_hooks(ctx, &app_group_begin, &app_group_end);
+    if (rv != ACVP_SUCCESS) {
+        printf("Failed to set test group hooks\n");
+        goto end;
+    }
+
     if (cfg.sample) {
         acvp_mark_as_sample(ctx);
     }
@@ -1001,6 +1040,19 @@ int main(int argc, char **argv) {
         }
 #endif
     }
+
+    if (cfg.offline) {
+        /*
+         * The vector sets were saved earlier, process them
+         * without registering with the server.
+         */
+        rv = acvp_process_tests_offline(ctx, cfg.vs_dir, cfg.rsp_dir);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to process vector sets offline (%d)\n", rv);
+        }
+        goto end;
+    }
+
     /*
      * Now that we have a test session, we register with
      * the server to advertise our capabilities and receive
@@ -1031,9 +1083,6 @@ int main(int argc, char **argv) {
 
 end:
     if (glb_cipher_ctx) EVP_CIPHER_CTX_free(glb_cipher_ctx);
-    /* free RSA group vals */
-    if (group_rsa) RSA_free(group_rsa);
-    if (group_n) BN_free(group_n);
     /* free DSA group vals */
     if (group_dsa) DSA_free(group_dsa);
     if (group_p) BN_free(group_p);
@@ -2855,7 +2904,7 @@ static int app_des_handler(ACVP_TEST_CASE *test_case) {
     }
 
     /* Begin encrypt code section */
-    cipher_ctx = glb_cipher_ctx;
+    cipher_ctx = test_case->module_group_ctx ? test_case->module_group_ctx : glb_cipher_ctx;
 
     switch (tc->cipher) {
     case ACVP_TDES_ECB:
@@ -2994,7 +3043,7 @@ static int app_aes_handler(ACVP_TEST_CASE *test_case) {
     tc = test_case->tc.symmetric;
 
     /* Begin encrypt code section */
-    cipher_ctx = glb_cipher_ctx;
+    cipher_ctx = test_case->module_group_ctx ? test_case->module_group_ctx : glb_cipher_ctx;
     if ((tc->test_type != ACVP_SYM_TEST_TYPE_MCT)) {
         EVP_CIPHER_CTX_init(cipher_ctx);
     }
@@ -3465,6 +3514,7 @@ static int app_sha_handler(ACVP_TEST_CASE *test_case) {
     ACVP_HASH_TC    *tc;
     const EVP_MD    *md;
     EVP_MD_CTX *md_ctx = NULL;
+    EVP_MD_CTX *own_md_ctx = NULL; /* only when there is no group context */
     /* assume fail */
     int rc = 1;
 
@@ -3502,7 +3552,10 @@ static int app_sha_handler(ACVP_TEST_CASE *test_case) {
         printf("\nCrypto module error, md memory not allocated by library\n");
         goto end;
     }
-    md_ctx = EVP_MD_CTX_create();
+    md_ctx = test_case->module_group_ctx;
+    if (!md_ctx) {
+        md_ctx = own_md_ctx = EVP_MD_CTX_create();
+    }
 
     /* If Monte Carlo we need to be able to init and then update
      * one thousand times before we complete each iteration.
@@ -3555,7 +3608,7 @@ static int app_sha_handler(ACVP_TEST_CASE *test_case) {
     rc = 0;
 
 end:
-    if (md_ctx) EVP_MD_CTX_destroy(md_ctx);
+    if (own_md_ctx) EVP_MD_CTX_destroy(own_md_ctx);
 
     return rc;
 }
@@ -4994,8 +5047,8 @@ err:
  * RSA SigGen handler
  * requires Makefile.fom to function
  *
- * group values are decalred near the top so that they
- * can be freed at the end of main execution
+ * the group key lives in the APP_RSA_GROUP handed out
+ * by app_group_begin()
  */
 static int app_rsa_sig_handler(ACVP_TEST_CASE *test_case) {
     EVP_MD *tc_md = NULL;
@@ -5003,6 +5056,7 @@ static int app_rsa_sig_handler(ACVP_TEST_CASE *test_case) {
     BIGNUM *bn_e = NULL, *e = NULL, *n = NULL;
     ACVP_RSA_SIG_TC    *tc;
     RSA *rsa = NULL;
+    APP_RSA_GROUP *grp = NULL;
     int salt_len = -1;
 
     int rv = 1;
@@ -5113,32 +5167,31 @@ static int app_rsa_sig_handler(ACVP_TEST_CASE *test_case) {
 
         tc->ver_disposition = FIPS_rsa_verify(rsa, tc->msg, tc->msg_len, tc_md, pad_mode, salt_len, NULL, tc->signature, tc->sig_len);
     } else {
-        if (rsa_current_tg != tc->tg_id) {
-            rsa_current_tg = tc->tg_id;
-            if (group_rsa) RSA_free(group_rsa);
-            group_rsa = RSA_new();
-            if (!FIPS_rsa_x931_generate_key_ex(group_rsa, tc->modulo, bn_e, NULL)) {
+        grp = test_case->module_group_ctx;
+        if (!grp) {
+            printf("\nError: no group context in RSA SigGen handler\n");
+            goto err;
+        }
+        if (!grp->rsa) {
+            grp->rsa = RSA_new();
+            if (!grp->rsa || !FIPS_rsa_x931_generate_key_ex(grp->rsa, tc->modulo, bn_e, NULL)) {
                 printf("\nError: Issue with keygen during siggen handling\n");
                 goto err;
             }
+        }
 #if OPENSSL_VERSION_NUMBER <= 0x10100000L
-            e = group_rsa->e;
-            n = group_rsa->n;
-            group_n = BN_dup(n);
+        e = grp->rsa->e;
+        n = grp->rsa->n;
 #else
-            RSA_get0_key(rsa, (const BIGNUM **)&n, (const BIGNUM **)&e, NULL);
+        RSA_get0_key(grp->rsa, (const BIGNUM **)&n, (const BIGNUM **)&e, NULL);
 #endif
-        } else {
-            e = BN_dup(bn_e);
-            n = BN_dup(group_n);
-        }
         tc->e_len = BN_bn2bin(e, tc->e);
         tc->n_len = BN_bn2bin(n, tc->n);
 
         if (tc->msg && tc_md) {
-            siglen = RSA_size(group_rsa);
+            siglen = RSA_size(grp->rsa);
 
-            if (!FIPS_rsa_sign(group_rsa, tc->msg, tc->msg_len, tc_md, pad_mode, salt_len, NULL,
+            if (!FIPS_rsa_sign(grp->rsa, tc->msg, tc->msg_len, tc_md, pad_mode, salt_len, NULL,
                                tc->signature, (unsigned int *)&siglen)) {
                 printf("\nError: RSA Signature Generation fail\n");
                 goto err;
@@ -5561,6 +5614,42 @@ end:
     return len;
 }
 
+/*
+ * AES/TDES groups get an EVP_CIPHER_CTX, hash groups an EVP_MD_CTX and
+ * RSA SigGen groups an APP_RSA_GROUP, handed back to the handlers in
+ * test_case->module_group_ctx.
+ */
+static int app_group_begin(ACVP_CIPHER cipher, void *vs_ctx, void **group_ctx) {
+    if (cipher >= ACVP_AES_GCM && cipher <= ACVP_TDES_KW) {
+        *group_ctx = EVP_CIPHER_CTX_new();
+    } else if (cipher >= ACVP_HASH_SHA1 && cipher <= ACVP_HASH_SHA512) {
+        *group_ctx = EVP_MD_CTX_create();
+    } else if (cipher == ACVP_RSA_SIGGEN) {
+        *group_ctx = calloc(1, sizeof(APP_RSA_GROUP));
+    } else {
+        return 0;
+    }
+    if (!*group_ctx) {
+        printf("Failed to allocate test group context\n");
+        return 1;
+    }
+    return 0;
+}
+
+static void app_group_end(ACVP_CIPHER cipher, void *vs_ctx, void *group_ctx) {
+    if (!group_ctx) {
+        return;
+    }
+    if (cipher >= ACVP_AES_GCM && cipher <= ACVP_TDES_KW) {
+        EVP_CIPHER_CTX_free(group_ctx);
+    } else if (cipher >= ACVP_HASH_SHA1 && cipher <= ACVP_HASH_SHA512) {
+        EVP_MD_CTX_destroy(group_ctx);
+    } else if (cipher == ACVP_RSA_SIGGEN) {
+        if (((APP_RSA_GROUP *)group_ctx)->rsa) RSA_free(((APP_RSA_GROUP *)group_ctx)->rsa);
+        free(group_ctx);
+    }
+}
+
 static ACVP_RESULT totp(char **token, int token_max) {
     char hash[MAX_LEN] = {0};
     int os, bin, otp;
@@ -643,6 +643,10 @@ typedef struct acvp_sym_cipher_tc_t {
     unsigned int mct_index;  /* used to identify init vs. update */
     unsigned int incr_ctr;
     unsigned int ovrflw_ctr;
+    unsigned int mct_count;  /* inner iterations to run in the mct_handler */
+    unsigned int mct_row_len; /* bytes between entries of mct_pt/mct_ct */
+    unsigned char *mct_pt;   /* pt of each inner iteration, set by the mct_handler */
+    unsigned char *mct_ct;   /* ct of each inner iteration, set by the mct_handler */
 } ACVP_SYM_CIPHER_TC;
 
 /*!
@@ -675,6 +679,7 @@ typedef struct acvp_hash_tc_t {
     unsigned int msg_len;
     unsigned char *md; /* The resulting digest calculated for the test case */
     unsigned int md_len;
+    unsigned int mct_count; /* inner iterations to run in the mct_handler */
 } ACVP_HASH_TC;
 
 /*!
@@ -1029,6 +1034,10 @@ typedef struct acvp_ecdsa_tc_t {
  * test case for RSA signature testing. Both siggen and sigver
  * use this struct in their testing. This data is
  * passed between libacvp and the crypto module.
+ *
+ * msg, and for sigver e, n and signature, may point straight into
+ * the parsed vector set and are shared with later test cases, so
+ * the crypto module must only read them.
  */
 typedef struct acvp_rsa_sig_tc_t {
     unsigned int tc_id; /* Test case id */
@@ -1038,15 +1047,15 @@ typedef struct acvp_rsa_sig_tc_t {
     ACVP_HASH_ALG hash_alg;
     ACVP_RSA_SIG_TYPE sig_type;
     unsigned int modulo;
-    unsigned char *e;
+    unsigned char *e;         /* read only for sigver */
     int e_len;
-    unsigned char *n;
+    unsigned char *n;         /* read only for sigver */
     int n_len;
     char *salt;
     int salt_len;
-    unsigned char *msg;
+    unsigned char *msg;       /* read only */
     int msg_len;
-    unsigned char *signature;
+    unsigned char *signature; /* read only for sigver */
     int sig_len;
     ACVP_CIPHER sig_mode;
     ACVP_TEST_DISPOSITION ver_disposition; /**< Indicates pass/fail (only in "verify" direction)*/
@@ -1083,6 +1092,9 @@ typedef enum acvp_dsa_gen_parm {
  * @brief This struct holds data that represents a single test
  * case for DSA testing.  This data is
  * passed between libacvp and the crypto module.
+ *
+ * For pqgVer, p, q, g and seed may point straight into the parsed
+ * vector set, so the crypto module must only read them.
  */
 /*! @struct ACVP_DSA_TC */
 typedef struct acvp_dsa_tc_t {
@@ -1117,7 +1129,7 @@ typedef struct acvp_dsa_tc_t {
     int r_len;
     unsigned char *s;
     int s_len;
-    unsigned char *seed;
+    unsigned char *seed; /* read only, like p, q and g for pqgVer */
     unsigned char *msg;
 } ACVP_DSA_TC;
 
@@ -1278,6 +1290,10 @@ typedef enum acvp_kas_ffc_test_type {
  * @brief This struct holds data that represents a single test
  * case for KAS-FFC testing.  This data is
  * passed between libacvp and the crypto module.
+ *
+ * p, q, g and eps, and for VAL tests epri, epui and z, may point
+ * straight into the parsed vector set and are shared with later
+ * test cases, so the crypto module must only read them.
  */
 /*! @struct ACVP_KAS_FFC_TC */
 typedef struct acvp_kas_ffc_tc_t {
@@ -1285,14 +1301,14 @@ typedef struct acvp_kas_ffc_tc_t {
     ACVP_KAS_FFC_TEST_TYPE test_type;
     ACVP_HASH_ALG md;
     ACVP_KAS_FFC_MODE mode;
-    unsigned char *p;
-    unsigned char *q;
-    unsigned char *g;
+    unsigned char *p;    /* read only */
+    unsigned char *q;    /* read only */
+    unsigned char *g;    /* read only */
     unsigned char *d;
-    unsigned char *eps;
-    unsigned char *epri;
-    unsigned char *epui;
-    unsigned char *z;
+    unsigned char *eps;  /* read only */
+    unsigned char *epri; /* read only for VAL */
+    unsigned char *epui; /* read only for VAL */
+    unsigned char *z;    /* read only for VAL */
     unsigned char *chash;
     unsigned char *piut;
     int plen;
@@ -1368,6 +1384,8 @@ typedef struct acvp_test_case_t {
         ACVP_KAS_ECC_TC *kas_ecc;
         ACVP_KAS_FFC_TC *kas_ffc;
     } tc;
+    void *module_vs_ctx;    /* from the vs_begin hook, NULL if not set */
+    void *module_group_ctx; /* from the group_begin hook, NULL if not set */
 } ACVP_TEST_CASE;
 
 /*
@@ -1398,6 +1416,8 @@ enum acvp_result {
     ACVP_DUPLICATE_CTX,
     ACVP_JWT_EXPIRED,
     ACVP_JWT_INVALID,
+    ACVP_CANCELLED,
+    ACVP_IN_PROGRESS,    /**< Asynchronous processing is still running, see acvp_wait() */
     ACVP_RESULT_MAX
 };
 
@@ -2389,6 +2409,71 @@ ACVP_RESULT acvp_cap_kdf108_set_domain(ACVP_CTX *ctx,
                                        int max,
                                        int increment);
 
+/*! @brief acvp_cap_set_batch_handler() allows an application to have all
+       test cases of a test group handed to the crypto module in one call.
+
+    This is optional.  It is meant for modules that can amortize setup
+    across test cases, such as hardware queues or multi-buffer engines.
+    The capability must already have been enabled.  Batching is
+    available for AES (except Monte Carlo tests), hash (except Monte
+    Carlo tests), HMAC and CMAC.  Test groups that can't be batched keep
+    using the per test case crypto_handler.  All test cases of a group
+    are held at once, so for AES their buffers are sized from the
+    group's lengths: pt and ct hold the payload plus 16 bytes (room for
+    KW/KWP wrapping and the CCM tag), iv, tag and aad the lengths the
+    group gives, and iv at least one block.  For hash, msg holds just the
+    message and m1, m2 and m3 are NULL, as they are only used by Monte
+    Carlo tests.
+
+    @param ctx Address of pointer to a previously allocated ACVP_CTX.
+    @param cipher ACVP_CIPHER enum value identifying the crypto capability.
+    @param batch_handler Address of function implemented by application that
+       processes count test cases at once.  results[i] must be set to what the
+       crypto_handler would have returned for test_cases[i].  The function is
+       expected to return 0 on success and 1 if the whole batch failed.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_cap_set_batch_handler(ACVP_CTX *ctx,
+                                       ACVP_CIPHER cipher,
+                                       int (*batch_handler)(ACVP_TEST_CASE *test_cases,
+                                                            int *results,
+                                                            int count));
+
+/*! @brief acvp_cap_set_mct_handler() allows an application to run the
+       inner loop of a Monte Carlo test inside the crypto module.
+
+    This is optional.  Without it the crypto_handler is called once per
+    inner iteration (1000 for AES and SHA, 10000 for TDES).  With it the
+    mct_handler is called once per outer iteration and can keep a single
+    cipher or digest context for the whole inner loop.  The capability must
+    already have been enabled.  Supported for the AES and TDES modes that
+    have Monte Carlo tests, and for SHA-1/SHA-2.
+
+    On entry the test case holds the key, iv and pt/ct (or m1/m2/m3) for the
+    outer iteration and mct_count is the number of inner iterations.  The
+    module chains the iterations the same way libacvp does between
+    crypto_handler calls and then:
+       - AES/TDES: stores the pt and ct of inner iteration j at
+         mct_pt + j * mct_row_len and mct_ct + j * mct_row_len (the first
+         byte only for CFB1/CFB8) and sets ct_len/pt_len as the
+         crypto_handler would.  TDES also sets iv_ret and iv_ret_after as
+         the crypto_handler would for the last iteration.
+       - SHA: leaves the digest of the last iteration in md.
+    libacvp derives the next outer iteration from these values.
+
+    @param ctx Address of pointer to a previously allocated ACVP_CTX.
+    @param cipher ACVP_CIPHER enum value identifying the crypto capability.
+    @param mct_handler Address of function implemented by application that
+       runs the inner loop.  It is expected to return 0 on success and 1 on
+       failure.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_cap_set_mct_handler(ACVP_CTX *ctx,
+                                     ACVP_CIPHER cipher,
+                                     int (*mct_handler)(ACVP_TEST_CASE *test_case));
+
 /*! @brief acvp_enable_prereq_cap() allows an application to specify a
        prerequisite for a cipher capability that was previously registered.
 
@@ -2404,6 +2489,44 @@ ACVP_RESULT acvp_cap_set_prereq(ACVP_CTX *ctx,
                                 ACVP_PREREQ_ALG pre_req_cap,
                                 char *value);
 
+/*! @brief acvp_init_lib() prepares libacvp for several test sessions
+      in one process.
+
+    Each module build still gets its own ACVP_CTX, registration and
+    acvp_process_tests() or acvp_process_tests_async() run, and these
+    may now go on at the same time.  Call this once before creating the
+    contexts.  The HTTP library is then initialized only here, and all
+    sessions share one cache of TLS sessions and DNS lookups, and with
+    max_conns one pool of connections, instead of each keeping its
+    own.  max_workers bounds the vector sets being processed at once
+    across all sessions, on top of each session's
+    acvp_set_max_concurrency(), so dozens of sessions can be started
+    without oversubscribing the CPUs.  With acvp_set_pipeline_depth(),
+    each download and upload counts as well as each computation.
+    Calls nest; each one needs a matching acvp_cleanup_lib().
+
+    @param max_workers Most vector sets in progress across all
+        sessions, 0 for no limit.
+    @param max_conns Most connections open to ACVP servers at once
+        across all sessions, 0 for no limit.  The connections are
+        pooled and a request waits for one to be free when all are in
+        use.  Without a limit every vector set being processed keeps
+        a connection of its own.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_init_lib(int max_workers, int max_conns);
+
+/*! @brief acvp_cleanup_lib() undoes acvp_init_lib().
+
+    Every context must have been released with acvp_free_test_session()
+    before the last call.  acvp_cleanup() leaves the HTTP library alone
+    while acvp_init_lib() is in effect.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_cleanup_lib(void);
+
 /*! @brief acvp_create_test_session() creates a context that can be used to
       commence a test session with an ACVP server.
 
@@ -2569,6 +2692,174 @@ ACVP_RESULT acvp_mark_as_sample(ACVP_CTX *ctx);
  */
 ACVP_RESULT acvp_register(ACVP_CTX *ctx);
 
+/*! @brief acvp_set_max_concurrency() sets the number of vector sets
+    processed in parallel.
+
+    By default libacvp downloads, processes and uploads one vector
+    set at a time.  When max is greater than one, acvp_process_tests()
+    will run a pool of up to max worker threads, each working on its
+    own vector set.  The crypto handlers registered with the
+    acvp_enable_*_cap() functions must be safe to call from several
+    threads at once when this is enabled.  Not available on Windows.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param max Maximum number of vector sets to process at once,
+        between 1 and 32.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_max_concurrency(ACVP_CTX *ctx, int max);
+
+/*! @brief acvp_set_pipeline_depth() overlaps the network transfers of
+    a test session with the crypto work.
+
+    When depth is non-zero, acvp_process_tests() downloads vector sets
+    ahead on one thread and uploads finished responses on another, so
+    that the crypto module only waits on the server when it gets ahead
+    of the downloads.  Up to depth vector sets are held between the
+    download and compute stages, and as many again between compute and
+    upload.  The compute stage runs acvp_set_max_concurrency() threads.
+    Vector sets are parsed in full before they are processed rather
+    than as they arrive.  Not available on Windows.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param depth Vector sets to queue between stages, between 0 (no
+        pipeline, the default) and 16.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_pipeline_depth(ACVP_CTX *ctx, int depth);
+
+/*! @brief acvp_set_retry_limit() bounds how often libacvp asks the server
+    for something it isn't ready with yet.
+
+    When the server answers a vector set download with "retry", the
+    vector set is put aside and the other vector sets are processed
+    until it is due again.  The wait starts at the server's hint and
+    doubles on each further "retry", up to 60 seconds.  Incomplete test
+    session results are polled with the same backoff.  By default this
+    goes on until the server is ready.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param max_attempts Requests to make for one vector set, or for the
+        session results, before giving up with ACVP_KAT_DOWNLOAD_RETRY.
+        0 means no limit.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_retry_limit(ACVP_CTX *ctx, int max_attempts);
+
+/*! @brief acvp_set_vs_cache_dir() keeps a copy of every vector set
+    downloaded in the session in a local directory.
+
+    Each vector set is saved to dir under its vsId once it has been
+    downloaded in full, in a compact binary form with its hex values
+    already decoded and an index of its test groups.  When a vector set
+    is in the cache, acvp_process_tests() processes that copy instead of
+    downloading and parsing it again, so a session that was interrupted
+    can be rerun without going back to the server for its vector sets.
+    The cache files, named after the vsId and ending in ".vsc", can be
+    replayed with acvp_process_tests_offline().  They are only readable
+    on the machine that wrote them.  Not available on
+    Windows.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param dir Existing directory to keep the vector sets in.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_vs_cache_dir(ACVP_CTX *ctx, const char *dir);
+
+/*! @brief acvp_set_session_file() saves the test session to a local
+    file so that a restarted process can reattach to it.
+
+    Once acvp_register() has registered a test session, the session URL,
+    the access token with its expiry and the vector set URLs are written
+    to file, readable only by its owner.  The file is rewritten whenever
+    the token is refreshed.  When file already holds an unfinished
+    session for the same server, registered with the capabilities now
+    enabled on ctx, acvp_register() reattaches to that session instead
+    of logging in and registering the capabilities again, and only logs
+    in to refresh the token if it has expired.  Once the session's
+    results are in, the file is removed if it passed and otherwise
+    marked finished, so the next run registers a new test session.
+    Remove the file to start a new test session sooner.  Pairs well with acvp_resume_session().  Not
+    available on Windows.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param file Path of the session file.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_session_file(ACVP_CTX *ctx, const char *file);
+
+/*! @brief acvp_set_vs_hooks() registers callbacks that run when libacvp
+    starts and finishes processing a vector set.
+
+    This is optional.  vs_begin is called before the first test case of a
+    vector set is handed to the crypto module and may store a context of
+    its own in *module_vs_ctx.  That pointer is passed to the crypto
+    handlers in ACVP_TEST_CASE.module_vs_ctx for every test case of the
+    vector set, and to vs_end once the vector set is done, including when
+    processing stopped on an error.  With acvp_set_max_concurrency() the
+    hooks run on the worker thread that owns the vector set.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param vs_begin Called with the cipher of the vector set.  Returns 0
+        on success and 1 to fail the vector set.
+    @param vs_end Releases what vs_begin set up.  May be NULL.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_vs_hooks(ACVP_CTX *ctx,
+                              int (*vs_begin)(ACVP_CIPHER cipher, void **module_vs_ctx),
+                              void (*vs_end)(ACVP_CIPHER cipher, void *module_vs_ctx));
+
+/*! @brief acvp_set_group_hooks() registers callbacks that run around each
+    test group.
+
+    This is optional.  group_begin is called before the first test case
+    of a test group and may store a context in *module_group_ctx, for
+    instance a digest context or a key shared by the group.  The crypto
+    handlers see it in ACVP_TEST_CASE.module_group_ctx until group_end is
+    called at the end of the group.  Test cases of a group are all
+    processed before the next group begins.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param group_begin Called with the cipher and the vector set context.
+        Returns 0 on success and 1 to fail the vector set.
+    @param group_end Releases what group_begin set up.  May be NULL.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_group_hooks(ACVP_CTX *ctx,
+                                 int (*group_begin)(ACVP_CIPHER cipher, void *module_vs_ctx,
+                                                    void **module_group_ctx),
+                                 void (*group_end)(ACVP_CIPHER cipher, void *module_vs_ctx,
+                                                   void *module_group_ctx));
+
+/*! @brief acvp_get_handshakes_avoided() reports how many HTTP requests
+    reused an already open connection to the server.
+
+    libacvp keeps the connection to the ACVP server open between
+    requests.  Each request sent over a connection left open by an
+    earlier one saves a TCP and TLS handshake.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param count Set to the number of requests that reused a connection.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_get_handshakes_avoided(ACVP_CTX *ctx, int *count);
+
 /*! @brief acvp_process_tests() performs the ACVP testing procedures.
 
     This function will commence the test session after the DUT has
@@ -2577,6 +2868,15 @@ ACVP_RESULT acvp_register(ACVP_CTX *ctx);
     will download the vector sets from the ACVP server, process the
     vectors, and upload the results to the server.
 
+    Unless acvp_set_pipeline_depth() is used, each test group is
+    processed as soon as it has been received, while the rest of its
+    vector set is still being downloaded.  The crypto handlers are then
+    called from within the HTTP client's receive callback: the download
+    stalls until they return, and they must not call back into libacvp
+    for the same ctx, except for acvp_cancel().  A server that drops
+    connections left idle for long may need acvp_set_pipeline_depth(),
+    which downloads whole vector sets before any handler runs.
+
     @param ctx Pointer to ACVP_CTX that was previously created by
         calling acvp_create_test_session.
 
@@ -2584,6 +2884,130 @@ ACVP_RESULT acvp_register(ACVP_CTX *ctx);
  */
 ACVP_RESULT acvp_process_tests(ACVP_CTX *ctx);
 
+/*
+ * Reported for every vector set libacvp is done with when processing
+ * with acvp_process_tests_async()
+ */
+typedef struct acvp_vs_status_t {
+    const char *vsid_url;  /* vector set URL from the session */
+    int vs_id;             /* 0 if the vector set was never received */
+    const char *algorithm; /* NULL if the vector set was never received */
+    const char *mode;      /* NULL unless the algorithm has modes */
+    int tc_count;          /* test cases in the vector set */
+    long elapsed_ms;       /* from the last download attempt to the upload */
+    ACVP_RESULT result;
+} ACVP_VS_STATUS;
+
+/*! @brief acvp_process_tests_async() starts acvp_process_tests() on a
+    thread of its own and returns right away.
+
+    vs_done_cb is called once for each vector set as it is uploaded or
+    fails, with a status that is only valid during the call.  Calls are
+    not made at the same time, but may come from any libacvp thread, so
+    the callback should hand the status over to the application's own
+    event loop rather than do real work.  Use acvp_wait() to collect the
+    result of the whole run and acvp_cancel() to stop it early.  The
+    ACVP_CTX must not be otherwise used until acvp_wait() has returned
+    ACVP_SUCCESS.  Not available on Windows.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param vs_done_cb Called as each vector set finishes.  May be NULL.
+    @param arg Passed to vs_done_cb.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_process_tests_async(ACVP_CTX *ctx,
+                                     void (*vs_done_cb)(ACVP_CTX *ctx, const ACVP_VS_STATUS *status, void *arg),
+                                     void *arg);
+
+/*! @brief acvp_cancel() asks a running acvp_process_tests() or
+    acvp_process_tests_async() to stop.
+
+    No further vector sets are started and streamed downloads stop at
+    the next test group.  Vector sets that are already computed are
+    still uploaded.  Those that acvp_set_pipeline_depth() downloaded
+    ahead are dropped and reported to the vs_done_cb with
+    ACVP_CANCELLED.  The run then ends with ACVP_CANCELLED.  Safe to
+    call from any thread.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_cancel(ACVP_CTX *ctx);
+
+/*! @brief acvp_wait() waits for acvp_process_tests_async() to finish.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param timeout_ms How long to wait, 0 to only check, or -1 to wait
+        until processing is done.
+    @param result Set to what acvp_process_tests() returned once
+        processing is done.
+
+    @return ACVP_SUCCESS when processing is done, ACVP_IN_PROGRESS if
+        it is still running after timeout_ms, ACVP_NO_DATA if nothing
+        was started.
+ */
+ACVP_RESULT acvp_wait(ACVP_CTX *ctx, int timeout_ms, ACVP_RESULT *result);
+
+/*! @brief acvp_resume_session() processes the test session like
+    acvp_process_tests(), keeping a journal of its progress so that an
+    interrupted run can pick up where it stopped.
+
+    The journal is a text file that lines are only appended to: the
+    test session URL, then a line for each vector set URL as its
+    response is computed, uploaded or fails.  Each computed response is
+    also kept next to the journal as "<journal>.<vsId>.json".  Calling
+    acvp_resume_session() again with the same journal skips the vector
+    sets that were uploaded, sends the saved responses of those that
+    were computed but not known to be uploaded, even if sending them
+    failed before, and processes the rest.
+    A response may thus be sent twice if the process died right after
+    sending it.  The journal and the saved responses are left for the
+    application to remove once the session passed.  A journal that
+    doesn't exist yet is created, one written for another test session
+    is refused.  A restarted process gets back to the same test session
+    through acvp_set_session_file().  Not available on Windows.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session and registered with the
+        server.
+    @param journal Path of the journal file.
+
+    @return ACVP_RESULT, the first failure if any vector set failed
+ */
+ACVP_RESULT acvp_resume_session(ACVP_CTX *ctx, const char *journal);
+
+/*! @brief acvp_process_tests_offline() processes vector sets that were
+    saved to disk, without an ACVP server.
+
+    Every file in vs_dir whose name ends in ".json" is parsed as a
+    vector set, in the form the server returns it from the vector set
+    URL, and run through the same handlers as acvp_process_tests().
+    The response for each one is written to rsp_dir under the same
+    file name, with the contents that would otherwise be uploaded.
+    Files of an acvp_set_vs_cache_dir() cache, ending in ".vsc", are
+    read as well, and their responses get names ending in ".json".
+    No login, registration or network access takes place, so this is
+    useful for repeatable benchmarking of the library and the crypto
+    handlers.  The capabilities still need to be enabled on the ctx.
+    acvp_set_max_concurrency() applies here as well.  A file that fails
+    doesn't stop the others from being processed.  Not available on
+    Windows.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param vs_dir Directory holding the vector set files.
+    @param rsp_dir Directory the response files are written to; it
+        must already exist and can't be vs_dir.
+
+    @return ACVP_RESULT, the first failure if any file failed
+ */
+ACVP_RESULT acvp_process_tests_offline(ACVP_CTX *ctx, const char *vs_dir, const char *rsp_dir);
+
 /*! @brief acvp_set_vendor_info() specifies the vendor attributes
     for the test session.
 
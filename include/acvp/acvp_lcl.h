@@ -28,6 +28,10 @@
 
 #include "parson.h"
 
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
 #define ACVP_VERSION    "0.5"
 #define ACVP_LIBRARY_VERSION    "libacvp-1.0.0"
 
@@ -559,28 +563,80 @@
  * END RSA
  */
 
-#define ACVP_KAT_BUF_MAX        1024 * 1024 * 4
-#define ACVP_ANS_BUF_MAX        1024 * 1024 * 4
-#define ACVP_REG_BUF_MAX        1024 * 128
+#define ACVP_HTTP_BODY_SIZE_MIN 1024 /* first allocation when the body size is not known */
 #define ACVP_RETRY_TIME_MAX     60 /* seconds */
+#define ACVP_RESULT_POLL_MIN    5  /* seconds, first wait for incomplete session results */
+#define ACVP_CANCEL_POLL_MS     100 /* longest a wait goes without checking for acvp_cancel() */
 #define ACVP_JWT_TOKEN_MAX      1024
+#define ACVP_JWT_EXPIRY_MARGIN  60 /* seconds; a saved token closer to expiry is refreshed first */
 #define ACVP_ATTR_URL_MAX       2083 /* MS IE's limit - arbitrary */
 
 #define ACVP_SESSION_PARAMS_STR_LEN_MAX 256
 #define ACVP_PATH_SEGMENT_DEFAULT ""
 #define ACVP_JSON_FILENAME_MAX 24
+#define ACVP_VS_PATH_MAX 1024 /* vector set and response files for offline processing */
+#define ACVP_VS_CACHE_SUFFIX ".vsc" /* vector sets kept by acvp_set_vs_cache_dir */
+#define ACVP_VS_CACHE_NAME_MAX 24   /* "/<vsId>.vsc.tmp" in the cache directory */
+#define ACVP_JOURNAL_RSP_NAME_MAX 24 /* ".<vsId>.json.tmp" after the journal name */
+#define ACVP_JOURNAL_LINE_MAX (ACVP_ATTR_URL_MAX + 32)
 
 #define ACVP_CFB1_BIT_MASK      0x80
 
+#define ACVP_MAX_CONCURRENCY    32 /* upper bound for acvp_set_max_concurrency */
+#define ACVP_MAX_PIPELINE_DEPTH 16 /* upper bound for acvp_set_pipeline_depth */
+#define ACVP_CACHE_LINE_LEN     64
+
+/*
+ * Locks guarding state shared between vector set workers.  The
+ * worker pool is only built on platforms with pthreads, elsewhere
+ * vector sets are processed serially and these compile away.
+ */
+#ifdef WIN32
+#define ACVP_LOCK_DECLARE(name) static int name
+#define ACVP_LOCK(name)
+#define ACVP_UNLOCK(name)
+#else
+#define ACVP_LOCK_DECLARE(name) static pthread_mutex_t name = PTHREAD_MUTEX_INITIALIZER
+#define ACVP_LOCK(name) pthread_mutex_lock(&(name))
+#define ACVP_UNLOCK(name) pthread_mutex_unlock(&(name))
+#endif
+
+/*
+ * One-time initialization of process wide tables.
+ */
+#ifdef WIN32
+#define ACVP_ONCE_DECLARE(name) static int name
+#define ACVP_ONCE(name, fn) do { if (!(name)) { (name) = 1; fn(); } } while (0)
+#else
+#define ACVP_ONCE_DECLARE(name) static pthread_once_t name = PTHREAD_ONCE_INIT
+#define ACVP_ONCE(name, fn) pthread_once(&(name), fn)
+#endif
+
+typedef struct acvp_vs_ctx_t ACVP_VS_CTX;
+
+/*
+ * Bump allocator for memory that lives exactly as long as one vector
+ * set (or one test case).  Nothing is returned until acvp_arena_reset(),
+ * which keeps the largest chunk around for the next vector set.
+ */
+#define ACVP_ARENA_CHUNK_MIN (64 * 1024)
+
+typedef struct acvp_arena_chunk_t ACVP_ARENA_CHUNK;
+
+typedef struct acvp_arena_t {
+    ACVP_ARENA_CHUNK *chunks; /* most recently added first */
+} ACVP_ARENA;
+
 typedef struct acvp_alg_handler_t ACVP_ALG_HANDLER;
 
 struct acvp_alg_handler_t {
     ACVP_CIPHER cipher;
 
-    ACVP_RESULT (*handler) (ACVP_CTX *ctx, JSON_Object *obj);
+    ACVP_RESULT (*handler) (ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
     char *name;
     char *mode; /** < Should be NULL unless using an asymmetric alg */
+    const char * const *hex_fields; /* members the parser decodes from hex, NULL terminated */
 };
 
 typedef struct acvp_vs_list_t {
@@ -995,6 +1051,8 @@ typedef struct acvp_caps_list_t {
     } cap;
 
     int (*crypto_handler)(ACVP_TEST_CASE *test_case);
+    int (*batch_handler)(ACVP_TEST_CASE *test_cases, int *results, int count);
+    int (*mct_handler)(ACVP_TEST_CASE *test_case);
 
     struct acvp_caps_list_t *next;
 } ACVP_CAPS_LIST;
@@ -1010,6 +1068,16 @@ typedef struct acvp_dependency_list_t {
     struct acvp_dependency_list_t *next;
 } ACVP_DEPENDENCY_LIST;
 
+/*
+ * An HTTP response body.  The buffer grows as data arrives and
+ * is kept NUL terminated so it can be handed to the JSON parser.
+ */
+typedef struct acvp_http_body_t {
+    char *data;
+    size_t len;  /* bytes received */
+    size_t size; /* bytes allocated for data */
+} ACVP_HTTP_BODY;
+
 /*
  * This struct holds all the global data for a test session, such
  * as the server name, port#, etc.  Some of the values in this
@@ -1056,6 +1124,7 @@ struct acvp_ctx_t {
 
     /* crypto module capabilities list */
     ACVP_CAPS_LIST *caps_list;
+    ACVP_CAPS_LIST *caps_by_cipher[ACVP_CIPHER_END]; /* same entries, indexed by ACVP_CIPHER */
 
     /* application callbacks */
     ACVP_RESULT (*test_progress_cb) (char *msg);
@@ -1063,20 +1132,107 @@ struct acvp_ctx_t {
     /* Two-factor authentication callback */
     ACVP_RESULT (*totp_cb) (char **token, int token_max);
 
-    /* Transitory values */
+    /* Optional crypto module lifecycle hooks */
+    int (*vs_begin_cb) (ACVP_CIPHER cipher, void **module_vs_ctx);
+    void (*vs_end_cb) (ACVP_CIPHER cipher, void *module_vs_ctx);
+    int (*group_begin_cb) (ACVP_CIPHER cipher, void *module_vs_ctx, void **module_group_ctx);
+    void (*group_end_cb) (ACVP_CIPHER cipher, void *module_vs_ctx, void *module_group_ctx);
+
+    int max_concurrency;  /* number of vector sets processed in parallel */
+    int pipeline_depth;   /* vector sets queued between download, compute and upload, 0 if not pipelined */
+    int retry_limit;      /* most requests for a vector set or results that aren't ready, 0 for no limit */
+    char *vs_cache_dir;   /* where downloaded vector sets are kept, NULL if they aren't */
+    FILE *journal;        /* acvp_resume_session() progress, NULL outside of it */
+    char *journal_path;
+    char *session_file;   /* where the test session is saved for acvp_register() to reattach to */
+    unsigned long long session_reg_sum; /* acvp_checksum() of the registration it was saved for */
+    int session_completed; /* the saved session's results are in, don't reattach */
+
+    /* acvp_process_tests_async() state */
+    void (*vs_done_cb) (ACVP_CTX *ctx, const ACVP_VS_STATUS *status, void *arg);
+    void *vs_done_arg;
+    volatile int cancel;  /* set by acvp_cancel(), read by the workers */
+#ifndef WIN32
+    pthread_t async_thread;
+    pthread_mutex_t async_lock;
+    pthread_cond_t async_cond;
+#endif
+    int async_started;
+    int async_done;       /* protected by async_lock */
+    ACVP_RESULT async_rv;
+
+    /* HTTP connection cache */
+    void *http_hnd;         /* handle kept open for session level requests */
+    void *http_share;       /* TLS sessions shared by all handles of the session */
+    int handshakes_avoided; /* requests that reused an open connection */
+
+    /*
+     * Transitory values for session level requests.  Per vector set
+     * state lives on the ACVP_VS_CTX instead.
+     */
     char *login_buf;      /* holds the 2-FA authentication response */
-    char *reg_buf;        /* holds the JSON registration response */
-    char *kat_buf;        /* holds the current set of vectors being processed */
-    char *upld_buf;       /* holds the HTTP response from server when uploading results */
-    JSON_Value *kat_resp; /* holds the current set of vector responses */
-    int read_ctr;         /* used during curl processing */
-    char *test_sess_buf;
-    char *sample_buf;
-    int vs_id;      /* vs_id currently being processed */
-    char *vsid_url; /* vs currently being processed */
+    ACVP_HTTP_BODY reg_buf;       /* holds the JSON registration response */
+    ACVP_HTTP_BODY test_sess_buf; /* holds the test session results */
+    ACVP_HTTP_BODY sample_buf;    /* holds the expected answers of a sample vector set */
     char *ans_buf;  /* holds the queried answers on a sample registration */
 };
 
+/*
+ * A vector set on its way to the vector set cache.  The test groups
+ * are written to a temporary file as they are parsed, the rest of the
+ * vector set follows once it is complete.
+ */
+typedef struct acvp_vs_cache_t {
+    char path[ACVP_VS_PATH_MAX + 1];
+    int vs_id;
+    FILE *fp;                 /* temporary file, NULL while nothing is being cached */
+    unsigned char *buf;       /* binary form of the group being written */
+    size_t buf_size;
+    unsigned long long len;   /* bytes written to fp */
+    unsigned long long sum;   /* checksum of those bytes */
+    unsigned long long *ends; /* where each group ends in fp */
+    int count;
+    int capacity;
+    JSON_Value *groups;       /* parsed groups kept for the caller */
+} ACVP_VS_CACHE;
+
+/*
+ * Work context for a single vector set.  One of these is created
+ * for each vector set being processed and handed to the alg_tbl[]
+ * handlers and the transport, so that the ACVP_CTX stays read-only
+ * while vector sets are in flight and can be shared between workers.
+ */
+struct acvp_vs_ctx_t {
+    ACVP_CTX *ctx;        /* session the vector set belongs to */
+    ACVP_HTTP_BODY kat_buf;  /* error response to a vector set download */
+    ACVP_HTTP_BODY upld_buf; /* holds the HTTP response from server when uploading results */
+    JSON_Value *kat_resp; /* holds the current set of vector responses */
+    int vs_id;            /* vs_id currently being processed */
+    char *vsid_url;       /* vs currently being processed */
+    void *http_hnd;       /* connection kept open for this work context */
+    JSON_Stream *kat_stream; /* parses the vector set while it downloads */
+    int groups_done;         /* test groups already answered from kat_stream */
+    JSON_Value *deferred_groups; /* test groups streamed before the algorithm and vsId */
+    const char * const *hex_fields; /* of the vector set being parsed */
+    int hex_fields_known;           /* hex_fields has been looked up */
+    ACVP_RESULT stream_rv;   /* first handler failure seen while streaming */
+    ACVP_ARENA json_arena;   /* parson nodes of the vector set and its response */
+    ACVP_ARENA tc_arena;     /* scratch buffers of the current test case */
+    ACVP_CIPHER module_cipher; /* cipher the module contexts below belong to */
+    int module_vs_open;        /* vs_begin hook has run for this vector set */
+    int module_group_open;     /* group_begin hook has run for the current group */
+    void *module_vs_ctx;       /* set by the vs_begin hook */
+    void *module_group_ctx;    /* set by the group_begin hook */
+    unsigned int retry_period; /* server's "retry" hint when the vector set wasn't ready */
+    const char *algorithm;     /* of the vector set, points into its JSON */
+    const char *mode;
+    int tc_count;              /* test cases dispatched so far */
+    long long start_ms;        /* when work on the vector set started */
+    char *rsp_data;            /* response serialized ahead of the upload, not owned */
+    int rsp_len;
+    ACVP_VS_CACHE cache;       /* groups on their way to the vector set cache */
+};
+
 ACVP_RESULT acvp_send_test_session_registration(ACVP_CTX *ctx, char *reg, int len);
 
 #if 0 /* Needs to be refactored to provide data length for underlying functions
@@ -1092,7 +1248,7 @@ ACVP_RESULT acvp_send_dep_registration(ACVP_CTX *ctx, char *reg);
 
 ACVP_RESULT acvp_send_login(ACVP_CTX *ctx, char *login, int len);
 
-ACVP_RESULT acvp_retrieve_vector_set(ACVP_CTX *ctx, char *vsid_url);
+ACVP_RESULT acvp_retrieve_vector_set(ACVP_VS_CTX *vs_ctx, char *vsid_url);
 
 ACVP_RESULT acvp_retrieve_vector_set_result(ACVP_CTX *ctx, char *vsid_url);
 
@@ -1100,7 +1256,23 @@ ACVP_RESULT acvp_retrieve_result(ACVP_CTX *ctx, char *api_url);
 
 ACVP_RESULT acvp_retrieve_expected_result(ACVP_CTX *ctx, char *api_url);
 
-ACVP_RESULT acvp_submit_vector_responses(ACVP_CTX *ctx);
+ACVP_RESULT acvp_submit_vector_responses(ACVP_VS_CTX *vs_ctx);
+
+ACVP_RESULT acvp_transport_init(ACVP_CTX *ctx);
+
+ACVP_RESULT acvp_transport_lib_init(int max_conns);
+
+void acvp_transport_lib_cleanup(void);
+
+#ifndef WIN32
+void acvp_deadline(struct timespec *ts, long long ms);
+#endif
+
+void acvp_transport_global_cleanup(void);
+
+void acvp_transport_close(ACVP_CTX *ctx, ACVP_VS_CTX *vs_ctx);
+
+void acvp_http_body_free(ACVP_HTTP_BODY *body);
 
 void acvp_log_msg(ACVP_CTX *ctx, ACVP_LOG_LVL level, const char *format, ...);
 
@@ -1113,57 +1285,57 @@ ACVP_RESULT acvp_bit_to_bin(const unsigned char *in, int len, unsigned char *out
 /*
  * These are the handler routines for each KAT operation
  */
-ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_aes_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_des_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_des_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
 ACVP_RESULT acvp_entropy_handler(ACVP_CTX *ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_hash_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_drbg_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_hmac_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_hmac_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_cmac_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_cmac_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_rsa_keygen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_rsa_keygen_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_rsa_siggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_rsa_siggen_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_rsa_sigver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_rsa_sigver_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_ecdsa_keygen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_ecdsa_keygen_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_ecdsa_keyver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_ecdsa_keyver_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_ecdsa_siggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_ecdsa_siggen_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_ecdsa_sigver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_ecdsa_sigver_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_kdf135_tls_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_kdf135_tls_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_kdf135_snmp_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_kdf135_snmp_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_kdf135_ssh_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_kdf135_ssh_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_kdf135_srtp_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_kdf135_srtp_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_kdf135_ikev2_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_kdf135_ikev2_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_kdf135_ikev1_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_kdf135_ikev1_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_kdf135_x963_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_kdf135_x963_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_kdf108_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_kdf108_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_dsa_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_dsa_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_dsa_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_dsa_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_kas_ecc_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_kas_ecc_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-ACVP_RESULT acvp_kas_ffc_kat_handler(ACVP_CTX *ctx, JSON_Object *obj);
+ACVP_RESULT acvp_kas_ffc_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
 /*
  * ACVP build registration functions used internally
@@ -1189,6 +1361,8 @@ ACVP_RESULT acvp_build_dependency(ACVP_DEPENDENCY_LIST *dep, char **reg);
  */
 ACVP_CAPS_LIST *acvp_locate_cap_entry(ACVP_CTX *ctx, ACVP_CIPHER cipher);
 
+const ACVP_ALG_HANDLER *acvp_lookup_alg_entry(ACVP_CIPHER alg);
+
 char *acvp_lookup_cipher_name(ACVP_CIPHER alg);
 
 ACVP_CIPHER acvp_lookup_cipher_index(const char *algorithm);
@@ -1221,9 +1395,12 @@ char *acvp_lookup_ec_curve_name(ACVP_CIPHER cipher, ACVP_EC_CURVE id);
 
 void ctr64_inc(unsigned char *counter);
 void ctr128_inc(unsigned char *counter);
+
+#define ACVP_CHECKSUM_INIT 14695981039346656037ULL
+unsigned long long acvp_checksum(unsigned long long sum, const void *p, size_t len);
 ACVP_RESULT acvp_refresh(ACVP_CTX *ctx);
 
-ACVP_RESULT acvp_setup_json_rsp_group(ACVP_CTX **ctx,
+ACVP_RESULT acvp_setup_json_rsp_group(ACVP_VS_CTX *vs_ctx,
                                       JSON_Value **outer_arr_val,
                                       JSON_Value **r_vs_val,
                                       JSON_Object **r_vs,
@@ -1232,4 +1409,79 @@ ACVP_RESULT acvp_setup_json_rsp_group(ACVP_CTX **ctx,
 
 void acvp_release_json(JSON_Value *r_vs_val,
                        JSON_Value *r_gval);
+
+void *acvp_arena_alloc(ACVP_ARENA *arena, size_t size);
+
+void *acvp_arena_calloc(ACVP_ARENA *arena, size_t nmemb, size_t size);
+
+ACVP_RESULT acvp_tc_buf(ACVP_VS_CTX *vs_ctx,
+                        const char *hex,
+                        int min_len,
+                        int max_len,
+                        unsigned char **buf,
+                        int *len);
+
+ACVP_RESULT acvp_tc_hex(ACVP_VS_CTX *vs_ctx,
+                        JSON_Object *obj,
+                        const char *name,
+                        int min_len,
+                        int max_len,
+                        unsigned char **buf,
+                        int *len);
+
+void acvp_arena_reset(ACVP_ARENA *arena);
+
+void acvp_arena_free(ACVP_ARENA *arena);
+
+void acvp_json_init(void);
+
+ACVP_ARENA *acvp_json_arena_set(ACVP_ARENA *arena);
+
+/*
+ * Test cases of one test group collected for the module's batch
+ * handler.  The handlers allocate their own per test case structs
+ * and point tcs[i] at them.  Everything lives in the test case arena.
+ */
+typedef struct acvp_tc_batch_t {
+    ACVP_TEST_CASE *tcs;
+    int *results;  /* crypto_handler equivalent return value of each */
+    int count;
+} ACVP_TC_BATCH;
+
+ACVP_RESULT acvp_tc_batch_init(ACVP_VS_CTX *vs_ctx, ACVP_TC_BATCH *batch, int max);
+
+ACVP_RESULT acvp_tc_batch_run(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TC_BATCH *batch);
+
+/*
+ * Run the module lifecycle hooks registered with acvp_set_vs_hooks()
+ * and acvp_set_group_hooks().  The handlers call the group functions
+ * around each test group; the vector set ones are called from acvp.c.
+ */
+ACVP_RESULT acvp_module_vs_begin(ACVP_VS_CTX *vs_ctx, ACVP_CIPHER cipher);
+
+void acvp_module_vs_end(ACVP_VS_CTX *vs_ctx);
+
+ACVP_RESULT acvp_module_group_begin(ACVP_VS_CTX *vs_ctx, ACVP_TEST_CASE *tc);
+
+void acvp_module_group_end(ACVP_VS_CTX *vs_ctx);
+
+/*
+ * Where acvp_time_vector_set() spent its time, in nanoseconds
+ */
+typedef struct acvp_vs_timing_t {
+    long long parse_ns;     /* vector set JSON text to JSON values */
+    long long handler_ns;   /* algorithm handler, crypto callbacks included */
+    long long serialize_ns; /* response JSON values to text */
+    int tc_count;           /* test cases in the vector set */
+    size_t rsp_len;         /* length of the response text */
+} ACVP_VS_TIMING;
+
+/*
+ * Runs one vector set, in the form the server returns it from the
+ * vector set URL, through its handler exactly as acvp_process_tests()
+ * would, then serializes the response and drops it.  Used with crypto
+ * callbacks that do little or no work this measures the overhead of
+ * libacvp itself.  Only for app/acvp_bench.c, not part of the API.
+ */
+ACVP_RESULT acvp_time_vector_set(ACVP_CTX *ctx, const char *vs_json, ACVP_VS_TIMING *timing);
 #endif
@@ -78,7 +78,38 @@ JSON_Value * json_parse_string(const char *string);
 JSON_Value * json_parse_string_with_comments(const char *string);
 #endif
 
-/* Serialization */
+/* Incremental parsing. Input can be fed in chunks of any size (e.g. as it arrives from
+   the network). Every element of an array whose name matches stream_name is handed to
+   the callback as soon as it is complete instead of being stored in the tree, together
+   with the object holding that array (only the names that came before the array are
+   set at that point, and stream_name must not be set when the callback returns). The
+   callback takes ownership of the element and returns 0 to continue or non-zero to
+   abort parsing. */
+typedef struct json_stream_t JSON_Stream;
+typedef int (*JSON_Stream_Callback)(JSON_Object *parent, JSON_Value *element, void *arg);
+
+JSON_Stream * json_stream_init(const char *stream_name, JSON_Stream_Callback callback, void *arg);
+JSON_Status   json_stream_feed(JSON_Stream *stream, const char *chunk, size_t len);
+/* Returns the parsed value without the streamed elements, or NULL if the input was
+   incomplete or invalid. The caller owns the returned value. */
+JSON_Value  * json_stream_finish(JSON_Stream *stream);
+void          json_stream_free(JSON_Stream *stream);
+
+/* Hex decoding while streaming. The callback is asked about every string member of
+   an object by name and returns non-zero to have a value made up of hex digits
+   decoded once, as it is parsed. The string is kept as well; json_value_get_hex and
+   json_object_get_hex return the decoded bytes, which are aligned and live as long
+   as the string does. */
+typedef int (*JSON_Hex_Callback)(JSON_Stream *stream, const char *name, void *arg);
+void          json_stream_set_hex_callback(JSON_Stream *stream, JSON_Hex_Callback callback, void *arg);
+/* Looks name up in the objects that enclose the one being parsed, innermost first.
+   Meant for hex callbacks; returns NULL if none of them has such a string (yet). */
+const char  * json_stream_get_outer_string(const JSON_Stream *stream, const char *name);
+
+/* Serialization
+ * Each call walks the value once. json_serialize_to_string grows its result as it
+ * goes, json_serialize_to_buffer writes directly and fails (leaving buf partially
+ * written) if the value does not fit. */
 size_t      json_serialization_size(const JSON_Value *value); /* returns 0 on fail */
 JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes);
 JSON_Status json_serialize_to_file(const JSON_Value *value, const char *filename);
@@ -92,6 +123,16 @@ char *      json_serialize_to_string_pretty(const JSON_Value *value, int *len);
 
 void        json_free_serialized_string(char *string); /* frees string from json_serialize_to_string and json_serialize_to_string_pretty */
 
+/* Binary serialization
+ * A compact form for keeping parsed values on disk. Numbers and lengths are written
+ * in host byte order, so the result is only meant to be read back on the machine
+ * that wrote it. Strings made up of hex digits of one case are stored as their bytes
+ * and come back decoded, as if the stream parser had decoded them. json_parse_binary
+ * stops after the first value and sets *used (if not NULL) to the bytes it took up. */
+size_t       json_binary_size(const JSON_Value *value); /* returns 0 on fail */
+JSON_Status  json_serialize_to_binary(const JSON_Value *value, unsigned char *buf, size_t buf_size_in_bytes);
+JSON_Value * json_parse_binary(const unsigned char *buf, size_t buf_size_in_bytes, size_t *used);
+
 /* Comparing */
 int  json_value_equals(const JSON_Value *a, const JSON_Value *b);
 
@@ -112,6 +153,7 @@ JSON_Status json_validate(const JSON_Value *schema, const JSON_Value *value);
  */
 JSON_Value  * json_object_get_value  (const JSON_Object *object, const char *name);
 const char  * json_object_get_string (const JSON_Object *object, const char *name);
+const unsigned char * json_object_get_hex(const JSON_Object *object, const char *name, size_t *len); /* returns NULL if not decoded */
 JSON_Object * json_object_get_object (const JSON_Object *object, const char *name);
 JSON_Array  * json_object_get_array  (const JSON_Object *object, const char *name);
 double        json_object_get_number (const JSON_Object *object, const char *name); /* returns 0 on fail */
@@ -205,6 +247,10 @@ JSON_Status json_array_append_number(JSON_Array *array, double number);
 JSON_Status json_array_append_boolean(JSON_Array *array, int boolean);
 JSON_Status json_array_append_null(JSON_Array *array);
 
+/* Moves all values of src to the end of array without copying them, src is left empty.
+   Nothing is moved if JSONFailure is returned. */
+JSON_Status json_array_append_array_values(JSON_Array *array, JSON_Array *src);
+
 /*
  *JSON Value
  */
@@ -223,6 +269,7 @@ JSON_Value_Type json_value_get_type   (const JSON_Value *value);
 JSON_Object *   json_value_get_object (const JSON_Value *value);
 JSON_Array  *   json_value_get_array  (const JSON_Value *value);
 const char  *   json_value_get_string (const JSON_Value *value);
+const unsigned char * json_value_get_hex(const JSON_Value *value, size_t *len); /* returns NULL if not decoded */
 double          json_value_get_number (const JSON_Value *value);
 int             json_value_get_boolean(const JSON_Value *value);
 JSON_Value  *   json_value_get_parent (const JSON_Value *value);
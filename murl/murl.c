@@ -646,64 +646,35 @@ static void murl_log_peer_cert(SSL *ssl)
 }
 
 
-#define TBUF_MAX 1024
-#define READ_CHUNK_SZ 16384
-CURLcode curl_easy_perform(CURL *curl)
+/*
+ * Tear down the TLS connection held open on the handle, if any.
+ * The SSL_CTX and the TLS session are kept so the next connection
+ * can reuse them.
+ */
+static void murl_close_connection(SessionHandle *ctx)
 {
-    BIO *conn;
-    int rv;
-    int ssl_err;
-    int read_cnt = 0;
-    char *rbuf = NULL;
-    char tbuf[TBUF_MAX];
-    SSL *ssl = NULL;
-    SSL_CTX *ssl_ctx = NULL;
-    X509_VERIFY_PARAM *vpm = NULL;
-    int cl;
-    SessionHandle *ctx = (SessionHandle*)curl;
-    struct curl_slist *hdrs;
-    unsigned long ossl_err;
-    CURLcode crv;
-
-    if (!ctx) {
-	return CURLE_UNKNOWN_OPTION;
-    }
-
-    /*
-     * Allocate some space to build the HTTP request
-     */
-    if (ctx->http_post && ctx->post_field_size) {
-        cl = ctx->post_field_size; 
-    } else if (ctx->http_post && ctx->post_fields) {
-        cl = strlen(ctx->post_fields); //FIXME: this is not safe
-    } else {
-        cl = 0;
-    }
-    if (cl > MURL_POST_MAX) {
-	fprintf(stderr, "POST data exceeds %d byte limit\n", MURL_POST_MAX);
-	return CURLE_FILESIZE_EXCEEDED;
-    }
-    rbuf = calloc(1, cl+MURL_HDR_MAX);
-    if (!rbuf) {
-        fprintf(stderr, "calloc failed.\n");
-        return CURLE_OUT_OF_MEMORY;
+    if (ctx->ssl) {
+	SSL_shutdown(ctx->ssl);
+	SSL_free(ctx->ssl);
+	ctx->ssl = NULL;
     }
+    ctx->conn_host[0] = 0;
+    ctx->conn_port = 0;
+}
 
-    /*
-     * Split the URL into it's parts
-     */
-    crv = parseurl(ctx);
-    if (crv != CURLE_OK) goto easy_perform_cleanup;
+/*
+ * Create the OpenSSL context used for every connection made
+ * on this handle.
+ */
+static CURLcode murl_setup_ssl_ctx(SessionHandle *ctx)
+{
+    X509_VERIFY_PARAM *vpm = NULL;
 
-    /*
-     * Setup OpenSSL API
-     */
-    ssl_ctx = SSL_CTX_new(SSLv23_client_method());
-    if (!ssl_ctx) {
+    ctx->ssl_ctx = SSL_CTX_new(SSLv23_client_method());
+    if (!ctx->ssl_ctx) {
         fprintf(stderr, "Failed to create SSL context.\n");
         ERR_print_errors_fp(stderr);
-        crv = CURLE_SSL_CONNECT_ERROR;
-	goto easy_perform_cleanup;
+        return CURLE_SSL_CONNECT_ERROR;
     }
     /*
      * This is optional.
@@ -712,28 +683,26 @@ CURLcode curl_easy_perform(CURL *curl)
      * the error handling required when reading/writing to
      * the SSL socket.
      */
-    SSL_CTX_set_mode(ssl_ctx, SSL_MODE_AUTO_RETRY);
-
+    SSL_CTX_set_mode(ctx->ssl_ctx, SSL_MODE_AUTO_RETRY);
+    SSL_CTX_set_session_cache_mode(ctx->ssl_ctx, SSL_SESS_CACHE_CLIENT);
 
     /*
      * Enable TLS peer verification if requested and CA certs were provided
      */
     if (ctx->ssl_verify_peer && ctx->ca_file) {
-        if (!SSL_CTX_load_verify_locations(ssl_ctx, ctx->ca_file, NULL)) {
+        if (!SSL_CTX_load_verify_locations(ctx->ssl_ctx, ctx->ca_file, NULL)) {
             fprintf(stderr, "Failed to set trust anchors.\n");
             ERR_print_errors_fp(stderr);
-            crv = CURLE_SSL_CACERT_BADFILE;
-	    goto easy_perform_cleanup;
+            return CURLE_SSL_CACERT_BADFILE;
         }
-        SSL_CTX_set_verify(ssl_ctx, SSL_VERIFY_PEER|SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+        SSL_CTX_set_verify(ctx->ssl_ctx, SSL_VERIFY_PEER|SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
     }
 
     vpm = X509_VERIFY_PARAM_new();
     if (vpm == NULL) {
         fprintf(stderr, "Unable to allocate a verify parameter structure.\n");
         ERR_print_errors_fp(stderr);
-        crv = CURLE_SSL_CONNECT_ERROR;
-	goto easy_perform_cleanup;
+        return CURLE_SSL_CONNECT_ERROR;
     }
 #if 0
     /* TODO: Enable CRL checks */
@@ -745,21 +714,101 @@ CURLcode curl_easy_perform(CURL *curl)
     if (ctx->ssl_verify_hostname) {
 	X509_VERIFY_PARAM_set1_host(vpm, ctx->host_name, strnlen(ctx->host_name, MURL_HOSTNAME_MAX));
     }
-    SSL_CTX_set1_param(ssl_ctx, vpm);
+    SSL_CTX_set1_param(ctx->ssl_ctx, vpm);
     X509_VERIFY_PARAM_free(vpm);
 
     if (ctx->ssl_cert_file && ctx->ssl_key_file) {
-        if (SSL_CTX_use_certificate_chain_file(ssl_ctx, ctx->ssl_cert_file) != 1) {
+        if (SSL_CTX_use_certificate_chain_file(ctx->ssl_ctx, ctx->ssl_cert_file) != 1) {
             fprintf(stderr,"Failed to load client certificate\n");
             ERR_print_errors_fp(stderr);
-            crv = CURLE_SSL_CERTPROBLEM;
-	    goto easy_perform_cleanup;
+            return CURLE_SSL_CERTPROBLEM;
         }
-        if (SSL_CTX_use_PrivateKey_file(ssl_ctx, ctx->ssl_key_file, SSL_FILETYPE_PEM) != 1) {
+        if (SSL_CTX_use_PrivateKey_file(ctx->ssl_ctx, ctx->ssl_key_file, SSL_FILETYPE_PEM) != 1) {
             fprintf(stderr, "Failed to load client private key\n");
             ERR_print_errors_fp(stderr);
-            crv = CURLE_SSL_CERTPROBLEM;
-	    goto easy_perform_cleanup;
+            return CURLE_SSL_CERTPROBLEM;
+        }
+    }
+
+    return CURLE_OK;
+}
+
+/*
+ * Describe the options the SSL context is built from, so a
+ * handle can tell when a request asks for different ones.
+ */
+static char *murl_ssl_opts(SessionHandle *ctx)
+{
+    char *opts;
+    int len;
+
+    len = snprintf(NULL, 0, "%d %d %s\n%s\n%s\n%s", ctx->ssl_verify_peer,
+                   ctx->ssl_verify_hostname, ctx->host_name,
+                   ctx->ca_file ? ctx->ca_file : "",
+                   ctx->ssl_cert_file ? ctx->ssl_cert_file : "",
+                   ctx->ssl_key_file ? ctx->ssl_key_file : "");
+    opts = malloc(len + 1);
+    if (!opts) {
+        return NULL;
+    }
+    snprintf(opts, len + 1, "%d %d %s\n%s\n%s\n%s", ctx->ssl_verify_peer,
+             ctx->ssl_verify_hostname, ctx->host_name,
+             ctx->ca_file ? ctx->ca_file : "",
+             ctx->ssl_cert_file ? ctx->ssl_cert_file : "",
+             ctx->ssl_key_file ? ctx->ssl_key_file : "");
+    return opts;
+}
+
+/*
+ * Drop the SSL context, and with it the open connection and the
+ * TLS session, when the request's CA, verification or client
+ * certificate options are not the ones it was built from.
+ */
+static CURLcode murl_check_ssl_ctx(SessionHandle *ctx)
+{
+    char *opts;
+
+    opts = murl_ssl_opts(ctx);
+    if (!opts) {
+        return CURLE_OUT_OF_MEMORY;
+    }
+    if (ctx->ssl_ctx && ctx->ssl_ctx_opts && !strcmp(ctx->ssl_ctx_opts, opts)) {
+        free(opts);
+        return CURLE_OK;
+    }
+    murl_close_connection(ctx);
+    if (ctx->ssl_session) {
+        SSL_SESSION_free(ctx->ssl_session);
+        ctx->ssl_session = NULL;
+    }
+    if (ctx->ssl_ctx) {
+        SSL_CTX_free(ctx->ssl_ctx);
+        ctx->ssl_ctx = NULL;
+    }
+    if (ctx->ssl_ctx_opts) free(ctx->ssl_ctx_opts);
+    ctx->ssl_ctx_opts = opts;
+    return CURLE_OK;
+}
+
+/*
+ * Open a TCP connection to the server and perform the TLS
+ * handshake.  The TLS session from the previous connection
+ * is offered to the server so it can resume it.
+ */
+static CURLcode murl_open_connection(SessionHandle *ctx)
+{
+    BIO *conn;
+    int rv;
+    CURLcode crv;
+
+    if (!ctx->ssl_ctx) {
+        crv = murl_setup_ssl_ctx(ctx);
+        if (crv != CURLE_OK) {
+            if (ctx->ssl_ctx) {
+                SSL_CTX_free(ctx->ssl_ctx);
+                ctx->ssl_ctx = NULL;
+            }
+            return crv;
         }
     }
 
@@ -771,73 +820,92 @@ CURLcode curl_easy_perform(CURL *curl)
     } else {
 	conn = create_connection(ctx->host_name, ctx->server_port);
     }
-    //FIXME: do we need to free conn, or is this handled by SSL_free?
     if (conn == NULL) {
         fprintf(stderr, "Unable to open socket with server.\n");
-        crv = CURLE_COULDNT_CONNECT;
-	goto easy_perform_cleanup;
+        return CURLE_COULDNT_CONNECT;
     }
-    ssl = SSL_new(ssl_ctx);
-    if (!SSL_set_tlsext_host_name(ssl, ctx->host_name)) {
+    ctx->ssl = SSL_new(ctx->ssl_ctx);
+    if (!ctx->ssl) {
+        BIO_free_all(conn);
+        return CURLE_OUT_OF_MEMORY;
+    }
+    if (!SSL_set_tlsext_host_name(ctx->ssl, ctx->host_name)) {
         fprintf(stderr, "Warning: SNI extension not set.\n");
     }
-    SSL_set_bio(ssl, conn, conn);
-    rv = SSL_connect(ssl);
+    /* SSL_free() will release the BIO */
+    SSL_set_bio(ctx->ssl, conn, conn);
+    if (ctx->ssl_session) {
+        SSL_set_session(ctx->ssl, ctx->ssl_session);
+    }
+    rv = SSL_connect(ctx->ssl);
     if (rv <= 0) {
         fprintf(stderr, "TLS handshake failed.\n");
         ERR_print_errors_fp(stderr);
-        crv = CURLE_SSL_CONNECT_ERROR;
-	goto easy_perform_cleanup;
+        murl_close_connection(ctx);
+        return CURLE_SSL_CONNECT_ERROR;
     }
 
     /*
      * PSB requires we log the X509 distinguished name of the peer
      */
     if (ctx->ssl_verify_peer) {
-	murl_log_peer_cert(ssl);
+	murl_log_peer_cert(ctx->ssl);
     }
 
-    /*
-     * Build HTTP request
-     */
-    memset(tbuf, 0, sizeof(tbuf));
-    snprintf(tbuf, TBUF_MAX, "%s %s HTTP/1.0\r\n"
-            "Host: %s:%d\r\n"
-            "User-Agent: %s\r\n",
-            (ctx->http_post ? "POST" : "GET"),
-            ctx->path_segment, ctx->host_name, ctx->server_port,
-            (ctx->user_agent ? ctx->user_agent : "Murl"));
-    strcat(rbuf, tbuf); //FIXME: safe string handling needed
+    strncpy(ctx->conn_host, ctx->host_name, MURL_HOSTNAME_MAX - 1);
+    ctx->conn_port = ctx->server_port;
+    ctx->num_connects++;
 
-    /*
-     * Add any custom headers requested by the user
-     */
-    if (ctx->headers) {
-        hdrs = ctx->headers;
-        while (hdrs) {
-            memset(tbuf, 0, sizeof(tbuf));
-            snprintf(tbuf, TBUF_MAX, "%s\r\n", hdrs->data);
-            strcat(rbuf, tbuf); //FIXME: safe string handling needed
-            hdrs = hdrs->next;
-        }
+    return CURLE_OK;
+}
+
+/*
+ * Remember the TLS session of the current connection so
+ * a later connection can resume it.
+ */
+static void murl_save_ssl_session(SessionHandle *ctx)
+{
+    SSL_SESSION *sess;
+
+    sess = SSL_get1_session(ctx->ssl);
+    if (!sess) {
+        return;
+    }
+    if (ctx->ssl_session) {
+        SSL_SESSION_free(ctx->ssl_session);
     }
+    ctx->ssl_session = sess;
+}
 
-    /*
-     * Set the Content-length header
-     */
-    memset(tbuf, 0, sizeof(tbuf));
-    snprintf(tbuf, TBUF_MAX, "Content-Length: %d\r\n" "Accept: */*\r\n\r\n", cl);
-    strcat(rbuf, tbuf); //FIXME: safe string handling needed
+/*
+ * Send the HTTP request on the current connection and read
+ * back the complete response.  Reading stops once the response
+ * is complete, which leaves the connection open for the next
+ * request unless the server asked to close it.
+ */
+#define READ_CHUNK_SZ 16384
+static CURLcode murl_send_recv(SessionHandle *ctx, char *req, int req_len,
+                               int cl, char **resp, int *keep_alive)
+{
+    int rv;
+    int ssl_err;
+    int read_cnt = 0;
+    char *rbuf = NULL;
+    unsigned long ossl_err;
+
+    *resp = NULL;
+    *keep_alive = 0;
 
     /*
      * Send the HTTP request
      */
-    SSL_write(ssl, rbuf, strlen(rbuf));
-    SSL_write(ssl, ctx->post_fields, cl);
-
+    if (SSL_write(ctx->ssl, req, req_len) <= 0) {
+        return CURLE_SEND_ERROR;
+    }
+    if (cl && SSL_write(ctx->ssl, ctx->post_fields, cl) <= 0) {
+        return CURLE_SEND_ERROR;
+    }
     ERR_clear_error();
-    free(rbuf);
-    rbuf = NULL;
 
     /*
      * Read the HTTP response
@@ -847,24 +915,23 @@ CURLcode curl_easy_perform(CURL *curl)
 	/*
 	 * Allocate some space to receive the response from the server
 	 */
-	rbuf = realloc(rbuf, read_cnt + READ_CHUNK_SZ);
-	if (!rbuf) {
+	char *tmp = realloc(rbuf, read_cnt + READ_CHUNK_SZ + 1);
+	if (!tmp) {
 	    fprintf(stderr, "realloc failed (%s).\n", __FUNCTION__);
-	    crv = CURLE_OUT_OF_MEMORY;
-	    goto easy_perform_cleanup;
+	    free(rbuf);
+	    return CURLE_OUT_OF_MEMORY;
 	}
-	memset(rbuf+read_cnt, 0x0, READ_CHUNK_SZ);
+	rbuf = tmp;
 	
 	/*
 	 * Read the next chunk from the server
 	 */
-        rv = SSL_read(ssl, rbuf+read_cnt, READ_CHUNK_SZ);
+        rv = SSL_read(ctx->ssl, rbuf+read_cnt, READ_CHUNK_SZ);
         if (rv <= 0) {
-            ssl_err = SSL_get_error(ssl, rv);
+            ssl_err = SSL_get_error(ctx->ssl, rv);
             switch (ssl_err) {
             case SSL_ERROR_NONE:
             case SSL_ERROR_ZERO_RETURN:
-                //fprintf(stderr, "SSL_read finished\n");
                 break;
             default:
                 ossl_err = ERR_get_error();
@@ -872,32 +939,163 @@ CURLcode curl_easy_perform(CURL *curl)
                     fprintf(stderr, "SSL_read failed, rv=%d ssl_err=%d ossl_err=%d.\n",
                             rv, ssl_err, (int)ossl_err);
                     ERR_print_errors_fp(stderr);
-                    crv = CURLE_USE_SSL_FAILED;
-	            goto easy_perform_cleanup;
+                    free(rbuf);
+                    return CURLE_RECV_ERROR;
                 }
                 break;
             }
+            /* Server closed the connection, whatever we have is the response */
+            rv = 0;
+            *keep_alive = 0;
+        } else {
+            read_cnt += rv;
+            rbuf[read_cnt] = 0;
+            if (murl_http_response_complete(rbuf, read_cnt, keep_alive)) {
+                rv = 0;
+            }
         }
-        read_cnt += rv;
 	
 	/*
 	 * Make sure we're not receving too much data from the server.
 	 */
 	if (read_cnt > MURL_RCV_MAX) {
-	    crv = CURLE_FILESIZE_EXCEEDED;
-	    goto easy_perform_cleanup;
+	    free(rbuf);
+	    return CURLE_FILESIZE_EXCEEDED;
 	}
     }
 
+    if (!read_cnt) {
+        free(rbuf);
+        return CURLE_GOT_NOTHING;
+    }
+
     /*
      * make sure the data is null terminated
      */
     rbuf[read_cnt] = 0;
+    *resp = rbuf;
+    return CURLE_OK;
+}
+
+#define TBUF_MAX 1024
+CURLcode curl_easy_perform(CURL *curl)
+{
+    char *rbuf = NULL;
+    char *resp = NULL;
+    char tbuf[TBUF_MAX];
+    int cl;
+    int reused;
+    int keep_alive = 0;
+    SessionHandle *ctx = (SessionHandle*)curl;
+    struct curl_slist *hdrs;
+    CURLcode crv;
+
+    if (!ctx) {
+	return CURLE_UNKNOWN_OPTION;
+    }
+    ctx->num_connects = 0;
+
+    /*
+     * Allocate some space to build the HTTP request
+     */
+    if (ctx->http_post && ctx->post_field_size) {
+        cl = ctx->post_field_size; 
+    } else if (ctx->http_post && ctx->post_fields) {
+        cl = strlen(ctx->post_fields); //FIXME: this is not safe
+    } else {
+        cl = 0;
+    }
+    if (cl > MURL_POST_MAX) {
+	fprintf(stderr, "POST data exceeds %d byte limit\n", MURL_POST_MAX);
+	return CURLE_FILESIZE_EXCEEDED;
+    }
+    rbuf = calloc(1, MURL_HDR_MAX);
+    if (!rbuf) {
+        fprintf(stderr, "calloc failed.\n");
+        return CURLE_OUT_OF_MEMORY;
+    }
+
+    /*
+     * Split the URL into it's parts
+     */
+    crv = parseurl(ctx);
+    if (crv != CURLE_OK) goto easy_perform_cleanup;
+
+    /*
+     * Build HTTP request
+     */
+    memset(tbuf, 0, sizeof(tbuf));
+    snprintf(tbuf, TBUF_MAX, "%s %s HTTP/1.1\r\n"
+            "Host: %s:%d\r\n"
+            "User-Agent: %s\r\n",
+            (ctx->http_post ? "POST" : "GET"),
+            ctx->path_segment, ctx->host_name, ctx->server_port,
+            (ctx->user_agent ? ctx->user_agent : "Murl"));
+    strcat(rbuf, tbuf); //FIXME: safe string handling needed
+
+    /*
+     * Add any custom headers requested by the user
+     */
+    if (ctx->headers) {
+        hdrs = ctx->headers;
+        while (hdrs) {
+            memset(tbuf, 0, sizeof(tbuf));
+            snprintf(tbuf, TBUF_MAX, "%s\r\n", hdrs->data);
+            strcat(rbuf, tbuf); //FIXME: safe string handling needed
+            hdrs = hdrs->next;
+        }
+    }
+
+    /*
+     * Set the Content-length header
+     */
+    memset(tbuf, 0, sizeof(tbuf));
+    snprintf(tbuf, TBUF_MAX, "Content-Length: %d\r\n" "Accept: */*\r\n\r\n", cl);
+    strcat(rbuf, tbuf); //FIXME: safe string handling needed
+
+    /*
+     * Reuse the connection left open by the previous request
+     * on this handle if it went to the same server with the
+     * same TLS options.
+     */
+    crv = murl_check_ssl_ctx(ctx);
+    if (crv != CURLE_OK) goto easy_perform_cleanup;
+    if (ctx->ssl && (ctx->conn_port != ctx->server_port ||
+                     strncmp(ctx->conn_host, ctx->host_name, MURL_HOSTNAME_MAX))) {
+        murl_close_connection(ctx);
+    }
+    reused = (ctx->ssl != NULL);
+    if (!reused) {
+        crv = murl_open_connection(ctx);
+        if (crv != CURLE_OK) goto easy_perform_cleanup;
+    }
+
+    crv = murl_send_recv(ctx, rbuf, strlen(rbuf), cl, &resp, &keep_alive);
+    if ((crv == CURLE_SEND_ERROR || crv == CURLE_GOT_NOTHING) && reused && !ctx->http_post) {
+        /*
+         * The server may have dropped the idle connection,
+         * try once more on a fresh one.  Only when nothing came
+         * back and never for a POST, which the server may have
+         * acted on already.
+         */
+        murl_close_connection(ctx);
+        crv = murl_open_connection(ctx);
+        if (crv != CURLE_OK) goto easy_perform_cleanup;
+        crv = murl_send_recv(ctx, rbuf, strlen(rbuf), cl, &resp, &keep_alive);
+    }
+    if (crv != CURLE_OK) {
+        murl_close_connection(ctx);
+        goto easy_perform_cleanup;
+    }
+    murl_save_ssl_session(ctx);
+    if (!keep_alive) {
+        murl_close_connection(ctx);
+    }
 
     /*
      * Parse the HTTP response
      */
-    if (murl_http_parse_response(ctx, rbuf)) {
+    if (murl_http_parse_response(ctx, resp)) {
         crv = CURLE_HTTP2;
 	goto easy_perform_cleanup;
     }
@@ -911,12 +1109,8 @@ CURLcode curl_easy_perform(CURL *curl)
 
     crv = CURLE_OK;
 easy_perform_cleanup:
-    if (ssl) {
-	SSL_shutdown(ssl);
-	SSL_free(ssl);
-    }
-    if (ssl_ctx) SSL_CTX_free(ssl_ctx);
     if (rbuf) free(rbuf);
+    if (resp) free(resp);
     return crv;
 }
 
@@ -926,6 +1120,9 @@ static CURLcode getinfo_long(SessionHandle *data, CURLINFO info, long *param_lon
     case CURLINFO_RESPONSE_CODE:
         *param_longp = data->http_status_code;
         break;
+    case CURLINFO_NUM_CONNECTS:
+        *param_longp = data->num_connects;
+        break;
     default:
         return CURLE_BAD_FUNCTION_ARGUMENT;
     }
@@ -1112,10 +1309,15 @@ static void Curl_ossl_cleanup(void)
 #endif
 }
 
-void curl_easy_cleanup(CURL *curl)
+/*
+ * Release the per-request options set on the handle and restore
+ * the defaults, the same as a new handle.  Like Curl, the open
+ * connection, SSL context and TLS session are kept so later
+ * requests can reuse them, as long as they ask for the same TLS
+ * options (see murl_check_ssl_ctx()).
+ */
+static void murl_free_options(SessionHandle *data)
 {
-    SessionHandle *data = (SessionHandle*)curl;
-
     if (data->user_agent) free(data->user_agent);
     if (data->url) free(data->url);
     if (data->post_fields) free(data->post_fields);
@@ -1125,6 +1327,47 @@ void curl_easy_cleanup(CURL *curl)
     if (data->ssl_key_file) free(data->ssl_key_file);
     if (data->ssl_key_type) free(data->ssl_key_type);
     if (data->recv_buf) free(data->recv_buf);
+}
+
+void curl_easy_reset(CURL *curl)
+{
+    SessionHandle *data = (SessionHandle*)curl;
+
+    if (!data) return;
+
+    murl_free_options(data);
+    data->url = NULL;
+    data->use_ipv6 = 0;
+    data->user_agent = NULL;
+    data->http_post = 0;
+    data->post_fields = NULL;
+    data->post_field_size = 0;
+    data->ca_file = NULL;
+    data->ssl_verify_peer = 0;
+    data->ssl_verify_hostname = 1;
+    data->ssl_certinfo = 0;
+    data->ssl_cert_file = NULL;
+    data->ssl_cert_type = NULL;
+    data->ssl_key_file = NULL;
+    data->ssl_key_type = NULL;
+    data->write_ctx = NULL;
+    data->headers = NULL;
+    data->write_func = NULL;
+    data->http_status_code = 0;
+    data->recv_buf = NULL;
+    data->recv_ctr = 0;
+    data->server_port = 443;
+}
+
+void curl_easy_cleanup(CURL *curl)
+{
+    SessionHandle *data = (SessionHandle*)curl;
+
+    murl_close_connection(data);
+    if (data->ssl_session) SSL_SESSION_free(data->ssl_session);
+    if (data->ssl_ctx) SSL_CTX_free(data->ssl_ctx);
+    if (data->ssl_ctx_opts) free(data->ssl_ctx_opts);
+    murl_free_options(data);
     //if (data->headers) curl_slist_free_all(data->headers);
 
     free(data);
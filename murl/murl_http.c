@@ -51,6 +51,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include "murl_lcl.h"
 #include "http_parser.h"
 
@@ -63,13 +64,6 @@
 #define MAX_ELEMENT_SIZE 64*1024
 #define MAX_BODY_SIZE 64*1024*1024
 
-/*
- * Using this global variable to track when all the HTTP data has been 
- * parsed.  This will need to be addressed if/when thread-safety is
- * desired.
- */
-static int currently_parsing_eof;
-
 typedef struct message {
     const char *name; // for debugging purposes
     const char *raw;
@@ -96,6 +90,7 @@ typedef struct message {
     int headers_complete_cb_called;
     int message_complete_cb_called;
     int message_complete_on_eof;
+    int currently_parsing_eof;  /* set while the parser is told of the end of the data */
 } http_msg;
 
 int request_path_cb (http_parser *p, const char *buf, size_t len)
@@ -244,7 +239,7 @@ int message_complete_cb (http_parser *p)
     }
     msg->message_complete_cb_called = 1;
 
-    msg->message_complete_on_eof = currently_parsing_eof;
+    msg->message_complete_on_eof = msg->currently_parsing_eof;
 
     return 0;
 }
@@ -287,7 +282,9 @@ void murl_http_parser_free (http_parser *parser)
 size_t murl_http_parse (http_parser *parser, const char *buf, size_t len)
 {
     size_t nparsed;
-    currently_parsing_eof = (len == 0);
+    http_msg *msg = parser->data;
+
+    msg->currently_parsing_eof = (len == 0);
     nparsed = http_parser_execute(parser, &settings, buf, len);
     return nparsed;
 }
@@ -372,3 +369,146 @@ int murl_http_parse_response (SessionHandle *ctx, const char *buf)
 
 
 
+
+/*
+ * Look for a header in the header block of an HTTP response.
+ * Returns a pointer to the start of the value or NULL.
+ */
+static const char *murl_http_find_header(const char *buf, const char *hdr_end,
+                                         const char *name)
+{
+    const char *line = strstr(buf, "\r\n");
+    size_t name_len = strlen(name);
+
+    while (line && line < hdr_end) {
+        line += 2;
+        if (!strncasecmp(line, name, name_len) && line[name_len] == ':') {
+            line += name_len + 1;
+            while (*line == ' ' || *line == '\t') line++;
+            return line;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return NULL;
+}
+
+/*
+ * Find the CRLF ending the line at p, looking no further than end.
+ * Returns a pointer to the CR or NULL.
+ */
+static const char *murl_http_find_crlf(const char *p, const char *end)
+{
+    for (; p + 1 < end; p++) {
+        if (p[0] == '\r' && p[1] == '\n') {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Walk the chunks of a chunked body starting at p.  Returns 1 once
+ * the zero size chunk and the trailer section after it are all in,
+ * 0 if more data is needed and -1 if a chunk size line is invalid.
+ */
+static int murl_http_chunked_complete(const char *p, const char *end)
+{
+    const char *eol;
+    char *size_end;
+    long size;
+
+    for (;;) {
+        eol = murl_http_find_crlf(p, end);
+        if (!eol) {
+            return 0;
+        }
+        size = strtol(p, &size_end, 16);
+        if (size_end == p || size < 0 ||
+            (size_end != eol && *size_end != ';' && *size_end != ' ' && *size_end != '\t')) {
+            return -1;
+        }
+        p = eol + 2;
+        if (!size) {
+            break;
+        }
+        if (end - p < size + 2) {
+            return 0;
+        }
+        p += size + 2;
+    }
+
+    /* Trailer fields, if any, up to an empty line */
+    for (;;) {
+        eol = murl_http_find_crlf(p, end);
+        if (!eol) {
+            return 0;
+        }
+        if (eol == p) {
+            return 1;
+        }
+        p = eol + 2;
+    }
+}
+
+/*
+ * This routine checks whether buf holds a complete HTTP response,
+ * which lets the caller stop reading without waiting for the server
+ * to close the connection.  keep_alive is set when the connection
+ * may be used for another request afterwards.
+ *
+ * Returns 1 when the response is complete, 0 if more data is needed.
+ */
+int murl_http_response_complete(const char *buf, int len, int *keep_alive)
+{
+    const char *hdr_end;
+    const char *val;
+    int hdr_len;
+    long body_len;
+
+    *keep_alive = 0;
+
+    hdr_end = strstr(buf, "\r\n\r\n");
+    if (!hdr_end) {
+        return 0;
+    }
+    hdr_len = (hdr_end - buf) + 4;
+
+    /*
+     * HTTP/1.0 servers close the connection unless told otherwise,
+     * HTTP/1.1 servers keep it open unless told otherwise.
+     */
+    val = murl_http_find_header(buf, hdr_end, "Connection");
+    if (strncmp(buf, "HTTP/1.1", 8)) {
+        *keep_alive = (val && !strncasecmp(val, "keep-alive", 10));
+    } else {
+        *keep_alive = !(val && !strncasecmp(val, "close", 5));
+    }
+
+    val = murl_http_find_header(buf, hdr_end, "Transfer-Encoding");
+    if (val && !strncasecmp(val, "chunked", 7)) {
+        /* the last chunk has zero length */
+        switch (murl_http_chunked_complete(buf + hdr_len, buf + len)) {
+        case 1:
+            return 1;
+        case 0:
+            return 0;
+        default:
+            /* Let the parser report it, the connection is unusable */
+            *keep_alive = 0;
+            return 1;
+        }
+    }
+
+    val = murl_http_find_header(buf, hdr_end, "Content-Length");
+    if (val) {
+        body_len = strtol(val, NULL, 10);
+        return (len >= hdr_len + body_len);
+    }
+
+    /*
+     * Without a length the body runs until the server closes
+     * the connection, it can't be reused.
+     */
+    *keep_alive = 0;
+    return 0;
+}
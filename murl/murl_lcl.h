@@ -62,7 +62,14 @@ typedef struct SessionHandle_ {
     struct curl_slist	    *headers;
     curl_write_callback	    write_func;
 
-    SSL	*ssl;
+    /* Connection kept open between requests on this handle */
+    SSL_CTX		*ssl_ctx;
+    char		*ssl_ctx_opts;  /* the TLS options ssl_ctx was built from */
+    SSL			*ssl;
+    SSL_SESSION		*ssl_session;  /* offered for resumption on reconnect */
+    char		conn_host[MURL_HOSTNAME_MAX];
+    int			conn_port;
+    int			num_connects;  /* new connections made by the last request */
 
     /* The following members are for HTTP parsing */
     int			http_status_code;  /* HTTP response from server */
@@ -74,6 +81,7 @@ typedef struct SessionHandle_ {
 } SessionHandle;
 
 int murl_http_parse_response(SessionHandle *ctx, const char *buf);
+int murl_http_response_complete(const char *buf, int len, int *keep_alive);
 
 #ifdef  __cplusplus
 }
@@ -32,6 +32,12 @@
 #include <Windows.h>
 #else
 #include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 #include "acvp.h"
 #include "acvp_lcl.h"
@@ -42,6 +48,7 @@
  * Forward prototypes for local functions
  */
 static ACVP_RESULT acvp_parse_login(ACVP_CTX *ctx);
+static ACVP_RESULT acvp_append_vsid_url(ACVP_CTX *ctx, char *vsid_url);
 
 #if 0
 static ACVP_RESULT acvp_parse_vendors(ACVP_CTX *ctx);
@@ -55,11 +62,18 @@ static ACVP_RESULT acvp_parse_dependencies(ACVP_CTX *ctx, ACVP_DEPENDENCY_LIST *
 
 static ACVP_RESULT acvp_parse_test_session_register(ACVP_CTX *ctx);
 
-static ACVP_RESULT acvp_process_vsid(ACVP_CTX *ctx, char *vsid_url);
+static ACVP_RESULT acvp_process_vsid(ACVP_VS_CTX *vs_ctx, char *vsid_url);
 
-static ACVP_RESULT acvp_process_vector_set(ACVP_CTX *ctx, JSON_Object *obj);
+#ifndef WIN32
+static ACVP_RESULT acvp_process_vs_file(ACVP_VS_CTX *vs_ctx, char *vs_file, const char *rsp_dir);
+#endif
+
+static ACVP_RESULT acvp_process_vector_set(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
 
-static ACVP_RESULT acvp_dispatch_vector_set(ACVP_CTX *ctx, JSON_Object *obj);
+static ACVP_RESULT acvp_dispatch_vector_set(ACVP_VS_CTX *vs_ctx, JSON_Object *obj);
+static ACVP_RESULT acvp_vs_deferred_groups(ACVP_VS_CTX *vs_ctx, JSON_Value *val);
+
+static int acvp_process_test_group(JSON_Object *vs_obj, JSON_Value *group, void *arg);
 
 static void acvp_cap_free_sl(ACVP_SL_LIST *list);
 
@@ -71,6 +85,24 @@ static void acvp_cap_free_hash_pairs(ACVP_RSA_HASH_PAIR_LIST *list);
 
 static ACVP_RESULT acvp_get_result_test_session(ACVP_CTX *ctx, char *session_url);
 
+/*
+ * Members the vector set parser decodes from hex as it goes, for the
+ * algorithms that carry kilobytes of hex per test case.  Handlers get
+ * at the bytes with acvp_tc_hex(), which decodes anything not listed.
+ */
+#define ACVP_HEX_FIELD_MAX 32
+
+static const char * const acvp_dsa_pqgver_hex[] = {
+    "p", "q", "g", "domainSeed", NULL
+};
+static const char * const acvp_rsa_sigver_hex[] = {
+    "e", "n", "message", "signature", NULL
+};
+static const char * const acvp_kas_ffc_comp_hex[] = {
+    "p", "q", "g", "ephemeralPublicServer", "ephemeralPrivateIut",
+    "ephemeralPublicIut", "hashZIut", NULL
+};
+
 /*
  * This table maps ACVP operations to handlers within libacvp.
  * Each ACVP operation may have unique parameters.  For instance,
@@ -130,12 +162,12 @@ ACVP_ALG_HANDLER alg_tbl[ACVP_ALG_MAX] = {
     { ACVP_CMAC_TDES,         &acvp_cmac_kat_handler,         ACVP_ALG_CMAC_TDES,         NULL                    },
     { ACVP_DSA_KEYGEN,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_KEYGEN     },
     { ACVP_DSA_PQGGEN,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_PQGGEN     },
-    { ACVP_DSA_PQGVER,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_PQGVER     },
+    { ACVP_DSA_PQGVER,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_PQGVER,    acvp_dsa_pqgver_hex   },
     { ACVP_DSA_SIGGEN,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_SIGGEN     },
     { ACVP_DSA_SIGVER,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_SIGVER     },
     { ACVP_RSA_KEYGEN,        &acvp_rsa_keygen_kat_handler,   ACVP_ALG_RSA,               ACVP_MODE_KEYGEN        },
     { ACVP_RSA_SIGGEN,        &acvp_rsa_siggen_kat_handler,   ACVP_ALG_RSA,               ACVP_MODE_SIGGEN        },
-    { ACVP_RSA_SIGVER,        &acvp_rsa_sigver_kat_handler,   ACVP_ALG_RSA,               ACVP_MODE_SIGVER        },
+    { ACVP_RSA_SIGVER,        &acvp_rsa_sigver_kat_handler,   ACVP_ALG_RSA,               ACVP_MODE_SIGVER,       acvp_rsa_sigver_hex   },
     { ACVP_ECDSA_KEYGEN,      &acvp_ecdsa_keygen_kat_handler, ACVP_ALG_ECDSA,             ACVP_MODE_KEYGEN        },
     { ACVP_ECDSA_KEYVER,      &acvp_ecdsa_keyver_kat_handler, ACVP_ALG_ECDSA,             ACVP_MODE_KEYVER        },
     { ACVP_ECDSA_SIGGEN,      &acvp_ecdsa_siggen_kat_handler, ACVP_ALG_ECDSA,             ACVP_MODE_SIGGEN        },
@@ -151,10 +183,99 @@ ACVP_ALG_HANDLER alg_tbl[ACVP_ALG_MAX] = {
     { ACVP_KAS_ECC_CDH,       &acvp_kas_ecc_kat_handler,      ACVP_ALG_KAS_ECC,           ACVP_ALG_KAS_ECC_CDH    },
     { ACVP_KAS_ECC_COMP,      &acvp_kas_ecc_kat_handler,      ACVP_ALG_KAS_ECC,           ACVP_ALG_KAS_ECC_COMP   },
     { ACVP_KAS_ECC_NOCOMP,    &acvp_kas_ecc_kat_handler,      ACVP_ALG_KAS_ECC,           ACVP_ALG_KAS_ECC_NOCOMP },
-    { ACVP_KAS_FFC_COMP,      &acvp_kas_ffc_kat_handler,      ACVP_ALG_KAS_FFC,           ACVP_ALG_KAS_FFC_COMP   },
+    { ACVP_KAS_FFC_COMP,      &acvp_kas_ffc_kat_handler,      ACVP_ALG_KAS_FFC,           ACVP_ALG_KAS_FFC_COMP,  acvp_kas_ffc_comp_hex },
     { ACVP_KAS_FFC_NOCOMP,    &acvp_kas_ffc_kat_handler,      ACVP_ALG_KAS_FFC,           ACVP_ALG_KAS_FFC_NOCOMP }
 };
 
+/*
+ * Tells whether the algorithm and mode parsed so far name the
+ * vector set's alg_tbl[] entry.  JSON objects are unordered, so
+ * either may still be to come, and the algorithms that have modes
+ * need both.
+ */
+static int acvp_vs_alg_known(const char *alg, const char *mode) {
+    const ACVP_ALG_HANDLER *entry = NULL;
+
+    if (!alg) {
+        return 0;
+    }
+    if (mode) {
+        return 1;
+    }
+    entry = acvp_lookup_alg_entry(acvp_lookup_cipher_index(alg));
+    return !entry || !entry->mode;
+}
+
+/*
+ * Hex callback of the vector set parser: decodes the hex_fields of
+ * the vector set's alg_tbl[] entry.  The entry is looked up once the
+ * algorithm and mode of the vector set have been parsed.  Members
+ * parsed before that stay text, acvp_tc_hex() decodes them later.
+ */
+static int acvp_hex_field(JSON_Stream *stream, const char *name, void *arg) {
+    ACVP_VS_CTX *vs_ctx = (ACVP_VS_CTX *)arg;
+    const ACVP_ALG_HANDLER *entry = NULL;
+    const char *alg = NULL, *mode = NULL;
+    int i, diff;
+
+    if (!vs_ctx->hex_fields_known) {
+        alg = json_stream_get_outer_string(stream, "algorithm");
+        mode = json_stream_get_outer_string(stream, "mode");
+        if (!acvp_vs_alg_known(alg, mode)) {
+            return 0;
+        }
+        if (mode) {
+            entry = acvp_lookup_alg_entry(acvp_lookup_cipher_w_mode_index(alg, mode));
+        } else {
+            entry = acvp_lookup_alg_entry(acvp_lookup_cipher_index(alg));
+        }
+        vs_ctx->hex_fields = entry ? entry->hex_fields : NULL;
+        vs_ctx->hex_fields_known = 1;
+    }
+    for (i = 0; vs_ctx->hex_fields && vs_ctx->hex_fields[i]; i++) {
+        strcmp_s(vs_ctx->hex_fields[i], ACVP_HEX_FIELD_MAX, name, &diff);
+        if (!diff) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Creates the parser for one vector set.  With group_cb set the
+ * test groups are handed to it as they arrive.
+ */
+static JSON_Stream *acvp_vs_parser(ACVP_VS_CTX *vs_ctx, JSON_Stream_Callback group_cb) {
+    JSON_Stream *stream = NULL;
+
+    stream = json_stream_init(group_cb ? "testGroups" : NULL, group_cb, vs_ctx);
+    if (stream) {
+        vs_ctx->hex_fields = NULL;
+        vs_ctx->hex_fields_known = 0;
+        json_stream_set_hex_callback(stream, &acvp_hex_field, vs_ctx);
+    }
+    return stream;
+}
+
+/*
+ * Parses a vector set that is already in memory, with the same
+ * hex decoding as one that is parsed while it downloads.
+ */
+static JSON_Value *acvp_parse_vector_set(ACVP_VS_CTX *vs_ctx, const char *json, size_t len) {
+    JSON_Stream *stream = NULL;
+    JSON_Value *val = NULL;
+
+    stream = acvp_vs_parser(vs_ctx, NULL);
+    if (!stream) {
+        return NULL;
+    }
+    if (json_stream_feed(stream, json, len) == JSONSuccess) {
+        val = json_stream_finish(stream);
+    }
+    json_stream_free(stream);
+    return val;
+}
+
 /*
  * This is the first function the user should invoke to allocate
  * a new context to be used for the test session.
@@ -179,6 +300,8 @@ ACVP_RESULT acvp_create_test_session(ACVP_CTX **ctx,
     }
 
     (*ctx)->debug = level;
+    (*ctx)->max_concurrency = 1;
+    acvp_json_init();
 
     return ACVP_SUCCESS;
 }
@@ -593,13 +716,16 @@ ACVP_RESULT acvp_free_test_session(ACVP_CTX *ctx) {
     ACVP_DEPENDENCY_LIST *dep_entry, *dep_e2;
 
     if (ctx) {
-        if (ctx->reg_buf) { free(ctx->reg_buf); }
+        if (ctx->async_started) {
+            acvp_cancel(ctx);
+            acvp_wait(ctx, -1, NULL);
+        }
+        acvp_transport_close(ctx, NULL);
+        acvp_http_body_free(&ctx->reg_buf);
         if (ctx->ans_buf) { free(ctx->ans_buf); }
         if (ctx->login_buf) { free(ctx->login_buf); }
-        if (ctx->test_sess_buf) { free(ctx->test_sess_buf); }
-        if (ctx->kat_buf) { free(ctx->kat_buf); }
-        if (ctx->upld_buf) { free(ctx->upld_buf); }
-        if (ctx->kat_resp) { json_value_free(ctx->kat_resp); }
+        acvp_http_body_free(&ctx->test_sess_buf);
+        acvp_http_body_free(&ctx->sample_buf);
         if (ctx->server_name) { free(ctx->server_name); }
         if (ctx->vendor_url) { free(ctx->vendor_url); }
         if (ctx->module_url) { free(ctx->module_url); }
@@ -620,6 +746,8 @@ ACVP_RESULT acvp_free_test_session(ACVP_CTX *ctx) {
         if (ctx->tls_cert) { free(ctx->tls_cert); }
         if (ctx->tls_key) { free(ctx->tls_key); }
         if (ctx->json_filename) { free(ctx->json_filename); }
+        if (ctx->vs_cache_dir) { free(ctx->vs_cache_dir); }
+        if (ctx->session_file) { free(ctx->session_file); }
         if (ctx->vs_list) {
             vs_entry = ctx->vs_list;
             while (vs_entry) {
@@ -1135,6 +1263,149 @@ ACVP_RESULT acvp_mark_as_sample(ACVP_CTX *ctx) {
     return ACVP_SUCCESS;
 }
 
+ACVP_RESULT acvp_set_max_concurrency(ACVP_CTX *ctx, int max) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (max < 1 || max > ACVP_MAX_CONCURRENCY) {
+        ACVP_LOG_ERR("Concurrency must be between 1 and %d", ACVP_MAX_CONCURRENCY);
+        return ACVP_INVALID_ARG;
+    }
+#ifdef WIN32
+    if (max > 1) {
+        ACVP_LOG_ERR("Parallel vector set processing is not supported on this platform");
+        return ACVP_UNSUPPORTED_OP;
+    }
+#endif
+    ctx->max_concurrency = max;
+    return ACVP_SUCCESS;
+}
+
+ACVP_RESULT acvp_set_pipeline_depth(ACVP_CTX *ctx, int depth) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (depth < 0 || depth > ACVP_MAX_PIPELINE_DEPTH) {
+        ACVP_LOG_ERR("Pipeline depth must be between 0 and %d", ACVP_MAX_PIPELINE_DEPTH);
+        return ACVP_INVALID_ARG;
+    }
+#ifdef WIN32
+    if (depth) {
+        ACVP_LOG_ERR("Pipelined vector set processing is not supported on this platform");
+        return ACVP_UNSUPPORTED_OP;
+    }
+#endif
+    ctx->pipeline_depth = depth;
+    return ACVP_SUCCESS;
+}
+
+ACVP_RESULT acvp_set_retry_limit(ACVP_CTX *ctx, int max_attempts) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (max_attempts < 0) {
+        ACVP_LOG_ERR("Retry limit must not be negative");
+        return ACVP_INVALID_ARG;
+    }
+    ctx->retry_limit = max_attempts;
+    return ACVP_SUCCESS;
+}
+
+ACVP_RESULT acvp_set_vs_cache_dir(ACVP_CTX *ctx, const char *dir) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!dir) {
+        return ACVP_MISSING_ARG;
+    }
+#ifdef WIN32
+    ACVP_LOG_ERR("The vector set cache is not supported on this platform");
+    return ACVP_UNSUPPORTED_OP;
+#else
+    if (strnlen_s(dir, ACVP_VS_PATH_MAX + 1) > ACVP_VS_PATH_MAX - ACVP_VS_CACHE_NAME_MAX) {
+        ACVP_LOG_ERR("Vector set cache directory name is too long");
+        return ACVP_INVALID_ARG;
+    }
+
+    if (ctx->vs_cache_dir) { free(ctx->vs_cache_dir); }
+    ctx->vs_cache_dir = calloc(ACVP_VS_PATH_MAX + 1, sizeof(char));
+    if (!ctx->vs_cache_dir) {
+        return ACVP_MALLOC_FAIL;
+    }
+    strcpy_s(ctx->vs_cache_dir, ACVP_VS_PATH_MAX + 1, dir);
+    return ACVP_SUCCESS;
+#endif
+}
+
+ACVP_RESULT acvp_set_session_file(ACVP_CTX *ctx, const char *file) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!file) {
+        return ACVP_MISSING_ARG;
+    }
+#ifdef WIN32
+    ACVP_LOG_ERR("Saving the test session is not supported on this platform");
+    return ACVP_UNSUPPORTED_OP;
+#else
+    if (strnlen_s(file, ACVP_VS_PATH_MAX + 1) > ACVP_VS_PATH_MAX) {
+        ACVP_LOG_ERR("Session file name is too long");
+        return ACVP_INVALID_ARG;
+    }
+
+    if (ctx->session_file) { free(ctx->session_file); }
+    ctx->session_file = calloc(ACVP_VS_PATH_MAX + 1, sizeof(char));
+    if (!ctx->session_file) {
+        return ACVP_MALLOC_FAIL;
+    }
+    strcpy_s(ctx->session_file, ACVP_VS_PATH_MAX + 1, file);
+    return ACVP_SUCCESS;
+#endif
+}
+
+ACVP_RESULT acvp_set_vs_hooks(ACVP_CTX *ctx,
+                              int (*vs_begin)(ACVP_CIPHER cipher, void **module_vs_ctx),
+                              void (*vs_end)(ACVP_CIPHER cipher, void *module_vs_ctx)) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!vs_begin) {
+        ACVP_LOG_ERR("NULL parameter 'vs_begin'");
+        return ACVP_INVALID_ARG;
+    }
+    ctx->vs_begin_cb = vs_begin;
+    ctx->vs_end_cb = vs_end;
+    return ACVP_SUCCESS;
+}
+
+ACVP_RESULT acvp_set_group_hooks(ACVP_CTX *ctx,
+                                 int (*group_begin)(ACVP_CIPHER cipher, void *module_vs_ctx,
+                                                    void **module_group_ctx),
+                                 void (*group_end)(ACVP_CIPHER cipher, void *module_vs_ctx,
+                                                   void *module_group_ctx)) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!group_begin) {
+        ACVP_LOG_ERR("NULL parameter 'group_begin'");
+        return ACVP_INVALID_ARG;
+    }
+    ctx->group_begin_cb = group_begin;
+    ctx->group_end_cb = group_end;
+    return ACVP_SUCCESS;
+}
+
+ACVP_RESULT acvp_get_handshakes_avoided(ACVP_CTX *ctx, int *count) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!count) {
+        return ACVP_INVALID_ARG;
+    }
+    *count = ctx->handshakes_avoided;
+    return ACVP_SUCCESS;
+}
+
 /*
  * This function builds the JSON login message that
  * will be sent to the ACVP server to perform the
@@ -1191,6 +1462,291 @@ err:
     return rv;
 }
 
+#ifndef WIN32
+/*
+ * Returns when the JWT expires, in seconds since the epoch, from the
+ * "exp" claim of its base64url encoded payload.  Returns 0 if that
+ * can't be told.
+ */
+static long long acvp_jwt_expiry(const char *jwt) {
+    static const char b64url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    const char *payload = NULL, *end = NULL, *c = NULL;
+    char *json = NULL;
+    JSON_Value *val = NULL;
+    long long exp = 0;
+    unsigned int bits = 0;
+    int nbits = 0, len = 0;
+
+    payload = jwt ? strchr(jwt, '.') : NULL;
+    end = payload ? strchr(payload + 1, '.') : NULL;
+    if (!end) {
+        return 0;
+    }
+    payload++;
+
+    json = calloc(end - payload + 1, sizeof(char));
+    if (!json) {
+        return 0;
+    }
+    for (; payload < end; payload++) {
+        c = strchr(b64url, *payload);
+        if (!c) {
+            goto end;
+        }
+        bits = (bits << 6) | (unsigned int)(c - b64url);
+        nbits += 6;
+        if (nbits >= 8) {
+            nbits -= 8;
+            json[len++] = (char)(bits >> nbits);
+        }
+    }
+
+    val = json_parse_string(json);
+    exp = (long long)json_object_get_number(json_value_get_object(val), "exp");
+    if (exp < 0) {
+        exp = 0;
+    }
+
+end:
+    if (val) { json_value_free(val); }
+    free(json);
+    return exp;
+}
+
+/*
+ * Sets ctx->session_reg_sum to the checksum of the registration that
+ * the capabilities now enabled on ctx make, so that a saved session
+ * is only reattached to when it was registered with the same ones.
+ */
+static ACVP_RESULT acvp_session_reg_sum(ACVP_CTX *ctx) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    JSON_Value *val = NULL;
+    char *reg = NULL;
+    int reg_len = 0;
+
+    if (ctx->use_json == 1) {
+        val = json_parse_file(ctx->json_filename);
+        if (val) {
+            reg = json_serialize_to_string(val, &reg_len);
+            json_value_free(val);
+        }
+        if (!reg) {
+            return ACVP_JSON_ERR;
+        }
+    } else {
+        rv = acvp_build_test_session(ctx, &reg, &reg_len);
+        if (rv != ACVP_SUCCESS) {
+            return rv;
+        }
+    }
+    ctx->session_reg_sum = acvp_checksum(ACVP_CHECKSUM_INIT, reg, reg_len);
+    json_free_serialized_string(reg);
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Writes the test session, its access token and vector set URLs to
+ * ctx->session_file, along with the checksum of the registration and
+ * whether the session's results are in.  The file holds a credential,
+ * so it is only readable by its owner.  A failure is logged but
+ * doesn't stop the session, it only can't be reattached to.
+ */
+static void acvp_session_file_save(ACVP_CTX *ctx) {
+    char tmp[ACVP_VS_PATH_MAX + 5];
+    char sum[17];
+    JSON_Value *val = NULL;
+    JSON_Object *obj = NULL;
+    JSON_Array *urls = NULL;
+    ACVP_STRING_LIST *vs = NULL;
+    char *data = NULL;
+    int len = 0, done = 0, fd = -1, ok = 0;
+    ssize_t n;
+
+    if (!ctx->session_file || !ctx->session_url) {
+        return;
+    }
+
+    val = json_value_init_object();
+    obj = json_value_get_object(val);
+    json_object_set_string(obj, "server", ctx->server_name);
+    json_object_set_number(obj, "port", ctx->server_port);
+    json_object_set_string(obj, "url", ctx->session_url);
+    snprintf(sum, sizeof(sum), "%016llx", ctx->session_reg_sum);
+    json_object_set_string(obj, "registration", sum);
+    if (ctx->session_completed) {
+        json_object_set_boolean(obj, "completed", 1);
+    }
+    if (ctx->jwt_token) {
+        json_object_set_string(obj, "accessToken", ctx->jwt_token);
+        json_object_set_number(obj, "accessTokenExpires", (double)acvp_jwt_expiry(ctx->jwt_token));
+    }
+    json_object_set_value(obj, "vectorSetUrls", json_value_init_array());
+    urls = json_object_get_array(obj, "vectorSetUrls");
+    for (vs = ctx->vsid_url_list; vs; vs = vs->next) {
+        json_array_append_string(urls, vs->string);
+    }
+    data = json_serialize_to_string(val, &len);
+    if (!data) {
+        goto end;
+    }
+
+    /*
+     * A temporary copy left by an earlier run may have been created
+     * with wider permissions, so it is replaced rather than truncated.
+     */
+    snprintf(tmp, sizeof(tmp), "%s.tmp", ctx->session_file);
+    if (unlink(tmp) && errno != ENOENT) {
+        goto end;
+    }
+    fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        goto end;
+    }
+    for (; done < len; done += n) {
+        n = write(fd, data + done, len - done);
+        if (n <= 0) {
+            break;
+        }
+    }
+    ok = done == len && !fsync(fd);
+    ok = !close(fd) && ok && !rename(tmp, ctx->session_file);
+    if (!ok) {
+        remove(tmp);
+    }
+
+end:
+    if (!ok) {
+        ACVP_LOG_WARN("Unable to save the test session to %s", ctx->session_file);
+    }
+    if (data) { json_free_serialized_string(data); }
+    json_value_free(val);
+}
+
+/*
+ * Called once the results of the session are in.  The file of a
+ * session that passed is removed, any other is marked completed, so
+ * that the next acvp_register() starts a new test session either way.
+ */
+static void acvp_session_file_done(ACVP_CTX *ctx, int passed) {
+    if (!ctx->session_file) {
+        return;
+    }
+    if (passed) {
+        if (remove(ctx->session_file) && errno != ENOENT) {
+            ACVP_LOG_WARN("Unable to remove %s", ctx->session_file);
+        }
+        return;
+    }
+    ctx->session_completed = 1;
+    acvp_session_file_save(ctx);
+}
+
+/*
+ * Reattaches ctx to the test session in ctx->session_file, getting a
+ * new access token first if the saved one has expired.  Returns
+ * ACVP_NO_DATA if there is no saved session for this server and
+ * these capabilities, or if the saved one is finished.
+ */
+static ACVP_RESULT acvp_session_file_load(ACVP_CTX *ctx) {
+    ACVP_RESULT rv = ACVP_NO_DATA;
+    JSON_Value *val = NULL;
+    JSON_Object *obj = NULL;
+    JSON_Array *urls = NULL;
+    const char *server = NULL, *url = NULL, *jwt = NULL, *vsid_url = NULL, *reg_sum = NULL;
+    char sum[17];
+    long long expires;
+    int i, count, diff = 1;
+
+    val = json_parse_file(ctx->session_file);
+    if (!val) {
+        return ACVP_NO_DATA;
+    }
+    obj = json_value_get_object(val);
+    server = json_object_get_string(obj, "server");
+    url = json_object_get_string(obj, "url");
+    jwt = json_object_get_string(obj, "accessToken");
+    urls = json_object_get_array(obj, "vectorSetUrls");
+    count = json_array_get_count(urls);
+    if (server && ctx->server_name) {
+        strcmp_s(ctx->server_name, ACVP_SESSION_PARAMS_STR_LEN_MAX, server, &diff);
+    }
+    if (diff || (int)json_object_get_number(obj, "port") != ctx->server_port) {
+        ACVP_LOG_WARN("%s is for another server, registering a new test session", ctx->session_file);
+        goto end;
+    }
+    snprintf(sum, sizeof(sum), "%016llx", ctx->session_reg_sum);
+    reg_sum = json_object_get_string(obj, "registration");
+    diff = 1;
+    if (reg_sum) {
+        strcmp_s(sum, sizeof(sum), reg_sum, &diff);
+    }
+    if (diff) {
+        ACVP_LOG_WARN("%s was registered with other capabilities, registering a new test session",
+                      ctx->session_file);
+        goto end;
+    }
+    if (json_object_get_boolean(obj, "completed") == 1) {
+        ACVP_LOG_WARN("%s is a finished test session, registering a new one", ctx->session_file);
+        goto end;
+    }
+    if (!url || strnlen_s(url, ACVP_ATTR_URL_MAX + 1) > ACVP_ATTR_URL_MAX || !count ||
+        (jwt && strnlen_s(jwt, ACVP_JWT_TOKEN_MAX + 1) > ACVP_JWT_TOKEN_MAX)) {
+        ACVP_LOG_WARN("%s is not a saved test session, registering a new one", ctx->session_file);
+        goto end;
+    }
+    for (i = 0; i < count; i++) {
+        vsid_url = json_array_get_string(urls, i);
+        if (!vsid_url || strnlen_s(vsid_url, ACVP_ATTR_URL_MAX + 1) > ACVP_ATTR_URL_MAX) {
+            ACVP_LOG_WARN("%s is not a saved test session, registering a new one", ctx->session_file);
+            goto end;
+        }
+    }
+
+    if (ctx->session_url) { free(ctx->session_url); }
+    ctx->session_url = calloc(ACVP_ATTR_URL_MAX + 1, sizeof(char));
+    if (!ctx->session_url) {
+        rv = ACVP_MALLOC_FAIL;
+        goto end;
+    }
+    strcpy_s(ctx->session_url, ACVP_ATTR_URL_MAX + 1, url);
+    if (jwt) {
+        if (ctx->jwt_token) { free(ctx->jwt_token); }
+        ctx->jwt_token = calloc(ACVP_JWT_TOKEN_MAX + 1, sizeof(char));
+        if (!ctx->jwt_token) {
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
+        strcpy_s(ctx->jwt_token, ACVP_JWT_TOKEN_MAX + 1, jwt);
+    }
+    if (ctx->vsid_url_list) {
+        acvp_cap_free_strl(ctx->vsid_url_list);
+        ctx->vsid_url_list = NULL;
+    }
+    for (i = 0; i < count; i++) {
+        rv = acvp_append_vsid_url(ctx, (char *)json_array_get_string(urls, i));
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
+    }
+    ACVP_LOG_STATUS("Reattached to test session %s with %d vector sets from %s",
+                    ctx->session_url, count, ctx->session_file);
+
+    /*
+     * A token expiring within the margin wouldn't last long enough
+     * to be worth using, a token of unknown expiry is tried as is.
+     */
+    expires = (long long)json_object_get_number(obj, "accessTokenExpires");
+    if (jwt && expires && expires - ACVP_JWT_EXPIRY_MARGIN <= (long long)time(NULL)) {
+        ACVP_LOG_STATUS("Saved access token has expired, refreshing it");
+        rv = acvp_refresh(ctx);
+    }
+
+end:
+    json_value_free(val);
+    return rv;
+}
+#endif
+
 /*
  * This function is used to register the DUT with the server.
  * Registration allows the DUT to advertise it's capabilities to
@@ -1212,13 +1768,32 @@ ACVP_RESULT acvp_register(ACVP_CTX *ctx) {
         return ACVP_NO_CTX;
     }
 
+#ifndef WIN32
     /*
-     * Construct the login message
+     * A test session saved by an earlier run is picked up again
+     * without logging in or registering, if it was registered with
+     * the same capabilities and isn't finished yet.
      */
-    if (ctx->totp_cb) {
-        rv = acvp_build_login(ctx, &login, &login_len, 0);
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Unable to build login message");
+    if (ctx->session_file) {
+        ctx->session_completed = 0;
+        rv = acvp_session_reg_sum(ctx);
+        if (rv == ACVP_SUCCESS) {
+            rv = acvp_session_file_load(ctx);
+            if (rv != ACVP_NO_DATA) {
+                return rv;
+            }
+        }
+        rv = ACVP_SUCCESS;
+    }
+#endif
+
+    /*
+     * Construct the login message
+     */
+    if (ctx->totp_cb) {
+        rv = acvp_build_login(ctx, &login, &login_len, 0);
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("Unable to build login message");
             goto end;
         }
 
@@ -1233,10 +1808,10 @@ ACVP_RESULT acvp_register(ACVP_CTX *ctx) {
          */
         rv = acvp_send_login(ctx, login, login_len);
         if (rv == ACVP_SUCCESS) {
-            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf);
+            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf.data);
             rv = acvp_parse_login(ctx);
         } else {
-            ACVP_LOG_STATUS("Login Send Failed %s", ctx->reg_buf);
+            ACVP_LOG_STATUS("Login Send Failed %s", ctx->reg_buf.data);
             goto end;
         }
         if (rv != ACVP_SUCCESS) {
@@ -1258,7 +1833,7 @@ ACVP_RESULT acvp_register(ACVP_CTX *ctx) {
         }
         rv = acvp_send_vendor_registration(ctx, vendors);
         if (rv == ACVP_SUCCESS) {
-            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf);
+            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf.data);
             rv = acvp_parse_vendors(ctx);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Failed to parse vendor response");
@@ -1275,7 +1850,7 @@ ACVP_RESULT acvp_register(ACVP_CTX *ctx) {
         }
         rv = acvp_send_module_registration(ctx, modules);
         if (rv == ACVP_SUCCESS) {
-            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf);
+            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf.data);
             rv = acvp_parse_modules(ctx);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Failed to parse module response");
@@ -1295,7 +1870,7 @@ ACVP_RESULT acvp_register(ACVP_CTX *ctx) {
             }
             rv = acvp_send_dep_registration(ctx, dep);
             if (rv == ACVP_SUCCESS) {
-                ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf);
+                ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf.data);
                 rv = acvp_parse_dependencies(ctx, current_dep);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("Failed to parse dependency response");
@@ -1314,7 +1889,7 @@ ACVP_RESULT acvp_register(ACVP_CTX *ctx) {
         }
         rv = acvp_send_oe_registration(ctx, oes);
         if (rv == ACVP_SUCCESS) {
-            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf);
+            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf.data);
             rv = acvp_parse_oes(ctx);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Failed to parse oe response");
@@ -1334,7 +1909,7 @@ ACVP_RESULT acvp_register(ACVP_CTX *ctx) {
             goto end;
         }
         rv = acvp_send_test_session_registration(ctx, reg, reg_len);
-        ACVP_LOG_STATUS("Sending registration: %s", ctx->reg_buf);
+        ACVP_LOG_STATUS("Sending registration: %s", ctx->reg_buf.data);
         if (rv == ACVP_SUCCESS) {
             ACVP_LOG_STATUS("200 OK");
             rv = acvp_parse_test_session_register(ctx);
@@ -1356,9 +1931,14 @@ ACVP_RESULT acvp_register(ACVP_CTX *ctx) {
     } else {
         ACVP_LOG_INFO("POST %s", reg);
     }
+#ifndef WIN32
+    if (rv == ACVP_SUCCESS) {
+        acvp_session_file_save(ctx);
+    }
+#endif
 
 end:
-    if (login) free(login);
+    if (login) json_free_serialized_string(login);
     if (reg) json_free_serialized_string(reg);
 #if 0 // TODO these endpoints are NOT availble via API yet
     if (vendors) json_free_serialized_string(vendors);
@@ -1441,7 +2021,7 @@ static JSON_Object *acvp_get_obj_from_rsp(JSON_Value *arry_val) {
 static ACVP_RESULT acvp_parse_login(ACVP_CTX *ctx) {
     JSON_Value *val;
     JSON_Object *obj = NULL;
-    char *json_buf = ctx->reg_buf;
+    char *json_buf = ctx->reg_buf.data;
     const char *jwt;
     ACVP_RESULT rv = ACVP_SUCCESS;
 
@@ -1473,6 +2053,7 @@ static ACVP_RESULT acvp_parse_login(ACVP_CTX *ctx) {
             goto end;
         }
 
+        if (ctx->jwt_token) { free(ctx->jwt_token); }
         ctx->jwt_token = calloc(ACVP_JWT_TOKEN_MAX + 1, sizeof(char));
         strcpy_s(ctx->jwt_token, ACVP_JWT_TOKEN_MAX + 1, jwt);
 
@@ -1492,7 +2073,7 @@ end:
 static ACVP_RESULT acvp_parse_vendors(ACVP_CTX *ctx) {
     JSON_Value *val;
     JSON_Object *obj = NULL;
-    char *json_buf = ctx->reg_buf;
+    char *json_buf = ctx->reg_buf.data;
     const char *vendor_url;
     ACVP_RESULT rv = ACVP_SUCCESS;
 
@@ -1536,7 +2117,7 @@ end:
 static ACVP_RESULT acvp_parse_oes(ACVP_CTX *ctx) {
     JSON_Value *val;
     JSON_Object *obj = NULL;
-    char *json_buf = ctx->reg_buf;
+    char *json_buf = ctx->reg_buf.data;
     const char *oe_url;
     ACVP_RESULT rv = ACVP_SUCCESS;
 
@@ -1580,7 +2161,7 @@ end:
 static ACVP_RESULT acvp_parse_modules(ACVP_CTX *ctx) {
     JSON_Value *val;
     JSON_Object *obj = NULL;
-    char *json_buf = ctx->reg_buf;
+    char *json_buf = ctx->reg_buf.data;
     const char *module_url;
     ACVP_RESULT rv = ACVP_SUCCESS;
 
@@ -1624,7 +2205,7 @@ end:
 static ACVP_RESULT acvp_parse_dependencies(ACVP_CTX *ctx, ACVP_DEPENDENCY_LIST *current_dep) {
     JSON_Value *val;
     JSON_Object *obj = NULL;
-    char *json_buf = ctx->reg_buf;
+    char *json_buf = ctx->reg_buf.data;
     const char *dep_url;
     ACVP_RESULT rv = ACVP_SUCCESS;
 
@@ -1670,7 +2251,7 @@ static ACVP_RESULT acvp_parse_test_session_register(ACVP_CTX *ctx) {
     JSON_Value *val;
     JSON_Object *obj = NULL;
     ACVP_RESULT rv;
-    char *json_buf = ctx->reg_buf;
+    char *json_buf = ctx->reg_buf.data;
     JSON_Array *vect_sets;
     char *test_session_url;
     int i, vs_cnt;
@@ -1714,299 +2295,2673 @@ end:
 }
 
 /*
- * This function is used by the application after registration
- * to commence the testing.  All the testing will be handled
- * by libacvp.  This function will block the caller.  Therefore,
- * it should be run on a separate thread if needed.
+ * Retry scheduling.  A vector set the server isn't ready to hand out
+ * is parked in a queue, ordered by when to ask for it again, and the
+ * vector sets that are ready get processed in the meantime.  The
+ * wait starts at the server's "retry" hint and doubles with each
+ * attempt up to ACVP_RETRY_TIME_MAX, plus up to a quarter of random
+ * jitter so parked vector sets don't all come due together.
  */
-ACVP_RESULT acvp_process_tests(ACVP_CTX *ctx) {
-    ACVP_RESULT rv = ACVP_SUCCESS;
-    ACVP_STRING_LIST *vs_entry = NULL;
+typedef struct acvp_retry_entry_t {
+    char *vsid_url;
+    int attempts;  /* downloads answered with "retry" so far */
+    long long due; /* acvp_now_ms() at which to ask again */
+    struct acvp_retry_entry_t *next;
+} ACVP_RETRY_ENTRY;
 
-    if (!ctx) {
-        return ACVP_NO_CTX;
+typedef struct acvp_retry_queue_t {
+    ACVP_RETRY_ENTRY *head; /* earliest due first */
+    unsigned int seed;      /* jitter state */
+} ACVP_RETRY_QUEUE;
+
+static long long acvp_now_ms(void) {
+#ifdef WIN32
+    return (long long)GetTickCount64();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+/*
+ * Monotonic clock in nanoseconds, for acvp_time_vector_set()
+ */
+static long long acvp_now_ns(void) {
+#ifdef WIN32
+    LARGE_INTEGER cnt, freq;
+
+    QueryPerformanceCounter(&cnt);
+    QueryPerformanceFrequency(&freq);
+    return (long long)(cnt.QuadPart * (1000000000.0 / freq.QuadPart));
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static void acvp_sleep_ms(long long ms) {
+    if (ms <= 0) {
+        return;
     }
+#ifdef WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts;
 
-    /*
-     * Iterate through the VS identifiers the server sent to us
-     * in the test session register response.  Process each vector set and
-     * return the results to the server.
-     */
-    vs_entry = ctx->vsid_url_list;
-    if (!vs_entry) {
-        return ACVP_MISSING_ARG;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+#ifndef WIN32
+/*
+ * Sets ts to ms from now, for pthread_cond_timedwait().
+ */
+void acvp_deadline(struct timespec *ts, long long ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
     }
-    while (vs_entry) {
-        rv = acvp_process_vsid(ctx, vs_entry->string);
-        vs_entry = vs_entry->next;
+}
+#endif
+
+static void acvp_retry_queue_init(ACVP_RETRY_QUEUE *q) {
+    q->head = NULL;
+    q->seed = (unsigned int)time(NULL) ^ (unsigned int)(size_t)q;
+    if (!q->seed) {
+        q->seed = 1;
     }
+}
 
-    return rv;
+static void acvp_retry_queue_free(ACVP_RETRY_QUEUE *q) {
+    ACVP_RETRY_ENTRY *e = NULL, *next = NULL;
+
+    for (e = q->head; e; e = next) {
+        next = e->next;
+        free(e);
+    }
+    q->head = NULL;
 }
 
 /*
- * This is a minimal retry handler, which pauses for a specific time.
- * This allows the server time to generate the vectors on behalf of
- * the client.
+ * Milliseconds to wait before asking again after the given number of
+ * "retry" answers.  hint is the server's retry period in seconds.
  */
-static ACVP_RESULT acvp_retry_handler(ACVP_CTX *ctx, unsigned int retry_period) {
-    ACVP_LOG_STATUS("200 OK KAT values not ready, server requests we wait and try again...");
-    if (retry_period <= 0 || retry_period > ACVP_RETRY_TIME_MAX) {
-        retry_period = ACVP_RETRY_TIME_MAX;
-        ACVP_LOG_WARN("retry_period not found, using max retry period!");
+static long long acvp_retry_delay_ms(ACVP_RETRY_QUEUE *q, unsigned int hint, int attempts) {
+    long long delay, max = ACVP_RETRY_TIME_MAX * 1000LL;
+
+    if (!hint || hint > ACVP_RETRY_TIME_MAX) {
+        hint = ACVP_RETRY_TIME_MAX;
     }
-    #ifdef WIN32
-    Sleep(retry_period);
-    #else
-    sleep(retry_period);
-    #endif
+    delay = hint * 1000LL;
+    while (--attempts > 0 && delay < max) {
+        delay *= 2;
+    }
+
+    /* xorshift32, only used to spread the polls out */
+    q->seed ^= q->seed << 13;
+    q->seed ^= q->seed >> 17;
+    q->seed ^= q->seed << 5;
+    delay += q->seed % (delay / 4 + 1);
 
-    return ACVP_KAT_DOWNLOAD_RETRY;
+    return delay < max ? delay : max;
 }
 
 /*
- * This routine will iterate through all the vector sets, requesting
- * the test result from the server for each set.
+ * Sleeps until due, waking up early if the session is cancelled.
  */
-ACVP_RESULT acvp_check_test_results(ACVP_CTX *ctx) {
-    ACVP_RESULT rv = ACVP_SUCCESS;
+static void acvp_sleep_until(ACVP_CTX *ctx, long long due) {
+    long long left;
 
-    if (!ctx) {
-        return ACVP_NO_CTX;
+    while (!ctx->cancel && (left = due - acvp_now_ms()) > 0) {
+        acvp_sleep_ms(left < ACVP_CANCEL_POLL_MS ? left : ACVP_CANCEL_POLL_MS);
     }
+}
 
-    rv = acvp_get_result_test_session(ctx, ctx->session_url);
-    return rv;
+/*
+ * Returns the vsId a vector set URL ends in, or 0 if it has none.
+ */
+static int acvp_vs_id_from_url(const char *vsid_url) {
+    const char *id = NULL;
+    char *end = NULL;
+    long vs_id;
+
+    id = strrchr(vsid_url, '/');
+    id = id ? id + 1 : vsid_url;
+    vs_id = strtol(id, &end, 10);
+    if (end == id || *end || vs_id <= 0 || vs_id != (int)vs_id) {
+        return 0;
+    }
+    return (int)vs_id;
 }
 
-/***************************************************************************************************************
-* Begin vector processing logic.  This code should probably go into another module.
-***************************************************************************************************************/
+#ifndef WIN32
+ACVP_LOCK_DECLARE(acvp_journal_lock);
 
-ACVP_RESULT acvp_refresh(ACVP_CTX *ctx) {
-    char *login = NULL;
-    int login_len = 0;
-    ACVP_RESULT rv = ACVP_SUCCESS;
+/*
+ * Appends one line to the acvp_resume_session() journal and flushes
+ * it to disk, so that the journal is good up to the last line even
+ * if the process dies right after.  Each line is a state and the
+ * vector set URL it applies to, "failed" lines end in the result.
+ */
+static void acvp_journal_write(ACVP_CTX *ctx, const char *state, const char *vsid_url, ACVP_RESULT rv) {
+    int n;
 
-    if (!ctx) {
-        return ACVP_NO_CTX;
+    if (!ctx->journal) {
+        return;
+    }
+    ACVP_LOCK(acvp_journal_lock);
+    if (rv != ACVP_SUCCESS) {
+        n = fprintf(ctx->journal, "%s %s %d\n", state, vsid_url, rv);
+    } else {
+        n = fprintf(ctx->journal, "%s %s\n", state, vsid_url);
+    }
+    if (n < 0 || fflush(ctx->journal) || fsync(fileno(ctx->journal))) {
+        ACVP_LOG_WARN("Unable to record %s %s in %s", state, vsid_url, ctx->journal_path);
     }
+    ACVP_UNLOCK(acvp_journal_lock);
+}
+#endif
 
-    if (ctx->totp_cb) {
-        rv = acvp_build_login(ctx, &login, &login_len, 1);
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Unable to build login message");
-            goto end;
-        }
+ACVP_LOCK_DECLARE(acvp_vs_done_lock);
 
-        if (ctx->debug >= ACVP_LOG_LVL_STATUS) {
-            printf("\nPOST %s\n", login);
-        } else {
-            ACVP_LOG_INFO("POST %s", login);
-        }
+/*
+ * Tells the application a vector set is finished, see
+ * acvp_process_tests_async(), and records it in the journal if
+ * there is one.  The lock keeps the callbacks from overlapping
+ * when several workers finish at once.
+ */
+static void acvp_vs_done(ACVP_CTX *ctx, char *vsid_url, int vs_id, const char *algorithm,
+                         const char *mode, int tc_count, long long start_ms, ACVP_RESULT rv) {
+    ACVP_VS_STATUS status;
 
-        /*
-         * Send the login to the ACVP server and get the response,
-         */
-        rv = acvp_send_login(ctx, login, login_len);
-        if (rv == ACVP_SUCCESS) {
-            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf);
-            rv = acvp_parse_login(ctx);
-        } else {
-            ACVP_LOG_STATUS("Login Send Failed %s", ctx->reg_buf);
-            goto end;
-        }
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_STATUS("Login Response Failed, %d", rv);
-        }
+#ifndef WIN32
+    acvp_journal_write(ctx, rv == ACVP_SUCCESS ? "uploaded" : "failed", vsid_url, rv);
+#endif
+    if (!ctx->vs_done_cb) {
+        return;
     }
-end:
-    free(login);
-    return rv;
+    status.vsid_url = vsid_url;
+    status.vs_id = vs_id;
+    status.algorithm = algorithm;
+    status.mode = mode;
+    status.tc_count = tc_count;
+    status.elapsed_ms = (long)(acvp_now_ms() - start_ms);
+    status.result = rv;
+
+    ACVP_LOCK(acvp_vs_done_lock);
+    ctx->vs_done_cb(ctx, &status, ctx->vs_done_arg);
+    ACVP_UNLOCK(acvp_vs_done_lock);
 }
 
 /*
- * This function will process a single KAT vector set.  Each KAT
- * vector set has an identifier associated with it, called
- * the vs_id.  During registration, libacvp will receive the
- * list of vs_id's that need to be processed during the test
- * session.  This routine will execute the test flow for a single
- * vs_id.  The flow is:
- *	a) Download the KAT vector set from the server using the vs_id
- *	b) Parse the KAT vectors
- *	c) Process each test case in the KAT vector set
- *	d) Generate the response data
- *	e) Send the response data back to the ACVP server
+ * Library wide limits set by acvp_init_lib().  Every vector set
+ * being worked on, in any session, holds one of max_workers slots:
+ * for all of its processing, or in a pipeline, for each stage.
  */
-static ACVP_RESULT acvp_process_vsid(ACVP_CTX *ctx, char *vsid_url) {
-    ACVP_RESULT rv = ACVP_SUCCESS;
-    JSON_Value *val = NULL;
-    JSON_Object *obj = NULL;
-    char *json_buf = NULL;
-    int retry = 1;
-
-    //TODO: do we want to limit the number of retries?
-    while (retry) {
-        /*
-         * Get the KAT vector set
-         */
-        rv = acvp_retrieve_vector_set(ctx, vsid_url);
-        if (rv != ACVP_SUCCESS) {
-            goto end;
-        }
-        json_buf = ctx->kat_buf;
-        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-            printf("\n200 OK %s\n", ctx->kat_buf);
-        } else {
-            ACVP_LOG_STATUS("200 OK %s\n", ctx->kat_buf);
-        }
-        val = json_parse_string(json_buf);
-        if (!val) {
-            ACVP_LOG_ERR("JSON parse error");
-            rv = ACVP_JSON_ERR;
-            goto end;
-        }
-        obj = acvp_get_obj_from_rsp(val);
-        ctx->vsid_url = vsid_url;
+static int lib_refs;
+static int lib_max_workers;
+#ifndef WIN32
+static int lib_busy_workers;
+static pthread_mutex_t lib_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t lib_slot_free = PTHREAD_COND_INITIALIZER;
+#endif
 
-        /*
-         * Check if we received a retry response
-         */
-        unsigned int retry_period = json_object_get_number(obj, "retry");
-        if (retry_period) {
-            rv = acvp_retry_handler(ctx, retry_period);
-        } else {
-            /*
-             * Process the KAT vectors
-             */
-            rv = acvp_process_vector_set(ctx, obj);
-        }
-        json_value_free(val);
+/*
+ * Takes a worker slot, waiting for one if the library wide limit
+ * is reached.  Returns 0 if the session was cancelled meanwhile,
+ * unless the work has to be done regardless, as for uploads.
+ */
+static int acvp_lib_worker_enter(ACVP_CTX *ctx, int cancellable) {
+#ifndef WIN32
+    struct timespec ts;
 
-        /*
-         * Check if we need to retry the download because
-         * the KAT values were not ready
-         */
-        if (ACVP_KAT_DOWNLOAD_RETRY == rv) {
-            retry = 1;
-        } else if (rv != ACVP_SUCCESS) {
-            return rv;
-        } else {
-            retry = 0;
-        }
+    if (!lib_max_workers) {
+        return 1;
     }
+    pthread_mutex_lock(&lib_lock);
+    while (lib_busy_workers >= lib_max_workers && !(cancellable && ctx->cancel)) {
+        acvp_deadline(&ts, ACVP_CANCEL_POLL_MS);
+        pthread_cond_timedwait(&lib_slot_free, &lib_lock, &ts);
+    }
+    if (cancellable && ctx->cancel) {
+        pthread_mutex_unlock(&lib_lock);
+        return 0;
+    }
+    lib_busy_workers++;
+    pthread_mutex_unlock(&lib_lock);
+#endif
+    return 1;
+}
 
-    /*
-     * Send the responses to the ACVP server
-     */
-    ACVP_LOG_STATUS("POST vector set response vsId: %d", ctx->vs_id);
-    rv = acvp_submit_vector_responses(ctx);
-end:
-    return rv;
+static void acvp_lib_worker_leave(void) {
+#ifndef WIN32
+    if (!lib_max_workers) {
+        return;
+    }
+    pthread_mutex_lock(&lib_lock);
+    lib_busy_workers--;
+    pthread_cond_signal(&lib_slot_free);
+    pthread_mutex_unlock(&lib_lock);
+#endif
 }
 
 /*
- * This function is used to invoke the appropriate handler function
- * for a given ACV operation.  The operation is specified in the
- * KAT vector set that was previously downloaded.  The handler function
- * is looked up in the alg_tbl[] and invoked here.
+ * Held across acvp_init_lib() and acvp_cleanup_lib(), so sessions
+ * started from several threads can't set up or tear down the
+ * library wide state twice.
  */
-static ACVP_RESULT acvp_dispatch_vector_set(ACVP_CTX *ctx, JSON_Object *obj) {
-    int i;
-    const char *alg = json_object_get_string(obj, "algorithm");
-    const char *mode = json_object_get_string(obj, "mode");
-    int vs_id = json_object_get_number(obj, "vsId");
-    int diff = 1;
+ACVP_LOCK_DECLARE(acvp_lib_init_lock);
 
-    ctx->vs_id = vs_id;
-    ACVP_RESULT rv;
+ACVP_RESULT acvp_init_lib(int max_workers, int max_conns) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
 
-    if (!alg) {
-        ACVP_LOG_ERR("JSON parse error: ACV algorithm not found");
-        return ACVP_JSON_ERR;
+    if (max_workers < 0 || max_conns < 0) {
+        return ACVP_INVALID_ARG;
+    }
+    ACVP_LOCK(acvp_lib_init_lock);
+    if (lib_refs) {
+        lib_refs++;
+        goto end;
     }
 
-    ACVP_LOG_STATUS("vs: %d", vs_id);
-    ACVP_LOG_STATUS("ACV Operation: %s", alg);
-    ACVP_LOG_INFO("ACV version: %s", json_object_get_string(obj, "acvVersion"));
+    rv = acvp_transport_lib_init(max_conns);
+    if (rv != ACVP_SUCCESS) {
+        goto end;
+    }
+    lib_max_workers = max_workers;
+    lib_refs = 1;
 
-    for (i = 0; i < ACVP_ALG_MAX; i++) {
-        strcmp_s(alg_tbl[i].name,
-                 ACVP_ALG_NAME_MAX,
-                 alg, &diff);
-        if (!diff) {
-            if (mode == NULL) {
-                rv = (alg_tbl[i].handler)(ctx, obj);
-                return rv;
-            }
+end:
+    ACVP_UNLOCK(acvp_lib_init_lock);
+    return rv;
+}
 
-            if (alg_tbl[i].mode != NULL) {
-                strcmp_s(alg_tbl[i].mode,
-                        ACVP_ALG_MODE_MAX,
-                        mode, &diff);
-                if (!diff) {
-                    rv = (alg_tbl[i].handler)(ctx, obj);
-                    return rv;
-                }
-            }
-        }
+ACVP_RESULT acvp_cleanup_lib(void) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+
+    ACVP_LOCK(acvp_lib_init_lock);
+    if (!lib_refs) {
+        rv = ACVP_NO_DATA;
+        goto end;
     }
-    return ACVP_UNSUPPORTED_OP;
+    if (--lib_refs) {
+        goto end;
+    }
+
+    acvp_transport_lib_cleanup();
+    lib_max_workers = 0;
+
+end:
+    ACVP_UNLOCK(acvp_lib_init_lock);
+    return rv;
 }
 
 /*
- * This function is used to process the test cases for
- * a given KAT vector set.  This is invoked after the
- * KAT vector set has been downloaded from the server.  The
- * vectors are stored on the ACVP_CTX in one of the
- * transitory fields.  Therefore, the vs_id isn't needed
- * here to know which vectors need to be processed.
- *
- * The processing logic is:
- *	a) JSON parse the data
- *	b) Identify the ACVP operation to be performed (e.g. AES encrypt)
- *	c) Dispatch the vectors to the handler for the
- *	   specified ACVP operation.
+ * Parks vsid_url after its attempts'th "retry" answer.  Fails with
+ * ACVP_KAT_DOWNLOAD_RETRY once ctx->retry_limit attempts were made.
  */
-static ACVP_RESULT acvp_process_vector_set(ACVP_CTX *ctx, JSON_Object *obj) {
-    ACVP_RESULT rv;
-
-    rv = acvp_dispatch_vector_set(ctx, obj);
-    if (rv != ACVP_SUCCESS) {
-        return rv;
+static ACVP_RESULT acvp_retry_park(ACVP_CTX *ctx, ACVP_RETRY_QUEUE *q, char *vsid_url,
+                                   int attempts, unsigned int hint) {
+    ACVP_RETRY_ENTRY *e = NULL, **pos = NULL;
+
+    if (ctx->retry_limit && attempts >= ctx->retry_limit) {
+        ACVP_LOG_ERR("Vector set %s still not ready after %d attempts, giving up", vsid_url, attempts);
+        acvp_vs_done(ctx, vsid_url, 0, NULL, NULL, 0, acvp_now_ms(), ACVP_KAT_DOWNLOAD_RETRY);
+        return ACVP_KAT_DOWNLOAD_RETRY;
     }
 
-    ACVP_LOG_STATUS("Successfully processed KAT vector set");
+    e = calloc(1, sizeof(ACVP_RETRY_ENTRY));
+    if (!e) {
+        return ACVP_MALLOC_FAIL;
+    }
+    e->vsid_url = vsid_url;
+    e->attempts = attempts;
+    e->due = acvp_now_ms() + acvp_retry_delay_ms(q, hint, attempts);
+    ACVP_LOG_STATUS("KAT values not ready, asking for %s again in %lld ms",
+                    vsid_url, e->due - acvp_now_ms());
+
+    for (pos = &q->head; *pos && (*pos)->due <= e->due; pos = &(*pos)->next) ;
+    e->next = *pos;
+    *pos = e;
     return ACVP_SUCCESS;
 }
 
 /*
- * This function will get the test results for a single KAT vector set.
+ * Removes the earliest parked vector set if it is due.  The caller
+ * frees the entry.
  */
-static ACVP_RESULT acvp_get_result_test_session(ACVP_CTX *ctx, char *session_url) {
-    ACVP_RESULT rv = ACVP_SUCCESS;
-    JSON_Value *val = NULL;
-    JSON_Object *obj = NULL;
-    char *json_buf = NULL;
-    int retry = 1, count = 0, i, passed;
-    JSON_Array *results = NULL;
-    JSON_Object *current = NULL;
-    int diff = 1;
+static ACVP_RETRY_ENTRY *acvp_retry_take(ACVP_RETRY_QUEUE *q) {
+    ACVP_RETRY_ENTRY *e = q->head;
 
-    while (retry) {
-        /*
-         * Get the KAT vector set
-         */
-        rv = acvp_retrieve_result(ctx, session_url);
-        if (rv != ACVP_SUCCESS) {
+    if (!e || e->due > acvp_now_ms()) {
+        return NULL;
+    }
+    q->head = e->next;
+    return e;
+}
+
+#ifndef WIN32
+/*
+ * A vector set cache file holds the test groups, then the rest of the
+ * vector set, then the offset at which each group ends and finally
+ * this trailer, everything but the trailer and the offsets in the
+ * binary form of json_serialize_to_binary().  The trailer goes last
+ * so that the groups can be written out as they are parsed.  Its
+ * checksum covers everything before it, so a damaged file is found
+ * before any of its groups is processed.
+ */
+#define ACVP_VS_CACHE_MAGIC "ACVPVS2"
+#define ACVP_VS_CACHE_ORDER 0x01020304U
+#define ACVP_VS_CACHE_GROUPS_MIN 16
+
+typedef struct acvp_vs_cache_trailer_t {
+    unsigned long long checksum; /* acvp_checksum() of the rest of the file */
+    unsigned long long rest_off; /* the vector set without its groups */
+    unsigned int rest_len;
+    unsigned int group_count;
+    unsigned int vs_id;
+    unsigned int order;          /* ACVP_VS_CACHE_ORDER as the writer stored it */
+    char magic[8];
+} ACVP_VS_CACHE_TRAILER;
+
+/*
+ * Puts the name of the cache file for the vector set at vsid_url,
+ * which ends in its vsId, into vs_ctx->cache.  Returns 0 if there is
+ * no cache or the URL has no vsId.
+ */
+static int acvp_vs_cache_name(ACVP_VS_CTX *vs_ctx, const char *vsid_url) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    int vs_id;
+
+    if (!ctx->vs_cache_dir) {
+        return 0;
+    }
+    vs_id = acvp_vs_id_from_url(vsid_url);
+    if (!vs_id) {
+        ACVP_LOG_WARN("No vsId in %s, not caching the vector set", vsid_url);
+        return 0;
+    }
+    vs_ctx->cache.vs_id = vs_id;
+    snprintf(vs_ctx->cache.path, sizeof(vs_ctx->cache.path), "%s/%d%s",
+             ctx->vs_cache_dir, vs_id, ACVP_VS_CACHE_SUFFIX);
+    return 1;
+}
+
+/*
+ * Starts writing the vector set named by vs_ctx->cache to a
+ * temporary file next to its cache file.
+ */
+static ACVP_RESULT acvp_vs_cache_open(ACVP_VS_CTX *vs_ctx) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    ACVP_VS_CACHE *cache = &vs_ctx->cache;
+    char tmp[ACVP_VS_PATH_MAX + 5];
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", cache->path);
+    cache->fp = fopen(tmp, "wb");
+    if (!cache->fp) {
+        ACVP_LOG_WARN("Unable to create %s, not caching the vector set", tmp);
+        return ACVP_TRANSPORT_FAIL;
+    }
+    cache->len = 0;
+    cache->sum = ACVP_CHECKSUM_INIT;
+    cache->count = 0;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Appends the binary form of value to the cache file.
+ */
+static ACVP_RESULT acvp_vs_cache_write(ACVP_VS_CACHE *cache, const JSON_Value *value, size_t *len) {
+    unsigned char *buf = NULL;
+
+    *len = json_binary_size(value);
+    if (!*len) {
+        return ACVP_JSON_ERR;
+    }
+    if (*len > cache->buf_size) {
+        buf = realloc(cache->buf, *len);
+        if (!buf) {
+            return ACVP_MALLOC_FAIL;
+        }
+        cache->buf = buf;
+        cache->buf_size = *len;
+    }
+    if (json_serialize_to_binary(value, cache->buf, *len) != JSONSuccess) {
+        return ACVP_JSON_ERR;
+    }
+    if (fwrite(cache->buf, 1, *len, cache->fp) != *len) {
+        return ACVP_TRANSPORT_FAIL;
+    }
+    cache->len += *len;
+    cache->sum = acvp_checksum(cache->sum, cache->buf, *len);
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Appends a test group to the cache file and notes where it ends.
+ */
+static ACVP_RESULT acvp_vs_cache_put(ACVP_VS_CACHE *cache, const JSON_Value *group) {
+    unsigned long long *ends = NULL;
+    size_t len;
+    int capacity;
+
+    if (cache->count == cache->capacity) {
+        capacity = cache->capacity ? cache->capacity * 2 : ACVP_VS_CACHE_GROUPS_MIN;
+        ends = realloc(cache->ends, capacity * sizeof(unsigned long long));
+        if (!ends) {
+            return ACVP_MALLOC_FAIL;
+        }
+        cache->ends = ends;
+        cache->capacity = capacity;
+    }
+    if (acvp_vs_cache_write(cache, group, &len) != ACVP_SUCCESS) {
+        return ACVP_JSON_ERR;
+    }
+    cache->ends[cache->count++] = cache->len;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Finishes the cache file with rest, the vector set without the
+ * groups written so far, and moves it into place.  With rest NULL,
+ * or on any error, the temporary file is dropped instead, so the
+ * cache only ever holds complete vector sets.
+ */
+static void acvp_vs_cache_close(ACVP_VS_CTX *vs_ctx, const JSON_Value *rest) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    ACVP_VS_CACHE *cache = &vs_ctx->cache;
+    ACVP_VS_CACHE_TRAILER trailer;
+    char tmp[ACVP_VS_PATH_MAX + 5];
+    size_t len = 0;
+    int ok = 0;
+
+    if (!cache->fp) {
+        return;
+    }
+    snprintf(tmp, sizeof(tmp), "%s.tmp", cache->path);
+    if (rest) {
+        memzero_s(&trailer, sizeof(trailer));
+        trailer.rest_off = cache->len;
+        ok = acvp_vs_cache_write(cache, rest, &len) == ACVP_SUCCESS && len <= 0xFFFFFFFFUL;
+        trailer.rest_len = (unsigned int)len;
+        trailer.group_count = (unsigned int)cache->count;
+        trailer.vs_id = (unsigned int)cache->vs_id;
+        trailer.order = ACVP_VS_CACHE_ORDER;
+        trailer.checksum = acvp_checksum(cache->sum, cache->ends, cache->count * sizeof(unsigned long long));
+        memcpy_s(trailer.magic, sizeof(trailer.magic), ACVP_VS_CACHE_MAGIC, sizeof(ACVP_VS_CACHE_MAGIC));
+        ok = ok && fwrite(cache->ends, sizeof(unsigned long long), cache->count, cache->fp) == (size_t)cache->count;
+        ok = ok && fwrite(&trailer, sizeof(trailer), 1, cache->fp) == 1;
+    }
+    ok = fclose(cache->fp) == 0 && ok;
+    cache->fp = NULL;
+    if (ok && rename(tmp, cache->path)) {
+        ACVP_LOG_WARN("Unable to move %s to %s", tmp, cache->path);
+        ok = 0;
+    }
+    if (!ok) {
+        if (rest) {
+            ACVP_LOG_WARN("Unable to write vsId %d to the vector set cache", cache->vs_id);
+        }
+        remove(tmp);
+    }
+}
+
+/*
+ * Appends a test group to the cache file being written, if any.  The
+ * cache is best-effort: when the group can't be written the file is
+ * dropped and the vector set carries on without it.
+ */
+static void acvp_vs_cache_add_group(ACVP_VS_CTX *vs_ctx, const JSON_Value *group) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+
+    if (!vs_ctx->cache.fp) {
+        return;
+    }
+    if (acvp_vs_cache_put(&vs_ctx->cache, group) != ACVP_SUCCESS) {
+        ACVP_LOG_WARN("Unable to add a test group of vsId %d to the vector set cache, not caching the vector set",
+                      vs_ctx->cache.vs_id);
+        acvp_vs_cache_close(vs_ctx, NULL);
+    }
+}
+
+/*
+ * Group callback for a vector set that is being cached as it downloads:
+ * the group goes to the cache file before it is answered.  Once a group
+ * has failed, the remaining ones are still read for the cache so that
+ * a rerun doesn't have to download them again.
+ */
+static int acvp_vs_cache_process_group(JSON_Object *vs_obj, JSON_Value *group, void *arg) {
+    ACVP_VS_CTX *vs_ctx = (ACVP_VS_CTX *)arg;
+    ACVP_CTX *ctx = vs_ctx->ctx;
+
+    acvp_vs_cache_add_group(vs_ctx, group);
+    if (vs_ctx->stream_rv != ACVP_SUCCESS && !ctx->cancel) {
+        json_value_free(group);
+        return 0;
+    }
+    return acvp_process_test_group(vs_obj, group, arg);
+}
+
+/*
+ * Group callback for a vector set that is parsed in full and cached:
+ * the group goes to the cache file and is then kept in
+ * vs_ctx->cache.groups.
+ */
+static int acvp_vs_cache_keep_group(JSON_Object *vs_obj, JSON_Value *group, void *arg) {
+    ACVP_VS_CTX *vs_ctx = (ACVP_VS_CTX *)arg;
+    ACVP_VS_CACHE *cache = &vs_ctx->cache;
+
+    acvp_vs_cache_add_group(vs_ctx, group);
+    if (!cache->groups) {
+        cache->groups = json_value_init_array();
+    }
+    if (!cache->groups || json_array_append_value(json_value_get_array(cache->groups), group) != JSONSuccess) {
+        json_value_free(group);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Reads a vector set from the cache file at path, which has to be the
+ * one of vsId vs_id unless vs_id is 0.  The test groups are handed to
+ * group_cb one by one, as acvp_vs_parser() would, or put back into the
+ * vector set when group_cb is NULL.  *val is left NULL, and the vector
+ * set should be downloaded, when there is no usable cache file.  A
+ * damaged cache file is removed so the download replaces it; files
+ * read with vs_id 0 are the application's and are left alone.
+ */
+static ACVP_RESULT acvp_vs_cache_read(ACVP_VS_CTX *vs_ctx, const char *path, int vs_id,
+                                      JSON_Stream_Callback group_cb, JSON_Value **val) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    ACVP_VS_CACHE_TRAILER trailer;
+    JSON_Value *group = NULL, *groups_val = NULL;
+    JSON_Object *obj = NULL;
+    const unsigned char *map = NULL;
+    unsigned long long *ends = NULL, start = 0, size = 0;
+    struct stat st;
+    size_t used = 0;
+    int fd, diff = 1;
+    unsigned int i;
+
+    *val = NULL;
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            ACVP_LOG_WARN("Unable to open %s", path);
+        }
+        return ACVP_SUCCESS;
+    }
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(trailer)) {
+        ACVP_LOG_WARN("Ignoring %s, it is not a vector set cache file", path);
+        close(fd);
+        return ACVP_SUCCESS;
+    }
+    size = (unsigned long long)st.st_size;
+    map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        ACVP_LOG_WARN("Unable to map %s", path);
+        return ACVP_SUCCESS;
+    }
+
+    /*
+     * Everything the trailer says, and the checksum of the whole
+     * file, is checked before a group is handed out.  A file that
+     * doesn't add up is downloaded again.
+     */
+    memcpy_s(&trailer, sizeof(trailer), map + size - sizeof(trailer), sizeof(trailer));
+    memcmp_s(trailer.magic, sizeof(trailer.magic), ACVP_VS_CACHE_MAGIC, sizeof(ACVP_VS_CACHE_MAGIC), &diff);
+    if (diff || trailer.order != ACVP_VS_CACHE_ORDER || (vs_id && trailer.vs_id != (unsigned int)vs_id) ||
+        trailer.rest_off > size || trailer.group_count > size / sizeof(unsigned long long) ||
+        trailer.rest_off + trailer.rest_len + trailer.group_count * sizeof(unsigned long long) +
+        sizeof(trailer) != size) {
+        ACVP_LOG_WARN("Ignoring %s, it is not a vector set cache file of this machine", path);
+        goto damaged;
+    }
+    if (acvp_checksum(ACVP_CHECKSUM_INIT, map, size - sizeof(trailer)) != trailer.checksum) {
+        ACVP_LOG_WARN("Ignoring %s, its checksum doesn't match", path);
+        goto damaged;
+    }
+    if (trailer.group_count) {
+        ends = malloc(trailer.group_count * sizeof(unsigned long long));
+        if (!ends) {
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
+        memcpy_s(ends, trailer.group_count * sizeof(unsigned long long),
+                 map + trailer.rest_off + trailer.rest_len, trailer.group_count * sizeof(unsigned long long));
+    }
+    for (i = 0; i < trailer.group_count; i++) {
+        if (ends[i] <= (i ? ends[i - 1] : 0) || ends[i] > trailer.rest_off) {
+            break;
+        }
+    }
+    if (i < trailer.group_count || (i && ends[i - 1] != trailer.rest_off)) {
+        ACVP_LOG_WARN("Ignoring %s, its test group index is damaged", path);
+        goto damaged;
+    }
+    *val = json_parse_binary(map + trailer.rest_off, trailer.rest_len, &used);
+    obj = acvp_get_obj_from_rsp(*val);
+    if (!obj || used != trailer.rest_len) {
+        ACVP_LOG_WARN("Ignoring %s, unable to read the vector set", path);
+        goto damaged;
+    }
+
+    for (i = 0; i < trailer.group_count; i++) {
+        group = json_parse_binary(map + start, ends[i] - start, &used);
+        if (!group || used != ends[i] - start) {
+            if (group) { json_value_free(group); }
+            if (!group_cb || !i) {
+                ACVP_LOG_WARN("Ignoring %s, unable to read test group %u", path, i + 1);
+                goto damaged;
+            }
+            /* Only with a checksum that matches: written by another version */
+            ACVP_LOG_ERR("Unable to read test group %u of %s", i + 1, path);
+            rv = ACVP_JSON_ERR;
+            goto damaged;
+        }
+        start = ends[i];
+        if (group_cb) {
+            if (group_cb(obj, group, vs_ctx)) {
+                break;
+            }
+            continue;
+        }
+        if (!groups_val) {
+            groups_val = json_value_init_array();
+            if (!groups_val || json_object_set_value(obj, "testGroups", groups_val) != JSONSuccess) {
+                if (groups_val) { json_value_free(groups_val); }
+                json_value_free(group);
+                rv = ACVP_MALLOC_FAIL;
+                goto end;
+            }
+        }
+        if (json_array_append_value(json_value_get_array(groups_val), group) != JSONSuccess) {
+            json_value_free(group);
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
+    }
+
+    goto end;
+
+damaged:
+    if (*val) { json_value_free(*val); }
+    *val = NULL;
+    if (vs_id && remove(path)) {
+        ACVP_LOG_WARN("Unable to remove %s", path);
+    }
+
+end:
+    free(ends);
+    munmap((void *)map, size);
+    return rv;
+}
+
+/*
+ * Parses a downloaded vector set like acvp_parse_vector_set() and
+ * writes it to the vector set cache on the way.
+ */
+static JSON_Value *acvp_vs_cache_parse(ACVP_VS_CTX *vs_ctx, const char *json, size_t len) {
+    ACVP_VS_CACHE *cache = &vs_ctx->cache;
+    JSON_Stream *stream = NULL;
+    JSON_Value *val = NULL;
+    JSON_Object *obj = NULL;
+
+    if (acvp_vs_cache_open(vs_ctx) != ACVP_SUCCESS) {
+        return acvp_parse_vector_set(vs_ctx, json, len);
+    }
+    stream = acvp_vs_parser(vs_ctx, &acvp_vs_cache_keep_group);
+    if (stream && json_stream_feed(stream, json, len) == JSONSuccess) {
+        val = json_stream_finish(stream);
+    }
+    json_stream_free(stream);
+
+    obj = acvp_get_obj_from_rsp(val);
+    acvp_vs_cache_close(vs_ctx, obj && !json_object_get_number(obj, "retry") ? val : NULL);
+    if (cache->groups && obj && json_object_set_value(obj, "testGroups", cache->groups) == JSONSuccess) {
+        cache->groups = NULL;
+    }
+    if (cache->groups) {
+        /* parse error, or nowhere to put them */
+        json_value_free(cache->groups);
+        cache->groups = NULL;
+        if (val) { json_value_free(val); }
+        val = NULL;
+    }
+    return val;
+}
+
+/*
+ * Releases what vs_ctx->cache holds, dropping an unfinished file.
+ */
+static void acvp_vs_cache_free(ACVP_VS_CTX *vs_ctx) {
+    ACVP_VS_CACHE *cache = &vs_ctx->cache;
+
+    acvp_vs_cache_close(vs_ctx, NULL);
+    if (cache->groups) { json_value_free(cache->groups); }
+    free(cache->buf);
+    free(cache->ends);
+    memzero_s(cache, sizeof(ACVP_VS_CACHE));
+}
+#endif
+
+#ifndef WIN32
+/*
+ * Puts the name of the file the response for vsid_url is kept in
+ * while a journal is open, "<journal>.<vsId>.json", into path.
+ * Returns 0 if the URL has no vsId.
+ */
+static int acvp_journal_rsp_name(ACVP_CTX *ctx, const char *vsid_url, char *path, size_t size) {
+    int vs_id = acvp_vs_id_from_url(vsid_url);
+
+    if (!vs_id) {
+        return 0;
+    }
+    snprintf(path, size, "%s.%d.json", ctx->journal_path, vs_id);
+    return 1;
+}
+
+/*
+ * Saves the response computed for vsid_url next to the journal and
+ * records it as computed.  The vector set is still uploaded if that
+ * fails, it just can't be sent again without being recomputed.
+ */
+static void acvp_journal_computed(ACVP_CTX *ctx, const char *vsid_url, const char *rsp, int rsp_len) {
+    char path[ACVP_VS_PATH_MAX + 1], tmp[ACVP_VS_PATH_MAX + 5];
+    FILE *fp = NULL;
+    int ok;
+
+    if (!ctx->journal) {
+        return;
+    }
+    if (!acvp_journal_rsp_name(ctx, vsid_url, path, sizeof(path))) {
+        ACVP_LOG_WARN("No vsId in %s, not saving the response", vsid_url);
+        return;
+    }
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    fp = fopen(tmp, "wb");
+    if (!fp) {
+        ACVP_LOG_WARN("Unable to create %s, not saving the response", tmp);
+        return;
+    }
+    ok = fwrite(rsp, 1, rsp_len, fp) == (size_t)rsp_len && !fflush(fp) && !fsync(fileno(fp));
+    ok = !fclose(fp) && ok;
+    if (!ok || rename(tmp, path)) {
+        ACVP_LOG_WARN("Unable to write %s, not saving the response", path);
+        remove(tmp);
+        return;
+    }
+    acvp_journal_write(ctx, "computed", vsid_url, ACVP_SUCCESS);
+}
+
+/*
+ * Serializes the response of vs_ctx to the heap for
+ * acvp_journal_computed().  The upload then sends that copy, the
+ * caller frees *rsp once it is done.
+ */
+static ACVP_RESULT acvp_journal_response(ACVP_VS_CTX *vs_ctx, char **rsp) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    size_t rsp_size;
+
+    rsp_size = json_serialization_size(vs_ctx->kat_resp);
+    *rsp = rsp_size ? malloc(rsp_size) : NULL;
+    if (!*rsp || json_serialize_to_buffer(vs_ctx->kat_resp, *rsp, rsp_size) != JSONSuccess) {
+        ACVP_LOG_ERR("Unable to serialize response of vsId: %d", vs_ctx->vs_id);
+        return ACVP_MALLOC_FAIL;
+    }
+    vs_ctx->rsp_data = *rsp;
+    vs_ctx->rsp_len = (int)rsp_size - 1;
+    acvp_journal_computed(ctx, vs_ctx->vsid_url, vs_ctx->rsp_data, vs_ctx->rsp_len);
+    return ACVP_SUCCESS;
+}
+#endif
+
+/*
+ * Release the transitory buffers held by a vector set
+ * work context.
+ */
+static void acvp_free_vs_ctx(ACVP_VS_CTX *vs_ctx) {
+    acvp_transport_close(vs_ctx->ctx, vs_ctx);
+    acvp_http_body_free(&vs_ctx->kat_buf);
+    acvp_http_body_free(&vs_ctx->upld_buf);
+    if (vs_ctx->kat_resp) { json_value_free(vs_ctx->kat_resp); }
+    if (vs_ctx->kat_stream) { json_stream_free(vs_ctx->kat_stream); }
+#ifndef WIN32
+    acvp_vs_cache_free(vs_ctx);
+#endif
+    acvp_arena_free(&vs_ctx->json_arena);
+    acvp_arena_free(&vs_ctx->tc_arena);
+    memzero_s(vs_ctx, sizeof(ACVP_VS_CTX));
+}
+
+#ifndef WIN32
+/*
+ * State shared by the workers of acvp_process_tests_parallel().
+ * The lock protects next_vs, retry_q, busy and rv, the session
+ * context itself is only read while the pool is running.  When
+ * rsp_dir is set the list holds vector set files rather than vsId
+ * URLs.
+ */
+typedef struct acvp_vs_pool_t {
+    ACVP_CTX *ctx;
+    ACVP_STRING_LIST *next_vs;
+    ACVP_RETRY_QUEUE retry_q; /* vector sets the server wasn't ready with */
+    int busy;                 /* workers processing a vector set */
+    const char *rsp_dir;
+    ACVP_RESULT rv;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;   /* retry_q or busy changed */
+} ACVP_VS_POOL;
+
+/*
+ * Picks the next vector set for a worker: a parked one that is due,
+ * else the next new one.  With neither, waits for the earliest parked
+ * vector set or for a busy worker to park one.  Returns NULL when
+ * nothing is left or the session was cancelled.  Called with the
+ * pool locked.
+ */
+static char *acvp_vs_pool_next(ACVP_VS_POOL *pool, int *attempts) {
+    ACVP_RETRY_ENTRY *parked = NULL;
+    struct timespec ts;
+    long long wait;
+    char *vs = NULL;
+
+    while (1) {
+        if (pool->ctx->cancel) {
+            return NULL;
+        }
+        parked = acvp_retry_take(&pool->retry_q);
+        if (parked) {
+            vs = parked->vsid_url;
+            *attempts = parked->attempts + 1;
+            free(parked);
+            return vs;
+        }
+        if (pool->next_vs) {
+            vs = pool->next_vs->string;
+            pool->next_vs = pool->next_vs->next;
+            *attempts = 1;
+            return vs;
+        }
+        if (!pool->retry_q.head) {
+            if (!pool->busy) {
+                return NULL;
+            }
+            pthread_cond_wait(&pool->changed, &pool->lock);
+            continue;
+        }
+        wait = pool->retry_q.head->due - acvp_now_ms();
+        if (wait > ACVP_CANCEL_POLL_MS) {
+            wait = ACVP_CANCEL_POLL_MS; /* look at ctx->cancel now and then */
+        }
+        acvp_deadline(&ts, wait);
+        pthread_cond_timedwait(&pool->changed, &pool->lock, &ts);
+    }
+}
+
+/*
+ * Worker thread body.  Each worker owns a vector set work context
+ * and pulls vector sets off the list until it is empty.
+ */
+static void *acvp_vs_worker(void *arg) {
+    ACVP_VS_POOL *pool = (ACVP_VS_POOL *)arg;
+    ACVP_CTX *ctx = pool->ctx;
+    ACVP_VS_CTX vs_ctx;
+    char *vs = NULL;
+    int attempts = 0;
+    ACVP_RESULT rv;
+
+    memzero_s(&vs_ctx, sizeof(ACVP_VS_CTX));
+    pthread_mutex_lock(&pool->lock);
+    while ((vs = acvp_vs_pool_next(pool, &attempts))) {
+        pool->busy++;
+        pthread_mutex_unlock(&pool->lock);
+
+        vs_ctx.ctx = ctx;
+        if (pool->rsp_dir) {
+            rv = acvp_process_vs_file(&vs_ctx, vs, pool->rsp_dir);
+        } else {
+            rv = acvp_process_vsid(&vs_ctx, vs);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (rv == ACVP_KAT_DOWNLOAD_RETRY) {
+            rv = acvp_retry_park(ctx, &pool->retry_q, vs, attempts, vs_ctx.retry_period);
+        }
+        if (rv != ACVP_SUCCESS && pool->rv == ACVP_SUCCESS) {
+            pool->rv = rv;
+        }
+        pool->busy--;
+        pthread_cond_broadcast(&pool->changed);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    acvp_free_vs_ctx(&vs_ctx);
+    return NULL;
+}
+
+/*
+ * Process the vector sets in vs_list with a pool of
+ * ctx->max_concurrency worker threads.  vs_list holds vsId URLs,
+ * or vector set files when rsp_dir is given.  Returns the first
+ * failure seen by any worker.
+ */
+static ACVP_RESULT acvp_process_tests_parallel(ACVP_CTX *ctx,
+                                               ACVP_STRING_LIST *vs_list,
+                                               const char *rsp_dir) {
+    ACVP_VS_POOL pool;
+    pthread_t workers[ACVP_MAX_CONCURRENCY];
+    ACVP_STRING_LIST *vs_entry = NULL;
+    ACVP_RESULT rv;
+    int vs_cnt = 0, worker_cnt = 0, i;
+
+    for (vs_entry = vs_list; vs_entry; vs_entry = vs_entry->next) {
+        vs_cnt++;
+    }
+
+    /*
+     * The transport's one-time global setup isn't thread safe,
+     * get it out of the way before the workers start.
+     */
+    if (!rsp_dir) {
+        rv = acvp_transport_init(ctx);
+        if (rv != ACVP_SUCCESS) {
+            return rv;
+        }
+    }
+
+    pool.ctx = ctx;
+    pool.next_vs = vs_list;
+    acvp_retry_queue_init(&pool.retry_q);
+    pool.busy = 0;
+    pool.rsp_dir = rsp_dir;
+    pool.rv = ACVP_SUCCESS;
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.changed, NULL);
+
+    ACVP_LOG_STATUS("Processing %d vector sets with up to %d workers",
+                    vs_cnt, ctx->max_concurrency);
+
+    for (i = 0; i < ctx->max_concurrency && i < vs_cnt; i++) {
+        if (pthread_create(&workers[i], NULL, acvp_vs_worker, &pool)) {
+            ACVP_LOG_WARN("Unable to start worker %d, continuing with %d", i, worker_cnt);
+            break;
+        }
+        worker_cnt++;
+    }
+
+    /*
+     * If no worker could be started, do the work on this thread
+     */
+    if (!worker_cnt) {
+        acvp_vs_worker(&pool);
+    }
+
+    for (i = 0; i < worker_cnt; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    acvp_retry_queue_free(&pool.retry_q);
+    pthread_cond_destroy(&pool.changed);
+    pthread_mutex_destroy(&pool.lock);
+
+    if (ctx->cancel && pool.rv == ACVP_SUCCESS) {
+        return ACVP_CANCELLED;
+    }
+    return pool.rv;
+}
+
+/*
+ * A vector set moving through the pipeline of
+ * acvp_process_tests_pipelined().
+ */
+typedef struct acvp_pipe_item_t {
+    char *vsid_url;
+    JSON_Value *val; /* downloaded vector set, heap allocated */
+    char *rsp;       /* serialized response */
+    int rsp_len;
+    int vs_id;
+    char algorithm[ACVP_ALG_NAME_MAX + 1];
+    char mode[ACVP_ALG_MODE_MAX + 1];
+    int tc_count;
+    long long start_ms;
+} ACVP_PIPE_ITEM;
+
+/*
+ * Bounded FIFO between two pipeline stages.  put() blocks while the
+ * queue is full, get() while it is empty.  Once closed, put() fails
+ * and get() returns what is left, then NULL.
+ */
+typedef struct acvp_pipe_queue_t {
+    ACVP_PIPE_ITEM *items[ACVP_MAX_PIPELINE_DEPTH];
+    int depth, head, count;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} ACVP_PIPE_QUEUE;
+
+typedef struct acvp_pipe_t {
+    ACVP_CTX *ctx;
+    ACVP_STRING_LIST *vs_list;
+    ACVP_PIPE_QUEUE downloaded;
+    ACVP_PIPE_QUEUE computed;
+    ACVP_RESULT rv;
+    pthread_mutex_t lock; /* protects rv */
+} ACVP_PIPE;
+
+static void acvp_pipe_queue_init(ACVP_PIPE_QUEUE *q, int depth) {
+    memzero_s(q, sizeof(ACVP_PIPE_QUEUE));
+    q->depth = depth;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+}
+
+static void acvp_pipe_queue_destroy(ACVP_PIPE_QUEUE *q) {
+    pthread_cond_destroy(&q->not_full);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_mutex_destroy(&q->lock);
+}
+
+static int acvp_pipe_queue_put(ACVP_PIPE_QUEUE *q, ACVP_PIPE_ITEM *item) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->depth && !q->closed) {
+        pthread_cond_wait(&q->not_full, &q->lock);
+    }
+    if (q->closed) {
+        pthread_mutex_unlock(&q->lock);
+        return 0;
+    }
+    q->items[(q->head + q->count) % q->depth] = item;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return 1;
+}
+
+static ACVP_PIPE_ITEM *acvp_pipe_queue_get(ACVP_PIPE_QUEUE *q) {
+    ACVP_PIPE_ITEM *item = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (!q->count && !q->closed) {
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    }
+    if (q->count) {
+        item = q->items[q->head];
+        q->head = (q->head + 1) % q->depth;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return item;
+}
+
+static void acvp_pipe_queue_close(ACVP_PIPE_QUEUE *q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void acvp_pipe_item_free(ACVP_PIPE_ITEM *item) {
+    if (item->val) json_value_free(item->val);
+    free(item->rsp);
+    free(item);
+}
+
+static void acvp_pipe_fail(ACVP_PIPE *pipe, ACVP_RESULT rv) {
+    pthread_mutex_lock(&pipe->lock);
+    if (pipe->rv == ACVP_SUCCESS) {
+        pipe->rv = rv;
+    }
+    pthread_mutex_unlock(&pipe->lock);
+}
+
+/*
+ * Reports a downloaded vector set that won't be processed because
+ * the session was cancelled, then frees it.
+ */
+static void acvp_pipe_item_cancel(ACVP_CTX *ctx, ACVP_PIPE_ITEM *item) {
+    JSON_Object *obj = acvp_get_obj_from_rsp(item->val);
+
+    acvp_vs_done(ctx, item->vsid_url, (int)json_object_get_number(obj, "vsId"),
+                 json_object_get_string(obj, "algorithm"), json_object_get_string(obj, "mode"),
+                 0, item->start_ms, ACVP_CANCELLED);
+    acvp_pipe_item_free(item);
+}
+
+/*
+ * Download stage.  Fetches and parses the vector sets in order.
+ * Vector sets the server isn't ready with are parked and fetched
+ * again when due, so the compute stage never sees a "retry".
+ * Nothing on this thread uses an arena, the parsed vector sets are
+ * freed by the compute stage.
+ */
+static void *acvp_pipe_download(void *arg) {
+    ACVP_PIPE *pipe = (ACVP_PIPE *)arg;
+    ACVP_CTX *ctx = pipe->ctx;
+    ACVP_VS_CTX vs_ctx;
+    ACVP_STRING_LIST *vs_entry = NULL;
+    ACVP_RETRY_QUEUE retry_q;
+    ACVP_RETRY_ENTRY *parked = NULL;
+    ACVP_PIPE_ITEM *item = NULL;
+    ACVP_RESULT rv;
+    unsigned int retry_period;
+    char *vs = NULL;
+    int attempts, cached;
+
+    memzero_s(&vs_ctx, sizeof(ACVP_VS_CTX));
+    vs_ctx.ctx = ctx;
+    acvp_retry_queue_init(&retry_q);
+    vs_entry = pipe->vs_list;
+    while ((vs_entry || retry_q.head) && !ctx->cancel) {
+        parked = acvp_retry_take(&retry_q);
+        if (parked) {
+            vs = parked->vsid_url;
+            attempts = parked->attempts + 1;
+            free(parked);
+        } else if (vs_entry) {
+            vs = vs_entry->string;
+            attempts = 1;
+            vs_entry = vs_entry->next;
+        } else {
+            acvp_sleep_until(ctx, retry_q.head->due);
+            continue;
+        }
+
+        item = calloc(1, sizeof(ACVP_PIPE_ITEM));
+        if (!item) {
+            acvp_pipe_fail(pipe, ACVP_MALLOC_FAIL);
+            break;
+        }
+        item->vsid_url = vs;
+        item->start_ms = acvp_now_ms();
+        if (!acvp_lib_worker_enter(ctx, 1)) {
+            acvp_pipe_item_free(item);
+            break;
+        }
+
+        cached = acvp_vs_cache_name(&vs_ctx, vs);
+        rv = ACVP_SUCCESS;
+        if (cached) {
+            rv = acvp_vs_cache_read(&vs_ctx, vs_ctx.cache.path, vs_ctx.cache.vs_id, NULL, &item->val);
+        }
+        if (rv == ACVP_SUCCESS && item->val) {
+            ACVP_LOG_STATUS("Read vsId %d from %s", vs_ctx.cache.vs_id, vs_ctx.cache.path);
+        } else if (rv == ACVP_SUCCESS) {
+            rv = acvp_retrieve_vector_set(&vs_ctx, vs);
+        }
+        if (rv == ACVP_SUCCESS && !item->val) {
+            if (cached) {
+                item->val = acvp_vs_cache_parse(&vs_ctx, vs_ctx.kat_buf.data, vs_ctx.kat_buf.len);
+            } else {
+                item->val = acvp_parse_vector_set(&vs_ctx, vs_ctx.kat_buf.data, vs_ctx.kat_buf.len);
+            }
+            if (!item->val) {
+                ACVP_LOG_ERR("JSON parse error");
+                rv = ACVP_JSON_ERR;
+            }
+        }
+        acvp_lib_worker_leave();
+        if (rv == ACVP_SUCCESS) {
+            retry_period = json_object_get_number(acvp_get_obj_from_rsp(item->val), "retry");
+            if (retry_period) {
+                rv = acvp_retry_park(ctx, &retry_q, vs, attempts, retry_period);
+                if (rv == ACVP_SUCCESS) {
+                    acvp_pipe_item_free(item);
+                    continue;
+                }
+            }
+        }
+
+        if (rv != ACVP_SUCCESS) {
+            if (rv != ACVP_KAT_DOWNLOAD_RETRY) {
+                acvp_vs_done(ctx, vs, 0, NULL, NULL, 0, item->start_ms, rv);
+            }
+            acvp_pipe_fail(pipe, rv);
+            acvp_pipe_item_free(item);
+            continue;
+        }
+        if (!acvp_pipe_queue_put(&pipe->downloaded, item)) {
+            acvp_pipe_item_free(item);
+            break;
+        }
+    }
+    acvp_pipe_queue_close(&pipe->downloaded);
+
+    acvp_retry_queue_free(&retry_q);
+    acvp_free_vs_ctx(&vs_ctx);
+    return NULL;
+}
+
+/*
+ * Compute stage.  Runs the handlers on a downloaded vector set and
+ * serializes the response to the heap, so that it outlives the
+ * arena and can be uploaded while the next vector set is processed.
+ */
+static void *acvp_pipe_compute(void *arg) {
+    ACVP_PIPE *pipe = (ACVP_PIPE *)arg;
+    ACVP_CTX *ctx = pipe->ctx;
+    ACVP_VS_CTX vs_ctx;
+    ACVP_PIPE_ITEM *item = NULL;
+    ACVP_ARENA *prev_arena = NULL;
+    ACVP_RESULT rv;
+    size_t rsp_size;
+
+    memzero_s(&vs_ctx, sizeof(ACVP_VS_CTX));
+    while ((item = acvp_pipe_queue_get(&pipe->downloaded))) {
+        /* Drain the queue so the downloader isn't left blocked */
+        if (ctx->cancel || !acvp_lib_worker_enter(ctx, 1)) {
+            acvp_pipe_item_cancel(ctx, item);
+            continue;
+        }
+        vs_ctx.ctx = ctx;
+        vs_ctx.vsid_url = item->vsid_url;
+        vs_ctx.algorithm = NULL;
+        vs_ctx.mode = NULL;
+        vs_ctx.tc_count = 0;
+        prev_arena = acvp_json_arena_set(&vs_ctx.json_arena);
+
+        rv = acvp_process_vector_set(&vs_ctx, acvp_get_obj_from_rsp(item->val));
+        acvp_module_vs_end(&vs_ctx);
+        acvp_lib_worker_leave();
+        if (rv == ACVP_SUCCESS) {
+            rsp_size = json_serialization_size(vs_ctx.kat_resp);
+            item->rsp = rsp_size ? malloc(rsp_size) : NULL;
+            if (!item->rsp ||
+                json_serialize_to_buffer(vs_ctx.kat_resp, item->rsp, rsp_size) != JSONSuccess) {
+                ACVP_LOG_ERR("Unable to serialize response of vsId: %d", vs_ctx.vs_id);
+                rv = ACVP_MALLOC_FAIL;
+            } else {
+                item->rsp_len = (int)rsp_size - 1;
+                acvp_journal_computed(ctx, item->vsid_url, item->rsp, item->rsp_len);
+            }
+        }
+        item->vs_id = vs_ctx.vs_id;
+        item->tc_count = vs_ctx.tc_count;
+        if (vs_ctx.algorithm) {
+            strcpy_s(item->algorithm, sizeof(item->algorithm), vs_ctx.algorithm);
+        }
+        if (vs_ctx.mode) {
+            strcpy_s(item->mode, sizeof(item->mode), vs_ctx.mode);
+        }
+
+        vs_ctx.kat_resp = NULL;
+        acvp_json_arena_set(prev_arena);
+        acvp_arena_reset(&vs_ctx.json_arena);
+        json_value_free(item->val);
+        item->val = NULL;
+
+        if (rv != ACVP_SUCCESS) {
+            acvp_vs_done(ctx, item->vsid_url, item->vs_id, item->algorithm[0] ? item->algorithm : NULL,
+                         item->mode[0] ? item->mode : NULL, item->tc_count, item->start_ms, rv);
+            acvp_pipe_fail(pipe, rv);
+            acvp_pipe_item_free(item);
+            continue;
+        }
+        if (!acvp_pipe_queue_put(&pipe->computed, item)) {
+            acvp_pipe_item_free(item);
+        }
+    }
+
+    acvp_free_vs_ctx(&vs_ctx);
+    return NULL;
+}
+
+/*
+ * Upload stage.  POSTs the responses in the order they finish.
+ */
+static void *acvp_pipe_upload(void *arg) {
+    ACVP_PIPE *pipe = (ACVP_PIPE *)arg;
+    ACVP_CTX *ctx = pipe->ctx;
+    ACVP_VS_CTX vs_ctx;
+    ACVP_PIPE_ITEM *item = NULL;
+    ACVP_RESULT rv;
+
+    memzero_s(&vs_ctx, sizeof(ACVP_VS_CTX));
+    vs_ctx.ctx = ctx;
+    while ((item = acvp_pipe_queue_get(&pipe->computed))) {
+        vs_ctx.vs_id = item->vs_id;
+        vs_ctx.vsid_url = item->vsid_url;
+        vs_ctx.rsp_data = item->rsp;
+        vs_ctx.rsp_len = item->rsp_len;
+        ACVP_LOG_STATUS("POST vector set response vsId: %d", vs_ctx.vs_id);
+        acvp_lib_worker_enter(ctx, 0);
+        rv = acvp_submit_vector_responses(&vs_ctx);
+        acvp_lib_worker_leave();
+        if (rv != ACVP_SUCCESS) {
+            acvp_pipe_fail(pipe, rv);
+        }
+        acvp_vs_done(ctx, item->vsid_url, item->vs_id, item->algorithm[0] ? item->algorithm : NULL,
+                     item->mode[0] ? item->mode : NULL, item->tc_count, item->start_ms, rv);
+        vs_ctx.rsp_data = NULL;
+        acvp_pipe_item_free(item);
+    }
+
+    acvp_free_vs_ctx(&vs_ctx);
+    return NULL;
+}
+
+/*
+ * Process the vector sets in vs_list as a three stage pipeline:
+ * one thread downloads, ctx->max_concurrency threads compute and
+ * one thread uploads, with up to ctx->pipeline_depth vector sets
+ * queued between the stages.  Like the worker pool, a failed vector
+ * set does not stop the others and the first failure is returned.
+ */
+static ACVP_RESULT acvp_process_tests_pipelined(ACVP_CTX *ctx, ACVP_STRING_LIST *vs_list) {
+    ACVP_PIPE pipe;
+    pthread_t downloader, uploader;
+    pthread_t workers[ACVP_MAX_CONCURRENCY];
+    int worker_cnt = 0, i;
+    ACVP_RESULT rv;
+
+    rv = acvp_transport_init(ctx);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
+
+    memzero_s(&pipe, sizeof(ACVP_PIPE));
+    pipe.ctx = ctx;
+    pipe.vs_list = vs_list;
+    pipe.rv = ACVP_SUCCESS;
+    pthread_mutex_init(&pipe.lock, NULL);
+    acvp_pipe_queue_init(&pipe.downloaded, ctx->pipeline_depth);
+    acvp_pipe_queue_init(&pipe.computed, ctx->pipeline_depth);
+
+    ACVP_LOG_STATUS("Processing vector sets in a pipeline of depth %d with %d compute workers",
+                    ctx->pipeline_depth, ctx->max_concurrency > 1 ? ctx->max_concurrency : 1);
+
+    if (pthread_create(&downloader, NULL, acvp_pipe_download, &pipe)) {
+        ACVP_LOG_ERR("Unable to start the download thread");
+        rv = ACVP_UNSUPPORTED_OP;
+        goto end;
+    }
+    if (pthread_create(&uploader, NULL, acvp_pipe_upload, &pipe)) {
+        ACVP_LOG_ERR("Unable to start the upload thread");
+        acvp_pipe_queue_close(&pipe.downloaded);
+        acvp_pipe_queue_close(&pipe.computed);
+        acvp_pipe_compute(&pipe); /* frees what was already downloaded */
+        pthread_join(downloader, NULL);
+        rv = ACVP_UNSUPPORTED_OP;
+        goto end;
+    }
+
+    for (i = 1; i < ctx->max_concurrency; i++) {
+        if (pthread_create(&workers[worker_cnt], NULL, acvp_pipe_compute, &pipe)) {
+            ACVP_LOG_WARN("Unable to start compute worker %d, continuing with %d", i, worker_cnt + 1);
+            break;
+        }
+        worker_cnt++;
+    }
+    /* This thread is a compute worker as well */
+    acvp_pipe_compute(&pipe);
+    for (i = 0; i < worker_cnt; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    acvp_pipe_queue_close(&pipe.computed);
+    pthread_join(uploader, NULL);
+    pthread_join(downloader, NULL);
+    rv = pipe.rv;
+    if (ctx->cancel && rv == ACVP_SUCCESS) {
+        rv = ACVP_CANCELLED;
+    }
+
+end:
+    acvp_pipe_queue_destroy(&pipe.computed);
+    acvp_pipe_queue_destroy(&pipe.downloaded);
+    pthread_mutex_destroy(&pipe.lock);
+    return rv;
+}
+#endif
+
+/*
+ * Processes and uploads the vector sets in vs_list, one at a
+ * time or as configured on the ctx.
+ */
+static ACVP_RESULT acvp_process_vs_list(ACVP_CTX *ctx, ACVP_STRING_LIST *vs_list) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    ACVP_STRING_LIST *vs_entry = vs_list;
+    ACVP_VS_CTX vs_ctx;
+    ACVP_RETRY_QUEUE retry_q;
+    ACVP_RETRY_ENTRY *parked = NULL;
+    ACVP_RESULT vs_rv;
+    char *vs = NULL;
+    int attempts;
+
+#ifndef WIN32
+    if (ctx->pipeline_depth) {
+        rv = acvp_process_tests_pipelined(ctx, vs_list);
+        goto end;
+    }
+    if (ctx->max_concurrency > 1) {
+        rv = acvp_process_tests_parallel(ctx, vs_list, NULL);
+        goto end;
+    }
+#endif
+    memzero_s(&vs_ctx, sizeof(ACVP_VS_CTX));
+    acvp_retry_queue_init(&retry_q);
+    while (vs_entry || retry_q.head) {
+        if (ctx->cancel) {
+            if (rv == ACVP_SUCCESS) {
+                rv = ACVP_CANCELLED;
+            }
+            break;
+        }
+        /*
+         * Parked vector sets that are due go first, then new ones.
+         * Only sleep when there is nothing else left to do.
+         */
+        parked = acvp_retry_take(&retry_q);
+        if (parked) {
+            vs = parked->vsid_url;
+            attempts = parked->attempts + 1;
+            free(parked);
+        } else if (vs_entry) {
+            vs = vs_entry->string;
+            attempts = 1;
+            vs_entry = vs_entry->next;
+        } else {
+            acvp_sleep_until(ctx, retry_q.head->due);
+            continue;
+        }
+
+        /*
+         * The other vector sets are still processed after one fails,
+         * and the first failure is what gets returned.
+         */
+        vs_ctx.ctx = ctx;
+        vs_rv = acvp_process_vsid(&vs_ctx, vs);
+        if (vs_rv == ACVP_KAT_DOWNLOAD_RETRY) {
+            vs_rv = acvp_retry_park(ctx, &retry_q, vs, attempts, vs_ctx.retry_period);
+        }
+        if (vs_rv != ACVP_SUCCESS && rv == ACVP_SUCCESS) {
+            rv = vs_rv;
+        }
+    }
+    acvp_retry_queue_free(&retry_q);
+    acvp_free_vs_ctx(&vs_ctx);
+
+end:
+    ACVP_LOG_STATUS("Reused an open connection for %d requests", ctx->handshakes_avoided);
+    if (ctx->cancel) {
+        ACVP_LOG_STATUS("Test session processing was cancelled");
+        ctx->cancel = 0;
+    }
+    return rv;
+}
+
+/*
+ * This function is used by the application after registration
+ * to commence the testing.  All the testing will be handled
+ * by libacvp.  This function will block the caller.  Therefore,
+ * it should be run on a separate thread if needed.
+ */
+ACVP_RESULT acvp_process_tests(ACVP_CTX *ctx) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+
+    /*
+     * Iterate through the VS identifiers the server sent to us
+     * in the test session register response.  Process each vector set and
+     * return the results to the server.
+     */
+    if (!ctx->vsid_url_list) {
+        return ACVP_MISSING_ARG;
+    }
+    return acvp_process_vs_list(ctx, ctx->vsid_url_list);
+}
+
+#ifndef WIN32
+/* What the journal says about a vector set, its last line for it wins */
+#define ACVP_JOURNAL_PENDING  0
+#define ACVP_JOURNAL_COMPUTED 1
+#define ACVP_JOURNAL_UPLOADED 2
+
+/*
+ * Reads the journal at path into state, which has an entry for each
+ * vector set of the session in list order.  A journal that doesn't
+ * exist yet is empty, torn is set if its last line was cut short.
+ * Fails with ACVP_INVALID_ARG if the journal belongs to another test
+ * session.
+ */
+static ACVP_RESULT acvp_journal_read(ACVP_CTX *ctx, const char *path, int *state, int *empty, int *torn) {
+    char line[ACVP_JOURNAL_LINE_MAX];
+    ACVP_STRING_LIST *vs = NULL;
+    char *url = NULL, *end = NULL;
+    FILE *fp = NULL;
+    int i, s, c, diff, line_no = 0;
+
+    *empty = 1;
+    *torn = 0;
+    fp = fopen(path, "r");
+    if (!fp) {
+        return ACVP_SUCCESS;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+        *empty = 0;
+        end = strchr(line, '\n');
+        if (!end) {
+            /* Cut short by a crash, or too long to be ours */
+            ACVP_LOG_WARN("Ignoring incomplete line %d of %s", line_no, path);
+            while ((c = fgetc(fp)) != EOF && c != '\n') ;
+            *torn = c == EOF;
+            continue;
+        }
+        *end = '\0';
+        url = strchr(line, ' ');
+        if (!url) {
+            ACVP_LOG_WARN("Ignoring line %d of %s: %s", line_no, path, line);
+            continue;
+        }
+        *url++ = '\0';
+
+        strcmp_s(line, sizeof(line), "session", &diff);
+        if (!diff) {
+            strcmp_s(ctx->session_url, ACVP_ATTR_URL_MAX, url, &diff);
+            if (diff) {
+                ACVP_LOG_ERR("%s is the journal of test session %s", path, url);
+                fclose(fp);
+                return ACVP_INVALID_ARG;
+            }
+            continue;
+        }
+        strcmp_s(line, sizeof(line), "computed", &diff);
+        if (!diff) {
+            s = ACVP_JOURNAL_COMPUTED;
+        } else {
+            strcmp_s(line, sizeof(line), "uploaded", &diff);
+            s = ACVP_JOURNAL_UPLOADED;
+            if (diff) {
+                /*
+                 * "failed <url> <rv>", processed again unless the
+                 * response was computed and only the upload failed
+                 */
+                end = strchr(url, ' ');
+                if (end) {
+                    *end = '\0';
+                }
+                s = ACVP_JOURNAL_PENDING;
+            }
+        }
+        for (vs = ctx->vsid_url_list, i = 0; vs; vs = vs->next, i++) {
+            strcmp_s(vs->string, ACVP_ATTR_URL_MAX, url, &diff);
+            if (!diff) {
+                if (s != ACVP_JOURNAL_PENDING || state[i] != ACVP_JOURNAL_COMPUTED) {
+                    state[i] = s;
+                }
+                break;
+            }
+        }
+    }
+    fclose(fp);
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Uploads the response kept on disk for vsid_url.  Returns
+ * ACVP_NO_DATA if there is none, in which case the vector set
+ * has to be processed again.
+ */
+static ACVP_RESULT acvp_journal_resubmit(ACVP_VS_CTX *vs_ctx, char *vsid_url) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    ACVP_RESULT rv = ACVP_NO_DATA;
+    char path[ACVP_VS_PATH_MAX + 1];
+    long long start_ms = acvp_now_ms();
+    struct stat st;
+    char *rsp = NULL;
+    FILE *fp = NULL;
+
+    if (!acvp_journal_rsp_name(ctx, vsid_url, path, sizeof(path))) {
+        return ACVP_NO_DATA;
+    }
+    fp = fopen(path, "rb");
+    if (!fp || fstat(fileno(fp), &st) || st.st_size <= 0 || st.st_size != (int)st.st_size) {
+        ACVP_LOG_WARN("No saved response in %s, processing %s again", path, vsid_url);
+        goto end;
+    }
+    rsp = malloc(st.st_size);
+    if (!rsp) {
+        rv = ACVP_MALLOC_FAIL;
+        goto end;
+    }
+    if (fread(rsp, 1, st.st_size, fp) != (size_t)st.st_size) {
+        ACVP_LOG_WARN("Unable to read %s, processing %s again", path, vsid_url);
+        goto end;
+    }
+
+    vs_ctx->vsid_url = vsid_url;
+    vs_ctx->vs_id = acvp_vs_id_from_url(vsid_url);
+    vs_ctx->rsp_data = rsp;
+    vs_ctx->rsp_len = (int)st.st_size;
+    ACVP_LOG_STATUS("POST saved vector set response vsId: %d", vs_ctx->vs_id);
+    rv = acvp_submit_vector_responses(vs_ctx);
+    vs_ctx->rsp_data = NULL;
+    acvp_vs_done(ctx, vsid_url, vs_ctx->vs_id, NULL, NULL, 0, start_ms, rv);
+
+end:
+    if (fp) { fclose(fp); }
+    if (rsp) { free(rsp); }
+    return rv;
+}
+#endif
+
+ACVP_RESULT acvp_resume_session(ACVP_CTX *ctx, const char *journal) {
+#ifdef WIN32
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    ACVP_LOG_ERR("Resuming a test session is not supported on Windows");
+    return ACVP_UNSUPPORTED_OP;
+#else
+    ACVP_RESULT rv = ACVP_SUCCESS, vs_rv;
+    ACVP_STRING_LIST *vs = NULL, *todo = NULL, **tail = &todo;
+    ACVP_VS_CTX vs_ctx;
+    int *state = NULL;
+    int count = 0, i, empty, torn, uploaded = 0, resent = 0, left = 0;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!journal) {
+        ACVP_LOG_ERR("Must provide a journal file");
+        return ACVP_MISSING_ARG;
+    }
+    if (strnlen_s(journal, ACVP_VS_PATH_MAX + 1) > ACVP_VS_PATH_MAX - ACVP_JOURNAL_RSP_NAME_MAX) {
+        ACVP_LOG_ERR("Journal path too long: %s", journal);
+        return ACVP_INVALID_ARG;
+    }
+    if (!ctx->vsid_url_list || !ctx->session_url) {
+        return ACVP_MISSING_ARG;
+    }
+    if (ctx->journal) {
+        ACVP_LOG_ERR("Test session is already being resumed");
+        return ACVP_DUPLICATE_CTX;
+    }
+
+    memzero_s(&vs_ctx, sizeof(ACVP_VS_CTX));
+    vs_ctx.ctx = ctx;
+    for (vs = ctx->vsid_url_list; vs; vs = vs->next) {
+        count++;
+    }
+    state = calloc(count, sizeof(int));
+    ctx->journal_path = calloc(ACVP_VS_PATH_MAX + 1, sizeof(char));
+    if (!state || !ctx->journal_path) {
+        rv = ACVP_MALLOC_FAIL;
+        goto end;
+    }
+    strcpy_s(ctx->journal_path, ACVP_VS_PATH_MAX + 1, journal);
+
+    rv = acvp_journal_read(ctx, journal, state, &empty, &torn);
+    if (rv != ACVP_SUCCESS) {
+        goto end;
+    }
+    ctx->journal = fopen(journal, "a");
+    if (!ctx->journal) {
+        ACVP_LOG_ERR("Unable to open journal %s", journal);
+        rv = ACVP_TRANSPORT_FAIL;
+        goto end;
+    }
+    if (torn) {
+        /* Don't run on from the partial line */
+        fputc('\n', ctx->journal);
+    }
+    if (empty) {
+        acvp_journal_write(ctx, "session", ctx->session_url, ACVP_SUCCESS);
+    }
+
+    /*
+     * Responses that were computed but maybe not uploaded are sent
+     * from disk, everything not uploaded yet is processed as usual.
+     */
+    for (vs = ctx->vsid_url_list, i = 0; vs; vs = vs->next, i++) {
+        if (state[i] == ACVP_JOURNAL_UPLOADED) {
+            uploaded++;
+            continue;
+        }
+        if (state[i] == ACVP_JOURNAL_COMPUTED) {
+            vs_rv = acvp_journal_resubmit(&vs_ctx, vs->string);
+            if (vs_rv == ACVP_SUCCESS) {
+                resent++;
+                continue;
+            }
+            if (vs_rv != ACVP_NO_DATA) {
+                if (rv == ACVP_SUCCESS) {
+                    rv = vs_rv;
+                }
+                continue;
+            }
+        }
+        *tail = calloc(1, sizeof(ACVP_STRING_LIST));
+        if (!*tail) {
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
+        (*tail)->string = vs->string;
+        tail = &(*tail)->next;
+        left++;
+    }
+    ACVP_LOG_STATUS("Resuming from %s: %d vector sets uploaded before, %d saved responses sent, %d left",
+                    journal, uploaded, resent, left);
+
+    if (todo) {
+        vs_rv = acvp_process_vs_list(ctx, todo);
+        if (rv == ACVP_SUCCESS) {
+            rv = vs_rv;
+        }
+    }
+
+end:
+    acvp_free_vs_ctx(&vs_ctx);
+    while (todo) {
+        vs = todo->next;
+        free(todo);
+        todo = vs;
+    }
+    if (ctx->journal) {
+        fclose(ctx->journal);
+        ctx->journal = NULL;
+    }
+    if (ctx->journal_path) {
+        free(ctx->journal_path);
+        ctx->journal_path = NULL;
+    }
+    if (state) { free(state); }
+    return rv;
+#endif
+}
+
+#ifndef WIN32
+static void *acvp_process_tests_thread(void *arg) {
+    ACVP_CTX *ctx = (ACVP_CTX *)arg;
+    ACVP_RESULT rv;
+
+    rv = acvp_process_tests(ctx);
+
+    pthread_mutex_lock(&ctx->async_lock);
+    ctx->async_rv = rv;
+    ctx->async_done = 1;
+    pthread_cond_broadcast(&ctx->async_cond);
+    pthread_mutex_unlock(&ctx->async_lock);
+    return NULL;
+}
+#endif
+
+ACVP_RESULT acvp_process_tests_async(ACVP_CTX *ctx,
+                                     void (*vs_done_cb)(ACVP_CTX *ctx, const ACVP_VS_STATUS *status, void *arg),
+                                     void *arg) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+#ifdef WIN32
+    ACVP_LOG_ERR("Asynchronous processing is not supported on Windows");
+    return ACVP_UNSUPPORTED_OP;
+#else
+    if (ctx->async_started) {
+        ACVP_LOG_ERR("Test session processing already started, call acvp_wait() first");
+        return ACVP_DUPLICATE_CTX;
+    }
+    if (!ctx->vsid_url_list) {
+        return ACVP_MISSING_ARG;
+    }
+
+    ctx->vs_done_cb = vs_done_cb;
+    ctx->vs_done_arg = arg;
+    ctx->cancel = 0;
+    ctx->async_done = 0;
+    ctx->async_rv = ACVP_SUCCESS;
+    pthread_mutex_init(&ctx->async_lock, NULL);
+    pthread_cond_init(&ctx->async_cond, NULL);
+    if (pthread_create(&ctx->async_thread, NULL, acvp_process_tests_thread, ctx)) {
+        ACVP_LOG_ERR("Unable to start the test session thread");
+        pthread_cond_destroy(&ctx->async_cond);
+        pthread_mutex_destroy(&ctx->async_lock);
+        ctx->vs_done_cb = NULL;
+        ctx->vs_done_arg = NULL;
+        return ACVP_UNSUPPORTED_OP;
+    }
+    ctx->async_started = 1;
+    return ACVP_SUCCESS;
+#endif
+}
+
+ACVP_RESULT acvp_cancel(ACVP_CTX *ctx) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    ctx->cancel = 1;
+    return ACVP_SUCCESS;
+}
+
+ACVP_RESULT acvp_wait(ACVP_CTX *ctx, int timeout_ms, ACVP_RESULT *result) {
+#ifndef WIN32
+    struct timespec ts;
+    int done;
+#endif
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+#ifdef WIN32
+    return ACVP_NO_DATA;
+#else
+    if (!ctx->async_started) {
+        return ACVP_NO_DATA;
+    }
+
+    if (timeout_ms > 0) {
+        acvp_deadline(&ts, timeout_ms);
+    }
+    pthread_mutex_lock(&ctx->async_lock);
+    while (!ctx->async_done && timeout_ms) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&ctx->async_cond, &ctx->async_lock);
+        } else if (pthread_cond_timedwait(&ctx->async_cond, &ctx->async_lock, &ts) == ETIMEDOUT) {
+            break;
+        }
+    }
+    done = ctx->async_done;
+    pthread_mutex_unlock(&ctx->async_lock);
+    if (!done) {
+        return ACVP_IN_PROGRESS;
+    }
+
+    pthread_join(ctx->async_thread, NULL);
+    pthread_cond_destroy(&ctx->async_cond);
+    pthread_mutex_destroy(&ctx->async_lock);
+    ctx->async_started = 0;
+    ctx->vs_done_cb = NULL;
+    ctx->vs_done_arg = NULL;
+    if (result) {
+        *result = ctx->async_rv;
+    }
+    return ACVP_SUCCESS;
+#endif
+}
+
+#ifndef WIN32
+static int acvp_is_vs_file(const struct dirent *entry) {
+    size_t len = strnlen_s(entry->d_name, ACVP_VS_PATH_MAX);
+
+    return (len > 5 && !strncmp(entry->d_name + len - 5, ".json", 5)) ||
+           (len > 4 && !strncmp(entry->d_name + len - 4, ACVP_VS_CACHE_SUFFIX, 4));
+}
+
+/*
+ * Whether a vector set file came from the vector set cache
+ * rather than from the server as is.
+ */
+static int acvp_is_vs_cache_file(const char *vs_file) {
+    size_t len = strnlen_s(vs_file, ACVP_VS_PATH_MAX);
+
+    return len > 4 && !strncmp(vs_file + len - 4, ACVP_VS_CACHE_SUFFIX, 4);
+}
+
+/*
+ * Lists the vector set files in vs_dir, in name order so
+ * that repeated runs process them the same way.
+ */
+static ACVP_RESULT acvp_list_vs_files(ACVP_CTX *ctx, const char *vs_dir, ACVP_STRING_LIST **vs_list) {
+    struct dirent **names = NULL;
+    ACVP_STRING_LIST **tail = vs_list;
+    ACVP_STRING_LIST *vs_entry = NULL;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    int cnt, i, len;
+
+    cnt = scandir(vs_dir, &names, acvp_is_vs_file, alphasort);
+    if (cnt < 0) {
+        ACVP_LOG_ERR("Unable to read vector set directory %s", vs_dir);
+        return ACVP_INVALID_ARG;
+    }
+
+    for (i = 0; i < cnt; i++) {
+        if (rv == ACVP_SUCCESS) {
+            vs_entry = calloc(1, sizeof(ACVP_STRING_LIST));
+            if (vs_entry) {
+                vs_entry->string = calloc(ACVP_VS_PATH_MAX + 1, sizeof(char));
+            }
+            if (!vs_entry || !vs_entry->string) {
+                free(vs_entry);
+                rv = ACVP_MALLOC_FAIL;
+            } else {
+                *tail = vs_entry;
+                tail = &vs_entry->next;
+                len = snprintf(vs_entry->string, ACVP_VS_PATH_MAX + 1, "%s/%s", vs_dir, names[i]->d_name);
+                if (len > ACVP_VS_PATH_MAX) {
+                    ACVP_LOG_ERR("Vector set file path too long: %s/%s", vs_dir, names[i]->d_name);
+                    rv = ACVP_INVALID_ARG;
+                }
+            }
+        }
+        free(names[i]);
+    }
+    free(names);
+    return rv;
+}
+#endif
+
+/*
+ * Offline counterpart of acvp_process_tests().  The vector sets
+ * come from files in vs_dir and the responses are written to
+ * rsp_dir, there is no session with the server.
+ */
+ACVP_RESULT acvp_process_tests_offline(ACVP_CTX *ctx, const char *vs_dir, const char *rsp_dir) {
+#ifdef WIN32
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    ACVP_LOG_ERR("Offline processing is not supported on Windows");
+    return ACVP_UNSUPPORTED_OP;
+#else
+    ACVP_RESULT rv = ACVP_SUCCESS, vs_rv;
+    ACVP_STRING_LIST *vs_list = NULL, *vs_entry = NULL;
+    ACVP_VS_CTX vs_ctx;
+    struct stat vs_st, rsp_st;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!vs_dir || !rsp_dir) {
+        ACVP_LOG_ERR("Vector set and response directories are required");
+        return ACVP_MISSING_ARG;
+    }
+    if (stat(rsp_dir, &rsp_st) || !S_ISDIR(rsp_st.st_mode)) {
+        ACVP_LOG_ERR("Response directory %s doesn't exist", rsp_dir);
+        return ACVP_INVALID_ARG;
+    }
+    /* Responses have the names of the vector sets and would replace them */
+    if (!stat(vs_dir, &vs_st) && vs_st.st_dev == rsp_st.st_dev && vs_st.st_ino == rsp_st.st_ino) {
+        ACVP_LOG_ERR("Vector set and response directories must differ");
+        return ACVP_INVALID_ARG;
+    }
+
+    rv = acvp_list_vs_files(ctx, vs_dir, &vs_list);
+    if (rv != ACVP_SUCCESS) {
+        goto end;
+    }
+    if (!vs_list) {
+        ACVP_LOG_ERR("No vector set files found in %s", vs_dir);
+        rv = ACVP_MISSING_ARG;
+        goto end;
+    }
+
+    if (ctx->max_concurrency > 1) {
+        rv = acvp_process_tests_parallel(ctx, vs_list, rsp_dir);
+        goto end;
+    }
+
+    /*
+     * As with acvp_process_tests(), the other files are still
+     * processed after one fails and the first failure is returned.
+     */
+    memzero_s(&vs_ctx, sizeof(ACVP_VS_CTX));
+    for (vs_entry = vs_list; vs_entry; vs_entry = vs_entry->next) {
+        if (ctx->cancel) {
+            if (rv == ACVP_SUCCESS) {
+                rv = ACVP_CANCELLED;
+            }
+            break;
+        }
+        vs_ctx.ctx = ctx;
+        vs_rv = acvp_process_vs_file(&vs_ctx, vs_entry->string, rsp_dir);
+        if (vs_rv != ACVP_SUCCESS && rv == ACVP_SUCCESS) {
+            rv = vs_rv;
+        }
+    }
+    acvp_free_vs_ctx(&vs_ctx);
+
+end:
+    while (vs_list) {
+        vs_entry = vs_list->next;
+        free(vs_list->string);
+        free(vs_list);
+        vs_list = vs_entry;
+    }
+    ctx->cancel = 0;
+    return rv;
+#endif
+}
+
+/*
+ * This routine will iterate through all the vector sets, requesting
+ * the test result from the server for each set.
+ */
+ACVP_RESULT acvp_check_test_results(ACVP_CTX *ctx) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+
+    rv = acvp_get_result_test_session(ctx, ctx->session_url);
+    return rv;
+}
+
+/***************************************************************************************************************
+* Begin vector processing logic.  This code should probably go into another module.
+***************************************************************************************************************/
+
+ACVP_RESULT acvp_refresh(ACVP_CTX *ctx) {
+    char *login = NULL;
+    int login_len = 0;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    ACVP_ARENA *vs_arena = NULL;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+
+    /*
+     * A refresh can happen in the middle of a vector set, the login
+     * JSON is session state and must not come from its arena.
+     */
+    vs_arena = acvp_json_arena_set(NULL);
+
+    if (ctx->totp_cb) {
+        rv = acvp_build_login(ctx, &login, &login_len, 1);
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("Unable to build login message");
+            goto end;
+        }
+
+        if (ctx->debug >= ACVP_LOG_LVL_STATUS) {
+            printf("\nPOST %s\n", login);
+        } else {
+            ACVP_LOG_INFO("POST %s", login);
+        }
+
+        /*
+         * Send the login to the ACVP server and get the response,
+         */
+        rv = acvp_send_login(ctx, login, login_len);
+        if (rv == ACVP_SUCCESS) {
+            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf.data);
+            rv = acvp_parse_login(ctx);
+        } else {
+            ACVP_LOG_STATUS("Login Send Failed %s", ctx->reg_buf.data);
+            goto end;
+        }
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_STATUS("Login Response Failed, %d", rv);
+            goto end;
+        }
+#ifndef WIN32
+        acvp_session_file_save(ctx);
+#endif
+    }
+end:
+    if (login) json_free_serialized_string(login);
+    acvp_json_arena_set(vs_arena);
+    return rv;
+}
+
+/*
+ * This function will process a single KAT vector set.  Each KAT
+ * vector set has an identifier associated with it, called
+ * the vs_id.  During registration, libacvp will receive the
+ * list of vs_id's that need to be processed during the test
+ * session.  This routine will execute the test flow for a single
+ * vs_id.  The flow is:
+ *	a) Download the KAT vector set from the server using the vs_id
+ *	b) Parse the KAT vectors
+ *	c) Process each test case in the KAT vector set
+ *	d) Generate the response data
+ *	e) Send the response data back to the ACVP server
+ *
+ * Returns ACVP_KAT_DOWNLOAD_RETRY with vs_ctx->retry_period set when
+ * the server isn't ready with the vector set yet.
+ */
+static ACVP_RESULT acvp_process_vsid(ACVP_VS_CTX *vs_ctx, char *vsid_url) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    JSON_Value *val = NULL;
+    JSON_Object *obj = NULL;
+    ACVP_ARENA *prev_arena = NULL;
+    ACVP_RESULT net_rv;
+    char *rsp = NULL;
+    int cached = 0;
+
+    vs_ctx->vsid_url = vsid_url;
+    vs_ctx->retry_period = 0;
+    vs_ctx->vs_id = 0;
+    vs_ctx->algorithm = NULL;
+    vs_ctx->mode = NULL;
+    vs_ctx->tc_count = 0;
+    vs_ctx->start_ms = acvp_now_ms();
+
+    if (!acvp_lib_worker_enter(ctx, 1)) {
+        return ACVP_CANCELLED;
+    }
+
+    /*
+     * Every JSON value of this vector set, request and response,
+     * comes from the work context's arena and goes away at once
+     * when the vector set is done.
+     */
+    prev_arena = acvp_json_arena_set(&vs_ctx->json_arena);
+
+    vs_ctx->groups_done = 0;
+    vs_ctx->deferred_groups = NULL;
+    vs_ctx->stream_rv = ACVP_SUCCESS;
+#ifndef WIN32
+    /*
+     * A vector set already in the cache is processed from
+     * there, the server isn't asked for it again.
+     */
+    cached = acvp_vs_cache_name(vs_ctx, vsid_url);
+    if (cached) {
+        rv = acvp_vs_cache_read(vs_ctx, vs_ctx->cache.path, vs_ctx->cache.vs_id, &acvp_process_test_group, &val);
+        if (rv == ACVP_SUCCESS && val) {
+            ACVP_LOG_STATUS("Read vsId %d from %s, %d test groups", vs_ctx->cache.vs_id,
+                            vs_ctx->cache.path, vs_ctx->groups_done);
+            rv = vs_ctx->stream_rv;
+        }
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
+        if (!val) {
+            cached = acvp_vs_cache_open(vs_ctx) == ACVP_SUCCESS;
+        }
+    }
+#endif
+
+    /*
+     * Get the KAT vector set.  The test groups are handed
+     * to acvp_process_test_group() as they arrive, so only
+     * the remainder of the vector set is left in val.
+     */
+    if (!val) {
+        vs_ctx->kat_stream = acvp_vs_parser(vs_ctx, cached ? &acvp_vs_cache_process_group : &acvp_process_test_group);
+        if (!vs_ctx->kat_stream) {
+            ACVP_LOG_ERR("Unable to create vector set parser");
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
+
+        net_rv = acvp_retrieve_vector_set(vs_ctx, vsid_url);
+        rv = net_rv == ACVP_SUCCESS ? vs_ctx->stream_rv : net_rv;
+        val = json_stream_finish(vs_ctx->kat_stream);
+        json_stream_free(vs_ctx->kat_stream);
+        vs_ctx->kat_stream = NULL;
+#ifndef WIN32
+        /*
+         * The vector set is cached even when one of its groups
+         * failed, as long as all of it came through.
+         */
+        obj = acvp_get_obj_from_rsp(val);
+        acvp_vs_cache_close(vs_ctx, net_rv == ACVP_SUCCESS && obj && !json_object_get_number(obj, "retry") ? val : NULL);
+#endif
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
+        if (!val) {
+            ACVP_LOG_ERR("JSON parse error");
+            rv = ACVP_JSON_ERR;
+            goto end;
+        }
+        rv = acvp_vs_deferred_groups(vs_ctx, val);
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("Unable to process the test groups of %s", vsid_url);
+            goto end;
+        }
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n200 OK, %d test groups\n", vs_ctx->groups_done);
+        } else {
+            ACVP_LOG_STATUS("200 OK, %d test groups", vs_ctx->groups_done);
+        }
+    }
+    obj = acvp_get_obj_from_rsp(val);
+
+    /*
+     * If the KAT values are not ready yet, the caller parks the
+     * vector set and asks for it again later.
+     */
+    vs_ctx->retry_period = json_object_get_number(obj, "retry");
+    if (vs_ctx->retry_period) {
+        rv = ACVP_KAT_DOWNLOAD_RETRY;
+    } else if (vs_ctx->groups_done) {
+        ACVP_LOG_STATUS("Successfully processed KAT vector set");
+    } else {
+        /*
+         * Process the KAT vectors
+         */
+        rv = acvp_process_vector_set(vs_ctx, obj);
+    }
+    json_value_free(val);
+    val = NULL;
+    if (rv != ACVP_SUCCESS) {
+        goto end;
+    }
+
+#ifndef WIN32
+    /*
+     * With a journal the response is kept on disk before it is
+     * sent, so that it never needs to be computed again.
+     */
+    if (ctx->journal) {
+        rv = acvp_journal_response(vs_ctx, &rsp);
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
+    }
+#endif
+
+    /*
+     * Send the responses to the ACVP server
+     */
+    ACVP_LOG_STATUS("POST vector set response vsId: %d", vs_ctx->vs_id);
+    rv = acvp_submit_vector_responses(vs_ctx);
+end:
+    acvp_module_vs_end(vs_ctx);
+    if (rv != ACVP_KAT_DOWNLOAD_RETRY) {
+        acvp_vs_done(ctx, vsid_url, vs_ctx->vs_id, vs_ctx->algorithm, vs_ctx->mode,
+                     vs_ctx->tc_count, vs_ctx->start_ms, rv);
+    }
+    /* Nothing from the arena may be freed once it is unset */
+    vs_ctx->kat_resp = NULL;
+    vs_ctx->deferred_groups = NULL;
+    vs_ctx->rsp_data = NULL;
+    if (rsp) { free(rsp); }
+    acvp_json_arena_set(prev_arena);
+    acvp_arena_reset(&vs_ctx->json_arena);
+    acvp_lib_worker_leave();
+    return rv;
+}
+
+#ifndef WIN32
+/*
+ * Processes one vector set saved to disk and writes the
+ * response to a file of the same name in rsp_dir.  A vector
+ * set from the cache gets a ".json" response file.
+ */
+static ACVP_RESULT acvp_process_vs_file(ACVP_VS_CTX *vs_ctx, char *vs_file, const char *rsp_dir) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    JSON_Value *val = NULL;
+    JSON_Object *obj = NULL;
+    ACVP_ARENA *prev_arena = NULL;
+    char rsp_file[ACVP_VS_PATH_MAX + 1];
+    const char *name = NULL;
+    int from_cache, name_len;
+
+    name = strrchr(vs_file, '/');
+    name = name ? name + 1 : vs_file;
+    from_cache = acvp_is_vs_cache_file(name);
+    name_len = strnlen_s(name, ACVP_VS_PATH_MAX) - (from_cache ? 4 : 0);
+    if (snprintf(rsp_file, sizeof(rsp_file), "%s/%.*s%s", rsp_dir, name_len, name,
+                 from_cache ? ".json" : "") > ACVP_VS_PATH_MAX) {
+        ACVP_LOG_ERR("Response file path too long: %s/%s", rsp_dir, name);
+        return ACVP_INVALID_ARG;
+    }
+
+    vs_ctx->vs_id = 0;
+    vs_ctx->algorithm = NULL;
+    vs_ctx->mode = NULL;
+    vs_ctx->tc_count = 0;
+    vs_ctx->start_ms = acvp_now_ms();
+    if (!acvp_lib_worker_enter(ctx, 1)) {
+        return ACVP_CANCELLED;
+    }
+    prev_arena = acvp_json_arena_set(&vs_ctx->json_arena);
+
+    ACVP_LOG_STATUS("Processing vector set file %s", vs_file);
+    if (from_cache) {
+        rv = acvp_vs_cache_read(vs_ctx, vs_file, 0, NULL, &val);
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
+    } else {
+        val = json_parse_file(vs_file);
+    }
+    if (!val) {
+        ACVP_LOG_ERR("Unable to parse vector set file %s", vs_file);
+        rv = ACVP_JSON_ERR;
+        goto end;
+    }
+    obj = acvp_get_obj_from_rsp(val);
+    if (!obj) {
+        ACVP_LOG_ERR("Vector set file %s is missing the acvVersion header", vs_file);
+        rv = ACVP_JSON_ERR;
+        goto end;
+    }
+
+    rv = acvp_process_vector_set(vs_ctx, obj);
+    if (rv != ACVP_SUCCESS) {
+        goto end;
+    }
+
+    if (json_serialize_to_file(vs_ctx->kat_resp, rsp_file) != JSONSuccess) {
+        ACVP_LOG_ERR("Unable to write vector set response to %s", rsp_file);
+        rv = ACVP_TRANSPORT_FAIL;
+        goto end;
+    }
+    ACVP_LOG_STATUS("Wrote vector set response vsId: %d to %s", vs_ctx->vs_id, rsp_file);
+
+end:
+    acvp_module_vs_end(vs_ctx);
+    acvp_vs_done(ctx, vs_file, vs_ctx->vs_id, vs_ctx->algorithm, vs_ctx->mode,
+                 vs_ctx->tc_count, vs_ctx->start_ms, rv);
+    vs_ctx->kat_resp = NULL;
+    acvp_json_arena_set(prev_arena);
+    acvp_arena_reset(&vs_ctx->json_arena);
+    acvp_lib_worker_leave();
+    return rv;
+}
+#endif
+
+ACVP_RESULT acvp_time_vector_set(ACVP_CTX *ctx, const char *vs_json, ACVP_VS_TIMING *timing) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    ACVP_VS_CTX vs_ctx;
+    JSON_Value *val = NULL;
+    JSON_Object *obj = NULL;
+    ACVP_ARENA *prev_arena = NULL;
+    char *rsp = NULL;
+    size_t rsp_size;
+    long long t;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!vs_json || !timing) {
+        return ACVP_MISSING_ARG;
+    }
+    memzero_s(timing, sizeof(ACVP_VS_TIMING));
+    memzero_s(&vs_ctx, sizeof(ACVP_VS_CTX));
+    vs_ctx.ctx = ctx;
+    prev_arena = acvp_json_arena_set(&vs_ctx.json_arena);
+
+    t = acvp_now_ns();
+    val = acvp_parse_vector_set(&vs_ctx, vs_json, strnlen_s(vs_json, RSIZE_MAX_STR));
+    timing->parse_ns = acvp_now_ns() - t;
+    obj = acvp_get_obj_from_rsp(val);
+    if (!obj) {
+        ACVP_LOG_ERR("Unable to parse vector set");
+        rv = ACVP_JSON_ERR;
+        goto end;
+    }
+
+    t = acvp_now_ns();
+    rv = acvp_process_vector_set(&vs_ctx, obj);
+    acvp_module_vs_end(&vs_ctx);
+    timing->handler_ns = acvp_now_ns() - t;
+    timing->tc_count = vs_ctx.tc_count;
+    if (rv != ACVP_SUCCESS) {
+        goto end;
+    }
+
+    t = acvp_now_ns();
+    rsp_size = json_serialization_size(vs_ctx.kat_resp);
+    rsp = rsp_size ? malloc(rsp_size) : NULL;
+    if (!rsp || json_serialize_to_buffer(vs_ctx.kat_resp, rsp, rsp_size) != JSONSuccess) {
+        ACVP_LOG_ERR("Unable to serialize vector set response");
+        rv = ACVP_MALLOC_FAIL;
+        goto end;
+    }
+    timing->serialize_ns = acvp_now_ns() - t;
+    timing->rsp_len = rsp_size - 1;
+
+end:
+    free(rsp);
+    vs_ctx.kat_resp = NULL;
+    acvp_json_arena_set(prev_arena);
+    acvp_free_vs_ctx(&vs_ctx);
+    return rv;
+}
+
+/*
+ * Called by the vector set parser each time a complete test group
+ * has been downloaded.  The group is put into the partially parsed
+ * vector set as its only test group and dispatched on its own.  The
+ * handler's response groups are then moved onto the response of the
+ * first group, so that vs_ctx->kat_resp holds the whole vector set
+ * response once the download is complete.
+ *
+ * Returns non-zero to stop the download.
+ */
+static int acvp_process_test_group(JSON_Object *vs_obj, JSON_Value *group, void *arg) {
+    ACVP_VS_CTX *vs_ctx = (ACVP_VS_CTX *)arg;
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    ACVP_RESULT rv = ACVP_MALLOC_FAIL;
+    JSON_Value *groups_val = NULL, *prev_resp = NULL;
+    JSON_Array *rsp_groups = NULL, *prev_groups = NULL;
+
+    if (ctx->cancel) {
+        json_value_free(group);
+        rv = ACVP_CANCELLED;
+        goto end;
+    }
+
+    /*
+     * Until the algorithm and vsId of the vector set have been
+     * parsed the groups are set aside, acvp_vs_deferred_groups()
+     * puts them back for the whole vector set to be processed.
+     */
+    if (vs_ctx->deferred_groups ||
+        !json_object_has_value(vs_obj, "vsId") ||
+        !acvp_vs_alg_known(json_object_get_string(vs_obj, "algorithm"),
+                           json_object_get_string(vs_obj, "mode"))) {
+        if (!vs_ctx->deferred_groups) {
+            vs_ctx->deferred_groups = json_value_init_array();
+        }
+        if (!vs_ctx->deferred_groups ||
+            json_array_append_value(json_value_get_array(vs_ctx->deferred_groups), group) != JSONSuccess) {
+            json_value_free(group);
+            vs_ctx->stream_rv = ACVP_MALLOC_FAIL;
+            return 1;
+        }
+        return 0;
+    }
+
+    groups_val = json_value_init_array();
+    if (!groups_val) {
+        json_value_free(group);
+        goto end;
+    }
+    if (json_array_append_value(json_value_get_array(groups_val), group) != JSONSuccess) {
+        json_value_free(group);
+        json_value_free(groups_val);
+        goto end;
+    }
+    if (json_object_set_value(vs_obj, "testGroups", groups_val) != JSONSuccess) {
+        json_value_free(groups_val);
+        goto end;
+    }
+
+    /*
+     * The handler replaces vs_ctx->kat_resp, hold on to the
+     * responses from the earlier groups of this vector set.
+     */
+    if (vs_ctx->groups_done) {
+        prev_resp = vs_ctx->kat_resp;
+        vs_ctx->kat_resp = NULL;
+    }
+
+    rv = acvp_dispatch_vector_set(vs_ctx, vs_obj);
+    json_object_remove(vs_obj, "testGroups");
+    if (rv != ACVP_SUCCESS || !prev_resp) {
+        goto end;
+    }
+
+    rsp_groups = json_object_get_array(json_array_get_object(json_value_get_array(vs_ctx->kat_resp), 1),
+                                       "testGroups");
+    prev_groups = json_object_get_array(json_array_get_object(json_value_get_array(prev_resp), 1),
+                                        "testGroups");
+    if (!rsp_groups || !prev_groups) {
+        ACVP_LOG_ERR("Vector set response is missing testGroups");
+        rv = ACVP_JSON_ERR;
+        goto end;
+    }
+    if (json_array_append_array_values(prev_groups, rsp_groups) != JSONSuccess) {
+        rv = ACVP_MALLOC_FAIL;
+        goto end;
+    }
+    json_value_free(vs_ctx->kat_resp);
+    vs_ctx->kat_resp = prev_resp;
+    prev_resp = NULL;
+
+end:
+    if (rv == ACVP_SUCCESS) {
+        vs_ctx->groups_done++;
+    } else {
+        ACVP_LOG_ERR("Failed to process test group %d of vsId %d", vs_ctx->groups_done + 1, vs_ctx->vs_id);
+        vs_ctx->stream_rv = rv;
+    }
+    if (prev_resp) json_value_free(prev_resp);
+    return rv != ACVP_SUCCESS;
+}
+
+/*
+ * Puts the test groups that acvp_process_test_group() set aside back
+ * into the vector set once it is parsed, in place of the empty array
+ * the parser leaves behind.
+ */
+static ACVP_RESULT acvp_vs_deferred_groups(ACVP_VS_CTX *vs_ctx, JSON_Value *val) {
+    JSON_Object *obj = NULL;
+    JSON_Value *groups = vs_ctx->deferred_groups;
+
+    if (!groups) {
+        return ACVP_SUCCESS;
+    }
+    vs_ctx->deferred_groups = NULL;
+    obj = acvp_get_obj_from_rsp(val);
+    if (!obj || json_object_set_value(obj, "testGroups", groups) != JSONSuccess) {
+        json_value_free(groups);
+        return ACVP_JSON_ERR;
+    }
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function is used to invoke the appropriate handler function
+ * for a given ACV operation.  The operation is specified in the
+ * KAT vector set that was previously downloaded.  The handler function
+ * is looked up in the alg_tbl[] (through the hash index in acvp_util.c)
+ * and invoked here.
+ */
+static ACVP_RESULT acvp_dispatch_vector_set(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    const ACVP_ALG_HANDLER *entry;
+    ACVP_CIPHER cipher;
+    JSON_Array *groups = NULL;
+    size_t i;
+    const char *alg = json_object_get_string(obj, "algorithm");
+    const char *mode = json_object_get_string(obj, "mode");
+    int vs_id = json_object_get_number(obj, "vsId");
+
+    vs_ctx->vs_id = vs_id;
+    ACVP_RESULT rv;
+
+    if (!alg) {
+        ACVP_LOG_ERR("JSON parse error: ACV algorithm not found");
+        return ACVP_JSON_ERR;
+    }
+
+    /* A streamed vector set comes through here once per test group */
+    if (!vs_ctx->groups_done) {
+        ACVP_LOG_STATUS("vs: %d", vs_id);
+        ACVP_LOG_STATUS("ACV Operation: %s", alg);
+        ACVP_LOG_INFO("ACV version: %s", json_object_get_string(obj, "acvVersion"));
+    }
+
+    if (mode) {
+        cipher = acvp_lookup_cipher_w_mode_index(alg, mode);
+    } else {
+        cipher = acvp_lookup_cipher_index(alg);
+    }
+    entry = acvp_lookup_alg_entry(cipher);
+    if (!entry) {
+        return ACVP_UNSUPPORTED_OP;
+    }
+
+    vs_ctx->algorithm = alg;
+    vs_ctx->mode = mode;
+    groups = json_object_get_array(obj, "testGroups");
+    for (i = 0; i < json_array_get_count(groups); i++) {
+        vs_ctx->tc_count += (int)json_array_get_count(json_object_get_array(json_array_get_object(groups, i), "tests"));
+    }
+
+    rv = acvp_module_vs_begin(vs_ctx, entry->cipher);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
+    return (entry->handler)(vs_ctx, obj);
+}
+
+/*
+ * This function is used to process the test cases for
+ * a given KAT vector set.  This is invoked after the
+ * KAT vector set has been downloaded from the server.  The
+ * vectors are stored on the ACVP_VS_CTX in one of the
+ * transitory fields.  Therefore, the vs_id isn't needed
+ * here to know which vectors need to be processed.
+ *
+ * The processing logic is:
+ *	a) JSON parse the data
+ *	b) Identify the ACVP operation to be performed (e.g. AES encrypt)
+ *	c) Dispatch the vectors to the handler for the
+ *	   specified ACVP operation.
+ */
+static ACVP_RESULT acvp_process_vector_set(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    ACVP_RESULT rv;
+
+    rv = acvp_dispatch_vector_set(vs_ctx, obj);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
+
+    ACVP_LOG_STATUS("Successfully processed KAT vector set");
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function will get the test results for a single KAT vector set.
+ */
+static ACVP_RESULT acvp_get_result_test_session(ACVP_CTX *ctx, char *session_url) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    JSON_Value *val = NULL;
+    JSON_Object *obj = NULL;
+    char *json_buf = NULL;
+    int retry = 1, count = 0, i, passed;
+    JSON_Array *results = NULL;
+    JSON_Object *current = NULL;
+    int diff = 1;
+    ACVP_RETRY_QUEUE retry_q; /* only for its jitter state */
+    long long delay;
+    int polls = 0;
+
+    acvp_retry_queue_init(&retry_q);
+
+    while (retry) {
+        /*
+         * Get the KAT vector set
+         */
+        rv = acvp_retrieve_result(ctx, session_url);
+        if (rv != ACVP_SUCCESS) {
             goto end;
         }
-        json_buf = ctx->test_sess_buf;
+        json_buf = ctx->test_sess_buf.data;
 
         if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-            printf("%s\n", ctx->test_sess_buf);
+            printf("%s\n", ctx->test_sess_buf.data);
         } else {
-            ACVP_LOG_ERR("%s", ctx->test_sess_buf);
+            ACVP_LOG_ERR("%s", ctx->test_sess_buf.data);
         }
         val = json_parse_string(json_buf);
         if (!val) {
@@ -2019,8 +4974,11 @@ static ACVP_RESULT acvp_get_result_test_session(ACVP_CTX *ctx, char *session_url
         count = (int)json_array_get_count(results);
 
         passed = json_object_get_boolean(obj, "passed");
-        if (passed) {
+        if (passed == 1) {
             ACVP_LOG_STATUS("Passed all vectors in test session");
+#ifndef WIN32
+            acvp_session_file_done(ctx, 1);
+#endif
             goto end;
         }
 
@@ -2035,14 +4993,24 @@ static ACVP_RESULT acvp_get_result_test_session(ACVP_CTX *ctx, char *session_url
                      json_object_get_string(current, "status"), &diff);
 
             if (!diff) {
-                rv = acvp_retry_handler(ctx, 30);
-                if (ACVP_KAT_DOWNLOAD_RETRY == rv) {
-                    retry = 1;
-                } else if (rv != ACVP_SUCCESS) {
+                /*
+                 * Poll again, quickly at first and backing off while
+                 * the server is still working on the dispositions.
+                 */
+                polls++;
+                if (ctx->retry_limit && polls >= ctx->retry_limit) {
+                    ACVP_LOG_ERR("Test session results still incomplete after %d attempts", polls);
+                    rv = ACVP_KAT_DOWNLOAD_RETRY;
+                    goto end;
+                }
+                delay = acvp_retry_delay_ms(&retry_q, ACVP_RESULT_POLL_MIN, polls);
+                ACVP_LOG_STATUS("Test session results incomplete, asking again in %lld ms", delay);
+                acvp_sleep_until(ctx, acvp_now_ms() + delay);
+                if (ctx->cancel) {
+                    rv = ACVP_CANCELLED;
                     goto end;
-                } else {
-                    retry = 0;
                 }
+                retry = 1;
                 if (val) json_value_free(val);
                 val = NULL;
                 break;
@@ -2058,12 +5026,12 @@ static ACVP_RESULT acvp_get_result_test_session(ACVP_CTX *ctx, char *session_url
                         if (rv != ACVP_SUCCESS) {
                             goto end;
                         }
-                        json_buf = ctx->test_sess_buf;
+                        json_buf = ctx->test_sess_buf.data;
 
                         if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-                            printf("%s\n", ctx->test_sess_buf);
+                            printf("%s\n", ctx->test_sess_buf.data);
                         } else {
-                            ACVP_LOG_ERR("%s", ctx->test_sess_buf);
+                            ACVP_LOG_ERR("%s", ctx->test_sess_buf.data);
                         }
                     }
                     if (ctx->is_sample) {
@@ -2072,12 +5040,10 @@ static ACVP_RESULT acvp_get_result_test_session(ACVP_CTX *ctx, char *session_url
                             goto end;
                         }
                         if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-                            printf("%s\n", ctx->sample_buf);
+                            printf("%s\n", ctx->sample_buf.data);
                         } else {
-                            ACVP_LOG_ERR("%s", ctx->sample_buf);
+                            ACVP_LOG_ERR("%s", ctx->sample_buf.data);
                         }
-                        free(ctx->sample_buf);
-                        ctx->sample_buf = NULL;
                     }
                 }
             }
@@ -2085,6 +5051,9 @@ static ACVP_RESULT acvp_get_result_test_session(ACVP_CTX *ctx, char *session_url
     }
 
     ACVP_LOG_STATUS("Received all dispositions for test session");
+#ifndef WIN32
+    acvp_session_file_done(ctx, 0);
+#endif
 
 end:
     if (val) json_value_free(val);
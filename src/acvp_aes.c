@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "acvp.h"
 #include "acvp_lcl.h"
@@ -40,7 +41,7 @@ static ACVP_RESULT acvp_aes_output_tc(ACVP_CTX *ctx,
                                       JSON_Object *tc_rsp,
                                       int opt_rv);
 
-static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_aes_init_tc(ACVP_VS_CTX *vs_ctx,
                                     ACVP_SYM_CIPHER_TC *stc,
                                     unsigned int tc_id,
                                     ACVP_SYM_CIPH_TESTTYPE test_type,
@@ -62,20 +63,53 @@ static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
                                     ACVP_SYM_CIPH_IVGEN_MODE iv_gen_mode,
                                     unsigned int aad_len,
                                     unsigned int incr_ctr,
-                                    unsigned int ovrflw_ctr);
+                                    unsigned int ovrflw_ctr,
+                                    int batch);
 
-static ACVP_RESULT acvp_aes_release_tc(ACVP_SYM_CIPHER_TC *stc);
+static ACVP_RESULT acvp_aes_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_SYM_CIPHER_TC *stc);
+
+static ACVP_RESULT acvp_aes_process_batch(ACVP_VS_CTX *vs_ctx,
+                                          ACVP_CAPS_LIST *cap,
+                                          ACVP_TC_BATCH *batch,
+                                          JSON_Array *r_tarr);
 
-#define KEY_COL_LEN 101
 #define KEY_ROW_LEN 32
-#define IV_COL_LEN 101
 #define IV_ROW_LEN 16
-#define TEXT_COL_LEN 1001
-#define TEXT_ROW_LEN 32
-static unsigned char key[KEY_COL_LEN][KEY_ROW_LEN];
-static unsigned char iv[IV_COL_LEN][IV_ROW_LEN];
-static unsigned char ptext[TEXT_COL_LEN][TEXT_ROW_LEN];
-static unsigned char ctext[TEXT_COL_LEN][TEXT_ROW_LEN];
+#define TEXT_ROW_LEN 16
+
+/*
+ * Batched test cases get pt/ct buffers this much longer than the
+ * payload, for the output of KW/KWP wrapping and the CCM tag.
+ */
+#define ACVP_AES_BLOCK_LEN 16
+#define ACVP_AES_BATCH_PAD 16
+
+static int acvp_aes_min(int a, int b) { return a < b ? a : b; }
+static int acvp_aes_max(int a, int b) { return a > b ? a : b; }
+
+/* Bytes the hex string decodes to, 0 if there is none */
+static int acvp_aes_hex_bytes(const char *hex, int max_len) {
+    return hex ? (strnlen_s(hex, max_len + 1) + 1) / 2 : 0;
+}
+
+/*
+ * The iterate step never looks further back than 255 inner
+ * iterations (CFB1 with a 256 bit key), so only that many
+ * pt/ct blocks are kept, indexed by the iteration modulo 256.
+ */
+#define MCT_WINDOW 256
+#define MCT_ROW(a, j) ((a)[(j) & (MCT_WINDOW - 1)])
+
+/*
+ * Monte Carlo state for one test case, owned by
+ * acvp_aes_mct_tc() so any number of them can run at once.
+ */
+typedef struct acvp_aes_mct_state_t {
+    unsigned char ctext[MCT_WINDOW][TEXT_ROW_LEN];
+    unsigned char ptext[MCT_WINDOW][TEXT_ROW_LEN];
+    unsigned char key[KEY_ROW_LEN]; /* key at the start of the outer iteration */
+    unsigned char iv[IV_ROW_LEN];   /* iv of the outer iteration, for CFB1 */
+} ACVP_AES_MCT_STATE;
 
 #define gb(a, b) (((a)[(b) / 8] >> (7 - (b) % 8)) & 1)
 #define sb(a, b, v) ((a)[(b) / 8] = ((a)[(b) / 8] & ~(1 << (7 - (b) % 8))) | (!!(v) << (7 - (b) % 8)))
@@ -85,28 +119,29 @@ static unsigned char ctext[TEXT_COL_LEN][TEXT_ROW_LEN];
  * and/or pt/ct information may need to be modified.  This function
  * performs the iteration depdedent upon the cipher type and direction.
  */
-static ACVP_RESULT acvp_aes_mct_iterate_tc(ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *stc, int i) {
+static ACVP_RESULT acvp_aes_mct_iterate_tc(ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *stc, ACVP_AES_MCT_STATE *mct) {
     int j = stc->mct_index;
-
+    unsigned char (*ctext)[TEXT_ROW_LEN] = mct->ctext;
+    unsigned char (*ptext)[TEXT_ROW_LEN] = mct->ptext;
 
     if (stc->cipher != ACVP_AES_CFB1) {
-        memcpy_s(ctext[j], TEXT_ROW_LEN, stc->ct, stc->ct_len);
-        memcpy_s(ptext[j], TEXT_ROW_LEN, stc->pt, stc->pt_len);
+        memcpy_s(MCT_ROW(ctext, j), TEXT_ROW_LEN, stc->ct, stc->ct_len);
+        memcpy_s(MCT_ROW(ptext, j), TEXT_ROW_LEN, stc->pt, stc->pt_len);
     } else {
-        ctext[j][0] = stc->ct[0];
-        ptext[j][0] = stc->pt[0];
+        MCT_ROW(ctext, j)[0] = stc->ct[0];
+        MCT_ROW(ptext, j)[0] = stc->pt[0];
     }
     if (j == 0) {
-        memcpy_s(key[j], KEY_ROW_LEN, stc->key, stc->key_len / 8);
+        memcpy_s(mct->key, KEY_ROW_LEN, stc->key, stc->key_len / 8);
     }
 
     switch (stc->cipher) {
     case ACVP_AES_ECB:
 
         if (stc->direction == ACVP_SYM_CIPH_DIR_ENCRYPT) {
-            memcpy_s(stc->pt, ACVP_SYM_PT_BYTE_MAX, ctext[j], stc->ct_len);
+            memcpy_s(stc->pt, ACVP_SYM_PT_BYTE_MAX, MCT_ROW(ctext, j), stc->ct_len);
         } else {
-            memcpy_s(stc->ct, ACVP_SYM_CT_BYTE_MAX, ptext[j], stc->ct_len);
+            memcpy_s(stc->ct, ACVP_SYM_CT_BYTE_MAX, MCT_ROW(ptext, j), stc->ct_len);
         }
         break;
 
@@ -121,11 +156,11 @@ static ACVP_RESULT acvp_aes_mct_iterate_tc(ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *st
             }
         } else {
             if (stc->direction == ACVP_SYM_CIPH_DIR_ENCRYPT) {
-                memcpy_s(stc->pt, ACVP_SYM_PT_BYTE_MAX, ctext[j - 1], stc->ct_len);
-                memcpy_s(stc->iv, ACVP_SYM_IV_BYTE_MAX, ctext[j], stc->ct_len);
+                memcpy_s(stc->pt, ACVP_SYM_PT_BYTE_MAX, MCT_ROW(ctext, j - 1), stc->ct_len);
+                memcpy_s(stc->iv, ACVP_SYM_IV_BYTE_MAX, MCT_ROW(ctext, j), stc->ct_len);
             } else {
-                memcpy_s(stc->ct, ACVP_SYM_CT_BYTE_MAX, ptext[j - 1], stc->ct_len);
-                memcpy_s(stc->iv, ACVP_SYM_IV_BYTE_MAX, ptext[j], stc->ct_len);
+                memcpy_s(stc->ct, ACVP_SYM_CT_BYTE_MAX, MCT_ROW(ptext, j - 1), stc->ct_len);
+                memcpy_s(stc->iv, ACVP_SYM_IV_BYTE_MAX, MCT_ROW(ptext, j), stc->ct_len);
             }
         }
         break;
@@ -135,13 +170,13 @@ static ACVP_RESULT acvp_aes_mct_iterate_tc(ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *st
             if (j < 16) {
                 memcpy_s(stc->pt, ACVP_SYM_PT_BYTE_MAX, &stc->iv[j], stc->pt_len);
             } else {
-                memcpy_s(stc->pt, ACVP_SYM_PT_BYTE_MAX, ctext[j - 16], stc->pt_len);
+                memcpy_s(stc->pt, ACVP_SYM_PT_BYTE_MAX, MCT_ROW(ctext, j - 16), stc->pt_len);
             }
         } else {
             if (j < 16) {
                 memcpy_s(stc->ct, ACVP_SYM_CT_BYTE_MAX, &stc->iv[j], stc->ct_len);
             } else {
-                memcpy_s(stc->ct, ACVP_SYM_CT_BYTE_MAX, ptext[j - 16], stc->ct_len);
+                memcpy_s(stc->ct, ACVP_SYM_CT_BYTE_MAX, MCT_ROW(ptext, j - 16), stc->ct_len);
             }
         }
         break;
@@ -149,18 +184,18 @@ static ACVP_RESULT acvp_aes_mct_iterate_tc(ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *st
     case ACVP_AES_CFB1:
         if (stc->direction == ACVP_SYM_CIPH_DIR_ENCRYPT) {
             if (j < 128) {
-                sb(ptext[j + 1], 0, gb(iv[i], j));
+                sb(MCT_ROW(ptext, j + 1), 0, gb(mct->iv, j));
             } else {
-                sb(ptext[j + 1], 0, gb(ctext[j - 128], 0));
+                sb(MCT_ROW(ptext, j + 1), 0, gb(MCT_ROW(ctext, j - 128), 0));
             }
-            stc->pt[0] = ptext[j + 1][0];
+            stc->pt[0] = MCT_ROW(ptext, j + 1)[0];
         } else {
             if (j < 128) {
-                sb(ctext[j + 1], 0, gb(iv[i], j));
+                sb(MCT_ROW(ctext, j + 1), 0, gb(mct->iv, j));
             } else {
-                sb(ctext[j + 1], 0, gb(ptext[j - 128], 0));
+                sb(MCT_ROW(ctext, j + 1), 0, gb(MCT_ROW(ptext, j - 128), 0));
             }
-            stc->ct[0] = ctext[j + 1][0];
+            stc->ct[0] = MCT_ROW(ctext, j + 1)[0];
         }
         break;
     default:
@@ -246,6 +281,56 @@ end:
     return rv;
 }
 
+/*
+ * Runs the inner loop of one outer iteration through the module's
+ * mct_handler.  The handler hands back the pt/ct of every inner
+ * iteration; the tail of those is loaded into the window and the
+ * last iterate step is replayed, which leaves stc and mct exactly
+ * as the per-iteration loop would have.
+ */
+static ACVP_RESULT acvp_aes_mct_inner_tc(ACVP_CTX *ctx,
+                                         ACVP_CAPS_LIST *cap,
+                                         ACVP_TEST_CASE *tc,
+                                         ACVP_SYM_CIPHER_TC *stc,
+                                         ACVP_AES_MCT_STATE *mct,
+                                         unsigned char *rows) {
+    unsigned char *mct_pt = rows;
+    unsigned char *mct_ct = rows + ACVP_AES_MCT_INNER * TEXT_ROW_LEN;
+    int j, last = ACVP_AES_MCT_INNER - 1;
+    int rc;
+
+    memcpy_s(mct->key, KEY_ROW_LEN, stc->key, stc->key_len / 8);
+
+    stc->mct_index = 0;
+    stc->mct_count = ACVP_AES_MCT_INNER;
+    stc->mct_row_len = TEXT_ROW_LEN;
+    stc->mct_pt = mct_pt;
+    stc->mct_ct = mct_ct;
+    rc = (cap->mct_handler)(tc);
+    stc->mct_pt = NULL;
+    stc->mct_ct = NULL;
+    if (rc) {
+        ACVP_LOG_ERR("crypto module failed the MCT operation");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+
+    for (j = ACVP_AES_MCT_INNER - MCT_WINDOW; j < last; ++j) {
+        memcpy_s(MCT_ROW(mct->ctext, j), TEXT_ROW_LEN, mct_ct + j * TEXT_ROW_LEN, TEXT_ROW_LEN);
+        memcpy_s(MCT_ROW(mct->ptext, j), TEXT_ROW_LEN, mct_pt + j * TEXT_ROW_LEN, TEXT_ROW_LEN);
+    }
+
+    if (stc->cipher != ACVP_AES_CFB1) {
+        memcpy_s(stc->ct, ACVP_SYM_CT_BYTE_MAX, mct_ct + last * TEXT_ROW_LEN, stc->ct_len);
+        memcpy_s(stc->pt, ACVP_SYM_PT_BYTE_MAX, mct_pt + last * TEXT_ROW_LEN, stc->pt_len);
+    } else {
+        stc->ct[0] = mct_ct[last * TEXT_ROW_LEN];
+        stc->pt[0] = mct_pt[last * TEXT_ROW_LEN];
+    }
+    stc->mct_index = last;
+
+    return acvp_aes_mct_iterate_tc(ctx, stc, mct);
+}
+
 /*
  * This is the handler for AES MCT values.  This will parse
  * a JSON encoded vector set for AES.  Each test case is
@@ -262,16 +347,37 @@ static ACVP_RESULT acvp_aes_mct_tc(ACVP_CTX *ctx,
     JSON_Value *r_tval = NULL;  /* Response testval */
     JSON_Object *r_tobj = NULL; /* Response testobj */
     char *tmp = NULL;
+    void *mct_buf = NULL;
+    ACVP_AES_MCT_STATE *mct = NULL;
+    unsigned char (*ctext)[TEXT_ROW_LEN] = NULL;
+    unsigned char (*ptext)[TEXT_ROW_LEN] = NULL;
+    unsigned char *rows = NULL;
 #define MCT_CT_LEN 68 /* 64 + 4 */
     unsigned char ciphertext[MCT_CT_LEN] = { 0 };
 
     tmp = calloc(1, ACVP_SYM_CT_MAX + 1);
-    if (!tmp) {
+    /* Start the state on a cache line of its own */
+    mct_buf = calloc(1, sizeof(ACVP_AES_MCT_STATE) + ACVP_CACHE_LINE_LEN - 1);
+    if (!tmp || !mct_buf) {
         ACVP_LOG_ERR("Unable to malloc in acvp_aes_mct_tc");
-        return ACVP_MALLOC_FAIL;
+        rv = ACVP_MALLOC_FAIL;
+        goto end;
+    }
+    mct = (ACVP_AES_MCT_STATE *)(((uintptr_t)mct_buf + ACVP_CACHE_LINE_LEN - 1) &
+                                 ~(uintptr_t)(ACVP_CACHE_LINE_LEN - 1));
+    ctext = mct->ctext;
+    ptext = mct->ptext;
+
+    if (cap->mct_handler) {
+        rows = calloc(2 * ACVP_AES_MCT_INNER, TEXT_ROW_LEN);
+        if (!rows) {
+            ACVP_LOG_ERR("Unable to malloc in acvp_aes_mct_tc");
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
     }
 
-    memcpy_s(iv[0], IV_ROW_LEN, stc->iv, stc->iv_len);
+    memcpy_s(mct->iv, IV_ROW_LEN, stc->iv, stc->iv_len);
     for (i = 0; i < ACVP_AES_MCT_OUTER; ++i) {
         /*
          * Create a new test case in the response
@@ -286,28 +392,34 @@ static ACVP_RESULT acvp_aes_mct_tc(ACVP_CTX *ctx,
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("JSON output failure in AES module");
             json_value_free(r_tval);
-            free(tmp);
-            return rv;
+            goto end;
         }
 
-        for (j = 0; j < ACVP_AES_MCT_INNER; ++j) {
-            stc->mct_index = j;    /* indicates init vs. update */
-            /* Process the current AES encrypt test vector... */
-            if ((cap->crypto_handler)(tc)) {
-                ACVP_LOG_ERR("crypto module failed the operation");
-                free(tmp);
+        if (rows) {
+            rv = acvp_aes_mct_inner_tc(ctx, cap, tc, stc, mct, rows);
+            if (rv != ACVP_SUCCESS) {
                 json_value_free(r_tval);
-                return ACVP_CRYPTO_MODULE_FAIL;
+                goto end;
             }
+        } else {
+            for (j = 0; j < ACVP_AES_MCT_INNER; ++j) {
+                stc->mct_index = j;    /* indicates init vs. update */
+                /* Process the current AES encrypt test vector... */
+                if ((cap->crypto_handler)(tc)) {
+                    ACVP_LOG_ERR("crypto module failed the operation");
+                    json_value_free(r_tval);
+                    rv = ACVP_CRYPTO_MODULE_FAIL;
+                    goto end;
+                }
 
-            /*
-             * Adjust the parameters for next iteration if needed.
-             */
-            rv = acvp_aes_mct_iterate_tc(ctx, stc, i);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("Failed the MCT iteration changes");
-                free(tmp);
-                return rv;
+                /*
+                 * Adjust the parameters for next iteration if needed.
+                 */
+                rv = acvp_aes_mct_iterate_tc(ctx, stc, mct);
+                if (rv != ACVP_SUCCESS) {
+                    ACVP_LOG_ERR("Failed the MCT iteration changes");
+                    goto end;
+                }
             }
         }
 
@@ -318,15 +430,13 @@ static ACVP_RESULT acvp_aes_mct_tc(ACVP_CTX *ctx,
                 rv = acvp_bin_to_hexstr(stc->ct, 1, tmp, ACVP_SYM_CT_MAX);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("hex conversion failure (ct)");
-                    free(tmp);
-                    return rv;
+                    goto end;
                 }
             } else {
                 rv = acvp_bin_to_hexstr(stc->ct, stc->ct_len, tmp, ACVP_SYM_CT_MAX);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("hex conversion failure (ct)");
-                    free(tmp);
-                    return rv;
+                    goto end;
                 }
             }
             json_object_set_string(r_tobj, "ct", tmp);
@@ -334,37 +444,37 @@ static ACVP_RESULT acvp_aes_mct_tc(ACVP_CTX *ctx,
             if (stc->cipher == ACVP_AES_CFB8) {
                 /* ct = CT[j-15] || CT[j-14] || ... || CT[j] */
                 for (n1 = 0, n2 = stc->key_len / 8 - 1; n1 < stc->key_len / 8; ++n1, --n2) {
-                    ciphertext[n1] = ctext[j - n2][0];
+                    ciphertext[n1] = MCT_ROW(ctext, j - n2)[0];
                 }
 
                 /* IV[i+1] = ct */
                 for (n1 = 0, n2 = 15; n1 < 16; ++n1, --n2) {
-                    stc->iv[n1] = ctext[j - n2][0];
+                    stc->iv[n1] = MCT_ROW(ctext, j - n2)[0];
                 }
-                ptext[0][0] = ctext[j - 16][0];
+                MCT_ROW(ptext, 0)[0] = MCT_ROW(ctext, j - 16)[0];
             } else if (stc->cipher == ACVP_AES_CFB1) {
                 for (n1 = 0, n2 = stc->key_len - 1; n1 < stc->key_len; ++n1, --n2) {
-                    sb(ciphertext, n1, gb(ctext[j - n2], 0));
+                    sb(ciphertext, n1, gb(MCT_ROW(ctext, j - n2), 0));
                 }
 
                 for (n1 = 0, n2 = 127; n1 < 128; ++n1, --n2) {
-                    sb(iv[i + 1], n1, gb(ctext[j - n2], 0));
+                    sb(mct->iv, n1, gb(MCT_ROW(ctext, j - n2), 0));
                 }
-                ptext[0][0] = ctext[j - 128][0] & 0x80;
-                stc->pt[0] = ptext[0][0];
-                memcpy_s(stc->iv, ACVP_SYM_IV_BYTE_MAX, iv[i + 1], stc->iv_len);
+                MCT_ROW(ptext, 0)[0] = MCT_ROW(ctext, j - 128)[0] & 0x80;
+                stc->pt[0] = MCT_ROW(ptext, 0)[0];
+                memcpy_s(stc->iv, ACVP_SYM_IV_BYTE_MAX, mct->iv, stc->iv_len);
             } else {
                 switch (stc->key_len) {
                 case 128:
-                    memcpy_s(ciphertext, MCT_CT_LEN, ctext[j], 16);
+                    memcpy_s(ciphertext, MCT_CT_LEN, MCT_ROW(ctext, j), 16);
                     break;
                 case 192:
-                    memcpy_s(ciphertext, MCT_CT_LEN, ctext[j - 1] + 8, 8);
-                    memcpy_s(ciphertext + 8, (MCT_CT_LEN - 8), ctext[j], 16);
+                    memcpy_s(ciphertext, MCT_CT_LEN, MCT_ROW(ctext, j - 1) + 8, 8);
+                    memcpy_s(ciphertext + 8, (MCT_CT_LEN - 8), MCT_ROW(ctext, j), 16);
                     break;
                 case 256:
-                    memcpy_s(ciphertext, MCT_CT_LEN, ctext[j - 1], 16);
-                    memcpy_s(ciphertext + 16, (MCT_CT_LEN - 16), ctext[j], 16);
+                    memcpy_s(ciphertext, MCT_CT_LEN, MCT_ROW(ctext, j - 1), 16);
+                    memcpy_s(ciphertext + 16, (MCT_CT_LEN - 16), MCT_ROW(ctext, j), 16);
                     break;
                 }
             }
@@ -377,16 +487,14 @@ static ACVP_RESULT acvp_aes_mct_tc(ACVP_CTX *ctx,
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("hex conversion failure (pt)");
                     json_value_free(r_tval);
-                    free(tmp);
-                    return rv;
+                    goto end;
                 }
             } else {
                 rv = acvp_bin_to_hexstr(stc->pt, stc->pt_len, tmp, ACVP_SYM_CT_MAX);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("hex conversion failure (pt)");
-                    free(tmp);
                     json_value_free(r_tval);
-                    return rv;
+                    goto end;
                 }
             }
             json_object_set_string(r_tobj, "pt", tmp);
@@ -394,36 +502,36 @@ static ACVP_RESULT acvp_aes_mct_tc(ACVP_CTX *ctx,
             if (stc->cipher == ACVP_AES_CFB8) {
                 /* ct = CT[j-15] || CT[j-14] || ... || CT[j] */
                 for (n1 = 0, n2 = stc->key_len / 8 - 1; n1 < stc->key_len / 8; ++n1, --n2) {
-                    ciphertext[n1] = ptext[j - n2][0];
+                    ciphertext[n1] = MCT_ROW(ptext, j - n2)[0];
                 }
 
                 for (n1 = 0, n2 = 15; n1 < 16; ++n1, --n2) {
-                    stc->iv[n1] = ptext[j - n2][0];
+                    stc->iv[n1] = MCT_ROW(ptext, j - n2)[0];
                 }
-                ctext[0][0] = ptext[j - 16][0];
+                MCT_ROW(ctext, 0)[0] = MCT_ROW(ptext, j - 16)[0];
             } else if (stc->cipher == ACVP_AES_CFB1) {
                 for (n1 = 0, n2 = stc->key_len - 1; n1 < stc->key_len; ++n1, --n2) {
-                    sb(ciphertext, n1, gb(ptext[j - n2], 0));
+                    sb(ciphertext, n1, gb(MCT_ROW(ptext, j - n2), 0));
                 }
 
                 for (n1 = 0, n2 = 127; n1 < 128; ++n1, --n2) {
-                    sb(iv[i + 1], n1, gb(ptext[j - n2], 0));
+                    sb(mct->iv, n1, gb(MCT_ROW(ptext, j - n2), 0));
                 }
-                ctext[0][0] = ptext[j - 128][0] & 0x80;
-                stc->ct[0] = ctext[0][0];
-                memcpy_s(stc->iv, ACVP_SYM_IV_BYTE_MAX, iv[i + 1], stc->iv_len);
+                MCT_ROW(ctext, 0)[0] = MCT_ROW(ptext, j - 128)[0] & 0x80;
+                stc->ct[0] = MCT_ROW(ctext, 0)[0];
+                memcpy_s(stc->iv, ACVP_SYM_IV_BYTE_MAX, mct->iv, stc->iv_len);
             } else {
                 switch (stc->key_len) {
                 case 128:
-                    memcpy_s(ciphertext, MCT_CT_LEN, ptext[j], 16);
+                    memcpy_s(ciphertext, MCT_CT_LEN, MCT_ROW(ptext, j), 16);
                     break;
                 case 192:
-                    memcpy_s(ciphertext, MCT_CT_LEN, ptext[j - 1] + 8, 8);
-                    memcpy_s(ciphertext + 8, (MCT_CT_LEN - 8), ptext[j], 16);
+                    memcpy_s(ciphertext, MCT_CT_LEN, MCT_ROW(ptext, j - 1) + 8, 8);
+                    memcpy_s(ciphertext + 8, (MCT_CT_LEN - 8), MCT_ROW(ptext, j), 16);
                     break;
                 case 256:
-                    memcpy_s(ciphertext, MCT_CT_LEN, ptext[j - 1], 16);
-                    memcpy_s(ciphertext + 16, (MCT_CT_LEN - 16), ptext[j], 16);
+                    memcpy_s(ciphertext, MCT_CT_LEN, MCT_ROW(ptext, j - 1), 16);
+                    memcpy_s(ciphertext + 16, (MCT_CT_LEN - 16), MCT_ROW(ptext, j), 16);
                     break;
                 }
             }
@@ -431,15 +539,25 @@ static ACVP_RESULT acvp_aes_mct_tc(ACVP_CTX *ctx,
 
         /* create the key for the next loop */
         for (n = 0; n < stc->key_len / 8; ++n) {
-            stc->key[n] = key[0][n] ^ ciphertext[n];
+            stc->key[n] = mct->key[n] ^ ciphertext[n];
         }
 
         /* Append the test response value to array */
         json_array_append_value(res_array, r_tval);
     }
+    rv = ACVP_SUCCESS;
 
-    free(tmp);
-    return ACVP_SUCCESS;
+end:
+    if (tmp) free(tmp);
+    if (rows) {
+        memzero_s(rows, 2 * ACVP_AES_MCT_INNER * TEXT_ROW_LEN);
+        free(rows);
+    }
+    if (mct_buf) {
+        memzero_s(mct_buf, sizeof(ACVP_AES_MCT_STATE) + ACVP_CACHE_LINE_LEN - 1);
+        free(mct_buf);
+    }
+    return rv;
 }
 
 /**
@@ -572,7 +690,8 @@ static ACVP_SYM_CIPH_DIR read_direction(const char *str) {
  * parsed, processed, and a response is generated to be sent
  * back to the ACV server by the transport layer.
  */
-ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_aes_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Value *testval;
@@ -595,6 +714,9 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_CAPS_LIST *cap;
     ACVP_SYM_CIPHER_TC stc;
     ACVP_TEST_CASE tc;
+    ACVP_SYM_CIPHER_TC *batch_stc = NULL;
+    ACVP_TC_BATCH batch;
+    int use_batch = 0;
     ACVP_RESULT rv;
     unsigned int ovrflw_ctr = 0, incr_ctr = 0;  /* assume false */
     char *json_result = NULL;
@@ -640,7 +762,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -662,6 +784,11 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -847,6 +974,20 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         tests = json_object_get_array(groupobj, "tests");
         t_cnt = json_array_get_count(tests);
 
+        /*
+         * Collect the group for the module's batch handler if it has one
+         */
+        use_batch = cap->batch_handler && test_type != ACVP_SYM_TEST_TYPE_MCT;
+        if (use_batch) {
+            rv = acvp_tc_batch_init(vs_ctx, &batch, t_cnt);
+            batch_stc = acvp_arena_calloc(&vs_ctx->tc_arena, t_cnt ? t_cnt : 1, sizeof(ACVP_SYM_CIPHER_TC));
+            if (rv != ACVP_SUCCESS || !batch_stc) {
+                ACVP_LOG_ERR("Unable to malloc test case batch");
+                rv = ACVP_MALLOC_FAIL;
+                goto err;
+            }
+        }
+
         for (j = 0; j < t_cnt; j++) {
             const char *pt = NULL, *ct = NULL, *iv = NULL,
                        *key = NULL, *tag = NULL, *aad = NULL;
@@ -1001,16 +1142,26 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
              * Setup the test case data that will be passed down to
              * the crypto module.
              */
-            rv = acvp_aes_init_tc(ctx, &stc, tc_id, test_type, key, pt, ct, iv, tag, 
+            rv = acvp_aes_init_tc(vs_ctx, use_batch ? &batch_stc[batch.count] : &stc,
+                                  tc_id, test_type, key, pt, ct, iv, tag,
                                   aad, kwcipher, keylen, ivlen, datalen, ptlen,
                                   taglen, alg_id, dir, iv_gen, iv_gen_mode, aadlen,
-                                  incr_ctr, ovrflw_ctr);
+                                  incr_ctr, ovrflw_ctr, use_batch);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Init for stc (test case) failed");
-                acvp_aes_release_tc(&stc);
+                memzero_s(use_batch ? &batch_stc[batch.count] : &stc, sizeof(ACVP_SYM_CIPHER_TC));
+                json_value_free(r_tval);
                 goto err;
             }
 
+            if (use_batch) {
+                /* The response is filled in once the whole group has run */
+                batch.tcs[batch.count].tc.symmetric = &batch_stc[batch.count];
+                batch.count++;
+                json_array_append_value(r_tarr, r_tval);
+                continue;
+            }
+
             /* If Monte Carlo start that here */
             if (stc.test_type == ACVP_SYM_TEST_TYPE_MCT) {
                 json_object_set_value(r_tobj, "resultsArray", json_value_init_array());
@@ -1019,7 +1170,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("crypto module failed the MCT operation");
                     json_value_free(r_tval);
-                    acvp_aes_release_tc(&stc);
+                    acvp_aes_release_tc(vs_ctx, &stc);
                     goto err;
                 }
             } else {
@@ -1029,7 +1180,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
                     if (alg_id != ACVP_AES_KW && alg_id != ACVP_AES_GCM &&
                         alg_id != ACVP_AES_CCM && alg_id != ACVP_AES_KWP) {
                         ACVP_LOG_ERR("ERROR: crypto module failed the operation");
-                        acvp_aes_release_tc(&stc);
+                        acvp_aes_release_tc(vs_ctx, &stc);
                         json_value_free(r_tval);
                         rv = ACVP_CRYPTO_MODULE_FAIL;
                         goto err;
@@ -1043,7 +1194,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("JSON output failure in AES module");
                     json_value_free(r_tval);
-                    acvp_aes_release_tc(&stc);
+                    acvp_aes_release_tc(vs_ctx, &stc);
                     goto err;
                 }
             }
@@ -1051,26 +1202,38 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Release all the memory associated with the test case
              */
-            acvp_aes_release_tc(&stc);
+            acvp_aes_release_tc(vs_ctx, &stc);
 
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
+
+        if (use_batch) {
+            rv = acvp_aes_process_batch(vs_ctx, cap, &batch, r_tarr);
+            if (rv != ACVP_SUCCESS) {
+                goto err;
+            }
+        }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
     }
     json_array_append_value(reg_arry, r_vs_val);
     rv = ACVP_SUCCESS;
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
 
 err:
     if (rv != ACVP_SUCCESS) {
+        /* Test cases still batched or being set up */
+        acvp_arena_reset(&vs_ctx->tc_arena);
         acvp_release_json(r_vs_val, r_gval);
     }
     return rv;
@@ -1177,7 +1340,7 @@ err:
  * module to perform the actual encryption/decryption for
  * the test case.
  */
-static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_aes_init_tc(ACVP_VS_CTX *vs_ctx,
                                     ACVP_SYM_CIPHER_TC *stc,
                                     unsigned int tc_id,
                                     ACVP_SYM_CIPH_TESTTYPE test_type,
@@ -1199,24 +1362,45 @@ static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
                                     ACVP_SYM_CIPH_IVGEN_MODE iv_gen_mode,
                                     unsigned int aad_len,
                                     unsigned int incr_ctr,
-                                    unsigned int ovrflw_ctr) {
-
+                                    unsigned int ovrflw_ctr,
+                                    int batch) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     ACVP_RESULT rv;
+    int data_size = ACVP_SYM_PT_BYTE_MAX, iv_size = ACVP_SYM_IV_BYTE_MAX,
+        tag_size = ACVP_SYM_TAG_BYTE_MAX, aad_size = ACVP_SYM_AAD_BYTE_MAX;
 
     memzero_s(stc, sizeof(ACVP_SYM_CIPHER_TC));
 
-    stc->key = calloc(1, ACVP_SYM_KEY_MAX_BYTES);
-    if (!stc->key) { return ACVP_MALLOC_FAIL; }
-    stc->pt = calloc(1, ACVP_SYM_PT_BYTE_MAX);
-    if (!stc->pt) { return ACVP_MALLOC_FAIL; }
-    stc->ct = calloc(1, ACVP_SYM_CT_BYTE_MAX);
-    if (!stc->ct) { return ACVP_MALLOC_FAIL; }
-    stc->tag = calloc(1, ACVP_SYM_TAG_BYTE_MAX);
-    if (!stc->tag) { return ACVP_MALLOC_FAIL; }
-    stc->iv = calloc(1, ACVP_SYM_IV_BYTE_MAX);
-    if (!stc->iv) { return ACVP_MALLOC_FAIL; }
-    stc->aad = calloc(1, ACVP_SYM_AAD_BYTE_MAX);
-    if (!stc->aad) { return ACVP_MALLOC_FAIL; }
+    /*
+     * The test cases of a batch are all alive until the group is
+     * done, so their buffers are sized from the group's lengths
+     * and the values given rather than for the largest allowed.
+     */
+    if (batch) {
+        data_size = ACVP_BIT2BYTE(pt_len > (int)data_len ? pt_len : (int)data_len);
+        data_size = acvp_aes_max(data_size, acvp_aes_hex_bytes(j_pt, ACVP_SYM_PT_MAX));
+        data_size = acvp_aes_max(data_size, acvp_aes_hex_bytes(j_ct, ACVP_SYM_CT_MAX));
+        data_size = acvp_aes_min(data_size + ACVP_AES_BATCH_PAD, ACVP_SYM_PT_BYTE_MAX);
+        iv_size = acvp_aes_max(ACVP_BIT2BYTE(iv_len), acvp_aes_hex_bytes(j_iv, ACVP_SYM_IV_MAX));
+        iv_size = acvp_aes_min(acvp_aes_max(iv_size, ACVP_AES_BLOCK_LEN), ACVP_SYM_IV_BYTE_MAX);
+        tag_size = acvp_aes_max(ACVP_BIT2BYTE(tag_len), acvp_aes_hex_bytes(j_tag, ACVP_SYM_TAG_MAX));
+        tag_size = acvp_aes_min(tag_size, ACVP_SYM_TAG_BYTE_MAX);
+        aad_size = acvp_aes_max(ACVP_BIT2BYTE(aad_len), acvp_aes_hex_bytes(j_aad, ACVP_SYM_AAD_MAX));
+        aad_size = acvp_aes_min(aad_size, ACVP_SYM_AAD_BYTE_MAX);
+    }
+
+    rv = acvp_tc_buf(vs_ctx, NULL, ACVP_SYM_KEY_MAX_BYTES, ACVP_SYM_KEY_MAX_BYTES, &stc->key, NULL);
+    if (rv != ACVP_SUCCESS) { return rv; }
+    rv = acvp_tc_buf(vs_ctx, NULL, data_size, ACVP_SYM_PT_BYTE_MAX, &stc->pt, NULL);
+    if (rv != ACVP_SUCCESS) { return rv; }
+    rv = acvp_tc_buf(vs_ctx, NULL, data_size, ACVP_SYM_CT_BYTE_MAX, &stc->ct, NULL);
+    if (rv != ACVP_SUCCESS) { return rv; }
+    rv = acvp_tc_buf(vs_ctx, NULL, tag_size, ACVP_SYM_TAG_BYTE_MAX, &stc->tag, NULL);
+    if (rv != ACVP_SUCCESS) { return rv; }
+    rv = acvp_tc_buf(vs_ctx, NULL, iv_size, ACVP_SYM_IV_BYTE_MAX, &stc->iv, NULL);
+    if (rv != ACVP_SUCCESS) { return rv; }
+    rv = acvp_tc_buf(vs_ctx, NULL, aad_size, ACVP_SYM_AAD_BYTE_MAX, &stc->aad, NULL);
+    if (rv != ACVP_SUCCESS) { return rv; }
 
     rv = acvp_hexstr_to_bin(j_key, stc->key, ACVP_SYM_KEY_MAX_BYTES, NULL);
     if (rv != ACVP_SUCCESS) {
@@ -1226,7 +1410,7 @@ static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
 
     if (j_pt) {
         if (alg_id == ACVP_AES_CFB1) {
-            rv = acvp_hexstr_to_bin(j_pt, stc->pt, ACVP_SYM_PT_BYTE_MAX, NULL);
+            rv = acvp_hexstr_to_bin(j_pt, stc->pt, data_size, NULL);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Hex conversion failure (pt)");
                 return rv;
@@ -1234,7 +1418,7 @@ static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
             stc->data_len = data_len;
             stc->pt_len = data_len;
         } else {
-            rv = acvp_hexstr_to_bin(j_pt, stc->pt, ACVP_SYM_PT_BYTE_MAX, NULL);
+            rv = acvp_hexstr_to_bin(j_pt, stc->pt, data_size, NULL);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Hex conversion failure (pt)");
                 return rv;
@@ -1249,7 +1433,7 @@ static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
 
     if (j_ct) {
         if (alg_id == ACVP_AES_CFB1) {
-            rv = acvp_hexstr_to_bin(j_ct, stc->ct, ACVP_SYM_CT_BYTE_MAX, NULL);
+            rv = acvp_hexstr_to_bin(j_ct, stc->ct, data_size, NULL);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Hex conversion failure (ct)");
                 return rv;
@@ -1257,7 +1441,7 @@ static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
             stc->data_len = data_len;
             stc->ct_len = data_len;
         } else {
-            rv = acvp_hexstr_to_bin(j_ct, stc->ct, ACVP_SYM_CT_BYTE_MAX, NULL);
+            rv = acvp_hexstr_to_bin(j_ct, stc->ct, data_size, NULL);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Hex conversion failure (ct)");
                 return rv;
@@ -1270,7 +1454,7 @@ static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
         }
     }
     if (j_iv) {
-        rv = acvp_hexstr_to_bin(j_iv, stc->iv, ACVP_SYM_IV_BYTE_MAX, NULL);
+        rv = acvp_hexstr_to_bin(j_iv, stc->iv, iv_size, NULL);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (iv)");
             return rv;
@@ -1278,7 +1462,7 @@ static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
     }
 
     if (j_tag) {
-        rv = acvp_hexstr_to_bin(j_tag, stc->tag, ACVP_SYM_TAG_BYTE_MAX, NULL);
+        rv = acvp_hexstr_to_bin(j_tag, stc->tag, tag_size, NULL);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (tag)");
             return rv;
@@ -1286,7 +1470,7 @@ static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
     }
 
     if (j_aad) {
-        rv = acvp_hexstr_to_bin(j_aad, stc->aad, ACVP_SYM_AAD_BYTE_MAX, NULL);
+        rv = acvp_hexstr_to_bin(j_aad, stc->aad, aad_size, NULL);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (aad)");
             return rv;
@@ -1318,18 +1502,48 @@ static ACVP_RESULT acvp_aes_init_tc(ACVP_CTX *ctx,
     return ACVP_SUCCESS;
 }
 
+/*
+ * Runs the test cases collected for a test group through the
+ * module's batch handler and fills in their responses, which
+ * were appended to r_tarr in the same order.
+ */
+static ACVP_RESULT acvp_aes_process_batch(ACVP_VS_CTX *vs_ctx,
+                                          ACVP_CAPS_LIST *cap,
+                                          ACVP_TC_BATCH *batch,
+                                          JSON_Array *r_tarr) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    ACVP_SYM_CIPHER_TC *stc = NULL;
+    ACVP_RESULT rv;
+    int i;
+
+    rv = acvp_tc_batch_run(ctx, cap, batch);
+    for (i = 0; rv == ACVP_SUCCESS && i < batch->count; i++) {
+        stc = batch->tcs[i].tc.symmetric;
+        /* Failing to unwrap or authenticate is a valid answer for these */
+        if (batch->results[i] && stc->cipher != ACVP_AES_KW && stc->cipher != ACVP_AES_GCM &&
+            stc->cipher != ACVP_AES_CCM && stc->cipher != ACVP_AES_KWP) {
+            ACVP_LOG_ERR("ERROR: crypto module failed the operation");
+            rv = ACVP_CRYPTO_MODULE_FAIL;
+            break;
+        }
+        rv = acvp_aes_output_tc(ctx, stc, json_array_get_object(r_tarr, i), batch->results[i]);
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("JSON output failure in AES module");
+        }
+    }
+
+    /* The batched test cases were all allocated from the test case arena */
+    acvp_arena_reset(&vs_ctx->tc_arena);
+    return rv;
+}
+
 /*
  * This function simply releases the data associated with
  * a test case.
  */
-static ACVP_RESULT acvp_aes_release_tc(ACVP_SYM_CIPHER_TC *stc) {
-    if (stc->key) free(stc->key);
-    if (stc->pt) free(stc->pt);
-    if (stc->ct) free(stc->ct);
-    if (stc->tag) free(stc->tag);
-    if (stc->iv) free(stc->iv);
-    if (stc->aad) free(stc->aad);
+static ACVP_RESULT acvp_aes_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_SYM_CIPHER_TC *stc) {
     memzero_s(stc, sizeof(ACVP_SYM_CIPHER_TC));
+    acvp_arena_reset(&vs_ctx->tc_arena);
 
     return ACVP_SUCCESS;
 }
@@ -488,6 +488,10 @@ static ACVP_RESULT acvp_cap_list_append(ACVP_CTX *ctx,
         }
         cap_e2->next = cap_entry;
     }
+    if (cipher > ACVP_CIPHER_START && cipher < ACVP_CIPHER_END &&
+        !ctx->caps_by_cipher[cipher]) {
+        ctx->caps_by_cipher[cipher] = cap_entry;
+    }
 
     return ACVP_SUCCESS;
 
@@ -1012,6 +1016,97 @@ static ACVP_RESULT acvp_add_prereq_val(ACVP_CIPHER cipher,
     return ACVP_SUCCESS;
 }
 
+ACVP_RESULT acvp_cap_set_batch_handler(ACVP_CTX *ctx,
+                                       ACVP_CIPHER cipher,
+                                       int (*batch_handler)(ACVP_TEST_CASE *test_cases,
+                                                            int *results,
+                                                            int count)) {
+    ACVP_CAPS_LIST *cap_list;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!batch_handler) {
+        ACVP_LOG_ERR("NULL parameter 'batch_handler'");
+        return ACVP_INVALID_ARG;
+    }
+
+    cap_list = acvp_locate_cap_entry(ctx, cipher);
+    if (!cap_list) {
+        ACVP_LOG_ERR("Cap entry not found.");
+        return ACVP_NO_CAP;
+    }
+
+    /*
+     * Only the handlers that know how to collect a test group
+     */
+    switch (cap_list->cap_type) {
+    case ACVP_SYM_TYPE:
+        if (cipher < ACVP_AES_GCM || cipher > ACVP_AES_KWP) {
+            ACVP_LOG_ERR("Batch processing is not supported for this cipher");
+            return ACVP_UNSUPPORTED_OP;
+        }
+        break;
+    case ACVP_HASH_TYPE:
+    case ACVP_HMAC_TYPE:
+    case ACVP_CMAC_TYPE:
+        break;
+    default:
+        ACVP_LOG_ERR("Batch processing is not supported for this cipher");
+        return ACVP_UNSUPPORTED_OP;
+    }
+
+    cap_list->batch_handler = batch_handler;
+    return ACVP_SUCCESS;
+}
+
+ACVP_RESULT acvp_cap_set_mct_handler(ACVP_CTX *ctx,
+                                     ACVP_CIPHER cipher,
+                                     int (*mct_handler)(ACVP_TEST_CASE *test_case)) {
+    ACVP_CAPS_LIST *cap_list;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!mct_handler) {
+        ACVP_LOG_ERR("NULL parameter 'mct_handler'");
+        return ACVP_INVALID_ARG;
+    }
+
+    cap_list = acvp_locate_cap_entry(ctx, cipher);
+    if (!cap_list) {
+        ACVP_LOG_ERR("Cap entry not found.");
+        return ACVP_NO_CAP;
+    }
+
+    switch (cipher) {
+    case ACVP_AES_ECB:
+    case ACVP_AES_CBC:
+    case ACVP_AES_OFB:
+    case ACVP_AES_CFB1:
+    case ACVP_AES_CFB8:
+    case ACVP_AES_CFB128:
+    case ACVP_TDES_ECB:
+    case ACVP_TDES_CBC:
+    case ACVP_TDES_OFB:
+    case ACVP_TDES_CFB1:
+    case ACVP_TDES_CFB8:
+    case ACVP_TDES_CFB64:
+    case ACVP_HASH_SHA1:
+    case ACVP_HASH_SHA224:
+    case ACVP_HASH_SHA256:
+    case ACVP_HASH_SHA384:
+    case ACVP_HASH_SHA512:
+        break;
+    default:
+        ACVP_LOG_ERR("Monte Carlo tests are not supported for this cipher");
+        return ACVP_UNSUPPORTED_OP;
+    }
+
+    cap_list->mct_handler = mct_handler;
+    return ACVP_SUCCESS;
+}
+
 ACVP_RESULT acvp_cap_set_prereq(ACVP_CTX *ctx,
                                 ACVP_CIPHER cipher,
                                 ACVP_PREREQ_ALG pre_req_cap,
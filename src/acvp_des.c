@@ -62,9 +62,16 @@ static ACVP_RESULT acvp_des_release_tc(ACVP_SYM_CIPHER_TC *stc);
 #define OLD_IV_LEN 8
 #define TEXT_COL_LEN 10001
 #define TEXT_ROW_LEN 8
-static unsigned char old_iv[OLD_IV_LEN];
-static unsigned char ptext[TEXT_COL_LEN][TEXT_ROW_LEN];
-static unsigned char ctext[TEXT_COL_LEN][TEXT_ROW_LEN];
+
+/*
+ * Monte Carlo state carried between iterations.  Each handler call
+ * owns one, so vector sets of several sessions can run at once.
+ */
+typedef struct acvp_des_mct_state_t {
+    unsigned char old_iv[OLD_IV_LEN];
+    unsigned char ptext[TEXT_COL_LEN][TEXT_ROW_LEN];
+    unsigned char ctext[TEXT_COL_LEN][TEXT_ROW_LEN];
+} ACVP_DES_MCT_STATE;
 
 static void shiftin(unsigned char *dst, int dst_max, unsigned char *src, int nbits) {
     int n = 0, move_bytes = 0, copy_bytes = 0;
@@ -97,10 +104,14 @@ static void shiftin(unsigned char *dst, int dst_max, unsigned char *src, int nbi
  */
 static ACVP_RESULT acvp_des_mct_iterate_tc(ACVP_CTX *ctx,
                                            ACVP_SYM_CIPHER_TC *stc,
+                                           ACVP_DES_MCT_STATE *mct,
                                            int i,
                                            JSON_Object *r_tobj) {
     int j = stc->mct_index;
     int n;
+    unsigned char (*ctext)[TEXT_ROW_LEN] = mct->ctext;
+    unsigned char (*ptext)[TEXT_ROW_LEN] = mct->ptext;
+    unsigned char *old_iv = mct->old_iv;
 
     memcpy_s(ctext[j], TEXT_ROW_LEN,  stc->ct, stc->ct_len);
     memcpy_s(ptext[j], TEXT_ROW_LEN, stc->pt, stc->pt_len);
@@ -379,6 +390,55 @@ void acvp_des_set_odd_parity(unsigned char *key) {
     }
 }
 
+/*
+ * Runs the inner loop of one outer iteration through the module's
+ * mct_handler, which fills mct->ptext/ctext directly.  The next key only
+ * depends on the last 192 bits of output, so only those are shifted
+ * into nk before the last iterate step is replayed.
+ */
+static ACVP_RESULT acvp_des_mct_inner_tc(ACVP_CTX *ctx,
+                                         ACVP_CAPS_LIST *cap,
+                                         ACVP_TEST_CASE *tc,
+                                         ACVP_SYM_CIPHER_TC *stc,
+                                         ACVP_DES_MCT_STATE *mct,
+                                         unsigned char *nk,
+                                         int nk_len,
+                                         int bit_len,
+                                         int i,
+                                         JSON_Object *r_tobj) {
+    unsigned char (*ctext)[TEXT_ROW_LEN] = mct->ctext;
+    unsigned char (*ptext)[TEXT_ROW_LEN] = mct->ptext;
+    unsigned char (*out)[TEXT_ROW_LEN] = NULL;
+    int j, last = ACVP_DES_MCT_INNER - 1;
+    int rc;
+
+    memcpy_s(mct->old_iv, OLD_IV_LEN, stc->iv, stc->iv_len);
+
+    stc->mct_index = 0;
+    stc->mct_count = ACVP_DES_MCT_INNER;
+    stc->mct_row_len = TEXT_ROW_LEN;
+    stc->mct_pt = ptext[0];
+    stc->mct_ct = ctext[0];
+    rc = (cap->mct_handler)(tc);
+    stc->mct_pt = NULL;
+    stc->mct_ct = NULL;
+    if (rc) {
+        ACVP_LOG_ERR("crypto module failed the MCT operation");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+
+    out = (stc->direction == ACVP_SYM_CIPH_DIR_ENCRYPT) ? ctext : ptext;
+    for (j = ACVP_DES_MCT_INNER - 192 / bit_len; j <= last; ++j) {
+        shiftin(nk, nk_len, out[j], bit_len);
+    }
+
+    memcpy_s(stc->ct, ACVP_SYM_CT_BYTE_MAX, ctext[last], stc->ct_len);
+    memcpy_s(stc->pt, ACVP_SYM_PT_BYTE_MAX, ptext[last], stc->pt_len);
+    stc->mct_index = last;
+
+    return acvp_des_mct_iterate_tc(ctx, stc, mct, i, r_tobj);
+}
+
 /*
  * This is the handler for DES MCT values.  This will parse
  * a JSON encoded vector set for DES.  Each test case is
@@ -389,8 +449,11 @@ static ACVP_RESULT acvp_des_mct_tc(ACVP_CTX *ctx,
                                    ACVP_CAPS_LIST *cap,
                                    ACVP_TEST_CASE *tc,
                                    ACVP_SYM_CIPHER_TC *stc,
+                                   ACVP_DES_MCT_STATE *mct,
                                    JSON_Array *res_array) {
     int i, j, n, bit_len;
+    unsigned char (*ctext)[TEXT_ROW_LEN] = mct->ctext;
+    unsigned char (*ptext)[TEXT_ROW_LEN] = mct->ptext;
     ACVP_RESULT rv;
     JSON_Value *r_tval = NULL;  /* Response testval */
     JSON_Object *r_tobj = NULL; /* Response testobj */
@@ -442,33 +505,42 @@ static ACVP_RESULT acvp_des_mct_tc(ACVP_CTX *ctx,
             return rv;
         }
 
-        for (j = 0; j < ACVP_DES_MCT_INNER; ++j) {
-            if (j == 0) {
-                memcpy_s(old_iv, OLD_IV_LEN, stc->iv, stc->iv_len);
-            }
-            stc->mct_index = j;    /* indicates init vs. update */
-            /* Process the current DES encrypt test vector... */
-            if ((cap->crypto_handler)(tc)) {
-                ACVP_LOG_ERR("crypto module failed the operation");
-                free(tmp);
-                json_value_free(r_tval);
-                return ACVP_CRYPTO_MODULE_FAIL;
-            }
-            /*
-             * Adjust the parameters for next iteration if needed.
-             */
-            if (stc->direction == ACVP_SYM_CIPH_DIR_ENCRYPT) {
-                shiftin(nk, NK_LEN, stc->ct, bit_len);
-            } else {
-                shiftin(nk, NK_LEN, stc->pt, bit_len);
-            }
-            rv = acvp_des_mct_iterate_tc(ctx, stc, i, r_tobj);
+        if (cap->mct_handler) {
+            rv = acvp_des_mct_inner_tc(ctx, cap, tc, stc, mct, nk, NK_LEN, bit_len, i, r_tobj);
             if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("Failed the MCT iteration changes");
                 free(tmp);
                 json_value_free(r_tval);
                 return rv;
             }
+        } else {
+            for (j = 0; j < ACVP_DES_MCT_INNER; ++j) {
+                if (j == 0) {
+                    memcpy_s(mct->old_iv, OLD_IV_LEN, stc->iv, stc->iv_len);
+                }
+                stc->mct_index = j;    /* indicates init vs. update */
+                /* Process the current DES encrypt test vector... */
+                if ((cap->crypto_handler)(tc)) {
+                    ACVP_LOG_ERR("crypto module failed the operation");
+                    free(tmp);
+                    json_value_free(r_tval);
+                    return ACVP_CRYPTO_MODULE_FAIL;
+                }
+                /*
+                 * Adjust the parameters for next iteration if needed.
+                 */
+                if (stc->direction == ACVP_SYM_CIPH_DIR_ENCRYPT) {
+                    shiftin(nk, NK_LEN, stc->ct, bit_len);
+                } else {
+                    shiftin(nk, NK_LEN, stc->pt, bit_len);
+                }
+                rv = acvp_des_mct_iterate_tc(ctx, stc, mct, i, r_tobj);
+                if (rv != ACVP_SUCCESS) {
+                    ACVP_LOG_ERR("Failed the MCT iteration changes");
+                    free(tmp);
+                    json_value_free(r_tval);
+                    return rv;
+                }
+            }
         }
 
         for (n = 0; n < 8; ++n) {
@@ -613,7 +685,8 @@ static ACVP_SYM_CIPH_DIR read_direction(const char *str) {
  * parsed, processed, and a response is generated to be sent
  * back to the ACV server by the transport layer.
  */
-ACVP_RESULT acvp_des_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_des_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Value *testval;
@@ -637,6 +710,7 @@ ACVP_RESULT acvp_des_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_SYM_CIPHER_TC stc;
     ACVP_TEST_CASE tc;
     ACVP_RESULT rv;
+    ACVP_DES_MCT_STATE *mct = NULL;
 
     const char *alg_str = NULL;
     ACVP_SYM_CIPH_TESTTYPE test_type = 0;
@@ -689,7 +763,7 @@ ACVP_RESULT acvp_des_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -702,6 +776,11 @@ ACVP_RESULT acvp_des_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -955,7 +1034,17 @@ ACVP_RESULT acvp_des_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             if (stc.test_type == ACVP_SYM_TEST_TYPE_MCT) {
                 json_object_set_value(r_tobj, "resultsArray", json_value_init_array());
                 res_tarr = json_object_get_array(r_tobj, "resultsArray");
-                rv = acvp_des_mct_tc(ctx, cap, &tc, &stc, res_tarr);
+                if (!mct) {
+                    mct = calloc(1, sizeof(ACVP_DES_MCT_STATE));
+                    if (!mct) {
+                        ACVP_LOG_ERR("Unable to malloc MCT state");
+                        json_value_free(r_tval);
+                        acvp_des_release_tc(&stc);
+                        rv = ACVP_MALLOC_FAIL;
+                        goto err;
+                    }
+                }
+                rv = acvp_des_mct_tc(ctx, cap, &tc, &stc, mct, res_tarr);
                 if (rv != ACVP_SUCCESS) {
                     json_value_free(r_tval);
                     ACVP_LOG_ERR("crypto module failed the DES MCT operation");
@@ -995,24 +1084,31 @@ ACVP_RESULT acvp_des_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
     }
 
     json_array_append_value(reg_arry, r_vs_val);
     rv = ACVP_SUCCESS;
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
 
 err:
     if (rv != ACVP_SUCCESS) {
         acvp_release_json(r_vs_val, r_gval);
     }
+    if (mct) {
+        memzero_s(mct, sizeof(ACVP_DES_MCT_STATE));
+        free(mct);
+    }
     return rv;
 }
 
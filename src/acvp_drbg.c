@@ -36,9 +36,9 @@
 /*
  * Forward prototypes for local functions
  */
-static ACVP_RESULT acvp_drbg_output_tc(ACVP_CTX *ctx, ACVP_DRBG_TC *stc, JSON_Object *tc_rsp);
+static ACVP_RESULT acvp_drbg_output_tc(ACVP_VS_CTX *vs_ctx, ACVP_DRBG_TC *stc, JSON_Object *tc_rsp);
 
-static ACVP_RESULT acvp_drbg_init_tc(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_drbg_init_tc(ACVP_VS_CTX *vs_ctx,
                                      ACVP_DRBG_TC *stc,
                                      unsigned int tc_id,
                                      const char *additional_input,
@@ -58,9 +58,10 @@ static ACVP_RESULT acvp_drbg_init_tc(ACVP_CTX *ctx,
                                      ACVP_DRBG_MODE mode_id,
                                      ACVP_CIPHER alg_id);
 
-static ACVP_RESULT acvp_drbg_release_tc(ACVP_DRBG_TC *stc);
+static ACVP_RESULT acvp_drbg_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_DRBG_TC *stc);
 
-ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_drbg_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     char *json_result = NULL;
 
     JSON_Value *reg_arry_val = NULL;
@@ -134,7 +135,7 @@ ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -152,6 +153,11 @@ ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -280,9 +286,11 @@ ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             testval = json_array_get_value(tests, j);
             testobj = json_value_get_object(testval);
 
-            json_result = json_serialize_to_string_pretty(testval, NULL);
-            ACVP_LOG_INFO("json testval count: %d\n %s\n", i, json_result);
-            json_free_serialized_string(json_result);
+            if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+                json_result = json_serialize_to_string_pretty(testval, NULL);
+                ACVP_LOG_INFO("json testval count: %d\n %s\n", i, json_result);
+                json_free_serialized_string(json_result);
+            }
 
             tc_id = (unsigned int)json_object_get_number(testobj, "tcId");
 
@@ -433,7 +441,7 @@ ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
              * Setup the test case data that will be passed down to
              * the crypto module.
              */
-            rv = acvp_drbg_init_tc(ctx, &stc, tc_id, additional_input,
+            rv = acvp_drbg_init_tc(vs_ctx, &stc, tc_id, additional_input,
                                    entropy_input_pr, additional_input_1,
                                    entropy_input_pr_1, perso_string,
                                    entropy, nonce,
@@ -443,7 +451,7 @@ ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
                                    drb_len, mode_id, alg_id);
 
             if (rv != ACVP_SUCCESS) {
-                acvp_drbg_release_tc(&stc);
+                acvp_drbg_release_tc(vs_ctx, &stc);
                 json_value_free(r_tval);
                 goto err;
             }
@@ -452,7 +460,7 @@ ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             if ((cap->crypto_handler)(&tc)) {
                 ACVP_LOG_ERR("crypto module failed the operation");
                 rv = ACVP_CRYPTO_MODULE_FAIL;
-                acvp_drbg_release_tc(&stc);
+                acvp_drbg_release_tc(vs_ctx, &stc);
                 json_value_free(r_tval);
                 goto err;
             }
@@ -460,10 +468,10 @@ ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Output the test case results using JSON
              */
-            rv = acvp_drbg_output_tc(ctx, &stc, r_tobj);
+            rv = acvp_drbg_output_tc(vs_ctx, &stc, r_tobj);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("JSON output failure in DRBG module");
-                acvp_drbg_release_tc(&stc);
+                acvp_drbg_release_tc(vs_ctx, &stc);
                 json_value_free(r_tval);
                 goto err;
             }
@@ -471,22 +479,25 @@ ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Release all the memory associated with the test case
              */
-            acvp_drbg_release_tc(&stc);
+            acvp_drbg_release_tc(vs_ctx, &stc);
 
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
     }
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
 
     rv = ACVP_SUCCESS;
 err:
@@ -502,11 +513,12 @@ err:
  * file that will be uploaded to the server.  This routine handles
  * the JSON processing for a single test case.
  */
-static ACVP_RESULT acvp_drbg_output_tc(ACVP_CTX *ctx, ACVP_DRBG_TC *stc, JSON_Object *tc_rsp) {
+static ACVP_RESULT acvp_drbg_output_tc(ACVP_VS_CTX *vs_ctx, ACVP_DRBG_TC *stc, JSON_Object *tc_rsp) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     ACVP_RESULT rv = ACVP_SUCCESS;
     char *tmp = NULL;
 
-    tmp = calloc(ACVP_DRB_STR_MAX + 1, sizeof(char));
+    tmp = acvp_arena_alloc(&vs_ctx->tc_arena, ACVP_DRB_STR_MAX + 1);
     if (!tmp) {
         ACVP_LOG_ERR("Unable to malloc in acvp_drbg_output_tc");
         return ACVP_MALLOC_FAIL;
@@ -515,17 +527,14 @@ static ACVP_RESULT acvp_drbg_output_tc(ACVP_CTX *ctx, ACVP_DRBG_TC *stc, JSON_Ob
     rv = acvp_bin_to_hexstr(stc->drb, stc->drb_len, tmp, ACVP_DRB_STR_MAX);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (returnedBits)");
-        goto end;
+        return rv;
     }
     json_object_set_string(tc_rsp, "returnedBits", tmp);
 
-end:
-    if (tmp) free(tmp);
-
     return rv;
 }
 
-static ACVP_RESULT acvp_drbg_init_tc(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_drbg_init_tc(ACVP_VS_CTX *vs_ctx,
                                      ACVP_DRBG_TC *stc,
                                      unsigned int tc_id,
                                      const char *additional_input,
@@ -544,88 +553,64 @@ static ACVP_RESULT acvp_drbg_init_tc(ACVP_CTX *ctx,
                                      unsigned int drb_len,
                                      ACVP_DRBG_MODE mode_id,
                                      ACVP_CIPHER alg_id) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     ACVP_RESULT rv;
 
     memzero_s(stc, sizeof(ACVP_DRBG_TC));
 
-    stc->drb = calloc(ACVP_DRB_BYTE_MAX, sizeof(unsigned char));
-    if (!stc->drb) { return ACVP_MALLOC_FAIL; }
-    stc->additional_input = calloc(ACVP_DRBG_ADDI_IN_BYTE_MAX, sizeof(unsigned char));
-    if (!stc->additional_input) { return ACVP_MALLOC_FAIL; }
-    stc->additional_input_1 = calloc(ACVP_DRBG_ADDI_IN_BYTE_MAX, sizeof(unsigned char));
-    if (!stc->additional_input_1) { return ACVP_MALLOC_FAIL; }
-    stc->entropy = calloc(ACVP_DRBG_ENTPY_IN_BYTE_MAX, sizeof(unsigned char));
-    if (!stc->entropy) { return ACVP_MALLOC_FAIL; }
-    stc->entropy_input_pr = calloc(ACVP_DRBG_ENTPY_IN_BYTE_MAX, sizeof(unsigned char));
-    if (!stc->entropy_input_pr) { return ACVP_MALLOC_FAIL; }
-    stc->entropy_input_pr_1 = calloc(ACVP_DRBG_ENTPY_IN_BYTE_MAX, sizeof(unsigned char));
-    if (!stc->entropy_input_pr_1) { return ACVP_MALLOC_FAIL; }
-    stc->nonce = calloc(ACVP_DRBG_NONCE_BYTE_MAX, sizeof(unsigned char));
-    if (!stc->nonce) { return ACVP_MALLOC_FAIL; }
-    stc->perso_string = calloc(ACVP_DRBG_PER_SO_BYTE_MAX, sizeof(unsigned char));
-    if (!stc->perso_string) { return ACVP_MALLOC_FAIL; }
-
-    if (additional_input) {
-        rv = acvp_hexstr_to_bin(additional_input, stc->additional_input,
-                                ACVP_DRBG_ADDI_IN_BYTE_MAX, NULL);
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (additional_input)");
-            return rv;
-        }
+    /*
+     * Each input is sized from the group's bit lengths (or the value
+     * itself, if longer) and comes from the test case arena.  The
+     * module writes the returned bits, so that buffer keeps its full
+     * size.
+     */
+    rv = acvp_tc_buf(vs_ctx, NULL, ACVP_DRB_BYTE_MAX,
+                     ACVP_DRB_BYTE_MAX, &stc->drb, NULL);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Unable to allocate returnedBits");
+        return rv;
     }
-
-    if (entropy_input_pr) {
-        rv = acvp_hexstr_to_bin(entropy_input_pr, stc->entropy_input_pr,
-                                ACVP_DRBG_ENTPY_IN_BYTE_MAX, NULL);
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (entropy_input_pr)");
-            return rv;
-        }
+    rv = acvp_tc_buf(vs_ctx, additional_input, ACVP_BIT2BYTE(additional_input_len),
+                     ACVP_DRBG_ADDI_IN_BYTE_MAX, &stc->additional_input, NULL);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (additional_input)");
+        return rv;
     }
-
-    if (additional_input_1) {
-        rv = acvp_hexstr_to_bin(additional_input_1, stc->additional_input_1,
-                                ACVP_DRBG_ADDI_IN_BYTE_MAX, NULL);
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (2nd additional_input)");
-            return rv;
-        }
+    rv = acvp_tc_buf(vs_ctx, entropy_input_pr, ACVP_BIT2BYTE(entropy_len),
+                     ACVP_DRBG_ENTPY_IN_BYTE_MAX, &stc->entropy_input_pr, NULL);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (entropy_input_pr)");
+        return rv;
     }
-
-    if (entropy_input_pr_1) {
-        rv = acvp_hexstr_to_bin(entropy_input_pr_1, stc->entropy_input_pr_1,
-                                ACVP_DRBG_ENTPY_IN_BYTE_MAX, NULL);
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (2nd entropy_input_pr)");
-            return rv;
-        }
+    rv = acvp_tc_buf(vs_ctx, additional_input_1, ACVP_BIT2BYTE(additional_input_len),
+                     ACVP_DRBG_ADDI_IN_BYTE_MAX, &stc->additional_input_1, NULL);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (2nd additional_input)");
+        return rv;
     }
-
-    if (entropy) {
-        rv = acvp_hexstr_to_bin(entropy, stc->entropy,
-                                ACVP_DRBG_ENTPY_IN_BYTE_MAX, NULL);
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (entropy)");
-            return rv;
-        }
+    rv = acvp_tc_buf(vs_ctx, entropy_input_pr_1, ACVP_BIT2BYTE(entropy_len),
+                     ACVP_DRBG_ENTPY_IN_BYTE_MAX, &stc->entropy_input_pr_1, NULL);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (2nd entropy_input_pr)");
+        return rv;
     }
-
-    if (perso_string) {
-        rv = acvp_hexstr_to_bin(perso_string, stc->perso_string,
-                                ACVP_DRBG_PER_SO_BYTE_MAX, NULL);
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (perso_string)");
-            return rv;
-        }
+    rv = acvp_tc_buf(vs_ctx, entropy, ACVP_BIT2BYTE(entropy_len),
+                     ACVP_DRBG_ENTPY_IN_BYTE_MAX, &stc->entropy, NULL);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (entropy)");
+        return rv;
     }
-
-    if (nonce) {
-        rv = acvp_hexstr_to_bin(nonce, stc->nonce,
-                                ACVP_DRBG_NONCE_BYTE_MAX, NULL);
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (nonce)");
-            return rv;
-        }
+    rv = acvp_tc_buf(vs_ctx, perso_string, ACVP_BIT2BYTE(perso_string_len),
+                     ACVP_DRBG_PER_SO_BYTE_MAX, &stc->perso_string, NULL);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (perso_string)");
+        return rv;
+    }
+    rv = acvp_tc_buf(vs_ctx, nonce, ACVP_BIT2BYTE(nonce_len),
+                     ACVP_DRBG_NONCE_BYTE_MAX, &stc->nonce, NULL);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (nonce)");
+        return rv;
     }
 
     stc->der_func_enabled = der_func_enabled;
@@ -647,16 +632,8 @@ static ACVP_RESULT acvp_drbg_init_tc(ACVP_CTX *ctx,
  * This function simply releases the data associated with
  * a test case.
  */
-static ACVP_RESULT acvp_drbg_release_tc(ACVP_DRBG_TC *stc) {
-    if (stc->drb) free(stc->drb);
-    if (stc->additional_input) free(stc->additional_input);
-    if (stc->additional_input_1) free(stc->additional_input_1);
-    if (stc->entropy) free(stc->entropy);
-    if (stc->entropy_input_pr) free(stc->entropy_input_pr);
-    if (stc->entropy_input_pr_1) free(stc->entropy_input_pr_1);
-    if (stc->nonce) free(stc->nonce);
-    if (stc->perso_string) free(stc->perso_string);
-
+static ACVP_RESULT acvp_drbg_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_DRBG_TC *stc) {
     memzero_s(stc, sizeof(ACVP_DRBG_TC));
+    acvp_arena_reset(&vs_ctx->tc_arena);
     return ACVP_SUCCESS;
 }
@@ -203,21 +203,21 @@ static ACVP_RESULT acvp_dsa_sigver_init_tc(ACVP_CTX *ctx,
     return ACVP_SUCCESS;
 }
 
-static ACVP_RESULT acvp_dsa_pqgver_init_tc(ACVP_CTX *ctx,
+/*
+ * p, q, g and the seed usually come decoded by the parser, so
+ * pqgVer test cases take them in place.  The unused r, s and y
+ * buffers are kept for modules that expect them to be set.
+ */
+static ACVP_RESULT acvp_dsa_pqgver_init_tc(ACVP_VS_CTX *vs_ctx,
                                            ACVP_DSA_TC *stc,
-                                           unsigned int tc_id,
-                                           ACVP_CIPHER alg_id,
-                                           unsigned int num,
                                            int l,
                                            int n,
                                            int c,
                                            unsigned char *index,
                                            ACVP_HASH_ALG sha,
-                                           char *p,
-                                           char *q,
-                                           char *g,
-                                           char *seed,
+                                           JSON_Object *testobj,
                                            unsigned int pqg) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     ACVP_RESULT rv;
 
     stc->l = l;
@@ -233,52 +233,39 @@ static ACVP_RESULT acvp_dsa_pqgver_init_tc(ACVP_CTX *ctx,
         return ACVP_INVALID_ARG;
     }
 
-    stc->seed = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->seed) { return ACVP_MALLOC_FAIL; }
-
-    stc->p = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->p) { return ACVP_MALLOC_FAIL; }
-    stc->q = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->q) { return ACVP_MALLOC_FAIL; }
-    stc->g = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->g) { return ACVP_MALLOC_FAIL; }
-
-    stc->r = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->r) { return ACVP_MALLOC_FAIL; }
-    stc->s = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->s) { return ACVP_MALLOC_FAIL; }
-    stc->y = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->y) { return ACVP_MALLOC_FAIL; }
+    rv = acvp_tc_buf(vs_ctx, NULL, ACVP_DSA_MAX_STRING, ACVP_DSA_MAX_STRING, &stc->r, NULL);
+    if (rv != ACVP_SUCCESS) { return rv; }
+    rv = acvp_tc_buf(vs_ctx, NULL, ACVP_DSA_MAX_STRING, ACVP_DSA_MAX_STRING, &stc->s, NULL);
+    if (rv != ACVP_SUCCESS) { return rv; }
+    rv = acvp_tc_buf(vs_ctx, NULL, ACVP_DSA_MAX_STRING, ACVP_DSA_MAX_STRING, &stc->y, NULL);
+    if (rv != ACVP_SUCCESS) { return rv; }
 
     stc->index = -1;
     if (index) {
         stc->index = strtol((char *)index, NULL, 16);
     }
-    if (seed) {
-        rv = acvp_hexstr_to_bin(seed, stc->seed, ACVP_DSA_MAX_STRING, &(stc->seedlen));
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (seed)");
-            return rv;
-        }
+    rv = acvp_tc_hex(vs_ctx, testobj, "domainSeed", 0, ACVP_DSA_MAX_STRING,
+                     &stc->seed, &stc->seedlen);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (seed)");
+        return rv;
     }
 
-    rv = acvp_hexstr_to_bin(p, stc->p, ACVP_DSA_MAX_STRING, &(stc->p_len));
+    rv = acvp_tc_hex(vs_ctx, testobj, "p", 0, ACVP_DSA_MAX_STRING, &stc->p, &stc->p_len);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (p)");
         return rv;
     }
-    rv = acvp_hexstr_to_bin(q, stc->q, ACVP_DSA_MAX_STRING, &(stc->q_len));
+    rv = acvp_tc_hex(vs_ctx, testobj, "q", 0, ACVP_DSA_MAX_STRING, &stc->q, &stc->q_len);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (q)");
         return rv;
     }
 
-    if (g) {
-        rv = acvp_hexstr_to_bin(g, stc->g, ACVP_DSA_MAX_STRING, &(stc->g_len));
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (g)");
-            return rv;
-        }
+    rv = acvp_tc_hex(vs_ctx, testobj, "g", 0, ACVP_DSA_MAX_STRING, &stc->g, &stc->g_len);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (g)");
+        return rv;
     }
     return ACVP_SUCCESS;
 }
@@ -499,6 +486,15 @@ static ACVP_RESULT acvp_dsa_release_tc(ACVP_DSA_TC *stc) {
     return ACVP_SUCCESS;
 }
 
+/*
+ * pqgVer test cases hold nothing from the heap, see
+ * acvp_dsa_pqgver_init_tc().
+ */
+static void acvp_dsa_pqgver_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_DSA_TC *stc) {
+    memzero_s(stc, sizeof(ACVP_DSA_TC));
+    acvp_arena_reset(&vs_ctx->tc_arena);
+}
+
 ACVP_RESULT acvp_dsa_keygen_handler(ACVP_CTX *ctx,
                                     ACVP_TEST_CASE tc,
                                     ACVP_CAPS_LIST *cap,
@@ -1078,11 +1074,12 @@ err:
     return rv;
 }
 
-ACVP_RESULT acvp_dsa_pqgver_handler(ACVP_CTX *ctx,
+ACVP_RESULT acvp_dsa_pqgver_handler(ACVP_VS_CTX *vs_ctx,
                                     ACVP_TEST_CASE tc,
                                     ACVP_CAPS_LIST *cap,
                                     JSON_Array *r_tarr,
                                     JSON_Object *groupobj) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     unsigned char *index = NULL;
     char *g = NULL, *pqmode = NULL, *gmode = NULL, *seed = NULL;
     JSON_Array *tests;
@@ -1093,7 +1090,6 @@ ACVP_RESULT acvp_dsa_pqgver_handler(ACVP_CTX *ctx,
     ACVP_RESULT rv = ACVP_SUCCESS;
     JSON_Value *mval;
     JSON_Object *mobj = NULL;
-    unsigned int num = 0;
     char *p = NULL, *q = NULL;
     ACVP_DSA_TC *stc;
     ACVP_HASH_ALG sha = 0;
@@ -1233,17 +1229,16 @@ ACVP_RESULT acvp_dsa_pqgver_handler(ACVP_CTX *ctx,
          * Setup the test case data that will be passed down to
          * the crypto module.
          */
-        rv = acvp_dsa_pqgver_init_tc(ctx, stc, tc_id, stc->cipher, num,
-                                     l, n, c, index, sha, p, q, g, seed, gpq);
+        rv = acvp_dsa_pqgver_init_tc(vs_ctx, stc, l, n, c, index, sha, testobj, gpq);
         if (rv != ACVP_SUCCESS) {
-            acvp_dsa_release_tc(stc);
+            acvp_dsa_pqgver_release_tc(vs_ctx, stc);
             return rv;
         }
 
         /* Process the current DSA test vector... */
         if ((cap->crypto_handler)(&tc)) {
             ACVP_LOG_ERR("crypto module failed the operation");
-            acvp_dsa_release_tc(stc);
+            acvp_dsa_pqgver_release_tc(vs_ctx, stc);
             return ACVP_CRYPTO_MODULE_FAIL;
         }
 
@@ -1256,10 +1251,10 @@ ACVP_RESULT acvp_dsa_pqgver_handler(ACVP_CTX *ctx,
         rv = acvp_dsa_output_tc(ctx, stc, mobj);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("JSON output failure in DSA module");
-            acvp_dsa_release_tc(stc);
+            acvp_dsa_pqgver_release_tc(vs_ctx, stc);
             return rv;
         }
-        acvp_dsa_release_tc(stc);
+        acvp_dsa_pqgver_release_tc(vs_ctx, stc);
 
         /* Append the test response value to array */
         json_array_append_value(r_tarr, mval);
@@ -1433,7 +1428,8 @@ ACVP_RESULT acvp_dsa_sigver_handler(ACVP_CTX *ctx,
     return rv;
 }
 
-ACVP_RESULT acvp_dsa_pqgver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_dsa_pqgver_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Value *r_vs_val = NULL;
@@ -1485,7 +1481,7 @@ ACVP_RESULT acvp_dsa_pqgver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -1506,6 +1502,11 @@ ACVP_RESULT acvp_dsa_pqgver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -1526,28 +1527,31 @@ ACVP_RESULT acvp_dsa_pqgver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
 
         ACVP_LOG_INFO("    Test group: %d", i);
 
-        rv = acvp_dsa_pqgver_handler(ctx, tc, cap, r_tarr, groupobj);
+        rv = acvp_dsa_pqgver_handler(vs_ctx, tc, cap, r_tarr, groupobj);
         if (rv != ACVP_SUCCESS) {
             goto err;
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
         acvp_dsa_release_tc(&stc);
     }
     memzero_s(&stc, sizeof(ACVP_DSA_TC));
     json_array_append_value(reg_arry, r_vs_val);
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (!json_result) {
-        ACVP_LOG_ERR("JSON unable to be serialized");
-        rv = ACVP_JSON_ERR;
-        goto err;
-    }
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (!json_result) {
+            ACVP_LOG_ERR("JSON unable to be serialized");
+            rv = ACVP_JSON_ERR;
+            goto err;
+        }
 
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
@@ -1558,7 +1562,8 @@ err:
     return rv;
 }
 
-ACVP_RESULT acvp_dsa_pqggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_dsa_pqggen_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Value *r_vs_val = NULL;
@@ -1610,7 +1615,7 @@ ACVP_RESULT acvp_dsa_pqggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -1630,6 +1635,11 @@ ACVP_RESULT acvp_dsa_pqggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -1654,19 +1664,22 @@ ACVP_RESULT acvp_dsa_pqggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         if (rv != ACVP_SUCCESS) {
             goto err;
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
         acvp_dsa_release_tc(&stc);
     }
 
     memzero_s(&stc, sizeof(ACVP_DSA_TC));
     json_array_append_value(reg_arry, r_vs_val);
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
@@ -1677,7 +1690,8 @@ err:
     return rv;
 }
 
-ACVP_RESULT acvp_dsa_siggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_dsa_siggen_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Value *r_vs_val = NULL;
@@ -1729,7 +1743,7 @@ ACVP_RESULT acvp_dsa_siggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -1749,6 +1763,11 @@ ACVP_RESULT acvp_dsa_siggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -1774,20 +1793,23 @@ ACVP_RESULT acvp_dsa_siggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             goto err;
 
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
         acvp_dsa_release_tc(&stc);
     }
 
     memzero_s(&stc, sizeof(ACVP_DSA_TC));
     json_array_append_value(reg_arry, r_vs_val);
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
 
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
@@ -1798,7 +1820,8 @@ err:
     return rv;
 }
 
-ACVP_RESULT acvp_dsa_keygen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_dsa_keygen_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Value *r_vs_val = NULL;
@@ -1850,7 +1873,7 @@ ACVP_RESULT acvp_dsa_keygen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -1870,6 +1893,11 @@ ACVP_RESULT acvp_dsa_keygen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -1894,20 +1922,23 @@ ACVP_RESULT acvp_dsa_keygen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         if (rv != ACVP_SUCCESS) {
             goto err;
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
         acvp_dsa_release_tc(&stc);
     }
 
     memzero_s(&stc, sizeof(ACVP_DSA_TC));
     json_array_append_value(reg_arry, r_vs_val);
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
 
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
@@ -1918,7 +1949,8 @@ err:
     return rv;
 }
 
-ACVP_RESULT acvp_dsa_sigver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_dsa_sigver_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Value *r_vs_val = NULL;
@@ -1970,7 +2002,7 @@ ACVP_RESULT acvp_dsa_sigver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -1990,6 +2022,11 @@ ACVP_RESULT acvp_dsa_sigver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -2014,25 +2051,28 @@ ACVP_RESULT acvp_dsa_sigver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         if (rv != ACVP_SUCCESS) {
             goto err;
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
         acvp_dsa_release_tc(&stc);
     }
 
     memzero_s(&stc, sizeof(ACVP_DSA_TC));
     json_array_append_value(reg_arry, r_vs_val);
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (!json_result) {
-        ACVP_LOG_ERR("JSON unable to be serialized");
-        rv = ACVP_JSON_ERR;
-        goto err;
-    }
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (!json_result) {
+            ACVP_LOG_ERR("JSON unable to be serialized");
+            rv = ACVP_JSON_ERR;
+            goto err;
+        }
 
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
@@ -2045,7 +2085,8 @@ err:
 
 #define DSA_MODE_STR_MAX 6
 
-ACVP_RESULT acvp_dsa_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_dsa_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     const char *mode = json_object_get_string(obj, "mode");
     int diff = 0;
 
@@ -2065,19 +2106,19 @@ ACVP_RESULT acvp_dsa_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     }
 
     strcmp_s(ACVP_ALG_DSA_PQGGEN, DSA_MODE_STR_MAX, mode, &diff);
-    if (!diff) return acvp_dsa_pqggen_kat_handler(ctx, obj);
+    if (!diff) return acvp_dsa_pqggen_kat_handler(vs_ctx, obj);
 
     strcmp_s(ACVP_ALG_DSA_PQGVER, DSA_MODE_STR_MAX, mode, &diff);
-    if (!diff) return acvp_dsa_pqgver_kat_handler(ctx, obj);
+    if (!diff) return acvp_dsa_pqgver_kat_handler(vs_ctx, obj);
 
     strcmp_s(ACVP_ALG_DSA_SIGGEN, DSA_MODE_STR_MAX, mode, &diff);
-    if (!diff) return acvp_dsa_siggen_kat_handler(ctx, obj);
+    if (!diff) return acvp_dsa_siggen_kat_handler(vs_ctx, obj);
 
     strcmp_s(ACVP_ALG_DSA_SIGVER, DSA_MODE_STR_MAX, mode, &diff);
-    if (!diff) return acvp_dsa_sigver_kat_handler(ctx, obj);
+    if (!diff) return acvp_dsa_sigver_kat_handler(vs_ctx, obj);
 
     strcmp_s(ACVP_ALG_DSA_KEYGEN, DSA_MODE_STR_MAX, mode, &diff);
-    if (!diff) return acvp_dsa_keygen_kat_handler(ctx, obj);
+    if (!diff) return acvp_dsa_keygen_kat_handler(vs_ctx, obj);
 
     return ACVP_INVALID_ARG;
 }
@@ -33,69 +33,108 @@
 #include "parson.h"
 #include "safe_lib.h"
 
-static ACVP_RESULT acvp_ecdsa_kat_handler_internal(ACVP_CTX *ctx, JSON_Object *obj, ACVP_CIPHER cipher);
+static ACVP_RESULT acvp_ecdsa_kat_handler_internal(ACVP_VS_CTX *vs_ctx, JSON_Object *obj, ACVP_CIPHER cipher);
 
 
+/*
+ * Length in bytes of the field elements and scalars on a curve, which
+ * the values read from the vector set are zero padded to.  The buffers
+ * the module writes to keep their full size, ACVP_ECDSA_TC has no
+ * field telling the module how much room there is.
+ */
+static int acvp_ecdsa_curve_len(ACVP_EC_CURVE curve) {
+    switch (curve) {
+    case ACVP_EC_CURVE_P192:
+        return 24;
+    case ACVP_EC_CURVE_P224:
+        return 28;
+    case ACVP_EC_CURVE_P256:
+        return 32;
+    case ACVP_EC_CURVE_P384:
+        return 48;
+    case ACVP_EC_CURVE_P521:
+        return 66;
+    case ACVP_EC_CURVE_B163:
+    case ACVP_EC_CURVE_K163:
+        return 21;
+    case ACVP_EC_CURVE_B233:
+    case ACVP_EC_CURVE_K233:
+        return 30;
+    case ACVP_EC_CURVE_B283:
+    case ACVP_EC_CURVE_K283:
+        return 36;
+    case ACVP_EC_CURVE_B409:
+    case ACVP_EC_CURVE_K409:
+        return 52;
+    case ACVP_EC_CURVE_B571:
+    case ACVP_EC_CURVE_K571:
+        return 72;
+    case ACVP_EC_CURVE_START:
+    case ACVP_EC_CURVE_END:
+    default:
+        return ACVP_ECDSA_EXP_LEN_MAX / 2;
+    }
+}
+
 /*
  * After the test case has been processed by the DUT, the results
  * need to be JSON formated to be included in the vector set results
  * file that will be uploaded to the server.  This routine handles
  * the JSON processing for a single test case.
  */
-static ACVP_RESULT acvp_ecdsa_output_tc(ACVP_CTX *ctx, ACVP_CIPHER cipher, ACVP_ECDSA_TC *stc, JSON_Object *tc_rsp) {
+static ACVP_RESULT acvp_ecdsa_output_tc(ACVP_VS_CTX *vs_ctx, ACVP_CIPHER cipher, ACVP_ECDSA_TC *stc, JSON_Object *tc_rsp) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     ACVP_RESULT rv;
     char *tmp = NULL;
+    int tmp_max = ACVP_ECDSA_EXP_LEN_MAX;
 
-    tmp = calloc(ACVP_ECDSA_EXP_LEN_MAX + 1, sizeof(char));
+    tmp = acvp_arena_alloc(&vs_ctx->tc_arena, tmp_max + 1);
+    if (!tmp) {
+        ACVP_LOG_ERR("Unable to malloc in acvp_ecdsa_output_tc");
+        return ACVP_MALLOC_FAIL;
+    }
 
     if (cipher == ACVP_ECDSA_KEYGEN) {
-        rv = acvp_bin_to_hexstr(stc->qy, stc->qy_len, tmp, ACVP_ECDSA_EXP_LEN_MAX);
+        rv = acvp_bin_to_hexstr(stc->qy, stc->qy_len, tmp, tmp_max);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("hex conversion failure (qy)");
-            goto err;
+            return ACVP_SUCCESS;
         }
         json_object_set_string(tc_rsp, "qy", (const char *)tmp);
-        memzero_s(tmp, ACVP_ECDSA_EXP_LEN_MAX);
 
-        rv = acvp_bin_to_hexstr(stc->qx, stc->qx_len, tmp, ACVP_ECDSA_EXP_LEN_MAX);
+        rv = acvp_bin_to_hexstr(stc->qx, stc->qx_len, tmp, tmp_max);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("hex conversion failure (qx)");
-            goto err;
+            return ACVP_SUCCESS;
         }
         json_object_set_string(tc_rsp, "qx", (const char *)tmp);
-        memzero_s(tmp, ACVP_ECDSA_EXP_LEN_MAX);
 
-        rv = acvp_bin_to_hexstr(stc->d, stc->d_len, tmp, ACVP_ECDSA_EXP_LEN_MAX);
+        rv = acvp_bin_to_hexstr(stc->d, stc->d_len, tmp, tmp_max);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("hex conversion failure (d)");
-            goto err;
+            return ACVP_SUCCESS;
         }
         json_object_set_string(tc_rsp, "d", (const char *)tmp);
-        memzero_s(tmp, ACVP_ECDSA_EXP_LEN_MAX);
     }
     if (cipher == ACVP_ECDSA_KEYVER || cipher == ACVP_ECDSA_SIGVER) {
         json_object_set_boolean(tc_rsp, "testPassed", stc->ver_disposition);
     }
     if (cipher == ACVP_ECDSA_SIGGEN) {
-        rv = acvp_bin_to_hexstr(stc->r, stc->r_len, tmp, ACVP_ECDSA_EXP_LEN_MAX);
+        rv = acvp_bin_to_hexstr(stc->r, stc->r_len, tmp, tmp_max);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("hex conversion failure (r)");
-            goto err;
+            return ACVP_SUCCESS;
         }
         json_object_set_string(tc_rsp, "r", (const char *)tmp);
-        memzero_s(tmp, ACVP_ECDSA_EXP_LEN_MAX);
 
-        rv = acvp_bin_to_hexstr(stc->s, stc->s_len, tmp, ACVP_ECDSA_EXP_LEN_MAX);
+        rv = acvp_bin_to_hexstr(stc->s, stc->s_len, tmp, tmp_max);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("hex conversion failure (s)");
-            goto err;
+            return ACVP_SUCCESS;
         }
         json_object_set_string(tc_rsp, "s", (const char *)tmp);
-        memzero_s(tmp, ACVP_ECDSA_EXP_LEN_MAX);
     }
 
-err:
-    free(tmp);
     return ACVP_SUCCESS;
 }
 
@@ -104,19 +143,14 @@ err:
  * a test case.
  */
 
-static ACVP_RESULT acvp_ecdsa_release_tc(ACVP_ECDSA_TC *stc) {
-    if (stc->qy) { free(stc->qy); }
-    if (stc->qx) { free(stc->qx); }
-    if (stc->d) { free(stc->d); }
-    if (stc->r) { free(stc->r); }
-    if (stc->s) { free(stc->s); }
-    if (stc->message) { free(stc->message); }
+static ACVP_RESULT acvp_ecdsa_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_ECDSA_TC *stc) {
     memzero_s(stc, sizeof(ACVP_ECDSA_TC));
+    acvp_arena_reset(&vs_ctx->tc_arena);
 
     return ACVP_SUCCESS;
 }
 
-static ACVP_RESULT acvp_ecdsa_init_tc(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_ecdsa_init_tc(ACVP_VS_CTX *vs_ctx,
                                       ACVP_CIPHER cipher,
                                       ACVP_ECDSA_TC *stc,
                                       int tg_id,
@@ -129,7 +163,12 @@ static ACVP_RESULT acvp_ecdsa_init_tc(ACVP_CTX *ctx,
                                       char *message,
                                       char *r,
                                       char *s) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     ACVP_RESULT rv = ACVP_SUCCESS;
+    int ver = cipher == ACVP_ECDSA_KEYVER || cipher == ACVP_ECDSA_SIGVER;
+    int sig = cipher == ACVP_ECDSA_SIGVER || cipher == ACVP_ECDSA_SIGGEN;
+    int len = acvp_ecdsa_curve_len(curve);
+    int out_len = ACVP_RSA_EXP_LEN_MAX;
 
     memzero_s(stc, sizeof(ACVP_ECDSA_TC));
 
@@ -140,86 +179,63 @@ static ACVP_RESULT acvp_ecdsa_init_tc(ACVP_CTX *ctx,
     stc->curve = curve;
     stc->secret_gen_mode = secret_gen_mode;
 
-    stc->qx = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
-    if (!stc->qx) { goto err; }
-    stc->qy = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
-    if (!stc->qy) { goto err; }
-    stc->d = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
-    if (!stc->d) { goto err; }
-    stc->s = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
-    if (!stc->s) { goto err; }
-    stc->r = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
-    if (!stc->r) { goto err; }
-    stc->message = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
-    if (!stc->message) { goto err; }
-
-    if (cipher == ACVP_ECDSA_KEYVER || cipher == ACVP_ECDSA_SIGVER) {
-        if (!qx || !qy) return ACVP_MISSING_ARG;
+    if (ver && (!qx || !qy)) return ACVP_MISSING_ARG;
+    if (cipher == ACVP_ECDSA_SIGVER && (!r || !s)) return ACVP_MISSING_ARG;
+    if (sig && !message) return ACVP_MISSING_ARG;
 
-        rv = acvp_hexstr_to_bin(qx, stc->qx, ACVP_RSA_EXP_LEN_MAX, &(stc->qx_len));
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (qx)");
-            return rv;
-        }
-
-        rv = acvp_hexstr_to_bin(qy, stc->qy, ACVP_RSA_EXP_LEN_MAX, &(stc->qy_len));
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (qy)");
-            return rv;
-        }
+    rv = acvp_tc_buf(vs_ctx, ver ? qx : NULL, ver ? len : out_len, ACVP_RSA_EXP_LEN_MAX, &stc->qx, &stc->qx_len);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (qx)");
+        return rv;
     }
-    if (cipher == ACVP_ECDSA_SIGVER) {
-        if (!r || !s) return ACVP_MISSING_ARG;
-
-        rv = acvp_hexstr_to_bin(r, stc->r, ACVP_RSA_EXP_LEN_MAX, &(stc->r_len));
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (r)");
-            return rv;
-        }
-
-        rv = acvp_hexstr_to_bin(s, stc->s, ACVP_RSA_EXP_LEN_MAX, &(stc->s_len));
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (s)");
-            return rv;
-        }
+    rv = acvp_tc_buf(vs_ctx, ver ? qy : NULL, ver ? len : out_len, ACVP_RSA_EXP_LEN_MAX, &stc->qy, &stc->qy_len);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (qy)");
+        return rv;
     }
-    if (cipher == ACVP_ECDSA_SIGVER || cipher == ACVP_ECDSA_SIGGEN) {
-        if (!message) return ACVP_MISSING_ARG;
-
-        rv = acvp_hexstr_to_bin(message, stc->message, ACVP_RSA_MSGLEN_MAX, &(stc->msg_len));
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (message)");
-            return rv;
-        }
+    rv = acvp_tc_buf(vs_ctx, cipher == ACVP_ECDSA_SIGVER ? r : NULL,
+                     cipher == ACVP_ECDSA_SIGVER ? len : out_len,
+                     ACVP_RSA_EXP_LEN_MAX, &stc->r, &stc->r_len);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (r)");
+        return rv;
+    }
+    rv = acvp_tc_buf(vs_ctx, cipher == ACVP_ECDSA_SIGVER ? s : NULL,
+                     cipher == ACVP_ECDSA_SIGVER ? len : out_len,
+                     ACVP_RSA_EXP_LEN_MAX, &stc->s, &stc->s_len);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (s)");
+        return rv;
+    }
+    rv = acvp_tc_buf(vs_ctx, NULL, out_len, ACVP_RSA_EXP_LEN_MAX, &stc->d, NULL);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Failed to allocate buffer in ECDSA test case");
+        return rv;
+    }
+    rv = acvp_tc_buf(vs_ctx, sig ? message : NULL, 0, ACVP_RSA_MSGLEN_MAX,
+                     &stc->message, &stc->msg_len);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (message)");
+        return rv;
     }
 
     return ACVP_SUCCESS;
-
-err:
-    ACVP_LOG_ERR("Failed to allocate buffer in ECDSA test case");
-    if (stc->qx) free(stc->qx);
-    if (stc->qy) free(stc->qy);
-    if (stc->r) free(stc->r);
-    if (stc->s) free(stc->s);
-    if (stc->d) free(stc->d);
-    if (stc->message) free(stc->message);
-    return ACVP_MALLOC_FAIL;
 }
 
-ACVP_RESULT acvp_ecdsa_keygen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
-    return acvp_ecdsa_kat_handler_internal(ctx, obj, ACVP_ECDSA_KEYGEN);
+ACVP_RESULT acvp_ecdsa_keygen_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    return acvp_ecdsa_kat_handler_internal(vs_ctx, obj, ACVP_ECDSA_KEYGEN);
 }
 
-ACVP_RESULT acvp_ecdsa_keyver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
-    return acvp_ecdsa_kat_handler_internal(ctx, obj, ACVP_ECDSA_KEYVER);
+ACVP_RESULT acvp_ecdsa_keyver_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    return acvp_ecdsa_kat_handler_internal(vs_ctx, obj, ACVP_ECDSA_KEYVER);
 }
 
-ACVP_RESULT acvp_ecdsa_siggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
-    return acvp_ecdsa_kat_handler_internal(ctx, obj, ACVP_ECDSA_SIGGEN);
+ACVP_RESULT acvp_ecdsa_siggen_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    return acvp_ecdsa_kat_handler_internal(vs_ctx, obj, ACVP_ECDSA_SIGGEN);
 }
 
-ACVP_RESULT acvp_ecdsa_sigver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
-    return acvp_ecdsa_kat_handler_internal(ctx, obj, ACVP_ECDSA_SIGVER);
+ACVP_RESULT acvp_ecdsa_sigver_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    return acvp_ecdsa_kat_handler_internal(vs_ctx, obj, ACVP_ECDSA_SIGVER);
 }
 
 static ACVP_ECDSA_SECRET_GEN_MODE read_secret_gen_mode(const char *str) {
@@ -238,7 +254,8 @@ static ACVP_ECDSA_SECRET_GEN_MODE read_secret_gen_mode(const char *str) {
     return 0;
 }
 
-static ACVP_RESULT acvp_ecdsa_kat_handler_internal(ACVP_CTX *ctx, JSON_Object *obj, ACVP_CIPHER cipher) {
+static ACVP_RESULT acvp_ecdsa_kat_handler_internal(ACVP_VS_CTX *vs_ctx, JSON_Object *obj, ACVP_CIPHER cipher) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     unsigned int tc_id;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
@@ -312,7 +329,7 @@ static ACVP_RESULT acvp_ecdsa_kat_handler_internal(ACVP_CTX *ctx, JSON_Object *o
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -338,6 +355,11 @@ static ACVP_RESULT acvp_ecdsa_kat_handler_internal(ACVP_CTX *ctx, JSON_Object *o
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -475,7 +497,7 @@ static ACVP_RESULT acvp_ecdsa_kat_handler_internal(ACVP_CTX *ctx, JSON_Object *o
 
             json_object_set_number(r_tobj, "tcId", tc_id);
 
-            rv = acvp_ecdsa_init_tc(ctx, alg_id, &stc, tgId, tc_id, curve, secret_gen_mode, hash_alg, qx, qy, message, r, s);
+            rv = acvp_ecdsa_init_tc(vs_ctx, alg_id, &stc, tgId, tc_id, curve, secret_gen_mode, hash_alg, qx, qy, message, r, s);
 
             /* Process the current test vector... */
             if (rv == ACVP_SUCCESS) {
@@ -495,29 +517,32 @@ static ACVP_RESULT acvp_ecdsa_kat_handler_internal(ACVP_CTX *ctx, JSON_Object *o
              * Output the test case results using JSON
              */
             if (cipher == ACVP_ECDSA_SIGGEN) {
-                char *tmp = calloc(ACVP_ECDSA_EXP_LEN_MAX + 1, sizeof(char));
-                rv = acvp_bin_to_hexstr(stc.qy, stc.qy_len, tmp, ACVP_ECDSA_EXP_LEN_MAX);
+                int tmp_max = 2 * acvp_ecdsa_curve_len(stc.curve);
+                char *tmp = acvp_arena_alloc(&vs_ctx->tc_arena, tmp_max + 1);
+
+                if (!tmp) {
+                    ACVP_LOG_ERR("Unable to malloc");
+                    rv = ACVP_MALLOC_FAIL;
+                    json_value_free(r_tval);
+                    goto err;
+                }
+                rv = acvp_bin_to_hexstr(stc.qy, stc.qy_len, tmp, tmp_max);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("hex conversion failure (qy)");
-                    free(tmp);
                     json_value_free(r_tval);
                     goto err;
                 }
                 json_object_set_string(r_gobj, "qy", (const char *)tmp);
-                memzero_s(tmp, ACVP_ECDSA_EXP_LEN_MAX);
 
-                rv = acvp_bin_to_hexstr(stc.qx, stc.qx_len, tmp, ACVP_ECDSA_EXP_LEN_MAX);
+                rv = acvp_bin_to_hexstr(stc.qx, stc.qx_len, tmp, tmp_max);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("hex conversion failure (qx)");
-                    free(tmp);
                     json_value_free(r_tval);
                     goto err;
                 }
                 json_object_set_string(r_gobj, "qx", (const char *)tmp);
-                memzero_s(tmp, ACVP_ECDSA_EXP_LEN_MAX);
-                free(tmp);
             }
-            rv = acvp_ecdsa_output_tc(ctx, alg_id, &stc, r_tobj);
+            rv = acvp_ecdsa_output_tc(vs_ctx, alg_id, &stc, r_tobj);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("ERROR: JSON output failure in hash module");
                 json_value_free(r_tval);
@@ -530,25 +555,28 @@ static ACVP_RESULT acvp_ecdsa_kat_handler_internal(ACVP_CTX *ctx, JSON_Object *o
             /*
              * Release all the memory associated with the test case
              */
-            acvp_ecdsa_release_tc(&stc);
+            acvp_ecdsa_release_tc(vs_ctx, &stc);
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
     }
 
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
     if (rv != ACVP_SUCCESS) {
-        acvp_ecdsa_release_tc(&stc);
+        acvp_ecdsa_release_tc(vs_ctx, &stc);
         acvp_release_json(r_vs_val, r_gval);
     }
     return rv;
@@ -38,15 +38,21 @@
  */
 static ACVP_RESULT acvp_hash_output_tc(ACVP_CTX *ctx, ACVP_HASH_TC *stc, JSON_Object *tc_rsp);
 
-static ACVP_RESULT acvp_hash_init_tc(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_hash_init_tc(ACVP_VS_CTX *vs_ctx,
                                      ACVP_HASH_TC *stc,
                                      unsigned int tc_id,
                                      ACVP_HASH_TESTTYPE test_type,
                                      unsigned int msg_len,
                                      const char *msg,
-                                     ACVP_CIPHER alg_id);
+                                     ACVP_CIPHER alg_id,
+                                     int batch);
 
-static ACVP_RESULT acvp_hash_release_tc(ACVP_HASH_TC *stc);
+static ACVP_RESULT acvp_hash_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_HASH_TC *stc);
+
+static ACVP_RESULT acvp_hash_process_batch(ACVP_VS_CTX *vs_ctx,
+                                           ACVP_CAPS_LIST *cap,
+                                           ACVP_TC_BATCH *batch,
+                                           JSON_Array *r_tarr);
 
 
 /*
@@ -101,11 +107,12 @@ end:
  * parsed, processed, and a response is generated to be sent
  * back to the ACV server by the transport layer.
  */
-static ACVP_RESULT acvp_hash_mct_tc(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_hash_mct_tc(ACVP_VS_CTX *vs_ctx,
                                     ACVP_CAPS_LIST *cap,
                                     ACVP_TEST_CASE *tc,
                                     ACVP_HASH_TC *stc,
                                     JSON_Array *res_array) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     int i, j;
     ACVP_RESULT rv;
     JSON_Value *r_tval = NULL;  /* Response testval */
@@ -113,8 +120,13 @@ static ACVP_RESULT acvp_hash_mct_tc(ACVP_CTX *ctx,
     char *tmp = NULL;
     unsigned char *msg = NULL;
 
-    tmp = calloc(ACVP_HASH_MSG_STR_MAX * 3, sizeof(char));
-    if (!tmp) {
+    /*
+     * Scratch space comes from the test case arena and is
+     * released along with the test case.
+     */
+    tmp = acvp_arena_calloc(&vs_ctx->tc_arena, ACVP_HASH_MSG_STR_MAX * 3, sizeof(char));
+    msg = acvp_arena_calloc(&vs_ctx->tc_arena, ACVP_HASH_MSG_BYTE_MAX * 3, sizeof(unsigned char));
+    if (!tmp || !msg) {
         ACVP_LOG_ERR("Unable to malloc");
         return ACVP_MALLOC_FAIL;
     }
@@ -130,14 +142,6 @@ static ACVP_RESULT acvp_hash_mct_tc(ACVP_CTX *ctx,
         r_tval = json_value_init_object();
         r_tobj = json_value_get_object(r_tval);
 
-        msg = calloc(ACVP_HASH_MSG_BYTE_MAX * 3, sizeof(unsigned char));
-        if (!msg) {
-            ACVP_LOG_ERR("Unable to malloc");
-            free(tmp);
-            json_value_free(r_tval);
-            return ACVP_MALLOC_FAIL;
-        }
-
         memcpy_s(msg, ACVP_HASH_MSG_BYTE_MAX, stc->m1, stc->msg_len);
         memcpy_s(msg + stc->msg_len, (ACVP_HASH_MSG_BYTE_MAX - stc->msg_len), stc->m2, stc->msg_len);
         memcpy_s(msg + (stc->msg_len * 2), (ACVP_HASH_MSG_BYTE_MAX - (stc->msg_len * 2)), stc->m3, stc->msg_len);
@@ -145,33 +149,41 @@ static ACVP_RESULT acvp_hash_mct_tc(ACVP_CTX *ctx,
         rv = acvp_bin_to_hexstr(msg, stc->msg_len * 3, tmp, ACVP_HASH_MSG_STR_MAX * 3);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("hex conversion failure (msg)");
-            free(msg);
-            free(tmp);
             json_value_free(r_tval);
             return rv;
         }
         json_object_set_string(r_tobj, "msg", tmp);
-        for (j = 0; j < ACVP_HASH_MCT_INNER; ++j) {
-            /* Process the current SHA test vector... */
-            rv = (cap->crypto_handler)(tc);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("crypto module failed the operation");
-                free(msg);
-                free(tmp);
+        if (cap->mct_handler) {
+            /*
+             * The module chains all the inner iterations itself and
+             * only the last digest comes back.
+             */
+            stc->mct_count = ACVP_HASH_MCT_INNER;
+            if ((cap->mct_handler)(tc)) {
+                ACVP_LOG_ERR("crypto module failed the MCT operation");
                 json_value_free(r_tval);
                 return ACVP_CRYPTO_MODULE_FAIL;
             }
+            memcpy_s(stc->m3, ACVP_HASH_MD_BYTE_MAX, stc->md, stc->md_len);
+        } else {
+            for (j = 0; j < ACVP_HASH_MCT_INNER; ++j) {
+                /* Process the current SHA test vector... */
+                rv = (cap->crypto_handler)(tc);
+                if (rv != ACVP_SUCCESS) {
+                    ACVP_LOG_ERR("crypto module failed the operation");
+                    json_value_free(r_tval);
+                    return ACVP_CRYPTO_MODULE_FAIL;
+                }
 
-            /*
-             * Adjust the parameters for next iteration if needed.
-             */
-            rv = acvp_hash_mct_iterate_tc(ctx, stc, i, r_tobj);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("Failed the MCT iteration changes");
-                free(msg);
-                free(tmp);
-                json_value_free(r_tval);
-                return rv;
+                /*
+                 * Adjust the parameters for next iteration if needed.
+                 */
+                rv = acvp_hash_mct_iterate_tc(ctx, stc, i, r_tobj);
+                if (rv != ACVP_SUCCESS) {
+                    ACVP_LOG_ERR("Failed the MCT iteration changes");
+                    json_value_free(r_tval);
+                    return rv;
+                }
             }
         }
         /*
@@ -180,8 +192,6 @@ static ACVP_RESULT acvp_hash_mct_tc(ACVP_CTX *ctx,
         rv = acvp_hash_output_mct_tc(ctx, stc, r_tobj);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("JSON output failure in HASH module");
-            free(msg);
-            free(tmp);
             json_value_free(r_tval);
             return rv;
         }
@@ -191,11 +201,8 @@ static ACVP_RESULT acvp_hash_mct_tc(ACVP_CTX *ctx,
 
         memcpy_s(stc->m1, ACVP_HASH_MD_BYTE_MAX, stc->m3, stc->msg_len);
         memcpy_s(stc->m2, ACVP_HASH_MD_BYTE_MAX, stc->m3, stc->msg_len);
-
-        free(msg);
     }
 
-    free(tmp);
     return ACVP_SUCCESS;
 }
 
@@ -215,7 +222,8 @@ static ACVP_HASH_TESTTYPE read_test_type(const char *tt_str) {
     return 0;
 }
 
-ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_hash_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     unsigned int tc_id, msglen;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
@@ -239,6 +247,9 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_CAPS_LIST *cap;
     ACVP_HASH_TC stc;
     ACVP_TEST_CASE tc;
+    ACVP_HASH_TC *batch_stc = NULL;
+    ACVP_TC_BATCH batch;
+    int use_batch = 0;
     JSON_Array *res_tarr = NULL; /* Response resultsArray */
     ACVP_RESULT rv = ACVP_SUCCESS;
     ACVP_CIPHER alg_id = 0;
@@ -288,7 +299,7 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -303,6 +314,11 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -338,6 +354,21 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         tests = json_object_get_array(groupobj, "tests");
         t_cnt = json_array_get_count(tests);
 
+        /*
+         * Monte Carlo chains each digest into the next message, so
+         * only the AFT groups can be handed over as a batch.
+         */
+        use_batch = cap->batch_handler && test_type != ACVP_HASH_TEST_TYPE_MCT;
+        if (use_batch) {
+            rv = acvp_tc_batch_init(vs_ctx, &batch, t_cnt);
+            batch_stc = acvp_arena_calloc(&vs_ctx->tc_arena, t_cnt ? t_cnt : 1, sizeof(ACVP_HASH_TC));
+            if (rv != ACVP_SUCCESS || !batch_stc) {
+                ACVP_LOG_ERR("Unable to malloc test case batch");
+                rv = ACVP_MALLOC_FAIL;
+                goto err;
+            }
+        }
+
         for (j = 0; j < t_cnt; j++) {
             unsigned int tmp_msg_len = 0;
 
@@ -403,22 +434,30 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
              * Setup the test case data that will be passed down to
              * the crypto module.
              */
-            rv = acvp_hash_init_tc(ctx, &stc, tc_id, test_type, msglen, msg, alg_id);
+            rv = acvp_hash_init_tc(vs_ctx, use_batch ? &batch_stc[batch.count] : &stc,
+                                   tc_id, test_type, msglen, msg, alg_id, use_batch);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Init for stc (test case) failed");
-                acvp_hash_release_tc(&stc);
+                memzero_s(use_batch ? &batch_stc[batch.count] : &stc, sizeof(ACVP_HASH_TC));
                 json_value_free(r_tval);
                 goto err;
             }
 
+            if (use_batch) {
+                batch.tcs[batch.count].tc.hash = &batch_stc[batch.count];
+                batch.count++;
+                json_array_append_value(r_tarr, r_tval);
+                continue;
+            }
+
             /* If Monte Carlo start that here */
             if (stc.test_type == ACVP_HASH_TEST_TYPE_MCT) {
                 json_object_set_value(r_tobj, "resultsArray", json_value_init_array());
                 res_tarr = json_object_get_array(r_tobj, "resultsArray");
-                rv = acvp_hash_mct_tc(ctx, cap, &tc, &stc, res_tarr);
+                rv = acvp_hash_mct_tc(vs_ctx, cap, &tc, &stc, res_tarr);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("crypto module failed the HASH MCT operation");
-                    acvp_hash_release_tc(&stc);
+                    acvp_hash_release_tc(vs_ctx, &stc);
                     json_value_free(r_tval);
                     goto err;
                 }
@@ -426,7 +465,7 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
                 /* Process the current test vector... */
                 if ((cap->crypto_handler)(&tc)) {
                     ACVP_LOG_ERR("crypto module failed the operation");
-                    acvp_hash_release_tc(&stc);
+                    acvp_hash_release_tc(vs_ctx, &stc);
                     json_value_free(r_tval);
                     rv = ACVP_CRYPTO_MODULE_FAIL;
                     goto err;
@@ -438,7 +477,7 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
                 rv = acvp_hash_output_tc(ctx, &stc, r_tobj);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("JSON output failure in hash module");
-                    acvp_hash_release_tc(&stc);
+                    acvp_hash_release_tc(vs_ctx, &stc);
                     json_value_free(r_tval);
                     goto err;
                 }
@@ -446,27 +485,39 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Release all the memory associated with the test case
              */
-            acvp_hash_release_tc(&stc);
+            acvp_hash_release_tc(vs_ctx, &stc);
 
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
+
+        if (use_batch) {
+            rv = acvp_hash_process_batch(vs_ctx, cap, &batch, r_tarr);
+            if (rv != ACVP_SUCCESS) {
+                goto err;
+            }
+        }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
     }
 
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
     if (rv != ACVP_SUCCESS) {
+        /* Test cases still batched or being set up */
+        acvp_arena_reset(&vs_ctx->tc_arena);
         acvp_release_json(r_vs_val, r_gval);
     }
     return rv;
@@ -501,38 +552,73 @@ end:
     return rv;
 }
 
-static ACVP_RESULT acvp_hash_init_tc(ACVP_CTX *ctx,
+/*
+ * Hands a test group collected by acvp_hash_kat_handler to the
+ * module's batch handler, then writes each digest into the
+ * matching entry of r_tarr.
+ */
+static ACVP_RESULT acvp_hash_process_batch(ACVP_VS_CTX *vs_ctx,
+                                           ACVP_CAPS_LIST *cap,
+                                           ACVP_TC_BATCH *batch,
+                                           JSON_Array *r_tarr) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    ACVP_RESULT rv;
+    int i;
+
+    rv = acvp_tc_batch_run(ctx, cap, batch);
+    for (i = 0; rv == ACVP_SUCCESS && i < batch->count; i++) {
+        if (batch->results[i]) {
+            ACVP_LOG_ERR("crypto module failed the operation");
+            rv = ACVP_CRYPTO_MODULE_FAIL;
+            break;
+        }
+        rv = acvp_hash_output_tc(ctx, batch->tcs[i].tc.hash, json_array_get_object(r_tarr, i));
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("JSON output failure in hash module");
+        }
+    }
+
+    acvp_arena_reset(&vs_ctx->tc_arena);
+    return rv;
+}
+
+static ACVP_RESULT acvp_hash_init_tc(ACVP_VS_CTX *vs_ctx,
                                      ACVP_HASH_TC *stc,
                                      unsigned int tc_id,
                                      ACVP_HASH_TESTTYPE test_type,
                                      unsigned int msg_len,
                                      const char *msg,
-                                     ACVP_CIPHER alg_id) {
+                                     ACVP_CIPHER alg_id,
+                                     int batch) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     ACVP_RESULT rv;
 
     memzero_s(stc, sizeof(ACVP_HASH_TC));
 
-    stc->msg = calloc(1, ACVP_HASH_MSG_BYTE_MAX);
-    if (!stc->msg) { return ACVP_MALLOC_FAIL; }
-
-    stc->md = calloc(1, ACVP_HASH_MD_BYTE_MAX);
-    if (!stc->md) { return ACVP_MALLOC_FAIL; }
-
-    stc->m1 = calloc(1, ACVP_HASH_MD_BYTE_MAX);
-    if (!stc->m1) { return ACVP_MALLOC_FAIL; }
-
-    stc->m2 = calloc(1, ACVP_HASH_MD_BYTE_MAX);
-    if (!stc->m2) { return ACVP_MALLOC_FAIL; }
-
-    stc->m3 = calloc(1, ACVP_HASH_MD_BYTE_MAX);
-    if (!stc->m3) { return ACVP_MALLOC_FAIL; }
-
-    rv = acvp_hexstr_to_bin(msg, stc->msg, ACVP_HASH_MSG_BYTE_MAX, NULL);
+    /*
+     * The test cases of a batch are all alive until the group is
+     * done, so their message only gets the room it needs.  Batches
+     * are never Monte Carlo, which is all m1, m2 and m3 are for.
+     */
+    rv = acvp_tc_buf(vs_ctx, msg, batch ? 0 : ACVP_HASH_MSG_BYTE_MAX,
+                     ACVP_HASH_MSG_BYTE_MAX, &stc->msg, NULL);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex converstion failure (msg)");
         return rv;
     }
 
+    rv = acvp_tc_buf(vs_ctx, NULL, ACVP_HASH_MD_BYTE_MAX, ACVP_HASH_MD_BYTE_MAX, &stc->md, NULL);
+    if (rv != ACVP_SUCCESS) { return rv; }
+
+    if (!batch) {
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_HASH_MD_BYTE_MAX, ACVP_HASH_MD_BYTE_MAX, &stc->m1, NULL);
+        if (rv != ACVP_SUCCESS) { return rv; }
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_HASH_MD_BYTE_MAX, ACVP_HASH_MD_BYTE_MAX, &stc->m2, NULL);
+        if (rv != ACVP_SUCCESS) { return rv; }
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_HASH_MD_BYTE_MAX, ACVP_HASH_MD_BYTE_MAX, &stc->m3, NULL);
+        if (rv != ACVP_SUCCESS) { return rv; }
+    }
+
     stc->tc_id = tc_id;
     stc->msg_len = (msg_len + 7) / 8;
     stc->cipher = alg_id;
@@ -545,13 +631,9 @@ static ACVP_RESULT acvp_hash_init_tc(ACVP_CTX *ctx,
  * This function simply releases the data associated with
  * a test case.
  */
-static ACVP_RESULT acvp_hash_release_tc(ACVP_HASH_TC *stc) {
-    if (stc->msg) free(stc->msg);
-    if (stc->md) free(stc->md);
-    if (stc->m1) free(stc->m1);
-    if (stc->m2) free(stc->m2);
-    if (stc->m3) free(stc->m3);
+static ACVP_RESULT acvp_hash_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_HASH_TC *stc) {
     memzero_s(stc, sizeof(ACVP_HASH_TC));
+    acvp_arena_reset(&vs_ctx->tc_arena);
 
     return ACVP_SUCCESS;
 }
@@ -116,7 +116,51 @@ static ACVP_RESULT acvp_hmac_release_tc(ACVP_HMAC_TC *stc) {
     return ACVP_SUCCESS;
 }
 
-ACVP_RESULT acvp_hmac_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+/*
+ * Releases every test case collected for the batch handler
+ * along with the batch itself.
+ */
+static void acvp_hmac_release_batch(ACVP_VS_CTX *vs_ctx, ACVP_TC_BATCH *batch) {
+    int i;
+
+    for (i = 0; i < batch->count; i++) {
+        acvp_hmac_release_tc(batch->tcs[i].tc.hmac);
+    }
+    batch->count = 0;
+    acvp_arena_reset(&vs_ctx->tc_arena);
+}
+
+/*
+ * Runs a test group through the module's batch handler and
+ * writes each MAC into the matching entry of r_tarr.
+ */
+static ACVP_RESULT acvp_hmac_process_batch(ACVP_VS_CTX *vs_ctx,
+                                           ACVP_CAPS_LIST *cap,
+                                           ACVP_TC_BATCH *batch,
+                                           JSON_Array *r_tarr) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+    ACVP_RESULT rv;
+    int i;
+
+    rv = acvp_tc_batch_run(ctx, cap, batch);
+    for (i = 0; rv == ACVP_SUCCESS && i < batch->count; i++) {
+        if (batch->results[i]) {
+            ACVP_LOG_ERR("ERROR: crypto module failed the operation");
+            rv = ACVP_CRYPTO_MODULE_FAIL;
+            break;
+        }
+        rv = acvp_hmac_output_tc(ctx, batch->tcs[i].tc.hmac, json_array_get_object(r_tarr, i));
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("ERROR: JSON output failure in hash module");
+        }
+    }
+
+    acvp_hmac_release_batch(vs_ctx, batch);
+    return rv;
+}
+
+ACVP_RESULT acvp_hmac_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     unsigned int tc_id = 0, msglen = 0, keylen = 0, maclen = 0;
     char *msg = NULL, *key = NULL;
     JSON_Value *groupval;
@@ -141,6 +185,9 @@ ACVP_RESULT acvp_hmac_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_CAPS_LIST *cap;
     ACVP_HMAC_TC stc;
     ACVP_TEST_CASE tc;
+    ACVP_HMAC_TC *batch_stc = NULL;
+    ACVP_TC_BATCH batch;
+    int use_batch = 0;
     ACVP_RESULT rv;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     ACVP_CIPHER alg_id;
@@ -192,7 +239,7 @@ ACVP_RESULT acvp_hmac_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -210,6 +257,11 @@ ACVP_RESULT acvp_hmac_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -264,6 +316,17 @@ ACVP_RESULT acvp_hmac_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             goto err;
         }
 
+        use_batch = cap->batch_handler != NULL;
+        if (use_batch) {
+            rv = acvp_tc_batch_init(vs_ctx, &batch, t_cnt);
+            batch_stc = acvp_arena_calloc(&vs_ctx->tc_arena, t_cnt, sizeof(ACVP_HMAC_TC));
+            if (rv != ACVP_SUCCESS || !batch_stc) {
+                ACVP_LOG_ERR("Unable to malloc test case batch");
+                rv = ACVP_MALLOC_FAIL;
+                goto err;
+            }
+        }
+
         for (j = 0; j < t_cnt; j++) {
             ACVP_LOG_INFO("Found new hash test vector...");
             testval = json_array_get_value(tests, j);
@@ -323,6 +386,20 @@ ACVP_RESULT acvp_hmac_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
              * Setup the test case data that will be passed down to
              * the crypto module.
              */
+            if (use_batch) {
+                /* Counted in the batch even on failure so it gets released */
+                rv = acvp_hmac_init_tc(ctx, &batch_stc[batch.count], tc_id, msglen, msg,
+                                       maclen, keylen, key, alg_id);
+                batch.tcs[batch.count].tc.hmac = &batch_stc[batch.count];
+                batch.count++;
+                if (rv != ACVP_SUCCESS) {
+                    json_value_free(r_tval);
+                    goto err;
+                }
+                json_array_append_value(r_tarr, r_tval);
+                continue;
+            }
+
             rv = acvp_hmac_init_tc(ctx, &stc, tc_id, msglen, msg, maclen, keylen, key, alg_id);
             if (rv != ACVP_SUCCESS) {
                 acvp_hmac_release_tc(&stc);
@@ -357,22 +434,35 @@ ACVP_RESULT acvp_hmac_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
+
+        if (use_batch) {
+            rv = acvp_hmac_process_batch(vs_ctx, cap, &batch, r_tarr);
+            if (rv != ACVP_SUCCESS) {
+                goto err;
+            }
+        }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
     }
 
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
     if (rv != ACVP_SUCCESS) {
+        if (use_batch) {
+            acvp_hmac_release_batch(vs_ctx, &batch);
+        }
         acvp_release_json(r_vs_val, r_gval);
     }
     return rv;
@@ -306,12 +306,13 @@ static ACVP_KAS_ECC_TEST_TYPE read_test_type(const char *str) {
     return 0;
 }
 
-static ACVP_RESULT acvp_kas_ecc_cdh(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_kas_ecc_cdh(ACVP_VS_CTX *vs_ctx,
                                     ACVP_CAPS_LIST *cap,
                                     ACVP_TEST_CASE *tc,
                                     ACVP_KAS_ECC_TC *stc,
                                     JSON_Object *obj,
                                     JSON_Array *r_garr) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Array *groups;
@@ -336,6 +337,11 @@ static ACVP_RESULT acvp_kas_ecc_cdh(ACVP_CTX *ctx,
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -473,6 +479,7 @@ static ACVP_RESULT acvp_kas_ecc_cdh(ACVP_CTX *ctx,
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
     }
     rv = ACVP_SUCCESS;
@@ -484,12 +491,13 @@ err:
     return rv;
 }
 
-static ACVP_RESULT acvp_kas_ecc_comp(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_kas_ecc_comp(ACVP_VS_CTX *vs_ctx,
                                      ACVP_CAPS_LIST *cap,
                                      ACVP_TEST_CASE *tc,
                                      ACVP_KAS_ECC_TC *stc,
                                      JSON_Object *obj,
                                      JSON_Array *r_garr) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Array *groups;
@@ -515,6 +523,11 @@ static ACVP_RESULT acvp_kas_ecc_comp(ACVP_CTX *ctx,
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -738,6 +751,7 @@ static ACVP_RESULT acvp_kas_ecc_comp(ACVP_CTX *ctx,
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
     }
     rv = ACVP_SUCCESS;
@@ -749,7 +763,8 @@ err:
     return rv;
 }
 
-ACVP_RESULT acvp_kas_ecc_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_kas_ecc_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     JSON_Value *r_vs_val = NULL;
     JSON_Object *r_vs = NULL;
     JSON_Array *r_garr = NULL; /* Response testarray, grouparray */
@@ -793,7 +808,7 @@ ACVP_RESULT acvp_kas_ecc_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -822,7 +837,7 @@ ACVP_RESULT acvp_kas_ecc_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             rv = ACVP_UNSUPPORTED_OP;
             goto err;
         }
-        rv = acvp_kas_ecc_cdh(ctx, cap, &tc, &stc, obj, r_garr);
+        rv = acvp_kas_ecc_cdh(vs_ctx, cap, &tc, &stc, obj, r_garr);
         if (rv != ACVP_SUCCESS) {
             goto err;
         }
@@ -835,7 +850,7 @@ ACVP_RESULT acvp_kas_ecc_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             rv = ACVP_UNSUPPORTED_OP;
             goto err;
         }
-        rv = acvp_kas_ecc_comp(ctx, cap, &tc, &stc, obj, r_garr);
+        rv = acvp_kas_ecc_comp(vs_ctx, cap, &tc, &stc, obj, r_garr);
         if (rv != ACVP_SUCCESS) {
             goto err;
         }
@@ -850,13 +865,15 @@ ACVP_RESULT acvp_kas_ecc_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     }
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
@@ -38,129 +38,132 @@
  * file that will be uploaded to the server.  This routine handles
  * the JSON processing for a single test case.
  */
-static ACVP_RESULT acvp_kas_ffc_output_comp_tc(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_kas_ffc_output_comp_tc(ACVP_VS_CTX *vs_ctx,
                                                ACVP_KAS_FFC_TC *stc,
                                                JSON_Object *tc_rsp) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     ACVP_RESULT rv = ACVP_SUCCESS;
     char *tmp = NULL;
 
-    tmp = calloc(ACVP_KAS_FFC_STR_MAX + 1, sizeof(char));
-    if (!tmp) {
-        ACVP_LOG_ERR("Unable to malloc in acvp_aes_output_mct_tc");
-        return ACVP_MALLOC_FAIL;
-    }
-
     if (stc->test_type == ACVP_KAS_FFC_TT_VAL) {
         int diff = 1;
 
-        memcmp_s(stc->chash, ACVP_KAS_FFC_BYTE_MAX,
+        memcmp_s(stc->chash, stc->zlen,
                  stc->z, stc->zlen, &diff);
         if (!diff) {
             json_object_set_boolean(tc_rsp, "testPassed", 1);
         } else {
             json_object_set_boolean(tc_rsp, "testPassed", 0);
         }
-        goto end;
+        return rv;
+    }
+
+    tmp = acvp_arena_alloc(&vs_ctx->tc_arena, ACVP_KAS_FFC_STR_MAX + 1);
+    if (!tmp) {
+        ACVP_LOG_ERR("Unable to malloc in acvp_kas_ffc_output_comp_tc");
+        return ACVP_MALLOC_FAIL;
     }
 
-    memzero_s(tmp, ACVP_KAS_FFC_STR_MAX);
     rv = acvp_bin_to_hexstr(stc->piut, stc->piutlen, tmp, ACVP_KAS_FFC_STR_MAX);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (Z)");
-        goto end;
+        return rv;
     }
     json_object_set_string(tc_rsp, "ephemeralPublicIut", tmp);
 
-    memzero_s(tmp, ACVP_KAS_FFC_STR_MAX);
     rv = acvp_bin_to_hexstr(stc->chash, stc->chashlen, tmp, ACVP_KAS_FFC_STR_MAX);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (Z)");
-        goto end;
+        return rv;
     }
     json_object_set_string(tc_rsp, "hashZIut", tmp);
 
-end:
-    if (tmp) free(tmp);
-
     return rv;
 }
 
-static ACVP_RESULT acvp_kas_ffc_init_comp_tc(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_kas_ffc_init_comp_tc(ACVP_VS_CTX *vs_ctx,
                                              ACVP_KAS_FFC_TC *stc,
                                              unsigned int tc_id,
                                              ACVP_HASH_ALG hash_alg,
-                                             const char *p,
-                                             const char *q,
-                                             const char *g,
-                                             const char *eps,
-                                             const char *epri,
-                                             const char *epui,
-                                             const char *z) {
+                                             JSON_Object *groupobj,
+                                             JSON_Object *testobj) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     ACVP_RESULT rv;
+    int val = stc->test_type == ACVP_KAS_FFC_TT_VAL;
 
     stc->mode = ACVP_KAS_FFC_MODE_COMPONENT;
     stc->md = hash_alg;
 
-    stc->p = calloc(1, ACVP_KAS_FFC_BYTE_MAX);
-    if (!stc->p) { return ACVP_MALLOC_FAIL; }
-    rv = acvp_hexstr_to_bin(p, stc->p, ACVP_KAS_FFC_BYTE_MAX, &(stc->plen));
+    rv = acvp_tc_hex(vs_ctx, groupobj, "p", 0, ACVP_KAS_FFC_BYTE_MAX, &stc->p, &stc->plen);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (p)");
         return rv;
     }
 
-    stc->q = calloc(1, ACVP_KAS_FFC_BYTE_MAX);
-    if (!stc->q) { return ACVP_MALLOC_FAIL; }
-    rv = acvp_hexstr_to_bin(q, stc->q, ACVP_KAS_FFC_BYTE_MAX, &(stc->qlen));
+    rv = acvp_tc_hex(vs_ctx, groupobj, "q", 0, ACVP_KAS_FFC_BYTE_MAX, &stc->q, &stc->qlen);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (q)");
         return rv;
     }
 
-    stc->g = calloc(1, ACVP_KAS_FFC_BYTE_MAX);
-    if (!stc->g) { return ACVP_MALLOC_FAIL; }
-    rv = acvp_hexstr_to_bin(g, stc->g, ACVP_KAS_FFC_BYTE_MAX, &(stc->glen));
+    rv = acvp_tc_hex(vs_ctx, groupobj, "g", 0, ACVP_KAS_FFC_BYTE_MAX, &stc->g, &stc->glen);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (g)");
         return rv;
     }
 
-    stc->eps = calloc(1, ACVP_KAS_FFC_BYTE_MAX);
-    if (!stc->eps) { return ACVP_MALLOC_FAIL; }
-    rv = acvp_hexstr_to_bin(eps, stc->eps, ACVP_KAS_FFC_BYTE_MAX, &(stc->epslen));
+    rv = acvp_tc_hex(vs_ctx, testobj, "ephemeralPublicServer", 0, ACVP_KAS_FFC_BYTE_MAX,
+                     &stc->eps, &stc->epslen);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (eps)");
         return rv;
     }
 
-    stc->epri = calloc(1, ACVP_KAS_FFC_BYTE_MAX);
-    if (!stc->epri) { return ACVP_MALLOC_FAIL; }
-    stc->epui = calloc(1, ACVP_KAS_FFC_BYTE_MAX);
-    if (!stc->epui) { return ACVP_MALLOC_FAIL; }
-    stc->chash = calloc(1, ACVP_KAS_FFC_BYTE_MAX);
-    if (!stc->chash) { return ACVP_MALLOC_FAIL; }
-    stc->piut = calloc(1, ACVP_KAS_FFC_BYTE_MAX);
-    if (!stc->piut) { return ACVP_MALLOC_FAIL; }
-
-    stc->z = calloc(1, ACVP_KAS_FFC_BYTE_MAX);
-    if (!stc->z) { return ACVP_MALLOC_FAIL; }
-
-    if (stc->test_type == ACVP_KAS_FFC_TT_VAL) {
-        rv = acvp_hexstr_to_bin(z, stc->z, ACVP_KAS_FFC_BYTE_MAX, &(stc->zlen));
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (z)");
-            return rv;
-        }
-        rv = acvp_hexstr_to_bin(epri, stc->epri, ACVP_KAS_FFC_BYTE_MAX, &(stc->eprilen));
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (epri)");
-            return rv;
-        }
-        rv = acvp_hexstr_to_bin(epui, stc->epui, ACVP_KAS_FFC_BYTE_MAX, &(stc->epuilen));
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("Hex conversion failure (epui)");
-            return rv;
-        }
+    /*
+     * The module writes the IUT keys, Z and the hash of Z, and
+     * ACVP_KAS_FFC_TC doesn't tell it how much room there is, so these
+     * buffers keep their full size.  For VAL the keys and Z are inputs
+     * the module only reads.
+     */
+    if (val) {
+        rv = acvp_tc_hex(vs_ctx, testobj, "hashZIut", 0, ACVP_KAS_FFC_BYTE_MAX,
+                         &stc->z, &stc->zlen);
+    } else {
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_KAS_FFC_BYTE_MAX, ACVP_KAS_FFC_BYTE_MAX, &stc->z, &stc->zlen);
+    }
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (z)");
+        return rv;
+    }
+    if (val) {
+        rv = acvp_tc_hex(vs_ctx, testobj, "ephemeralPrivateIut", 0, ACVP_KAS_FFC_BYTE_MAX,
+                         &stc->epri, &stc->eprilen);
+    } else {
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_KAS_FFC_BYTE_MAX, ACVP_KAS_FFC_BYTE_MAX, &stc->epri, &stc->eprilen);
+    }
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (epri)");
+        return rv;
+    }
+    if (val) {
+        rv = acvp_tc_hex(vs_ctx, testobj, "ephemeralPublicIut", 0, ACVP_KAS_FFC_BYTE_MAX,
+                         &stc->epui, &stc->epuilen);
+    } else {
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_KAS_FFC_BYTE_MAX, ACVP_KAS_FFC_BYTE_MAX, &stc->epui, &stc->epuilen);
+    }
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (epui)");
+        return rv;
+    }
+    rv = acvp_tc_buf(vs_ctx, NULL, ACVP_KAS_FFC_BYTE_MAX, ACVP_KAS_FFC_BYTE_MAX, &stc->chash, NULL);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Unable to allocate chash");
+        return rv;
+    }
+    rv = acvp_tc_buf(vs_ctx, NULL, ACVP_KAS_FFC_BYTE_MAX, ACVP_KAS_FFC_BYTE_MAX, &stc->piut, NULL);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Unable to allocate piut");
+        return rv;
     }
     return ACVP_SUCCESS;
 }
@@ -169,17 +172,9 @@ static ACVP_RESULT acvp_kas_ffc_init_comp_tc(ACVP_CTX *ctx,
  * This function simply releases the data associated with
  * a test case.
  */
-static ACVP_RESULT acvp_kas_ffc_release_tc(ACVP_KAS_FFC_TC *stc) {
-    if (stc->piut) free(stc->piut);
-    if (stc->epri) free(stc->epri);
-    if (stc->epui) free(stc->epui);
-    if (stc->eps) free(stc->eps);
-    if (stc->z) free(stc->z);
-    if (stc->chash) free(stc->chash);
-    if (stc->p) free(stc->p);
-    if (stc->q) free(stc->q);
-    if (stc->g) free(stc->g);
+static ACVP_RESULT acvp_kas_ffc_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_KAS_FFC_TC *stc) {
     memzero_s(stc, sizeof(ACVP_KAS_FFC_TC));
+    acvp_arena_reset(&vs_ctx->tc_arena);
     return ACVP_SUCCESS;
 }
 
@@ -195,12 +190,13 @@ static ACVP_KAS_FFC_TEST_TYPE read_test_type(const char *str) {
     return 0;
 }
 
-static ACVP_RESULT acvp_kas_ffc_comp(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_kas_ffc_comp(ACVP_VS_CTX *vs_ctx,
                                      ACVP_CAPS_LIST *cap,
                                      ACVP_TEST_CASE *tc,
                                      ACVP_KAS_FFC_TC *stc,
                                      JSON_Object *obj,
                                      JSON_Array *r_garr) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Array *groups;
@@ -225,6 +221,11 @@ static ACVP_RESULT acvp_kas_ffc_comp(ACVP_CTX *ctx,
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -402,17 +403,17 @@ static ACVP_RESULT acvp_kas_ffc_comp(ACVP_CTX *ctx,
              * Setup the test case data that will be passed down to
              * the crypto module.
              */
-            rv = acvp_kas_ffc_init_comp_tc(ctx, stc, tc_id, hash_alg,
-                                           p, q, g, eps, epri, epui, z);
+            rv = acvp_kas_ffc_init_comp_tc(vs_ctx, stc, tc_id, hash_alg,
+                                           groupobj, testobj);
             if (rv != ACVP_SUCCESS) {
-                acvp_kas_ffc_release_tc(stc);
+                acvp_kas_ffc_release_tc(vs_ctx, stc);
                 json_value_free(r_tval);
                 goto err;
             }
 
             /* Process the current KAT test vector... */
             if ((cap->crypto_handler)(tc)) {
-                acvp_kas_ffc_release_tc(stc);
+                acvp_kas_ffc_release_tc(vs_ctx, stc);
                 ACVP_LOG_ERR("crypto module failed the operation");
                 rv = ACVP_CRYPTO_MODULE_FAIL;
                 json_value_free(r_tval);
@@ -422,10 +423,10 @@ static ACVP_RESULT acvp_kas_ffc_comp(ACVP_CTX *ctx,
             /*
              * Output the test case results using JSON
              */
-            rv = acvp_kas_ffc_output_comp_tc(ctx, stc, r_tobj);
+            rv = acvp_kas_ffc_output_comp_tc(vs_ctx, stc, r_tobj);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("JSON output failure in KAS-FFC module");
-                acvp_kas_ffc_release_tc(stc);
+                acvp_kas_ffc_release_tc(vs_ctx, stc);
                 json_value_free(r_tval);
                 goto err;
             }
@@ -433,11 +434,12 @@ static ACVP_RESULT acvp_kas_ffc_comp(ACVP_CTX *ctx,
             /*
              * Release all the memory associated with the test case
              */
-            acvp_kas_ffc_release_tc(stc);
+            acvp_kas_ffc_release_tc(vs_ctx, stc);
 
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
     }
     rv = ACVP_SUCCESS;
@@ -449,7 +451,8 @@ err:
     return rv;
 }
 
-ACVP_RESULT acvp_kas_ffc_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_kas_ffc_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     JSON_Value *r_vs_val = NULL;
     JSON_Object *r_vs = NULL;
     JSON_Array *r_garr = NULL; /* Response testarray */
@@ -493,7 +496,7 @@ ACVP_RESULT acvp_kas_ffc_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -520,7 +523,7 @@ ACVP_RESULT acvp_kas_ffc_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             rv = ACVP_UNSUPPORTED_OP;
             goto err;
         }
-        rv = acvp_kas_ffc_comp(ctx, cap, &tc, &stc, obj, r_garr);
+        rv = acvp_kas_ffc_comp(vs_ctx, cap, &tc, &stc, obj, r_garr);
         if (rv != ACVP_SUCCESS) {
             goto err;
         }
@@ -535,18 +538,20 @@ ACVP_RESULT acvp_kas_ffc_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     }
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
     if (rv != ACVP_SUCCESS) {
-        acvp_kas_ffc_release_tc(&stc);
+        acvp_kas_ffc_release_tc(vs_ctx, &stc);
         json_value_free(r_vs_val);
     }
     return rv;
@@ -35,9 +35,9 @@
 /*
  * Forward prototypes for local functions
  */
-static ACVP_RESULT acvp_kdf135_tls_output_tc(ACVP_CTX *ctx, ACVP_KDF135_TLS_TC *stc, JSON_Object *tc_rsp);
+static ACVP_RESULT acvp_kdf135_tls_output_tc(ACVP_VS_CTX *vs_ctx, ACVP_KDF135_TLS_TC *stc, JSON_Object *tc_rsp);
 
-static ACVP_RESULT acvp_kdf135_tls_init_tc(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_kdf135_tls_init_tc(ACVP_VS_CTX *vs_ctx,
                                            ACVP_KDF135_TLS_TC *stc,
                                            unsigned int tc_id,
                                            ACVP_CIPHER alg_id,
@@ -51,7 +51,7 @@ static ACVP_RESULT acvp_kdf135_tls_init_tc(ACVP_CTX *ctx,
                                            const char *s_rnd,
                                            const char *c_rnd);
 
-static ACVP_RESULT acvp_kdf135_tls_release_tc(ACVP_KDF135_TLS_TC *stc);
+static ACVP_RESULT acvp_kdf135_tls_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_KDF135_TLS_TC *stc);
 
 static ACVP_KDF135_TLS_METHOD read_version(const char *str) {
     int diff = 1;
@@ -65,7 +65,8 @@ static ACVP_KDF135_TLS_METHOD read_version(const char *str) {
     return 0; 
 }
 
-ACVP_RESULT acvp_kdf135_tls_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
+ACVP_RESULT acvp_kdf135_tls_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     unsigned int tc_id;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
@@ -150,7 +151,7 @@ ACVP_RESULT acvp_kdf135_tls_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         goto err;
@@ -163,6 +164,11 @@ ACVP_RESULT acvp_kdf135_tls_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -297,10 +303,10 @@ ACVP_RESULT acvp_kdf135_tls_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
              * Setup the test case data that will be passed down to
              * the crypto module.
              */
-            rv = acvp_kdf135_tls_init_tc(ctx, &stc, tc_id, alg_id, meth, md, pm_len,
+            rv = acvp_kdf135_tls_init_tc(vs_ctx, &stc, tc_id, alg_id, meth, md, pm_len,
                                          kb_len, pm_secret, sh_rnd, ch_rnd, s_rnd, c_rnd);
             if (rv != ACVP_SUCCESS) {
-                acvp_kdf135_tls_release_tc(&stc);
+                acvp_kdf135_tls_release_tc(vs_ctx, &stc);
                 json_value_free(r_tval);
                 goto err;
             }
@@ -308,7 +314,7 @@ ACVP_RESULT acvp_kdf135_tls_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             /* Process the current test vector... */
             if ((cap->crypto_handler)(&tc)) {
                 ACVP_LOG_ERR("crypto module failed the operation");
-                acvp_kdf135_tls_release_tc(&stc);
+                acvp_kdf135_tls_release_tc(vs_ctx, &stc);
                 rv = ACVP_CRYPTO_MODULE_FAIL;
                 json_value_free(r_tval);
                 goto err;
@@ -317,10 +323,10 @@ ACVP_RESULT acvp_kdf135_tls_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Output the test case results using JSON
              */
-            rv = acvp_kdf135_tls_output_tc(ctx, &stc, r_tobj);
+            rv = acvp_kdf135_tls_output_tc(vs_ctx, &stc, r_tobj);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("JSON output failure in hash module");
-                acvp_kdf135_tls_release_tc(&stc);
+                acvp_kdf135_tls_release_tc(vs_ctx, &stc);
                 json_value_free(r_tval);
                 goto err;
             }
@@ -328,23 +334,26 @@ ACVP_RESULT acvp_kdf135_tls_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Release all the memory associated with the test case
              */
-            acvp_kdf135_tls_release_tc(&stc);
+            acvp_kdf135_tls_release_tc(vs_ctx, &stc);
 
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
     }
 
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
@@ -360,11 +369,12 @@ err:
  * file that will be uploaded to the server.  This routine handles
  * the JSON processing for a single test case.
  */
-static ACVP_RESULT acvp_kdf135_tls_output_tc(ACVP_CTX *ctx, ACVP_KDF135_TLS_TC *stc, JSON_Object *tc_rsp) {
+static ACVP_RESULT acvp_kdf135_tls_output_tc(ACVP_VS_CTX *vs_ctx, ACVP_KDF135_TLS_TC *stc, JSON_Object *tc_rsp) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     char *tmp = NULL;
     ACVP_RESULT rv = ACVP_SUCCESS;
 
-    tmp = calloc(1, ACVP_KDF135_TLS_MSG_MAX + 1);
+    tmp = acvp_arena_alloc(&vs_ctx->tc_arena, ACVP_KDF135_TLS_MSG_MAX + 1);
     if (!tmp) {
         ACVP_LOG_ERR("Unable to malloc in acvp_kdf135_tls_output_tc");
         return ACVP_MALLOC_FAIL;
@@ -373,25 +383,21 @@ static ACVP_RESULT acvp_kdf135_tls_output_tc(ACVP_CTX *ctx, ACVP_KDF135_TLS_TC *
     rv = acvp_bin_to_hexstr(stc->msecret1, stc->pm_len, tmp, ACVP_KDF135_TLS_MSG_MAX);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (mac)");
-        goto err;
+        return rv;
     }
     json_object_set_string(tc_rsp, "masterSecret", tmp);
-    memzero_s(tmp, ACVP_KDF135_TLS_MSG_MAX);
 
     rv = acvp_bin_to_hexstr(stc->kblock1, stc->kb_len, tmp, ACVP_KDF135_TLS_MSG_MAX);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (mac)");
-        goto err;
+        return rv;
     }
     json_object_set_string(tc_rsp, "keyBlock", tmp);
 
-err:
-    free(tmp);
-
     return rv;
 }
 
-static ACVP_RESULT acvp_kdf135_tls_init_tc(ACVP_CTX *ctx,
+static ACVP_RESULT acvp_kdf135_tls_init_tc(ACVP_VS_CTX *vs_ctx,
                                            ACVP_KDF135_TLS_TC *stc,
                                            unsigned int tc_id,
                                            ACVP_CIPHER alg_id,
@@ -404,61 +410,64 @@ static ACVP_RESULT acvp_kdf135_tls_init_tc(ACVP_CTX *ctx,
                                            const char *ch_rnd,
                                            const char *s_rnd,
                                            const char *c_rnd) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     ACVP_RESULT rv;
 
     memzero_s(stc, sizeof(ACVP_KDF135_TLS_TC));
 
-    stc->pm_secret = calloc(1, ACVP_KDF135_TLS_MSG_MAX);
-    if (!stc->pm_secret) { return ACVP_MALLOC_FAIL; }
-    rv = acvp_hexstr_to_bin(pm_secret, stc->pm_secret, ACVP_KDF135_TLS_MSG_MAX, NULL);
+    rv = acvp_tc_buf(vs_ctx, pm_secret, pm_len / 8, ACVP_KDF135_TLS_MSG_MAX,
+                     &stc->pm_secret, NULL);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (pm_secret)");
         return rv;
     }
 
-    stc->sh_rnd = calloc(1, ACVP_KDF135_TLS_MSG_MAX);
-    if (!stc->sh_rnd) { return ACVP_MALLOC_FAIL; }
-    rv = acvp_hexstr_to_bin(sh_rnd, stc->sh_rnd, ACVP_KDF135_TLS_MSG_MAX, &(stc->sh_rnd_len));
+    rv = acvp_tc_buf(vs_ctx, sh_rnd, 0, ACVP_KDF135_TLS_MSG_MAX,
+                     &stc->sh_rnd, &stc->sh_rnd_len);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (sh_rnd)");
         return rv;
     }
 
-    stc->ch_rnd = calloc(1, ACVP_KDF135_TLS_MSG_MAX);
-    if (!stc->ch_rnd) { return ACVP_MALLOC_FAIL; }
-
-    rv = acvp_hexstr_to_bin(ch_rnd, stc->ch_rnd, ACVP_KDF135_TLS_MSG_MAX, &(stc->ch_rnd_len));
+    rv = acvp_tc_buf(vs_ctx, ch_rnd, 0, ACVP_KDF135_TLS_MSG_MAX,
+                     &stc->ch_rnd, &stc->ch_rnd_len);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (ch_rnd)");
         return rv;
     }
 
-    stc->c_rnd = calloc(1, ACVP_KDF135_TLS_MSG_MAX);
-    if (!stc->c_rnd) { return ACVP_MALLOC_FAIL; }
-
-    rv = acvp_hexstr_to_bin(c_rnd, stc->c_rnd, ACVP_KDF135_TLS_MSG_MAX, &(stc->c_rnd_len));
+    rv = acvp_tc_buf(vs_ctx, c_rnd, 0, ACVP_KDF135_TLS_MSG_MAX,
+                     &stc->c_rnd, &stc->c_rnd_len);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (c_rnd)");
         return rv;
     }
 
-    stc->s_rnd = calloc(1, ACVP_KDF135_TLS_MSG_MAX);
-    if (!stc->s_rnd) { return ACVP_MALLOC_FAIL; }
-
-    rv = acvp_hexstr_to_bin(s_rnd, stc->s_rnd, ACVP_KDF135_TLS_MSG_MAX, &(stc->s_rnd_len));
+    rv = acvp_tc_buf(vs_ctx, s_rnd, 0, ACVP_KDF135_TLS_MSG_MAX,
+                     &stc->s_rnd, &stc->s_rnd_len);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (s_rnd)");
         return rv;
     }
 
-    stc->msecret1 = calloc(1, ACVP_KDF135_TLS_MSG_MAX);
-    if (!stc->msecret1) { return ACVP_MALLOC_FAIL; }
-    stc->msecret2 = calloc(1, ACVP_KDF135_TLS_MSG_MAX);
-    if (!stc->msecret2) { return ACVP_MALLOC_FAIL; }
-    stc->kblock1 = calloc(1, ACVP_KDF135_TLS_MSG_MAX);
-    if (!stc->kblock1) { return ACVP_MALLOC_FAIL; }
-    stc->kblock2 = calloc(1, ACVP_KDF135_TLS_MSG_MAX);
-    if (!stc->kblock2) { return ACVP_MALLOC_FAIL; }
+    /*
+     * Outputs: the master secrets and key blocks.  The module isn't
+     * told how much room they have, so they keep their full size.
+     */
+    rv = acvp_tc_buf(vs_ctx, NULL, ACVP_KDF135_TLS_MSG_MAX, ACVP_KDF135_TLS_MSG_MAX, &stc->msecret1, NULL);
+    if (rv == ACVP_SUCCESS) {
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_KDF135_TLS_MSG_MAX, ACVP_KDF135_TLS_MSG_MAX, &stc->msecret2, NULL);
+    }
+    if (rv == ACVP_SUCCESS) {
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_KDF135_TLS_MSG_MAX, ACVP_KDF135_TLS_MSG_MAX, &stc->kblock1, NULL);
+    }
+    if (rv == ACVP_SUCCESS) {
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_KDF135_TLS_MSG_MAX, ACVP_KDF135_TLS_MSG_MAX, &stc->kblock2, NULL);
+    }
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Unable to allocate the test case outputs");
+        return rv;
+    }
 
     stc->tc_id = tc_id;
     stc->cipher = alg_id;
@@ -474,17 +483,8 @@ static ACVP_RESULT acvp_kdf135_tls_init_tc(ACVP_CTX *ctx,
  * This function simply releases the data associated with
  * a test case.
  */
-static ACVP_RESULT acvp_kdf135_tls_release_tc(ACVP_KDF135_TLS_TC *stc) {
-    free(stc->pm_secret);
-    free(stc->sh_rnd);
-    free(stc->ch_rnd);
-    free(stc->c_rnd);
-    free(stc->s_rnd);
-    free(stc->msecret1);
-    free(stc->msecret2);
-    free(stc->kblock1);
-    free(stc->kblock2);
-
+static ACVP_RESULT acvp_kdf135_tls_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_KDF135_TLS_TC *stc) {
     memzero_s(stc, sizeof(ACVP_KDF135_TLS_TC));
+    acvp_arena_reset(&vs_ctx->tc_arena);
     return ACVP_SUCCESS;
 }
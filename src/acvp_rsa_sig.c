@@ -33,7 +33,7 @@
 #include "parson.h"
 #include "safe_lib.h"
 
-static ACVP_RESULT acvp_rsa_sig_kat_handler_internal(ACVP_CTX *ctx, JSON_Object *obj, ACVP_CIPHER cipher);
+static ACVP_RESULT acvp_rsa_sig_kat_handler_internal(ACVP_VS_CTX *vs_ctx, JSON_Object *obj, ACVP_CIPHER cipher);
 
 /*
  * After the test case has been processed by the DUT, the results
@@ -71,17 +71,18 @@ err:
  * a test case.
  */
 
-static ACVP_RESULT acvp_rsa_siggen_release_tc(ACVP_RSA_SIG_TC *stc) {
-    if (stc->msg) { free(stc->msg); }
-    if (stc->e) { free(stc->e); }
-    if (stc->n) { free(stc->n); }
-    if (stc->signature) { free(stc->signature); }
-    if (stc->salt) { free(stc->salt); }
+static ACVP_RESULT acvp_rsa_siggen_release_tc(ACVP_VS_CTX *vs_ctx, ACVP_RSA_SIG_TC *stc) {
     memzero_s(stc, sizeof(ACVP_RSA_SIG_TC));
+    acvp_arena_reset(&vs_ctx->tc_arena);
     return ACVP_SUCCESS;
 }
 
-static ACVP_RESULT acvp_rsa_sig_init_tc(ACVP_CTX *ctx,
+/*
+ * For sigVer everything but the salt is an input, usually decoded
+ * by the parser and taken in place.  For sigGen the module fills
+ * in the signature and the key, so those get full size buffers.
+ */
+static ACVP_RESULT acvp_rsa_sig_init_tc(ACVP_VS_CTX *vs_ctx,
                                         ACVP_CIPHER cipher,
                                         ACVP_RSA_SIG_TC *stc,
                                         int tgId,
@@ -89,29 +90,19 @@ static ACVP_RESULT acvp_rsa_sig_init_tc(ACVP_CTX *ctx,
                                         ACVP_RSA_SIG_TYPE sig_type,
                                         unsigned int mod,
                                         ACVP_HASH_ALG hash_alg,
-                                        char *e,
-                                        char *n,
-                                        char *msg,
-                                        char *signature,
+                                        JSON_Object *groupobj,
+                                        JSON_Object *testobj,
                                         char *salt,
                                         int salt_len) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
     ACVP_RESULT rv;
 
     memzero_s(stc, sizeof(ACVP_RSA_SIG_TC));
 
-    stc->msg = calloc(ACVP_RSA_MSGLEN_MAX, sizeof(char));
-    if (!stc->msg) { return ACVP_MALLOC_FAIL; }
-    stc->signature = calloc(ACVP_RSA_SIGNATURE_MAX, sizeof(char));
-    if (!stc->signature) { return ACVP_MALLOC_FAIL; }
-    stc->salt = calloc(ACVP_RSA_SIGNATURE_MAX, sizeof(char));
+    stc->salt = acvp_arena_calloc(&vs_ctx->tc_arena, ACVP_RSA_SIGNATURE_MAX, sizeof(char));
     if (!stc->salt) { return ACVP_MALLOC_FAIL; }
 
-    stc->e = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
-    if (!stc->e) { return ACVP_MALLOC_FAIL; }
-    stc->n = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
-    if (!stc->n) { goto err; }
-
-    rv = acvp_hexstr_to_bin(msg, stc->msg, ACVP_RSA_MSGLEN_MAX, &(stc->msg_len));
+    rv = acvp_tc_hex(vs_ctx, testobj, "message", 0, ACVP_RSA_MSGLEN_MAX, &stc->msg, &stc->msg_len);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex conversion failure (msg)");
         return rv;
@@ -119,23 +110,31 @@ static ACVP_RESULT acvp_rsa_sig_init_tc(ACVP_CTX *ctx,
 
     if (cipher == ACVP_RSA_SIGVER) {
         stc->sig_mode = ACVP_RSA_SIGVER;
-        rv = acvp_hexstr_to_bin(e, stc->e, ACVP_RSA_EXP_LEN_MAX, &(stc->e_len));
+        rv = acvp_tc_hex(vs_ctx, groupobj, "e", 0, ACVP_RSA_EXP_LEN_MAX, &stc->e, &stc->e_len);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (e)");
             return rv;
         }
-        rv = acvp_hexstr_to_bin(n, stc->n, ACVP_RSA_EXP_LEN_MAX, &(stc->n_len));
+        rv = acvp_tc_hex(vs_ctx, groupobj, "n", 0, ACVP_RSA_EXP_LEN_MAX, &stc->n, &stc->n_len);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (n)");
             return rv;
         }
-        rv = acvp_hexstr_to_bin(signature, stc->signature, ACVP_RSA_SIGNATURE_MAX, &stc->sig_len);
+        rv = acvp_tc_hex(vs_ctx, testobj, "signature", 0, ACVP_RSA_SIGNATURE_MAX,
+                         &stc->signature, &stc->sig_len);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (signature)");
             return rv;
         }
     } else {
         stc->sig_mode = ACVP_RSA_SIGGEN;
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_RSA_EXP_LEN_MAX, ACVP_RSA_EXP_LEN_MAX, &stc->e, NULL);
+        if (rv != ACVP_SUCCESS) { return rv; }
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_RSA_EXP_LEN_MAX, ACVP_RSA_EXP_LEN_MAX, &stc->n, NULL);
+        if (rv != ACVP_SUCCESS) { return rv; }
+        rv = acvp_tc_buf(vs_ctx, NULL, ACVP_RSA_SIGNATURE_MAX, ACVP_RSA_SIGNATURE_MAX,
+                         &stc->signature, NULL);
+        if (rv != ACVP_SUCCESS) { return rv; }
     }
 
     if (salt_len) {
@@ -153,19 +152,14 @@ static ACVP_RESULT acvp_rsa_sig_init_tc(ACVP_CTX *ctx,
     stc->sig_type = sig_type;
 
     return rv;
-
-err:
-    ACVP_LOG_ERR("Failed to allocate buffer in RSA test case");
-    if (stc->n) free(stc->n);
-    return ACVP_MALLOC_FAIL;
 }
 
-ACVP_RESULT acvp_rsa_siggen_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
-    return acvp_rsa_sig_kat_handler_internal(ctx, obj, ACVP_RSA_SIGGEN);
+ACVP_RESULT acvp_rsa_siggen_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    return acvp_rsa_sig_kat_handler_internal(vs_ctx, obj, ACVP_RSA_SIGGEN);
 }
 
-ACVP_RESULT acvp_rsa_sigver_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
-    return acvp_rsa_sig_kat_handler_internal(ctx, obj, ACVP_RSA_SIGVER);
+ACVP_RESULT acvp_rsa_sigver_kat_handler(ACVP_VS_CTX *vs_ctx, JSON_Object *obj) {
+    return acvp_rsa_sig_kat_handler_internal(vs_ctx, obj, ACVP_RSA_SIGVER);
 }
 
 static ACVP_RSA_SIG_TYPE read_sig_type(const char *str) {
@@ -189,7 +183,8 @@ static ACVP_RSA_SIG_TYPE read_sig_type(const char *str) {
     return 0;
 }
 
-static ACVP_RESULT acvp_rsa_sig_kat_handler_internal(ACVP_CTX *ctx, JSON_Object *obj, ACVP_CIPHER cipher) {
+static ACVP_RESULT acvp_rsa_sig_kat_handler_internal(ACVP_VS_CTX *vs_ctx, JSON_Object *obj, ACVP_CIPHER cipher) {
+    ACVP_CTX *ctx = vs_ctx ? vs_ctx->ctx : NULL;
     unsigned int tc_id;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
@@ -270,7 +265,7 @@ static ACVP_RESULT acvp_rsa_sig_kat_handler_internal(ACVP_CTX *ctx, JSON_Object
     /*
      * Start to build the JSON response
      */
-    rv = acvp_setup_json_rsp_group(&ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
+    rv = acvp_setup_json_rsp_group(vs_ctx, &reg_arry_val, &r_vs_val, &r_vs, alg_str, &r_garr);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to setup json response");
         return rv;
@@ -288,6 +283,11 @@ static ACVP_RESULT acvp_rsa_sig_kat_handler_internal(ACVP_CTX *ctx, JSON_Object
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
+        rv = acvp_module_group_begin(vs_ctx, &tc);
+        if (rv != ACVP_SUCCESS) {
+            goto err;
+        }
+
         /*
          * Create a new group in the response with the tgid
          * and an array of tests
@@ -432,9 +432,9 @@ static ACVP_RESULT acvp_rsa_sig_kat_handler_internal(ACVP_CTX *ctx, JSON_Object
                 salt = (char *)json_object_get_string(testobj, "salt");
             }
 
-            rv = acvp_rsa_sig_init_tc(ctx, alg_id, &stc, tgId, tc_id,
-                                      sig_type, mod, hash_alg, e_str,
-                                      n_str, msg, signature, salt, salt_len);
+            rv = acvp_rsa_sig_init_tc(vs_ctx, alg_id, &stc, tgId, tc_id,
+                                      sig_type, mod, hash_alg, groupobj,
+                                      testobj, salt, salt_len);
 
             /* Process the current test vector... */
             if (rv == ACVP_SUCCESS) {
@@ -487,28 +487,31 @@ static ACVP_RESULT acvp_rsa_sig_kat_handler_internal(ACVP_CTX *ctx, JSON_Object
             /*
              * Release all the memory associated with the test case
              */
-            acvp_rsa_siggen_release_tc(&stc);
+            acvp_rsa_siggen_release_tc(vs_ctx, &stc);
 
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
+        acvp_module_group_end(vs_ctx);
         json_array_append_value(r_garr, r_gval);
     }
 
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+    if (ctx->debug >= ACVP_LOG_LVL_INFO) {
+        json_result = json_serialize_to_string_pretty(vs_ctx->kat_resp, NULL);
+        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+            printf("\n\n%s\n\n", json_result);
+        } else {
+            ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        }
+        json_free_serialized_string(json_result);
     }
-    json_free_serialized_string(json_result);
     rv = ACVP_SUCCESS;
 
 err:
     if (rv != ACVP_SUCCESS) {
-        acvp_rsa_siggen_release_tc(&stc);
+        acvp_rsa_siggen_release_tc(vs_ctx, &stc);
         acvp_release_json(r_vs_val, r_gval);
     }
     return rv;
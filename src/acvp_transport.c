@@ -50,10 +50,24 @@ typedef enum acvp_net_action {
     ACVP_NET_ACTION_POST_VECTOR_RESP
 } ACVP_NET_ACTION;
 
-static struct curl_slist *acvp_add_auth_hdr(ACVP_CTX *ctx, struct curl_slist *slist) {
+/*
+ * Serializes access to the session JWT between vector set
+ * workers, since any of them may need to refresh it.
+ */
+ACVP_LOCK_DECLARE(acvp_jwt_lock);
+
+static struct curl_slist *acvp_add_auth_hdr(ACVP_CTX *ctx, ACVP_VS_CTX *vs_ctx, struct curl_slist *slist) {
     int bearer_size;
     char *bearer;
 
+    /*
+     * Vector set requests may run on several workers, any of
+     * which can replace the token with a refresh.
+     */
+    if (vs_ctx) {
+        ACVP_LOCK(acvp_jwt_lock);
+    }
+
     /*
      * Create the Authorzation header if needed
      */
@@ -62,15 +76,248 @@ static struct curl_slist *acvp_add_auth_hdr(ACVP_CTX *ctx, struct curl_slist *sl
         bearer = calloc(1, bearer_size);
         if (!bearer) {
             ACVP_LOG_ERR("unable to allocate memory.");
-            return slist;
+            goto end;
         }
         snprintf(bearer, bearer_size + 1, "Authorization: Bearer %s", ctx->jwt_token);
         slist = curl_slist_append(slist, bearer);
         free(bearer);
     }
+end:
+    if (vs_ctx) {
+        ACVP_UNLOCK(acvp_jwt_lock);
+    }
     return slist;
 }
 
+/*
+ * Guards the connection cache bookkeeping on the session, which
+ * is touched by every vector set worker.
+ */
+ACVP_LOCK_DECLARE(acvp_conn_lock);
+
+#ifndef USE_MURL
+/*
+ * Curl takes the lock of one kind of shared data while holding
+ * another, so each kind needs a lock of its own.
+ */
+ACVP_LOCK_DECLARE(acvp_share_ssl_lock);
+ACVP_LOCK_DECLARE(acvp_share_dns_lock);
+ACVP_LOCK_DECLARE(acvp_share_misc_lock);
+
+static void acvp_share_lock(CURL *hnd, curl_lock_data data, curl_lock_access access, void *userptr) {
+    switch (data) {
+    case CURL_LOCK_DATA_SSL_SESSION:
+        ACVP_LOCK(acvp_share_ssl_lock);
+        break;
+    case CURL_LOCK_DATA_DNS:
+        ACVP_LOCK(acvp_share_dns_lock);
+        break;
+    default:
+        ACVP_LOCK(acvp_share_misc_lock);
+        break;
+    }
+}
+
+static void acvp_share_unlock(CURL *hnd, curl_lock_data data, void *userptr) {
+    switch (data) {
+    case CURL_LOCK_DATA_SSL_SESSION:
+        ACVP_UNLOCK(acvp_share_ssl_lock);
+        break;
+    case CURL_LOCK_DATA_DNS:
+        ACVP_UNLOCK(acvp_share_dns_lock);
+        break;
+    default:
+        ACVP_UNLOCK(acvp_share_misc_lock);
+        break;
+    }
+}
+#endif
+
+/*
+ * Set up by acvp_transport_lib_init() when the application runs
+ * several sessions through acvp_init_lib().  All of their handles
+ * then share one TLS session and DNS cache.  Curl can't share a
+ * connection cache between handles used by concurrent threads, so
+ * with a lib_max_conns limit the handles themselves are pooled:
+ * a request takes an idle handle, or makes one while there are
+ * fewer than lib_max_conns, and otherwise waits for one to be
+ * given back.  Each pooled handle keeps at most one connection.
+ */
+static int lib_http_ready;
+static int lib_max_conns;
+#ifndef USE_MURL
+static CURLSH *lib_http_share;
+#endif
+ACVP_LOCK_DECLARE(acvp_hnd_pool_lock);
+#ifndef WIN32
+static pthread_cond_t lib_hnd_returned = PTHREAD_COND_INITIALIZER;
+#endif
+static CURL **lib_hnd_idle;
+static int lib_hnd_idle_count;
+static int lib_hnd_count;
+
+/*
+ * Takes a handle from the pool.  Returns NULL if none could be
+ * made, or if the session was cancelled while waiting for one.
+ */
+static CURL *acvp_lib_hnd_take(ACVP_CTX *ctx) {
+    CURL *hnd = NULL;
+#ifndef WIN32
+    struct timespec ts;
+#endif
+
+    ACVP_LOCK(acvp_hnd_pool_lock);
+#ifndef WIN32
+    while (!lib_hnd_idle_count && lib_hnd_count >= lib_max_conns && !ctx->cancel) {
+        acvp_deadline(&ts, ACVP_CANCEL_POLL_MS);
+        pthread_cond_timedwait(&lib_hnd_returned, &acvp_hnd_pool_lock, &ts);
+    }
+#endif
+    if (lib_hnd_idle_count) {
+        hnd = lib_hnd_idle[--lib_hnd_idle_count];
+    } else if (lib_hnd_count < lib_max_conns) {
+        hnd = curl_easy_init();
+        if (hnd) {
+            lib_hnd_count++;
+        }
+    }
+    ACVP_UNLOCK(acvp_hnd_pool_lock);
+    return hnd;
+}
+
+static void acvp_lib_hnd_give_back(CURL *hnd) {
+    ACVP_LOCK(acvp_hnd_pool_lock);
+    lib_hnd_idle[lib_hnd_idle_count++] = hnd;
+#ifndef WIN32
+    pthread_cond_signal(&lib_hnd_returned);
+#endif
+    ACVP_UNLOCK(acvp_hnd_pool_lock);
+}
+
+/*
+ * Returns the HTTP handle for a request.  Vector set requests use
+ * the handle owned by their work context, everything else uses the
+ * session's handle.  Handles are kept between requests so the
+ * connection to the server stays open and is reused, with the
+ * options reset to start each request from a clean slate.  Pooled
+ * handles are only lent for the request, see acvp_put_http_hnd().
+ */
+static CURL *acvp_get_http_hnd(ACVP_CTX *ctx, ACVP_VS_CTX *vs_ctx) {
+    void **hnd = vs_ctx ? &vs_ctx->http_hnd : &ctx->http_hnd;
+
+    if (lib_max_conns) {
+        *hnd = acvp_lib_hnd_take(ctx);
+        if (!*hnd) {
+            if (!ctx->cancel) {
+                ACVP_LOG_ERR("Unable to create HTTP handle");
+            }
+            return NULL;
+        }
+        curl_easy_reset(*hnd);
+#ifndef USE_MURL
+        curl_easy_setopt(*hnd, CURLOPT_SHARE, lib_http_share);
+        curl_easy_setopt(*hnd, CURLOPT_MAXCONNECTS, 1L);
+#endif
+        return *hnd;
+    }
+
+    if (*hnd) {
+        curl_easy_reset(*hnd);
+    } else {
+        *hnd = curl_easy_init();
+        if (!*hnd) {
+            ACVP_LOG_ERR("Unable to create HTTP handle");
+            return NULL;
+        }
+    }
+
+#ifndef USE_MURL
+    if (lib_http_share) {
+        curl_easy_setopt(*hnd, CURLOPT_SHARE, lib_http_share);
+        return *hnd;
+    }
+
+    /*
+     * Share TLS sessions between the handles so a new connection
+     * made by one worker can resume a session set up by another.
+     */
+    ACVP_LOCK(acvp_conn_lock);
+    if (!ctx->http_share) {
+        ctx->http_share = curl_share_init();
+        if (ctx->http_share) {
+            curl_share_setopt(ctx->http_share, CURLSHOPT_LOCKFUNC, acvp_share_lock);
+            curl_share_setopt(ctx->http_share, CURLSHOPT_UNLOCKFUNC, acvp_share_unlock);
+            curl_share_setopt(ctx->http_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+    }
+    ACVP_UNLOCK(acvp_conn_lock);
+    if (ctx->http_share) {
+        curl_easy_setopt(*hnd, CURLOPT_SHARE, ctx->http_share);
+    }
+#endif
+
+    return *hnd;
+}
+
+/*
+ * Gives a pooled handle back once its request is done.  Handles
+ * of the work context or session are kept where they are.
+ */
+static void acvp_put_http_hnd(ACVP_CTX *ctx, ACVP_VS_CTX *vs_ctx) {
+    void **hnd = vs_ctx ? &vs_ctx->http_hnd : &ctx->http_hnd;
+
+    if (!lib_max_conns || !*hnd) {
+        return;
+    }
+    acvp_lib_hnd_give_back(*hnd);
+    *hnd = NULL;
+}
+
+/*
+ * Count the request towards handshakes_avoided if it went
+ * over a connection left open by an earlier request.
+ */
+static void acvp_track_conn_reuse(ACVP_CTX *ctx, CURL *hnd) {
+    long connects = 1;
+
+    if (curl_easy_getinfo(hnd, CURLINFO_NUM_CONNECTS, &connects) != CURLE_OK) {
+        return;
+    }
+    if (!connects) {
+        ACVP_LOCK(acvp_conn_lock);
+        ctx->handshakes_avoided++;
+        ACVP_UNLOCK(acvp_conn_lock);
+    }
+}
+
+/*
+ * Closes the connection held by the vector set work context,
+ * or the session's connection and TLS session cache when
+ * vs_ctx is NULL.
+ */
+void acvp_transport_close(ACVP_CTX *ctx, ACVP_VS_CTX *vs_ctx) {
+    if (vs_ctx) {
+        if (vs_ctx->http_hnd) {
+            curl_easy_cleanup(vs_ctx->http_hnd);
+            vs_ctx->http_hnd = NULL;
+        }
+        return;
+    }
+    if (!ctx) {
+        return;
+    }
+    if (ctx->http_hnd) {
+        curl_easy_cleanup(ctx->http_hnd);
+        ctx->http_hnd = NULL;
+    }
+#ifndef USE_MURL
+    if (ctx->http_share) {
+        curl_share_cleanup(ctx->http_share);
+        ctx->http_share = NULL;
+    }
+#endif
+}
+
 /*
  * This routine will log the TLS peer certificate chain, which
  * allows auditing the peer identity by inspecting the logs.
@@ -99,6 +346,123 @@ static void acvp_curl_log_peer_cert(ACVP_CTX *ctx, CURL *hnd) {
     }
 }
 
+/*
+ * State for acvp_curl_write_func() while one request is running.
+ */
+typedef struct acvp_http_sink_t {
+    ACVP_HTTP_BODY *body;
+    CURL *hnd;
+    JSON_Stream *stream; /* a 200 body is parsed as it arrives instead of being kept */
+} ACVP_HTTP_SINK;
+
+/*
+ * Returns the Content-Length the server announced for the
+ * response being received on hnd, or 0 if it is not known.
+ */
+static size_t acvp_http_content_length(CURL *hnd) {
+#if !defined USE_MURL && LIBCURL_VERSION_NUM >= 0x073700
+    curl_off_t cl = -1;
+
+    if (curl_easy_getinfo(hnd, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &cl) == CURLE_OK && cl > 0) {
+        return (size_t)cl;
+    }
+#endif
+    return 0;
+}
+
+/*
+ * Makes room for len more bytes plus the terminator in body.
+ * The first allocation is sized from the Content-Length when
+ * the server sent one, after that the buffer doubles.
+ */
+static int acvp_http_body_reserve(ACVP_HTTP_BODY *body, CURL *hnd, size_t len) {
+    size_t need = body->len + len + 1;
+    size_t new_size = 0;
+    char *new_data = NULL;
+
+    if (need <= body->len) {
+        return 0;
+    }
+    if (need <= body->size) {
+        return 1;
+    }
+
+    new_size = body->size ? body->size * 2 : ACVP_HTTP_BODY_SIZE_MIN;
+    if (!body->len) {
+        size_t hint = acvp_http_content_length(hnd);
+        if (hint >= new_size) {
+            new_size = hint + 1;
+        }
+    }
+    while (new_size < need) {
+        if (new_size * 2 < new_size) {
+            return 0;
+        }
+        new_size *= 2;
+    }
+
+    new_data = realloc(body->data, new_size);
+    if (!new_data) {
+        return 0;
+    }
+    body->data = new_data;
+    body->size = new_size;
+    return 1;
+}
+
+void acvp_http_body_free(ACVP_HTTP_BODY *body) {
+    if (!body) {
+        return;
+    }
+    if (body->data) {
+        free(body->data);
+    }
+    memzero_s(body, sizeof(ACVP_HTTP_BODY));
+}
+
+/*
+ * This is the callback used by curl to send the HTTP body
+ * to the application (us).  The body is appended to the
+ * ACVP_HTTP_BODY of the request, which grows as needed.
+ * A successful response is fed straight into the parser
+ * instead when the request has one, so that a vector set
+ * can be processed while it is still arriving.  The test
+ * groups are run from the parser, so the crypto handlers
+ * are called from here; acvp.h documents what that means
+ * for them at acvp_process_tests().
+ */
+static size_t acvp_curl_write_func(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    ACVP_HTTP_SINK *sink = (ACVP_HTTP_SINK *)userdata;
+    ACVP_HTTP_BODY *body = sink->body;
+    long http_code = 0;
+
+    if (size != 1) {
+        fprintf(stderr, "\ncurl size not 1\n");
+        return 0;
+    }
+
+    if (sink->stream) {
+        curl_easy_getinfo(sink->hnd, CURLINFO_RESPONSE_CODE, &http_code);
+        if (http_code == HTTP_OK) {
+            if (json_stream_feed(sink->stream, ptr, nmemb) != JSONSuccess) {
+                return 0;
+            }
+            return nmemb;
+        }
+    }
+
+    if (!acvp_http_body_reserve(body, sink->hnd, nmemb)) {
+        fprintf(stderr, "\nmalloc failed in curl write func\n");
+        return 0;
+    }
+
+    memcpy_s(&body->data[body->len], body->size - body->len, ptr, nmemb);
+    body->len += nmemb;
+    body->data[body->len] = 0;
+
+    return nmemb;
+}
+
 /*
  * This function uses libcurl to send a simple HTTP GET
  * request with no Content-Type header.
@@ -106,26 +470,34 @@ static void acvp_curl_log_peer_cert(ACVP_CTX *ctx, CURL *hnd) {
  * The parameters are:
  *
  * ctx: Ptr to ACVP_CTX, which contains the server name
+ * vs_ctx: Ptr to the vector set work context when the request
+ *         is made on behalf of a vector set, NULL otherwise
  * url: URL to use for the GET request
- * writefunc: Function pointer to handle writing the data
- *            from the HTTP body received from the server.
+ * body: Where the HTTP body received from the server is stored
+ * stream: Parser a successful response body is fed into instead
+ *         of being stored, may be NULL
  *
  * Return value is the HTTP status value from the server
  *	    (e.g. 200 for HTTP OK)
  */
-static long acvp_curl_http_get(ACVP_CTX *ctx, char *url, void *writefunc) {
+static long acvp_curl_http_get(ACVP_CTX *ctx, ACVP_VS_CTX *vs_ctx, char *url,
+                               ACVP_HTTP_BODY *body, JSON_Stream *stream) {
     long http_code = 0;
     CURL *hnd;
     struct curl_slist *slist;
     char user_agent_str[USER_AGENT_STR_MAX + 1];
+    ACVP_HTTP_SINK sink;
 
     slist = NULL;
     /*
      * Create the Authorzation header if needed
      */
-    slist = acvp_add_auth_hdr(ctx, slist);
+    slist = acvp_add_auth_hdr(ctx, vs_ctx, slist);
 
-    ctx->read_ctr = 0;
+    body->len = 0;
+    if (body->data) {
+        body->data[0] = 0;
+    }
 
     /*
      * Create the HTTP User Agent value
@@ -135,7 +507,11 @@ static long acvp_curl_http_get(ACVP_CTX *ctx, char *url, void *writefunc) {
     /*
      * Setup Curl
      */
-    hnd = curl_easy_init();
+    hnd = acvp_get_http_hnd(ctx, vs_ctx);
+    if (!hnd) {
+        if (slist) curl_slist_free_all(slist);
+        return 0;
+    }
     curl_easy_setopt(hnd, CURLOPT_URL, url);
     curl_easy_setopt(hnd, CURLOPT_NOPROGRESS, 1L);
     curl_easy_setopt(hnd, CURLOPT_USERAGENT, user_agent_str);
@@ -159,18 +535,20 @@ static long acvp_curl_http_get(ACVP_CTX *ctx, char *url, void *writefunc) {
         curl_easy_setopt(hnd, CURLOPT_SSLKEY, ctx->tls_key);
     }
     /*
-     * If the caller wants the HTTP data from the server
-     * set the callback function
+     * Collect the HTTP body from the server
      */
-    if (writefunc) {
-        curl_easy_setopt(hnd, CURLOPT_WRITEDATA, ctx);
-        curl_easy_setopt(hnd, CURLOPT_WRITEFUNCTION, writefunc);
-    }
+    sink.body = body;
+    sink.hnd = hnd;
+    sink.stream = stream;
+    curl_easy_setopt(hnd, CURLOPT_WRITEDATA, &sink);
+    curl_easy_setopt(hnd, CURLOPT_WRITEFUNCTION, &acvp_curl_write_func);
 
     /*
      * Send the HTTP GET request
      */
-    curl_easy_perform(hnd);
+    if (curl_easy_perform(hnd) == CURLE_OK) {
+        acvp_track_conn_reuse(ctx, hnd);
+    }
 
     /*
      * Get the cert info from the TLS peer
@@ -188,12 +566,11 @@ static long acvp_curl_http_get(ACVP_CTX *ctx, char *url, void *writefunc) {
         ACVP_LOG_ERR("HTTP response: %d\n", (int)http_code);
     }
 
-    curl_easy_cleanup(hnd);
-    hnd = NULL;
     if (slist) {
         curl_slist_free_all(slist);
         slist = NULL;
     }
+    acvp_put_http_hnd(ctx, vs_ctx);
 
     return http_code;
 }
@@ -205,20 +582,23 @@ static long acvp_curl_http_get(ACVP_CTX *ctx, char *url, void *writefunc) {
  * The parameters are:
  *
  * ctx: Ptr to ACVP_CTX, which contains the server name
+ * vs_ctx: Ptr to the vector set work context when the request
+ *         is made on behalf of a vector set, NULL otherwise
  * url: URL to use for the GET request
  * data: data to POST to the server
- * writefunc: Function pointer to handle writing the data
- *            from the HTTP body received from the server.
+ * body: Where the HTTP body received from the server is stored
  *
  * Return value is the HTTP status value from the server
  *	    (e.g. 200 for HTTP OK)
  */
-static long acvp_curl_http_post(ACVP_CTX *ctx, char *url, char *data, int data_len, void *writefunc) {
+static long acvp_curl_http_post(ACVP_CTX *ctx, ACVP_VS_CTX *vs_ctx, char *url, char *data, int data_len,
+                                ACVP_HTTP_BODY *body) {
     long http_code = 0;
     CURL *hnd;
     CURLcode crv;
     struct curl_slist *slist;
     char user_agent_str[USER_AGENT_STR_MAX + 1];
+    ACVP_HTTP_SINK sink;
 
     /*
      * Set the Content-Type header in the HTTP request
@@ -229,9 +609,12 @@ static long acvp_curl_http_post(ACVP_CTX *ctx, char *url, char *data, int data_l
     /*
      * Create the Authorzation header if needed
      */
-    slist = acvp_add_auth_hdr(ctx, slist);
+    slist = acvp_add_auth_hdr(ctx, vs_ctx, slist);
 
-    ctx->read_ctr = 0;
+    body->len = 0;
+    if (body->data) {
+        body->data[0] = 0;
+    }
 
     /*
      * Create the HTTP User Agent value
@@ -241,7 +624,11 @@ static long acvp_curl_http_post(ACVP_CTX *ctx, char *url, char *data, int data_l
     /*
      * Setup Curl
      */
-    hnd = curl_easy_init();
+    hnd = acvp_get_http_hnd(ctx, vs_ctx);
+    if (!hnd) {
+        curl_slist_free_all(slist);
+        return 0;
+    }
     curl_easy_setopt(hnd, CURLOPT_URL, url);
     curl_easy_setopt(hnd, CURLOPT_NOPROGRESS, 1L);
     curl_easy_setopt(hnd, CURLOPT_USERAGENT, user_agent_str);
@@ -269,13 +656,13 @@ static long acvp_curl_http_post(ACVP_CTX *ctx, char *url, char *data, int data_l
     }
 
     /*
-     * If the caller wants the HTTP data from the server
-     * set the callback function
+     * Collect the HTTP body from the server
      */
-    if (writefunc) {
-        curl_easy_setopt(hnd, CURLOPT_WRITEDATA, ctx);
-        curl_easy_setopt(hnd, CURLOPT_WRITEFUNCTION, writefunc);
-    }
+    sink.body = body;
+    sink.hnd = hnd;
+    sink.stream = NULL;
+    curl_easy_setopt(hnd, CURLOPT_WRITEDATA, &sink);
+    curl_easy_setopt(hnd, CURLOPT_WRITEFUNCTION, &acvp_curl_write_func);
 
     /*
      * Send the HTTP POST request
@@ -283,6 +670,8 @@ static long acvp_curl_http_post(ACVP_CTX *ctx, char *url, char *data, int data_l
     crv = curl_easy_perform(hnd);
     if (crv != CURLE_OK) {
         ACVP_LOG_ERR("Curl failed with code %d (%s)\n", crv, curl_easy_strerror(crv));
+    } else {
+        acvp_track_conn_reuse(ctx, hnd);
     }
 
     /*
@@ -301,189 +690,13 @@ static long acvp_curl_http_post(ACVP_CTX *ctx, char *url, char *data, int data_l
         ACVP_LOG_ERR("HTTP response: %d\n", (int)http_code);
     }
 
-    curl_easy_cleanup(hnd);
-    hnd = NULL;
     curl_slist_free_all(slist);
     slist = NULL;
+    acvp_put_http_hnd(ctx, vs_ctx);
 
     return http_code;
 }
 
-/*
- * This is a callback used by curl to send the HTTP body
- * to the application (us).  We will store the HTTP body
- * on the ACVP_CTX in one of the transitory fields.
- */
-static size_t acvp_curl_write_upld_func(void *ptr, size_t size, size_t nmemb, void *userdata) {
-    ACVP_CTX *ctx = (ACVP_CTX *)userdata;
-    char *http_buf;
-
-    if (size != 1) {
-        fprintf(stderr, "\ncurl size not 1\n");
-        return 0;
-    }
-
-    if (!ctx->upld_buf) {
-        ctx->upld_buf = calloc(1, ACVP_KAT_BUF_MAX);
-        if (!ctx->upld_buf) {
-            fprintf(stderr, "\nmalloc failed in curl write upld func\n");
-            return 0;
-        }
-    }
-    http_buf = ctx->upld_buf;
-
-    if ((ctx->read_ctr + nmemb) > ACVP_KAT_BUF_MAX) {
-        fprintf(stderr, "\nKAT is too large\n");
-        return 0;
-    }
-
-    memcpy_s(&http_buf[ctx->read_ctr], (ACVP_KAT_BUF_MAX - ctx->read_ctr), ptr, nmemb);
-    http_buf[ctx->read_ctr + nmemb] = 0;
-    ctx->read_ctr += nmemb;
-
-    return nmemb;
-}
-
-/*
- * This is a callback used by curl to send the HTTP body
- * to the application (us).  We will store the HTTP body
- * on the ACVP_CTX in one of the transitory fields.
- */
-static size_t acvp_curl_write_vs_func(void *ptr, size_t size, size_t nmemb, void *userdata) {
-    ACVP_CTX *ctx = (ACVP_CTX *)userdata;
-    char *json_buf;
-
-    if (size != 1) {
-        fprintf(stderr, "\ncurl size not 1\n");
-        return 0;
-    }
-
-    if (!ctx->test_sess_buf) {
-        ctx->test_sess_buf = calloc(1, ACVP_ANS_BUF_MAX);
-        if (!ctx->test_sess_buf) {
-            fprintf(stderr, "\nmalloc failed in curl write ans func\n");
-            return 0;
-        }
-    }
-    json_buf = ctx->test_sess_buf;
-
-    if ((ctx->read_ctr + nmemb) > ACVP_ANS_BUF_MAX) {
-        fprintf(stderr, "\nAnswer response is too large\n");
-        return 0;
-    }
-
-    memcpy_s(&json_buf[ctx->read_ctr], (ACVP_ANS_BUF_MAX - ctx->read_ctr), ptr, nmemb);
-    json_buf[ctx->read_ctr + nmemb] = 0;
-    ctx->read_ctr += nmemb;
-
-    return nmemb;
-}
-
-/*
- * This is a callback used by curl to send the HTTP body
- * to the application (us).  We will store the HTTP body
- * on the ACVP_CTX in one of the transitory fields.
- */
-static size_t acvp_curl_write_sample_func(void *ptr, size_t size, size_t nmemb, void *userdata) {
-    ACVP_CTX *ctx = (ACVP_CTX *)userdata;
-    char *json_buf;
-
-    if (size != 1) {
-        fprintf(stderr, "\ncurl size not 1\n");
-        return 0;
-    }
-
-    if (!ctx->sample_buf) {
-        ctx->sample_buf = calloc(1, ACVP_ANS_BUF_MAX);
-        if (!ctx->sample_buf) {
-            fprintf(stderr, "\nmalloc failed in curl write ans func\n");
-            return 0;
-        }
-    }
-    json_buf = ctx->sample_buf;
-
-    if ((ctx->read_ctr + nmemb) > ACVP_ANS_BUF_MAX) {
-        fprintf(stderr, "\nAnswer response is too large\n");
-        return 0;
-    }
-
-    memcpy_s(&json_buf[ctx->read_ctr], (ACVP_ANS_BUF_MAX - ctx->read_ctr), ptr, nmemb);
-    json_buf[ctx->read_ctr + nmemb] = 0;
-    ctx->read_ctr += nmemb;
-
-    return nmemb;
-}
-
-/*
- * This is a callback used by curl to send the HTTP body
- * to the application (us).  We will store the HTTP body
- * on the ACVP_CTX in one of the transitory fields.
- */
-static size_t acvp_curl_write_kat_func(void *ptr, size_t size, size_t nmemb, void *userdata) {
-    ACVP_CTX *ctx = (ACVP_CTX *)userdata;
-    char *json_buf;
-
-    if (size != 1) {
-        fprintf(stderr, "\ncurl size not 1\n");
-        return 0;
-    }
-
-    if (!ctx->kat_buf) {
-        ctx->kat_buf = calloc(1, ACVP_KAT_BUF_MAX);
-        if (!ctx->kat_buf) {
-            fprintf(stderr, "\nmalloc failed in curl write kat func\n");
-            return 0;
-        }
-    }
-    json_buf = ctx->kat_buf;
-
-    if ((ctx->read_ctr + nmemb) > ACVP_KAT_BUF_MAX) {
-        fprintf(stderr, "\nKAT is too large\n");
-        return 0;
-    }
-
-    memcpy_s(&json_buf[ctx->read_ctr], (ACVP_KAT_BUF_MAX - ctx->read_ctr), ptr, nmemb);
-    json_buf[ctx->read_ctr + nmemb] = 0;
-    ctx->read_ctr += nmemb;
-
-    return nmemb;
-}
-
-/*
- * This is a callback used by curl to send the HTTP body
- * to the application (us).  We will store the HTTP body
- * on the ACVP_CTX in one of the transitory fields.
- */
-static size_t acvp_curl_write_register_func(void *ptr, size_t size, size_t nmemb, void *userdata) {
-    ACVP_CTX *ctx = (ACVP_CTX *)userdata;
-    char *json_buf;
-
-    if (size != 1) {
-        fprintf(stderr, "\ncurl size not 1\n");
-        return 0;
-    }
-
-    if (!ctx->reg_buf) {
-        ctx->reg_buf = calloc(1, ACVP_REG_BUF_MAX);
-        if (!ctx->reg_buf) {
-            fprintf(stderr, "\nmalloc failed in curl write reg func\n");
-            return 0;
-        }
-    }
-    json_buf = ctx->reg_buf;
-
-    if ((ctx->read_ctr + nmemb) > ACVP_REG_BUF_MAX) {
-        fprintf(stderr, "\nRegister response is too large\n");
-        return 0;
-    }
-
-    memcpy_s(&json_buf[ctx->read_ctr], (ACVP_REG_BUF_MAX - ctx->read_ctr), ptr, nmemb);
-    json_buf[ctx->read_ctr + nmemb] = 0;
-    ctx->read_ctr += nmemb;
-
-    return nmemb;
-}
-
 /*
  * This is the internal send function that takes the URI as an extra
  * parameter. This removes repeated code without having to change the
@@ -538,10 +751,10 @@ static ACVP_RESULT acvp_send_internal(ACVP_CTX *ctx, char *data, int data_len, c
         ctx->jwt_token = NULL;
     }
 
-    rv = acvp_curl_http_post(ctx, url, data, data_len, &acvp_curl_write_register_func);
+    rv = acvp_curl_http_post(ctx, NULL, url, data, data_len, &ctx->reg_buf);
     if (rv != HTTP_OK) {
         ACVP_LOG_ERR("Unable to register |%s| with ACVP server. curl rv=%d\n", url, rv);
-        printf("%s", ctx->reg_buf);
+        if (ctx->reg_buf.data) printf("%s", ctx->reg_buf.data);
         return ACVP_TRANSPORT_FAIL;
     }
 
@@ -631,7 +844,7 @@ ACVP_RESULT acvp_send_login(ACVP_CTX *ctx, char *login, int len) {
 #define JWT_EXPIRED_STR_LEN 11
 #define JWT_INVALID_STR "JWT signature does not match"
 #define JWT_INVALID_STR_LEN 28
-static ACVP_RESULT inspect_http_code(ACVP_CTX *ctx, int code) {
+static ACVP_RESULT inspect_http_code(ACVP_CTX *ctx, int code, char *body) {
     ACVP_RESULT result = ACVP_TRANSPORT_FAIL; /* Generic failure */
     JSON_Value *root_value = NULL;
     const JSON_Object *obj = NULL;
@@ -645,10 +858,8 @@ static ACVP_RESULT inspect_http_code(ACVP_CTX *ctx, int code) {
     if (code == HTTP_UNAUTH) {
         int diff = 1;
 
-        if (ctx->sample_buf) {
-            root_value = json_parse_string(ctx->sample_buf);
-        } else if (ctx->kat_buf) {
-            root_value = json_parse_string(ctx->kat_buf);
+        if (body) {
+            root_value = json_parse_string(body);
         }
 
         obj = json_value_get_object(root_value);
@@ -682,27 +893,64 @@ end:
     return result;
 }
 
+/*
+ * Returns the buffer the HTTP body for the given action
+ * is written into.
+ */
+static ACVP_HTTP_BODY *acvp_net_action_body(ACVP_CTX *ctx, ACVP_VS_CTX *vs_ctx, ACVP_NET_ACTION action) {
+    switch(action) {
+    case ACVP_NET_ACTION_GET_RESULT:
+        return &ctx->test_sess_buf;
+    case ACVP_NET_ACTION_GET_SAMPLE:
+        return &ctx->sample_buf;
+    case ACVP_NET_ACTION_GET_VECTOR_SET:
+        return vs_ctx ? &vs_ctx->kat_buf : NULL;
+    case ACVP_NET_ACTION_POST_VECTOR_RESP:
+        return vs_ctx ? &vs_ctx->upld_buf : NULL;
+    }
+    return NULL;
+}
+
 static ACVP_RESULT execute_network_action(ACVP_CTX *ctx,
+                                          ACVP_VS_CTX *vs_ctx,
                                           ACVP_NET_ACTION action,
-                                          char *url,
-                                          void *curl_callback) {
+                                          char *url) {
     ACVP_RESULT result = ACVP_TRANSPORT_FAIL;
-    char *resp = NULL;
-    int resp_len = 0;
+    ACVP_HTTP_BODY *body = NULL;
+    JSON_Stream *stream = NULL;
+    char *resp = NULL, *post_data = NULL;
+    int resp_len = 0, post_len = 0;
     int rc = 0;
 
+    body = acvp_net_action_body(ctx, vs_ctx, action);
+    if (!body) {
+        ACVP_LOG_ERR("Missing vector set context");
+        return ACVP_NO_CTX;
+    }
+    if (action == ACVP_NET_ACTION_GET_VECTOR_SET) {
+        stream = vs_ctx->kat_stream;
+    }
+
     switch(action) {
     case ACVP_NET_ACTION_GET_RESULT:
     case ACVP_NET_ACTION_GET_VECTOR_SET:
     case ACVP_NET_ACTION_GET_SAMPLE:
-        rc = acvp_curl_http_get(ctx, url, curl_callback);
+        rc = acvp_curl_http_get(ctx, vs_ctx, url, body, stream);
         break;
     case ACVP_NET_ACTION_POST_VECTOR_RESP:
-        resp = json_serialize_to_string(ctx->kat_resp, &resp_len);
+        if (vs_ctx->rsp_data) {
+            /* Already serialized by the pipeline's compute stage */
+            post_data = vs_ctx->rsp_data;
+            post_len = vs_ctx->rsp_len;
+        } else {
+            resp = json_serialize_to_string(vs_ctx->kat_resp, &resp_len);
+            post_data = resp;
+            post_len = resp_len;
+        }
 
-        rc = acvp_curl_http_post(ctx, url, resp, resp_len, curl_callback);
-        json_value_free(ctx->kat_resp);
-        ctx->kat_resp = NULL;
+        rc = acvp_curl_http_post(ctx, vs_ctx, url, post_data, post_len, body);
+        json_value_free(vs_ctx->kat_resp);
+        vs_ctx->kat_resp = NULL;
         break;
     default:
         ACVP_LOG_ERR("Unknown ACVP_NET_ACTION");
@@ -710,7 +958,7 @@ static ACVP_RESULT execute_network_action(ACVP_CTX *ctx,
     }
 
     /* Peek at the HTTP code */
-    result = inspect_http_code(ctx, rc);
+    result = inspect_http_code(ctx, rc, body->data);
 
     if (result != ACVP_SUCCESS) {
         if (result == ACVP_JWT_EXPIRED) {
@@ -722,7 +970,13 @@ static ACVP_RESULT execute_network_action(ACVP_CTX *ctx,
             ACVP_LOG_ERR("JWT authorization has timed out, curl rc=%d.\n"
                          "Refreshing session...", rc);
 
-            result = acvp_refresh(ctx);
+            if (vs_ctx) {
+                ACVP_LOCK(acvp_jwt_lock);
+                result = acvp_refresh(ctx);
+                ACVP_UNLOCK(acvp_jwt_lock);
+            } else {
+                result = acvp_refresh(ctx);
+            }
             if (result != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("JWT refresh failed.");
                 goto end;
@@ -733,14 +987,14 @@ static ACVP_RESULT execute_network_action(ACVP_CTX *ctx,
             case ACVP_NET_ACTION_GET_RESULT:
             case ACVP_NET_ACTION_GET_VECTOR_SET:
             case ACVP_NET_ACTION_GET_SAMPLE:
-                rc = acvp_curl_http_get(ctx, url, curl_callback);
+                rc = acvp_curl_http_get(ctx, vs_ctx, url, body, stream);
                 break;
             case ACVP_NET_ACTION_POST_VECTOR_RESP:
-                rc = acvp_curl_http_post(ctx, url, resp, resp_len, curl_callback);
+                rc = acvp_curl_http_post(ctx, vs_ctx, url, post_data, post_len, body);
                 break;
             }
 
-            result = inspect_http_code(ctx, rc);
+            result = inspect_http_code(ctx, rc, body->data);
             if (result != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Refreshed + retried, HTTP transport fails. curl rc=%d\n", rc);
                 goto end;
@@ -765,45 +1019,164 @@ end:
     case ACVP_NET_ACTION_GET_RESULT:
         if (result != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Unable to get vector result from server. curl rc=%d\n", rc);
-            ACVP_LOG_ERR("%s\n", ctx->kat_buf);
         }
         break;
     case ACVP_NET_ACTION_GET_VECTOR_SET:
         if (result != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Unable to get vector set from ACVP server. curl rc=%d\n", rc);
-            ACVP_LOG_ERR("%s\n", ctx->kat_buf);
         }
         break;
     case ACVP_NET_ACTION_GET_SAMPLE:
         if (result != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Unable to get vector result samples from server. curl rc=%d\n", rc);
-            ACVP_LOG_ERR("%s\n", ctx->sample_buf);
         }
         break;
     case ACVP_NET_ACTION_POST_VECTOR_RESP:
         if (result != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Unable to submit vector set responses. curl rc=%d\n", rc);
-            ACVP_LOG_ERR("%s\n", ctx->kat_buf);
         }
         break;
     }
+    if (result != ACVP_SUCCESS && body->data) {
+        ACVP_LOG_ERR("%s\n", body->data);
+    }
 
     if (resp) json_free_serialized_string(resp);
 
     return result;
 }
 
+/*
+ * Performs the one-time global setup of the HTTP layer.  Curl
+ * would otherwise do this lazily on the first handle, which is
+ * not safe once several vector set workers are running.
+ */
+ACVP_RESULT acvp_transport_init(ACVP_CTX *ctx) {
+#ifdef USE_MURL
+    CURL *hnd;
+#endif
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (lib_http_ready) {
+        return ACVP_SUCCESS;
+    }
+
+#ifdef USE_MURL
+    /* Murl initializes OpenSSL when the first handle is created */
+    hnd = curl_easy_init();
+    if (!hnd) {
+        ACVP_LOG_ERR("Unable to initialize murl");
+        return ACVP_TRANSPORT_FAIL;
+    }
+    curl_easy_cleanup(hnd);
+#else
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+        ACVP_LOG_ERR("Unable to initialize curl");
+        return ACVP_TRANSPORT_FAIL;
+    }
+#endif
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Global HTTP setup for acvp_init_lib().  Besides the one-time
+ * initialization this creates the TLS session cache and DNS cache
+ * shared by the handles of every session, and room for the handle
+ * pool when max_conns limits the connections.
+ */
+ACVP_RESULT acvp_transport_lib_init(int max_conns) {
+#ifdef USE_MURL
+    CURL *hnd;
+#endif
+
+    if (max_conns) {
+        lib_hnd_idle = calloc(max_conns, sizeof(CURL *));
+        if (!lib_hnd_idle) {
+            return ACVP_MALLOC_FAIL;
+        }
+    }
+#ifdef USE_MURL
+    hnd = curl_easy_init();
+    if (!hnd) {
+        free(lib_hnd_idle);
+        lib_hnd_idle = NULL;
+        return ACVP_TRANSPORT_FAIL;
+    }
+    curl_easy_cleanup(hnd);
+#else
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+        free(lib_hnd_idle);
+        lib_hnd_idle = NULL;
+        return ACVP_TRANSPORT_FAIL;
+    }
+    lib_http_share = curl_share_init();
+    if (!lib_http_share) {
+        curl_global_cleanup();
+        free(lib_hnd_idle);
+        lib_hnd_idle = NULL;
+        return ACVP_MALLOC_FAIL;
+    }
+    curl_share_setopt(lib_http_share, CURLSHOPT_LOCKFUNC, acvp_share_lock);
+    curl_share_setopt(lib_http_share, CURLSHOPT_UNLOCKFUNC, acvp_share_unlock);
+    curl_share_setopt(lib_http_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(lib_http_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+#endif
+    lib_max_conns = max_conns;
+    lib_http_ready = 1;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Undoes acvp_transport_lib_init().  Every handle using the
+ * shared caches must have been closed, and every pooled handle
+ * given back.
+ */
+void acvp_transport_lib_cleanup(void) {
+    if (!lib_http_ready) {
+        return;
+    }
+    while (lib_hnd_idle_count) {
+        curl_easy_cleanup(lib_hnd_idle[--lib_hnd_idle_count]);
+    }
+    free(lib_hnd_idle);
+    lib_hnd_idle = NULL;
+    lib_hnd_count = 0;
+#ifndef USE_MURL
+    curl_share_cleanup(lib_http_share);
+    lib_http_share = NULL;
+#endif
+    curl_global_cleanup();
+    lib_max_conns = 0;
+    lib_http_ready = 0;
+}
+
+/*
+ * Releases the global HTTP setup done for a single session,
+ * unless acvp_init_lib() owns it.
+ */
+void acvp_transport_global_cleanup(void) {
+    if (lib_http_ready) {
+        return;
+    }
+    curl_global_cleanup();
+}
+
 /*
  * This is the top level function used within libacvp to retrieve
  * a KAT vector set from the ACVP server.
  */
-ACVP_RESULT acvp_retrieve_vector_set(ACVP_CTX *ctx, char *vsid_url) {
+ACVP_RESULT acvp_retrieve_vector_set(ACVP_VS_CTX *vs_ctx, char *vsid_url) {
     char url[ACVP_ATTR_URL_MAX] = {0};
     ACVP_RESULT result = ACVP_SUCCESS;
+    ACVP_CTX *ctx = NULL;
 
-    if (!ctx) {
+    if (!vs_ctx || !vs_ctx->ctx) {
         return ACVP_NO_CTX;
     }
+    ctx = vs_ctx->ctx;
 
     if (!ctx->server_name || !ctx->server_port) {
         ACVP_LOG_ERR("Missing server/port details; call acvp_set_server first");
@@ -820,12 +1193,7 @@ ACVP_RESULT acvp_retrieve_vector_set(ACVP_CTX *ctx, char *vsid_url) {
 
     ACVP_LOG_STATUS("GET %s", url);
 
-    if (ctx->kat_buf) {
-        memzero_s(ctx->kat_buf, ACVP_KAT_BUF_MAX);
-    }
-
-    result = execute_network_action(ctx, ACVP_NET_ACTION_GET_VECTOR_SET,
-                                    url, &acvp_curl_write_kat_func);
+    result = execute_network_action(ctx, vs_ctx, ACVP_NET_ACTION_GET_VECTOR_SET, url);
     if (result != ACVP_SUCCESS) {
         /* Failed to transport */
         ACVP_LOG_ERR("Transport failure.");
@@ -841,31 +1209,32 @@ ACVP_RESULT acvp_retrieve_vector_set(ACVP_CTX *ctx, char *vsid_url) {
  * This function is used to submit a vector set response
  * to the ACV server.
  */
-ACVP_RESULT acvp_submit_vector_responses(ACVP_CTX *ctx) {
+ACVP_RESULT acvp_submit_vector_responses(ACVP_VS_CTX *vs_ctx) {
     char url[ACVP_ATTR_URL_MAX] = {0};
     ACVP_RESULT result = ACVP_SUCCESS;
+    ACVP_CTX *ctx = NULL;
 
-    if (!ctx) {
+    if (!vs_ctx || !vs_ctx->ctx) {
         return ACVP_NO_CTX;
     }
+    ctx = vs_ctx->ctx;
 
     if (!ctx->server_name || !ctx->server_port) {
         ACVP_LOG_ERR("Missing server/port details; call acvp_set_server first");
         return ACVP_MISSING_ARG;
     }
 
-    if (!ctx->vs_id) {
+    if (!vs_ctx->vs_id) {
         ACVP_LOG_ERR("Missing vs_id when trying to submit responses");
         return ACVP_MISSING_ARG;
     }
 
     snprintf(url, ACVP_ATTR_URL_MAX - 1, "https://%s:%d/%s%s/results", ctx->server_name, ctx->server_port,
-             ctx->api_context, ctx->vsid_url);
+             ctx->api_context, vs_ctx->vsid_url);
 
     ACVP_LOG_STATUS("Submitting vector responses to %s", url);
 
-    result = execute_network_action(ctx, ACVP_NET_ACTION_POST_VECTOR_RESP,
-                                    url, &acvp_curl_write_upld_func);
+    result = execute_network_action(ctx, vs_ctx, ACVP_NET_ACTION_POST_VECTOR_RESP, url);
     if (result != ACVP_SUCCESS) {
         /* Failed to transport */
         ACVP_LOG_ERR("Transport failure.");
@@ -903,12 +1272,7 @@ ACVP_RESULT acvp_retrieve_result(ACVP_CTX *ctx, char *api_url) {
     snprintf(url, ACVP_ATTR_URL_MAX - 1, "https://%s:%d/%s%s/results", ctx->server_name, ctx->server_port,
              ctx->api_context, api_url);
 
-    if (ctx->kat_buf) {
-        memzero_s(ctx->kat_buf, ACVP_KAT_BUF_MAX);
-    }
-
-    result = execute_network_action(ctx, ACVP_NET_ACTION_GET_RESULT,
-                                    url, &acvp_curl_write_vs_func);
+    result = execute_network_action(ctx, NULL, ACVP_NET_ACTION_GET_RESULT, url);
     if (result != ACVP_SUCCESS) {
         /* Failed to transport */
         ACVP_LOG_ERR("Transport failure.");
@@ -947,12 +1311,7 @@ ACVP_RESULT acvp_retrieve_expected_result(ACVP_CTX *ctx, char *api_url) {
     snprintf(url, ACVP_ATTR_URL_MAX - 1, "https://%s:%d/%s%s/expected", ctx->server_name, ctx->server_port,
              ctx->api_context, api_url);
 
-    if (ctx->sample_buf) {
-        memzero_s(ctx->sample_buf, ACVP_KAT_BUF_MAX);
-    }
-
-    result = execute_network_action(ctx, ACVP_NET_ACTION_GET_SAMPLE,
-                                    url, &acvp_curl_write_sample_func);
+    result = execute_network_action(ctx, NULL, ACVP_NET_ACTION_GET_SAMPLE, url);
     if (result != ACVP_SUCCESS) {
         /* Failed to transport */
         ACVP_LOG_ERR("Transport failure.");
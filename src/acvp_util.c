@@ -37,9 +37,26 @@
 #include <curl/curl.h>
 #endif
 
-extern ACVP_ALG_HANDLER alg_tbl[];
+/*
+ * Vector hex encode/decode is used when the target has it. SSE2 and NEON
+ * are part of the x86-64 and AArch64 baselines; AVX2 is picked at runtime.
+ * Build with ACVP_NO_SIMD to use only the scalar code.
+ */
+#ifndef ACVP_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64)
+#define ACVP_HEX_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ACVP_HEX_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ACVP_HEX_NEON
+#include <arm_neon.h>
+#endif
+#endif
 
-static int acvp_char_to_int(char ch);
+extern ACVP_ALG_HANDLER alg_tbl[];
 
 /*
  * This is a rudimentary logging facility for libacvp.
@@ -90,7 +107,7 @@ ACVP_RESULT acvp_cleanup(ACVP_CTX *ctx) {
         }
     }
 
-    curl_global_cleanup();
+    acvp_transport_global_cleanup();
 
     return rv;
 }
@@ -100,20 +117,23 @@ ACVP_RESULT acvp_cleanup(ACVP_CTX *ctx) {
  * when a particular crypto operation is needed by libacvp.
  */
 ACVP_CAPS_LIST *acvp_locate_cap_entry(ACVP_CTX *ctx, ACVP_CIPHER cipher) {
-    ACVP_CAPS_LIST *cap;
-
-    if (!ctx || !ctx->caps_list) {
+    if (!ctx || cipher <= ACVP_CIPHER_START || cipher >= ACVP_CIPHER_END) {
         return NULL;
     }
 
-    cap = ctx->caps_list;
-    while (cap) {
-        if (cap->cipher == cipher) {
-            return cap;
-        }
-        cap = cap->next;
+    return ctx->caps_by_cipher[cipher];
+}
+
+/*
+ * alg_tbl[] is dense and in ACVP_CIPHER order, so the entry for a
+ * cipher is alg_tbl[cipher - 1].
+ */
+const ACVP_ALG_HANDLER *acvp_lookup_alg_entry(ACVP_CIPHER alg) {
+    if (alg <= ACVP_CIPHER_START || alg >= ACVP_CIPHER_END ||
+        alg_tbl[alg - 1].cipher != alg) {
+        return NULL;
     }
-    return NULL;
+    return &alg_tbl[alg - 1];
 }
 
 /*
@@ -125,20 +145,108 @@ ACVP_CAPS_LIST *acvp_locate_cap_entry(ACVP_CTX *ctx, ACVP_CIPHER cipher) {
  * note that this API only returns the alg string
  */
 char *acvp_lookup_cipher_name(ACVP_CIPHER alg) {
+    const ACVP_ALG_HANDLER *entry = acvp_lookup_alg_entry(alg);
+
+    return entry ? entry->name : NULL;
+}
+
+/*
+ * Open addressed hash indexes over alg_tbl[], one keyed on the
+ * algorithm name alone (first entry with that name wins, as the old
+ * table scan did) and one keyed on algorithm + mode for the entries
+ * that have a mode.  Slots hold the alg_tbl[] index + 1, 0 is empty.
+ * They are built once per process and only read afterwards.
+ */
+#define ACVP_ALG_INDEX_SLOTS 256
+
+static unsigned short alg_name_index[ACVP_ALG_INDEX_SLOTS];
+static unsigned short alg_mode_index[ACVP_ALG_INDEX_SLOTS];
+ACVP_ONCE_DECLARE(alg_index_once);
+
+/* FNV-1a over the name, a separator, then the mode if there is one */
+static unsigned int acvp_alg_hash(const char *name, const char *mode) {
+    unsigned int h = 2166136261u;
+    int i;
+
+    for (i = 0; i < ACVP_ALG_NAME_MAX && name[i]; i++) {
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    }
+    if (mode) {
+        h = (h ^ 0xff) * 16777619u;
+        for (i = 0; i < ACVP_ALG_MODE_MAX && mode[i]; i++) {
+            h = (h ^ (unsigned char)mode[i]) * 16777619u;
+        }
+    }
+    return h ^ (h >> 16);
+}
+
+static int acvp_alg_entry_matches(int i, const char *name, const char *mode) {
+    int diff = 1;
+
+    strcmp_s(alg_tbl[i].name, ACVP_ALG_NAME_MAX, name, &diff);
+    if (diff) {
+        return 0;
+    }
+    if (!mode) {
+        return 1;
+    }
+    if (!alg_tbl[i].mode) {
+        return 0;
+    }
+    strcmp_s(alg_tbl[i].mode, ACVP_ALG_MODE_MAX, mode, &diff);
+    return !diff;
+}
+
+static void acvp_alg_index_insert(unsigned short *index, int i, const char *mode) {
+    unsigned int slot = acvp_alg_hash(alg_tbl[i].name, mode);
+
+    for (;; slot++) {
+        unsigned short *s = &index[slot % ACVP_ALG_INDEX_SLOTS];
+
+        if (!*s) {
+            *s = (unsigned short)(i + 1);
+            return;
+        }
+        if (acvp_alg_entry_matches(*s - 1, alg_tbl[i].name, mode)) {
+            return; /* keep the first entry with this key */
+        }
+    }
+}
+
+static void acvp_alg_index_build(void) {
     int i;
 
     for (i = 0; i < ACVP_ALG_MAX; i++) {
-        if (alg_tbl[i].cipher == alg) {
-            return alg_tbl[i].name;
+        acvp_alg_index_insert(alg_name_index, i, NULL);
+        if (alg_tbl[i].mode) {
+            acvp_alg_index_insert(alg_mode_index, i, alg_tbl[i].mode);
+        }
+    }
+}
+
+static ACVP_CIPHER acvp_alg_index_find(const unsigned short *index,
+                                       const char *name,
+                                       const char *mode) {
+    unsigned int slot;
+
+    ACVP_ONCE(alg_index_once, acvp_alg_index_build);
+    slot = acvp_alg_hash(name, mode);
+    for (;; slot++) {
+        unsigned short s = index[slot % ACVP_ALG_INDEX_SLOTS];
+
+        if (!s) {
+            return 0;
+        }
+        if (acvp_alg_entry_matches(s - 1, name, mode)) {
+            return alg_tbl[s - 1].cipher;
         }
     }
-    return NULL;
 }
 
 /**
- * @brief Loop through all entries in alg_tbl, trying to match
- *        \p algorithm to each name field. If successful, will
- *        return the ACVP_CIPHER id field.
+ * @brief Find the alg_tbl entry whose name field matches
+ *        \p algorithm. If successful, will return the ACVP_CIPHER
+ *        id field.
  *
  * IMPORTANT: This only works accurately for algorithms that have
  * a 1:1 name to id entry. I.e. does not work for algorithms that
@@ -149,31 +257,17 @@ char *acvp_lookup_cipher_name(ACVP_CIPHER alg) {
  * @return 0 if no-match
  */
 ACVP_CIPHER acvp_lookup_cipher_index(const char *algorithm) {
-    int i = 0;
-
     if (!algorithm) {
         return 0;
     }
 
-    for (i = 0; i < ACVP_ALG_MAX; i++) {
-        int diff = 1;
-
-        strcmp_s(alg_tbl[i].name,
-                 ACVP_ALG_NAME_MAX,
-                 algorithm, &diff);
-
-        if (!diff) {
-            return alg_tbl[i].cipher;
-        }
-    }
-
-    return 0;
+    return acvp_alg_index_find(alg_name_index, algorithm, NULL);
 }
 
 /**
- * @brief Loop through all entries in alg_tbl, trying to match
- *        both \p algorithm and \p mode to their respective fields.
- *        If successful, will return the ACVP_CIPHER id field.
+ * @brief Find the alg_tbl entry matching both \p algorithm and
+ *        \p mode to their respective fields. If successful, will
+ *        return the ACVP_CIPHER id field.
  *
  * Useful for algorithms that have multiple modes (i.e. asymmetric).
  *
@@ -182,33 +276,11 @@ ACVP_CIPHER acvp_lookup_cipher_index(const char *algorithm) {
  */
 ACVP_CIPHER acvp_lookup_cipher_w_mode_index(const char *algorithm,
                                             const char *mode) {
-    int i = 0;
-
     if (!algorithm || !mode) {
         return 0;
     }
 
-    for (i = 0; i < ACVP_ALG_MAX; i++) {
-        int diff = 0;
-
-        if (alg_tbl[i].mode == NULL) continue;
-
-        /* Compare the algorithm string */
-        strcmp_s(alg_tbl[i].name,
-                 ACVP_ALG_NAME_MAX,
-                 algorithm, &diff);
-
-        if (!diff) {
-            /* Compare the mode string */
-            strcmp_s(alg_tbl[i].mode,
-                     ACVP_ALG_MODE_MAX,
-                     mode, &diff);
-
-            if (!diff) return alg_tbl[i].cipher;
-        }
-    }
-
-    return 0;
+    return acvp_alg_index_find(alg_mode_index, algorithm, mode);
 }
 
 /*
@@ -497,15 +569,235 @@ ACVP_EC_CURVE acvp_lookup_ec_curve(ACVP_CIPHER cipher, const char *name) {
     return 0;
 }
 
+/*
+ * Hex nibble conversion without branches or table lookups on the data.
+ * Characters that are not hex digits decode to 0, as they always have.
+ */
+static char acvp_nibble_to_hex(unsigned int n) {
+    /* n > 9 makes (9 - n) wrap, which adds the 7 between '9' and 'A' */
+    return (char)(n + '0' + (((9u - n) >> 8) & 7u));
+}
+
+static unsigned int acvp_hex_to_nibble(unsigned char c) {
+    unsigned int d = (unsigned int)c - '0';
+    unsigned int l = ((unsigned int)c | 0x20) - 'a';
+    unsigned int d_mask = 0u - (unsigned int)(d < 10);
+    unsigned int l_mask = 0u - (unsigned int)(l < 6);
+
+    return (d & d_mask) | ((l + 10) & l_mask);
+}
+
+#ifdef ACVP_HEX_SSE2
+static __m128i acvp_sse2_nibble_to_hex(__m128i n) {
+    __m128i gt9 = _mm_cmpgt_epi8(n, _mm_set1_epi8(9));
+
+    return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')),
+                        _mm_and_si128(gt9, _mm_set1_epi8(7)));
+}
+
+static __m128i acvp_sse2_hex_to_nibble(__m128i c) {
+    __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i l = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i d_mask = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    __m128i l_mask = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+
+    return _mm_or_si128(_mm_and_si128(d, d_mask),
+                        _mm_and_si128(_mm_add_epi8(l, _mm_set1_epi8(10)), l_mask));
+}
+
+/* Returns the number of source bytes encoded; the caller does the tail */
+static int acvp_hex_encode_sse2(const unsigned char *src, int len, char *dest) {
+    int i;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+        __m128i lo = _mm_and_si128(v, _mm_set1_epi8(0x0f));
+
+        hi = acvp_sse2_nibble_to_hex(hi);
+        lo = acvp_sse2_nibble_to_hex(lo);
+        _mm_storeu_si128((__m128i *)(dest + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(dest + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+/*
+ * Decode 32 characters at a time. Viewed as 16-bit lanes each pair of
+ * nibbles is (hi | lo << 8), so (lane << 4 | lane >> 8) leaves the byte
+ * in the low half of the lane, ready for the pack.
+ */
+static int acvp_hex_decode_sse2(const char *src, int len, unsigned char *dest) {
+    __m128i low_byte = _mm_set1_epi16(0x00ff);
+    int i;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        __m128i a = acvp_sse2_hex_to_nibble(_mm_loadu_si128((const __m128i *)(src + 2 * i)));
+        __m128i b = acvp_sse2_hex_to_nibble(_mm_loadu_si128((const __m128i *)(src + 2 * i + 16)));
+
+        a = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(a, 4), _mm_srli_epi16(a, 8)), low_byte);
+        b = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(b, 4), _mm_srli_epi16(b, 8)), low_byte);
+        _mm_storeu_si128((__m128i *)(dest + i), _mm_packus_epi16(a, b));
+    }
+    return i;
+}
+#endif
+
+#ifdef ACVP_HEX_AVX2
+__attribute__((target("avx2")))
+static __m256i acvp_avx2_nibble_to_hex(__m256i n) {
+    __m256i gt9 = _mm256_cmpgt_epi8(n, _mm256_set1_epi8(9));
+
+    return _mm256_add_epi8(_mm256_add_epi8(n, _mm256_set1_epi8('0')),
+                           _mm256_and_si256(gt9, _mm256_set1_epi8(7)));
+}
+
+__attribute__((target("avx2")))
+static __m256i acvp_avx2_hex_to_nibble(__m256i c) {
+    __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i l = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i d_mask = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+    __m256i l_mask = _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+
+    return _mm256_or_si256(_mm256_and_si256(d, d_mask),
+                           _mm256_and_si256(_mm256_add_epi8(l, _mm256_set1_epi8(10)), l_mask));
+}
+
+/*
+ * The AVX2 unpack and pack instructions work within each 128-bit lane,
+ * hence the lane shuffles after them.
+ */
+__attribute__((target("avx2")))
+static int acvp_hex_encode_avx2(const unsigned char *src, int len, char *dest) {
+    int i;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f));
+        __m256i lo = _mm256_and_si256(v, _mm256_set1_epi8(0x0f));
+        __m256i x, y;
+
+        hi = acvp_avx2_nibble_to_hex(hi);
+        lo = acvp_avx2_nibble_to_hex(lo);
+        x = _mm256_unpacklo_epi8(hi, lo);
+        y = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i *)(dest + 2 * i), _mm256_permute2x128_si256(x, y, 0x20));
+        _mm256_storeu_si256((__m256i *)(dest + 2 * i + 32), _mm256_permute2x128_si256(x, y, 0x31));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static int acvp_hex_decode_avx2(const char *src, int len, unsigned char *dest) {
+    __m256i low_byte = _mm256_set1_epi16(0x00ff);
+    int i;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        __m256i a = acvp_avx2_hex_to_nibble(_mm256_loadu_si256((const __m256i *)(src + 2 * i)));
+        __m256i b = acvp_avx2_hex_to_nibble(_mm256_loadu_si256((const __m256i *)(src + 2 * i + 32)));
+
+        a = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi16(a, 4), _mm256_srli_epi16(a, 8)), low_byte);
+        b = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi16(b, 4), _mm256_srli_epi16(b, 8)), low_byte);
+        _mm256_storeu_si256((__m256i *)(dest + i),
+                            _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8));
+    }
+    return i;
+}
+#endif
+
+#ifdef ACVP_HEX_NEON
+static uint8x16_t acvp_neon_nibble_to_hex(uint8x16_t n) {
+    uint8x16_t gt9 = vcgtq_u8(n, vdupq_n_u8(9));
+
+    return vaddq_u8(vaddq_u8(n, vdupq_n_u8('0')), vandq_u8(gt9, vdupq_n_u8(7)));
+}
+
+static uint8x16_t acvp_neon_hex_to_nibble(uint8x16_t c) {
+    uint8x16_t d = vsubq_u8(c, vdupq_n_u8('0'));
+    uint8x16_t l = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+
+    return vorrq_u8(vandq_u8(d, vcltq_u8(d, vdupq_n_u8(10))),
+                    vandq_u8(vaddq_u8(l, vdupq_n_u8(10)), vcltq_u8(l, vdupq_n_u8(6))));
+}
+
+/* vld2/vst2 (de)interleave the high and low nibble characters for us */
+static int acvp_hex_encode_neon(const unsigned char *src, int len, char *dest) {
+    int i;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint8x16x2_t out;
+
+        out.val[0] = acvp_neon_nibble_to_hex(vshrq_n_u8(v, 4));
+        out.val[1] = acvp_neon_nibble_to_hex(vandq_u8(v, vdupq_n_u8(0x0f)));
+        vst2q_u8((uint8_t *)dest + 2 * i, out);
+    }
+    return i;
+}
+
+static int acvp_hex_decode_neon(const char *src, int len, unsigned char *dest) {
+    int i;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        uint8x16x2_t in = vld2q_u8((const uint8_t *)src + 2 * i);
+        uint8x16_t hi = acvp_neon_hex_to_nibble(in.val[0]);
+        uint8x16_t lo = acvp_neon_hex_to_nibble(in.val[1]);
+
+        vst1q_u8(dest + i, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+    }
+    return i;
+}
+#endif
+
+/*
+ * Encode src_len bytes as 2 * src_len hex characters (no terminator).
+ */
+static void acvp_hex_encode(const unsigned char *src, int src_len, char *dest) {
+    int i = 0;
+
+#if defined(ACVP_HEX_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        i = acvp_hex_encode_avx2(src, src_len, dest);
+    }
+#endif
+#if defined(ACVP_HEX_SSE2)
+    i += acvp_hex_encode_sse2(src + i, src_len - i, dest + 2 * i);
+#elif defined(ACVP_HEX_NEON)
+    i = acvp_hex_encode_neon(src, src_len, dest);
+#endif
+    for (; i < src_len; i++) {
+        dest[2 * i] = acvp_nibble_to_hex(src[i] >> 4);
+        dest[2 * i + 1] = acvp_nibble_to_hex(src[i] & 0x0f);
+    }
+}
+
+/*
+ * Decode 2 * len hex characters into len bytes.
+ */
+static void acvp_hex_decode(const char *src, int len, unsigned char *dest) {
+    int i = 0;
+
+#if defined(ACVP_HEX_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        i = acvp_hex_decode_avx2(src, len, dest);
+    }
+#endif
+#if defined(ACVP_HEX_SSE2)
+    i += acvp_hex_decode_sse2(src + 2 * i, len - i, dest + i);
+#elif defined(ACVP_HEX_NEON)
+    i = acvp_hex_decode_neon(src, len, dest);
+#endif
+    for (; i < len; i++) {
+        dest[i] = (unsigned char)((acvp_hex_to_nibble(src[2 * i]) << 4) |
+                                  acvp_hex_to_nibble(src[2 * i + 1]));
+    }
+}
+
 /*
  * Convert a byte array from source to a hexadecimal string which is
  * stored in the destination.
  */
 ACVP_RESULT acvp_bin_to_hexstr(const unsigned char *src, int src_len, char *dest, int dest_max) {
-    int i, j;
-    unsigned char nibb_a, nibb_b;
-    unsigned char hex_chars[] = "0123456789ABCDEF";
-
     if (!src || !dest) {
         return ACVP_MISSING_ARG;
     }
@@ -514,17 +806,8 @@ ACVP_RESULT acvp_bin_to_hexstr(const unsigned char *src, int src_len, char *dest
         return ACVP_DATA_TOO_LARGE;
     }
 
-    for (i = 0, j = 0; i < src_len; i++, j += 2) {
-        nibb_a = *src >> 4;   /* Get first half of byte */
-        nibb_b = *src & 0x0f; /* Get second half of byte */
-
-        *dest = hex_chars[nibb_a];
-        *(dest + 1) = hex_chars[nibb_b];
-
-        dest += 2;
-        src++;
-    }
-    *dest = '\0';
+    acvp_hex_encode(src, src_len, dest);
+    dest[src_len * 2] = '\0';
 
     return ACVP_SUCCESS;
 }
@@ -569,72 +852,51 @@ ACVP_RESULT acvp_bin_to_bit(const unsigned char *in, int len, unsigned char *out
 
 /*
  * Convert a source hexadecimal string to a byte array which is stored
- * in the destination.
- * TODO: Enable the function to handle odd number of hex characters
+ * in the destination. An odd number of hex characters is read as a
+ * value with a leading zero nibble, i.e. "abc" becomes 0x0a 0xbc.
  */
 ACVP_RESULT acvp_hexstr_to_bin(const char *src, unsigned char *dest, int dest_max, int *converted_len) {
-    int src_len;
-    int byte_a, byte_b;
-    int is_odd = 0;
+    int src_len, max_len;
     int length_converted = 0;
 
     if (!src || !dest) {
         return ACVP_INVALID_ARG;
     }
 
-    src_len = strnlen_s((char *)src, ACVP_HEXSTR_MAX);
+    /*
+     * Only scan as far as needed to tell whether the hex value fits
+     * in dest, rather than out to ACVP_HEXSTR_MAX every time.
+     */
+    if (dest_max < 0) {
+        max_len = 0;
+    } else if (dest_max < (ACVP_HEXSTR_MAX / 2)) {
+        max_len = 2 * dest_max;
+    } else {
+        max_len = ACVP_HEXSTR_MAX;
+    }
+    src_len = strnlen_s((char *)src, max_len < ACVP_HEXSTR_MAX ? max_len + 1 : ACVP_HEXSTR_MAX);
 
     /*
      * Make sure the hex value isn't too large
      */
-    if (src_len > (2 * dest_max)) {
+    if (src_len > max_len) {
         return ACVP_DATA_TOO_LARGE;
     }
 
     if (src_len & 1) {
-        is_odd = 1;
+        *dest = (unsigned char)acvp_hex_to_nibble(*src);
+        dest++;
+        src++;
+        length_converted++;
     }
 
-    if (!is_odd) {
-        while (*src && src[1]) {
-            byte_a = acvp_char_to_int((char)*src) << 4; /* Shift to left half of byte */
-            byte_b = acvp_char_to_int(*(src + 1));
-
-            *dest = byte_a + byte_b; /* Combine left half with right half */
-
-            dest++;
-            src += 2;
-            length_converted++;
-        }
-    } else {
-        return ACVP_UNSUPPORTED_OP;
-    }
+    acvp_hex_decode(src, src_len / 2, dest);
+    length_converted += src_len / 2;
 
     if (converted_len) *converted_len = length_converted;
     return ACVP_SUCCESS;
 }
 
-/*
- * Local - helper function for acvp_hexstring_to_bytes
- * Used to convert a hexadecimal character to it's byte
- * representation.
- */
-static int acvp_char_to_int(char ch) {
-    int ch_i;
-
-    if (ch >= '0' && ch <= '9') {
-        ch_i = ch - '0';
-    } else if (ch >= 'A' && ch <= 'F') {
-        ch_i = ch - 'A' + 10;
-    } else if (ch >= 'a' && ch <= 'f') {
-        ch_i = ch - 'a' + 10;
-    } else {
-        ch_i = 0;
-    }
-
-    return ch_i;
-}
-
 /*
  * This function is used to locate the callback function that's needed
  * when a particular crypto operation is needed by libacvp.
@@ -726,7 +988,9 @@ char *acvp_lookup_error_string(ACVP_RESULT rv) {
         { ACVP_DUP_CIPHER,         "Duplicate cipher, may have already registered"    },
         { ACVP_TOTP_DECODE_FAIL,   "Failed to base64 decode TOTP seed"                },
         { ACVP_TOTP_MISSING_SEED,  "Missing TOTP seed"                                },
-        { ACVP_DUPLICATE_CTX,      "ctx already initialized"                          }
+        { ACVP_DUPLICATE_CTX,      "ctx already initialized"                          },
+        { ACVP_CANCELLED,          "Test session processing was cancelled"            },
+        { ACVP_IN_PROGRESS,        "Test session processing is still running"         }
     };
 
     for (i = 0; i < ACVP_RESULT_MAX - 1; i++) {
@@ -752,6 +1016,21 @@ void ctr64_inc(unsigned char *counter) {
     } while (n);
 }
 
+/*
+ * Adds len bytes at p to the running checksum sum, which starts
+ * at ACVP_CHECKSUM_INIT (64-bit FNV-1a).  Good for telling damaged
+ * or different data apart, not against tampering.
+ */
+unsigned long long acvp_checksum(unsigned long long sum, const void *p, size_t len) {
+    const unsigned char *b = p;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        sum = (sum ^ b[i]) * 1099511628211ULL;
+    }
+    return sum;
+}
+
 /* increment counter (128-bit int) by 1 */
 void ctr128_inc(unsigned char *counter) {
     unsigned int n = 16, c = 1;
@@ -776,20 +1055,20 @@ void acvp_free_kv_list(ACVP_KV_LIST *kv_list) {
     }
 }
 
-ACVP_RESULT acvp_setup_json_rsp_group(ACVP_CTX **ctx,
+ACVP_RESULT acvp_setup_json_rsp_group(ACVP_VS_CTX *vs_ctx,
                                       JSON_Value **outer_arr_val,
                                       JSON_Value **r_vs_val,
                                       JSON_Object **r_vs,
                                       const char *alg_str,
                                       JSON_Array **groups_arr) {
-    if ((*ctx)->kat_resp) {
-        json_value_free((*ctx)->kat_resp);
+    if (vs_ctx->kat_resp) {
+        json_value_free(vs_ctx->kat_resp);
     }
-    (*ctx)->kat_resp = *outer_arr_val;
+    vs_ctx->kat_resp = *outer_arr_val;
     *r_vs_val = json_value_init_object();
     *r_vs = json_value_get_object(*r_vs_val);
 
-    json_object_set_number(*r_vs, "vsId", (*ctx)->vs_id);
+    json_object_set_number(*r_vs, "vsId", vs_ctx->vs_id);
     json_object_set_string(*r_vs, "algorithm", alg_str);
     /*
      * create an array of response test groups
@@ -807,3 +1086,410 @@ void acvp_release_json(JSON_Value *r_vs_val,
     if (r_vs_val) json_value_free(r_vs_val);
 }
 
+
+/*
+ * Arena allocator.  Chunks carry their bookkeeping in front of
+ * the memory they hand out, allocations are aligned for any type.
+ */
+#define ACVP_ARENA_ALIGN 16
+#define ACVP_ARENA_ROUND(n) (((n) + ACVP_ARENA_ALIGN - 1) & ~((size_t)ACVP_ARENA_ALIGN - 1))
+
+struct acvp_arena_chunk_t {
+    ACVP_ARENA_CHUNK *next;
+    size_t size;  /* usable bytes */
+    size_t used;
+};
+
+#define ACVP_ARENA_HDR_LEN ACVP_ARENA_ROUND(sizeof(ACVP_ARENA_CHUNK))
+#define ACVP_ARENA_DATA(chunk) ((unsigned char *)(chunk) + ACVP_ARENA_HDR_LEN)
+
+void *acvp_arena_alloc(ACVP_ARENA *arena, size_t size) {
+    ACVP_ARENA_CHUNK *chunk = NULL;
+    size_t chunk_size = ACVP_ARENA_CHUNK_MIN;
+    void *ptr = NULL;
+
+    if (!arena) {
+        return NULL;
+    }
+    size = ACVP_ARENA_ROUND(size ? size : 1);
+    chunk = arena->chunks;
+    if (!chunk || chunk->size - chunk->used < size) {
+        /*
+         * Grow geometrically so a large vector set needs only
+         * a handful of chunks.
+         */
+        if (chunk && chunk->size * 2 > chunk_size) {
+            chunk_size = chunk->size * 2;
+        }
+        if (size > chunk_size) {
+            chunk_size = size;
+        }
+        chunk = malloc(ACVP_ARENA_HDR_LEN + chunk_size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+    ptr = ACVP_ARENA_DATA(chunk) + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+void *acvp_arena_calloc(ACVP_ARENA *arena, size_t nmemb, size_t size) {
+    void *ptr = NULL;
+
+    if (size && nmemb > (size_t)-1 / size) {
+        return NULL;
+    }
+    ptr = acvp_arena_alloc(arena, nmemb * size);
+    if (ptr) {
+        memset(ptr, 0, nmemb * size);
+    }
+    return ptr;
+}
+
+/*
+ * Allocates a test case field from the test case arena.  The buffer
+ * is as long as the decoded hex value or min_len bytes, whichever is
+ * larger, rather than the largest value the algorithm allows, and
+ * only the bytes past the decoded value are zeroed.  hex may be NULL
+ * for an output field; unless the test case tells the module how much
+ * room the field has, pass max_len as min_len so the module can write
+ * as much as it always could.  max_len is the limit the old fixed size
+ * buffer enforced; longer values fail with ACVP_DATA_TOO_LARGE.
+ * The decoded length is returned in len, if given.
+ */
+ACVP_RESULT acvp_tc_buf(ACVP_VS_CTX *vs_ctx,
+                        const char *hex,
+                        int min_len,
+                        int max_len,
+                        unsigned char **buf,
+                        int *len_out) {
+    int hex_len = 0, len = 0, size;
+    unsigned char *p = NULL;
+    ACVP_RESULT rv;
+
+    if (!vs_ctx || !buf) {
+        return ACVP_INVALID_ARG;
+    }
+    if (hex) {
+        hex_len = strnlen_s(hex, 2 * max_len + 1);
+        if (hex_len > 2 * max_len) {
+            return ACVP_DATA_TOO_LARGE;
+        }
+        len = (hex_len + 1) / 2;
+    }
+    size = len > min_len ? len : min_len;
+    if (size > max_len) {
+        return ACVP_DATA_TOO_LARGE;
+    }
+
+    /* Modules check the pointers, so never hand back NULL for an empty field */
+    p = acvp_arena_alloc(&vs_ctx->tc_arena, size ? size : 1);
+    if (!p) {
+        return ACVP_MALLOC_FAIL;
+    }
+    if (hex) {
+        rv = acvp_hexstr_to_bin(hex, p, len, NULL);
+        if (rv != ACVP_SUCCESS) {
+            return rv;
+        }
+    }
+    memset(p + len, 0, (size ? size : 1) - len);
+    *buf = p;
+    if (len_out) *len_out = len;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * acvp_tc_buf() for the member name of obj.  If the parser already
+ * decoded the member (the hex_fields of its alg_tbl[] entry) and it
+ * needs no padding to min_len, the decoded bytes are handed back in
+ * place instead of being copied.  Those bytes belong to the JSON of
+ * the vector set, so this is only for fields acvp.h documents as
+ * read only for the module.
+ */
+ACVP_RESULT acvp_tc_hex(ACVP_VS_CTX *vs_ctx,
+                        JSON_Object *obj,
+                        const char *name,
+                        int min_len,
+                        int max_len,
+                        unsigned char **buf,
+                        int *len_out) {
+    const unsigned char *bin = NULL;
+    size_t len = 0;
+
+    if (!vs_ctx || !buf) {
+        return ACVP_INVALID_ARG;
+    }
+    bin = json_object_get_hex(obj, name, &len);
+    if (bin && len <= (size_t)max_len && (int)len >= min_len) {
+        *buf = (unsigned char *)bin;
+        if (len_out) *len_out = (int)len;
+        return ACVP_SUCCESS;
+    }
+    return acvp_tc_buf(vs_ctx, json_object_get_string(obj, name), min_len, max_len, buf, len_out);
+}
+
+/*
+ * Hands back everything allocated from the arena.  The largest
+ * chunk is kept, so an arena reused for similar sized vector sets
+ * stops calling malloc after the first one.
+ */
+void acvp_arena_reset(ACVP_ARENA *arena) {
+    ACVP_ARENA_CHUNK *chunk = NULL, *next = NULL, *keep = NULL;
+
+    if (!arena) {
+        return;
+    }
+    for (chunk = arena->chunks; chunk; chunk = chunk->next) {
+        if (!keep || chunk->size > keep->size) {
+            keep = chunk;
+        }
+    }
+    for (chunk = arena->chunks; chunk; chunk = next) {
+        next = chunk->next;
+        if (chunk != keep) {
+            free(chunk);
+        }
+    }
+    if (keep) {
+        keep->used = 0;
+        keep->next = NULL;
+    }
+    arena->chunks = keep;
+}
+
+void acvp_arena_free(ACVP_ARENA *arena) {
+    ACVP_ARENA_CHUNK *chunk = NULL, *next = NULL;
+
+    if (!arena) {
+        return;
+    }
+    for (chunk = arena->chunks; chunk; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+    arena->chunks = NULL;
+}
+
+/*
+ * parson only has process wide allocation hooks, so the arena the
+ * hooks allocate from is looked up per thread.  Threads without one
+ * (the application, session level requests) get plain malloc/free.
+ */
+#ifdef WIN32
+static ACVP_ARENA *acvp_json_arena;
+
+static ACVP_ARENA *acvp_json_arena_get(void) {
+    return acvp_json_arena;
+}
+#else
+static pthread_key_t acvp_json_arena_key;
+static pthread_once_t acvp_json_arena_once = PTHREAD_ONCE_INIT;
+
+static ACVP_ARENA *acvp_json_arena_get(void) {
+    return pthread_getspecific(acvp_json_arena_key);
+}
+#endif
+
+/*
+ * Every JSON allocation is preceded by the arena it came from, NULL
+ * for the heap, so a free knows what to do whichever arena the
+ * thread has set by then.  parson needs no more than pointer and
+ * double alignment.
+ */
+typedef union acvp_json_tag_t {
+    ACVP_ARENA *arena;
+    double align;
+} ACVP_JSON_TAG;
+
+static void *acvp_json_malloc(size_t size) {
+    ACVP_ARENA *arena = acvp_json_arena_get();
+    ACVP_JSON_TAG *tag = NULL;
+
+    if (size > (size_t)-1 - sizeof(ACVP_JSON_TAG)) {
+        return NULL;
+    }
+    if (arena) {
+        tag = acvp_arena_alloc(arena, sizeof(ACVP_JSON_TAG) + size);
+    } else {
+        tag = malloc(sizeof(ACVP_JSON_TAG) + size);
+    }
+    if (!tag) {
+        return NULL;
+    }
+    tag->arena = arena;
+    return tag + 1;
+}
+
+static void acvp_json_free(void *ptr) {
+    ACVP_JSON_TAG *tag = NULL;
+
+    if (!ptr) {
+        return;
+    }
+    /* Memory from an arena goes back with acvp_arena_reset() */
+    tag = (ACVP_JSON_TAG *)ptr - 1;
+    if (!tag->arena) {
+        free(tag);
+    }
+}
+
+static void acvp_json_arena_init(void) {
+#ifndef WIN32
+    pthread_key_create(&acvp_json_arena_key, NULL);
+#endif
+    json_set_allocation_functions(acvp_json_malloc, acvp_json_free);
+}
+
+/*
+ * Installs the JSON allocation hooks.  Memory parson allocated before
+ * couldn't be freed through them, so this runs when the first ctx is
+ * created, before libacvp builds or parses any JSON.
+ */
+void acvp_json_init(void) {
+#ifdef WIN32
+    static int initialized = 0;
+
+    if (!initialized) {
+        acvp_json_arena_init();
+        initialized = 1;
+    }
+#else
+    pthread_once(&acvp_json_arena_once, acvp_json_arena_init);
+#endif
+}
+
+/*
+ * Routes the JSON allocations of the calling thread to arena, or
+ * back to the heap when arena is NULL.  Returns the arena that was
+ * set before so callers can restore it.  JSON allocated from an arena
+ * can be freed at any time, which does nothing, but must not be used
+ * once the arena has been reset.
+ */
+ACVP_ARENA *acvp_json_arena_set(ACVP_ARENA *arena) {
+    ACVP_ARENA *prev = NULL;
+
+    acvp_json_init();
+#ifdef WIN32
+    prev = acvp_json_arena;
+    acvp_json_arena = arena;
+#else
+    prev = pthread_getspecific(acvp_json_arena_key);
+    pthread_setspecific(acvp_json_arena_key, arena);
+#endif
+    return prev;
+}
+
+/*
+ * Opens the module's vector set context.  Groups of a streamed
+ * vector set are dispatched one at a time, so this only calls the
+ * hook for the first of them.
+ */
+ACVP_RESULT acvp_module_vs_begin(ACVP_VS_CTX *vs_ctx, ACVP_CIPHER cipher) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+
+    if (vs_ctx->module_vs_open) {
+        return ACVP_SUCCESS;
+    }
+    vs_ctx->module_cipher = cipher;
+    vs_ctx->module_vs_ctx = NULL;
+    if (ctx->vs_begin_cb) {
+        if ((ctx->vs_begin_cb)(cipher, &vs_ctx->module_vs_ctx)) {
+            ACVP_LOG_ERR("crypto module failed to begin the vector set");
+            return ACVP_CRYPTO_MODULE_FAIL;
+        }
+    }
+    vs_ctx->module_vs_open = 1;
+    return ACVP_SUCCESS;
+}
+
+void acvp_module_vs_end(ACVP_VS_CTX *vs_ctx) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+
+    /* A handler that bailed out mid-group leaves the group open */
+    acvp_module_group_end(vs_ctx);
+    if (!vs_ctx->module_vs_open) {
+        return;
+    }
+    if (ctx->vs_end_cb) {
+        (ctx->vs_end_cb)(vs_ctx->module_cipher, vs_ctx->module_vs_ctx);
+    }
+    vs_ctx->module_vs_ctx = NULL;
+    vs_ctx->module_vs_open = 0;
+}
+
+/*
+ * Opens the module's context for the next test group and
+ * points the handler's test case at both module contexts.
+ */
+ACVP_RESULT acvp_module_group_begin(ACVP_VS_CTX *vs_ctx, ACVP_TEST_CASE *tc) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+
+    acvp_module_group_end(vs_ctx);
+    vs_ctx->module_group_ctx = NULL;
+    if (ctx->group_begin_cb) {
+        if ((ctx->group_begin_cb)(vs_ctx->module_cipher, vs_ctx->module_vs_ctx,
+                                  &vs_ctx->module_group_ctx)) {
+            ACVP_LOG_ERR("crypto module failed to begin the test group");
+            return ACVP_CRYPTO_MODULE_FAIL;
+        }
+    }
+    vs_ctx->module_group_open = 1;
+    tc->module_vs_ctx = vs_ctx->module_vs_ctx;
+    tc->module_group_ctx = vs_ctx->module_group_ctx;
+    return ACVP_SUCCESS;
+}
+
+void acvp_module_group_end(ACVP_VS_CTX *vs_ctx) {
+    ACVP_CTX *ctx = vs_ctx->ctx;
+
+    if (!vs_ctx->module_group_open) {
+        return;
+    }
+    if (ctx->group_end_cb) {
+        (ctx->group_end_cb)(vs_ctx->module_cipher, vs_ctx->module_vs_ctx,
+                            vs_ctx->module_group_ctx);
+    }
+    vs_ctx->module_group_ctx = NULL;
+    vs_ctx->module_group_open = 0;
+}
+
+/*
+ * Sets up an empty batch for a test group of up to max test
+ * cases.  The batch is released with the test case arena.
+ */
+ACVP_RESULT acvp_tc_batch_init(ACVP_VS_CTX *vs_ctx, ACVP_TC_BATCH *batch, int max) {
+    int i;
+
+    batch->count = 0;
+    batch->tcs = acvp_arena_calloc(&vs_ctx->tc_arena, max ? max : 1, sizeof(ACVP_TEST_CASE));
+    batch->results = acvp_arena_calloc(&vs_ctx->tc_arena, max ? max : 1, sizeof(int));
+    if (!batch->tcs || !batch->results) {
+        return ACVP_MALLOC_FAIL;
+    }
+    for (i = 0; i < max; i++) {
+        batch->tcs[i].module_vs_ctx = vs_ctx->module_vs_ctx;
+        batch->tcs[i].module_group_ctx = vs_ctx->module_group_ctx;
+    }
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Hands the collected test cases to the module in one call
+ */
+ACVP_RESULT acvp_tc_batch_run(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TC_BATCH *batch) {
+    if (!batch->count) {
+        return ACVP_SUCCESS;
+    }
+    ACVP_LOG_INFO("Passing %d test cases to the batch handler", batch->count);
+    if ((cap->batch_handler)(batch->tcs, batch->results, batch->count)) {
+        ACVP_LOG_ERR("ERROR: crypto module failed the batch operation");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+    return ACVP_SUCCESS;
+}
@@ -42,6 +42,9 @@
 
 #define STARTING_CAPACITY 16
 #define MAX_NESTING       2048
+#define OBJECT_INDEX_MIN  8    /* objects with this many names get a hash index */
+
+#define SERIALIZATION_STARTING_CAPACITY 1024
 
 #define FLOAT_FORMAT "%1.17g" /* do not increase precision without incresing NUM_BUF_SIZE */
 #define NUM_BUF_SIZE 64 /* double printed with "%1.17g" shouldn't be longer than 25 bytes so let's be paranoid and use 64 */
@@ -51,6 +54,12 @@
 #define SKIP_WHITESPACES(str) while (isspace((unsigned char)(**str))) { SKIP_CHAR(str); }
 #define MAX(a, b)             ((a) > (b) ? (a) : (b))
 
+/* Decoded hex bytes are kept in front of their string, padded so the string
+   and the bytes are both aligned as the allocator left them */
+#define HEX_ALIGN             16
+#define HEX_ROUND(n)          (((n) + HEX_ALIGN - 1) & ~((size_t)HEX_ALIGN - 1))
+#define HEX_BYTES(value)      ((unsigned char*)(value)->value.string - HEX_ROUND((size_t)(value)->hex_len))
+
 #define STRING_VALUE_MAX 8000000 /* SAFEC arbitrarily set max string value to 8 MB */
 #define STRING_NAME_MAX 128 /* SAFEC arbitrarily set max limit for 'name' string */
 
@@ -81,15 +90,19 @@ typedef union json_value_value {
 struct json_value_t {
     JSON_Value      *parent;
     JSON_Value_Type  type;
+    int              hex_len; /* strings only: bytes decoded by the stream parser, -1 if not decoded */
     JSON_Value_Value value;
 };
 
 struct json_object_t {
-    JSON_Value  *wrapping_value;
-    char       **names;
-    JSON_Value **values;
-    size_t       count;
-    size_t       capacity;
+    JSON_Value    *wrapping_value;
+    char         **names;
+    JSON_Value   **values;
+    unsigned long *hashes;     /* hash of each name, same order as names */
+    size_t        *cells;      /* open addressing index into names (index + 1, 0 is empty) */
+    size_t         cell_count; /* power of two, 0 while the object has no index */
+    size_t         count;
+    size_t         capacity;
 };
 
 struct json_array_t {
@@ -99,6 +112,78 @@ struct json_array_t {
     size_t       capacity;
 };
 
+/* Object or array the incremental parser is currently inside of */
+typedef struct json_stream_frame_t {
+    JSON_Value *value;    /* not yet attached to its parent */
+    char       *key;      /* name waiting for its value (objects only) */
+    int         streamed; /* elements go to the callback instead of the array */
+} JSON_Stream_Frame;
+
+enum json_stream_state {
+    STREAM_VALUE,       /* expecting a value */
+    STREAM_FIRST_VALUE, /* expecting a value or ']' */
+    STREAM_KEY,         /* expecting a name */
+    STREAM_FIRST_KEY,   /* expecting a name or '}' */
+    STREAM_COLON,       /* expecting ':' */
+    STREAM_NEXT,        /* expecting ',' or the end of the container */
+    STREAM_DONE         /* top level value complete */
+};
+
+enum json_stream_token {
+    STREAM_TOKEN_NONE,
+    STREAM_TOKEN_STRING,
+    STREAM_TOKEN_SCALAR /* number, true, false or null */
+};
+
+struct json_stream_t {
+    char                 *stream_name;
+    JSON_Stream_Callback  callback;
+    void                 *callback_arg;
+    JSON_Stream_Frame    *frames;
+    size_t                depth;
+    size_t                frames_capacity;
+    JSON_Value           *root;
+    int                   state;
+    int                   failed;
+    int                   token;
+    int                   token_is_key;
+    int                   escaped;
+    char                 *token_buf;
+    size_t                token_len;
+    size_t                token_capacity;
+    JSON_Hex_Callback     hex_callback;
+    void                 *hex_callback_arg;
+};
+
+/* Destination of a serialization pass: counts only (buf NULL, not growable),
+ * fills a caller supplied buffer, or grows its own buffer as it goes */
+typedef struct json_writer_t {
+    char   *buf;
+    size_t  len;
+    size_t  capacity;
+    int     growable;
+} JSON_Writer;
+
+/* Tags of the binary form, each followed by what the comment says */
+enum json_binary_tag {
+    BINARY_NULL = 1,
+    BINARY_FALSE,
+    BINARY_TRUE,
+    BINARY_NUMBER,    /* double */
+    BINARY_STRING,    /* length, characters */
+    BINARY_HEX_UPPER, /* number of digits, decoded bytes */
+    BINARY_HEX_LOWER, /* same, for a string written in lower case */
+    BINARY_OBJECT,    /* count, then name length, name, '\0' and value for each */
+    BINARY_ARRAY      /* count, then the values */
+};
+
+/* Input of json_parse_binary */
+typedef struct json_binary_reader_t {
+    const unsigned char *buf;
+    size_t               len;
+    size_t               pos;
+} JSON_Binary_Reader;
+
 /* Various */
 static char * read_file(const char *filename);
 #if 0
@@ -114,6 +199,7 @@ static int    num_bytes_in_utf8_sequence(unsigned char c);
 static int    verify_utf8_sequence(const unsigned char *string, int *len);
 static int    is_valid_utf8(const char *string, size_t string_len);
 static int    is_decimal(const char *string, size_t length);
+static unsigned long hash_string(const char *string, size_t n);
 
 /* JSON Object */
 static JSON_Object * json_object_init(JSON_Value *wrapping_value);
@@ -121,6 +207,8 @@ static JSON_Status   json_object_add(JSON_Object *object, const char *name, JSON
 static JSON_Status   json_object_addn(JSON_Object *object, const char *name, size_t name_len, JSON_Value *value);
 static JSON_Status   json_object_resize(JSON_Object *object, size_t new_capacity);
 static JSON_Value  * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len);
+static size_t        json_object_find(const JSON_Object *object, const char *name, size_t name_len, unsigned long hash);
+static JSON_Status   json_object_reindex(JSON_Object *object);
 static JSON_Status   json_object_remove_internal(JSON_Object *object, const char *name, int free_value);
 static JSON_Status   json_object_dotremove_internal(JSON_Object *object, const char *name, int free_value);
 static void          json_object_free(JSON_Object *object);
@@ -147,11 +235,33 @@ static JSON_Value * parse_number_value(const char **string);
 static JSON_Value * parse_null_value(const char **string);
 static JSON_Value * parse_value(const char **string, size_t nesting);
 
+/* Incremental parser */
+static JSON_Status  stream_token_append(JSON_Stream *stream, const char *chars, size_t n);
+static JSON_Status  stream_start_token(JSON_Stream *stream, int token, int is_key);
+static JSON_Status  stream_push(JSON_Stream *stream, JSON_Value *value);
+static JSON_Status  stream_pop(JSON_Stream *stream);
+static JSON_Status  stream_add_value(JSON_Stream *stream, JSON_Value *value);
+static int          stream_wants_hex(JSON_Stream *stream);
+static JSON_Status  stream_hex_value(const char *hex, size_t len, JSON_Value **value);
+static JSON_Status  stream_end_token(JSON_Stream *stream);
+static JSON_Status  stream_structural(JSON_Stream *stream, char c);
+
 /* Serialization */
-static int    json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int level, int is_pretty, char *num_buf);
-static int    json_serialize_string(const char *string, char *buf);
-static int    append_indent(char *buf, int level);
-static int    append_string(char *buf, const char *string);
+static JSON_Status json_writer_append(JSON_Writer *writer, const char *chars, size_t n);
+static JSON_Status json_serialize_to_writer_r(const JSON_Value *value, JSON_Writer *writer, int level, int is_pretty, char *num_buf);
+static JSON_Status json_serialize_string(const char *string, JSON_Writer *writer);
+static JSON_Status append_indent(JSON_Writer *writer, int level);
+static char *      json_serialize_to_string_internal(const JSON_Value *value, int *len, int is_pretty);
+
+/* Binary serialization */
+static JSON_Status binary_append_length(JSON_Writer *writer, size_t len);
+static int         binary_hex_case(const char *string, size_t len);
+static JSON_Status binary_append_hex(JSON_Writer *writer, const JSON_Value *value, size_t len);
+static JSON_Status json_serialize_to_binary_r(const JSON_Value *value, JSON_Writer *writer);
+static JSON_Status binary_read(JSON_Binary_Reader *reader, void *out, size_t n);
+static JSON_Status binary_read_length(JSON_Binary_Reader *reader, size_t *len);
+static JSON_Value * parse_binary_hex(JSON_Binary_Reader *reader, int lower);
+static JSON_Value * parse_binary_value(JSON_Binary_Reader *reader, size_t nesting);
 
 /* Various */
 static char * parson_strndup(const char *string, size_t n) {
@@ -293,6 +403,15 @@ static int is_decimal(const char *string, size_t length) {
     return 1;
 }
 
+static unsigned long hash_string(const char *string, size_t n) {
+    unsigned long hash = 5381;
+    size_t i;
+    for (i = 0; i < n && string[i] != '\0'; i++) {
+        hash = ((hash << 5) + hash) + (unsigned char)string[i]; /* djb2 */
+    }
+    return hash;
+}
+
 static char * read_file(const char * filename) {
     FILE *fp = fopen(filename, "r");
     size_t size_to_read = 0;
@@ -372,6 +491,9 @@ static JSON_Object * json_object_init(JSON_Value *wrapping_value) {
     new_obj->wrapping_value = wrapping_value;
     new_obj->names = (char**)NULL;
     new_obj->values = (JSON_Value**)NULL;
+    new_obj->hashes = (unsigned long*)NULL;
+    new_obj->cells = (size_t*)NULL;
+    new_obj->cell_count = 0;
     new_obj->capacity = 0;
     new_obj->count = 0;
     return new_obj;
@@ -385,11 +507,13 @@ static JSON_Status json_object_add(JSON_Object *object, const char *name, JSON_V
 }
 
 static JSON_Status json_object_addn(JSON_Object *object, const char *name, size_t name_len, JSON_Value *value) {
-    size_t index = 0;
+    size_t index = 0, cell = 0;
+    unsigned long hash = 0;
     if (object == NULL || name == NULL || value == NULL) {
         return JSONFailure;
     }
-    if (json_object_getn_value(object, name, name_len) != NULL) {
+    hash = hash_string(name, name_len);
+    if (json_object_find(object, name, name_len, hash) != object->count) {
         return JSONFailure;
     }
     if (object->count >= object->capacity) {
@@ -405,13 +529,64 @@ static JSON_Status json_object_addn(JSON_Object *object, const char *name, size_
     }
     value->parent = json_object_get_wrapping_value(object);
     object->values[index] = value;
+    object->hashes[index] = hash;
     object->count++;
+    if (object->cell_count == 0 && object->count < OBJECT_INDEX_MIN) {
+        return JSONSuccess;
+    }
+    if (object->count * 2 > object->cell_count) {
+        /* no index yet, or it is getting full */
+        if (json_object_reindex(object) == JSONFailure) {
+            object->count--;
+            parson_free(object->names[index]);
+            return JSONFailure;
+        }
+        return JSONSuccess;
+    }
+    cell = hash & (object->cell_count - 1);
+    while (object->cells[cell] != 0) {
+        cell = (cell + 1) & (object->cell_count - 1);
+    }
+    object->cells[cell] = index + 1;
+    return JSONSuccess;
+}
+
+/* Rebuilds the hash index from scratch, sized for the current count */
+static JSON_Status json_object_reindex(JSON_Object *object) {
+    size_t *new_cells = NULL;
+    size_t new_cell_count = 0, i = 0, cell = 0;
+    if (object->count < OBJECT_INDEX_MIN) {
+        parson_free(object->cells);
+        object->cells = NULL;
+        object->cell_count = 0;
+        return JSONSuccess;
+    }
+    new_cell_count = OBJECT_INDEX_MIN * 2;
+    while (new_cell_count < object->count * 4) {
+        new_cell_count *= 2;
+    }
+    new_cells = (size_t*)parson_malloc(new_cell_count * sizeof(size_t));
+    if (new_cells == NULL) {
+        return JSONFailure;
+    }
+    memzero_s(new_cells, new_cell_count * sizeof(size_t)); /* SAFEC */
+    for (i = 0; i < object->count; i++) {
+        cell = object->hashes[i] & (new_cell_count - 1);
+        while (new_cells[cell] != 0) {
+            cell = (cell + 1) & (new_cell_count - 1);
+        }
+        new_cells[cell] = i + 1;
+    }
+    parson_free(object->cells);
+    object->cells = new_cells;
+    object->cell_count = new_cell_count;
     return JSONSuccess;
 }
 
 static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity) {
     char **temp_names = NULL;
     JSON_Value **temp_values = NULL;
+    unsigned long *temp_hashes = NULL;
 
     if ((object->names == NULL && object->values != NULL) ||
         (object->names != NULL && object->values == NULL) ||
@@ -427,60 +602,101 @@ static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity)
         parson_free(temp_names);
         return JSONFailure;
     }
+    temp_hashes = (unsigned long*)parson_malloc(new_capacity * sizeof(unsigned long));
+    if (temp_hashes == NULL) {
+        parson_free(temp_names);
+        parson_free(temp_values);
+        return JSONFailure;
+    }
     if (object->names != NULL && object->values != NULL && object->count > 0) {
         /* SAFEC */
         memcpy_s(temp_names, new_capacity * sizeof(char*),
                  object->names, object->count * sizeof(char*));
         memcpy_s(temp_values, new_capacity * sizeof(JSON_Value*),
                  object->values, object->count * sizeof(JSON_Value*));
+        memcpy_s(temp_hashes, new_capacity * sizeof(unsigned long),
+                 object->hashes, object->count * sizeof(unsigned long));
     }
     parson_free(object->names);
     parson_free(object->values);
+    parson_free(object->hashes);
     object->names = temp_names;
     object->values = temp_values;
+    object->hashes = temp_hashes;
     object->capacity = new_capacity;
     return JSONSuccess;
 }
 
 static JSON_Value * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len) {
-    size_t i, name_length;
+    size_t index;
+    if (object == NULL) {
+        return NULL;
+    }
+    index = json_object_find(object, name, name_len, hash_string(name, name_len));
+    return index < object->count ? object->values[index] : NULL;
+}
+
+/* Returns the position of name in object, or object->count if it isn't there.
+   Only names with a matching hash are compared. */
+static size_t json_object_find(const JSON_Object *object, const char *name, size_t name_len, unsigned long hash) {
+    size_t i = 0, cell = 0;
     int diff = 1;
-    for (i = 0; i < json_object_get_count(object); i++) {
-        name_length = strnlen_s(object->names[i], STRING_NAME_MAX);
-        if (name_length != name_len) {
-            continue;
+    if (object->cell_count == 0) {
+        for (i = 0; i < object->count; i++) {
+            if (object->hashes[i] != hash ||
+                strnlen_s(object->names[i], STRING_NAME_MAX) != name_len) {
+                continue;
+            }
+            strcmp_s(name, name_len, object->names[i], &diff); /* SAFEC */
+            if (!diff) {
+                return i;
+            }
         }
-        strcmp_s(name, name_len, object->names[i], &diff); /* SAFEC */
-        if (!diff) {
-            return object->values[i];
+        return object->count;
+    }
+    cell = hash & (object->cell_count - 1);
+    while (object->cells[cell] != 0) {
+        i = object->cells[cell] - 1;
+        if (object->hashes[i] == hash &&
+            strnlen_s(object->names[i], STRING_NAME_MAX) == name_len) {
+            strcmp_s(name, name_len, object->names[i], &diff); /* SAFEC */
+            if (!diff) {
+                return i;
+            }
         }
+        cell = (cell + 1) & (object->cell_count - 1);
     }
-    return NULL;
+    return object->count;
 }
 
 static JSON_Status json_object_remove_internal(JSON_Object *object, const char *name, int free_value) {
-    size_t i = 0, last_item_index = 0;
-    if (object == NULL || json_object_get_value(object, name) == NULL) {
+    size_t i = 0, last_item_index = 0, name_len = 0;
+    if (object == NULL || name == NULL) {
         return JSONFailure;
     }
-    last_item_index = json_object_get_count(object) - 1;
-    for (i = 0; i < json_object_get_count(object); i++) {
-        int diff = 1;
-        strcmp_s(object->names[i], STRING_NAME_MAX, name, &diff); /* SAFEC */
-        if (!diff) {
-            parson_free(object->names[i]);
-            if (free_value) {
-                json_value_free(object->values[i]);
-            }
-            if (i != last_item_index) { /* Replace key value pair with one from the end */
-                object->names[i] = object->names[last_item_index];
-                object->values[i] = object->values[last_item_index];
-            }
-            object->count -= 1;
-            return JSONSuccess;
-        }
+    name_len = strnlen_s(name, STRING_NAME_MAX);
+    i = json_object_find(object, name, name_len, hash_string(name, name_len));
+    if (i == object->count) {
+        return JSONFailure;
+    }
+    last_item_index = object->count - 1;
+    parson_free(object->names[i]);
+    if (free_value) {
+        json_value_free(object->values[i]);
     }
-    return JSONFailure; /* No execution path should end here */
+    if (i != last_item_index) { /* Replace key value pair with one from the end */
+        object->names[i] = object->names[last_item_index];
+        object->values[i] = object->values[last_item_index];
+        object->hashes[i] = object->hashes[last_item_index];
+    }
+    object->count -= 1;
+    if (object->cell_count && json_object_reindex(object) == JSONFailure) {
+        /* fall back to scanning rather than keep a stale index */
+        parson_free(object->cells);
+        object->cells = NULL;
+        object->cell_count = 0;
+    }
+    return JSONSuccess;
 }
 
 static JSON_Status json_object_dotremove_internal(JSON_Object *object, const char *name, int free_value) {
@@ -512,6 +728,8 @@ static void json_object_free(JSON_Object *object) {
     }
     parson_free(object->names);
     parson_free(object->values);
+    parson_free(object->hashes);
+    parson_free(object->cells);
     parson_free(object);
 }
 
@@ -577,6 +795,7 @@ static JSON_Value * json_value_init_string_no_copy(char *string) {
     }
     new_value->parent = NULL;
     new_value->type = JSONString;
+    new_value->hex_len = -1;
     new_value->value.string = string;
     return new_value;
 }
@@ -905,18 +1124,360 @@ static JSON_Value * parse_null_value(const char **string) {
     return NULL;
 }
 
+/* Incremental parser */
+static JSON_Status stream_token_append(JSON_Stream *stream, const char *chars, size_t n) {
+    char *new_buf = NULL;
+    size_t new_capacity = 0;
+    if (stream->token_len + n >= STRING_VALUE_MAX) {
+        return JSONFailure;
+    }
+    if (stream->token_len + n + 1 > stream->token_capacity) {
+        new_capacity = MAX(stream->token_capacity * 2, STARTING_CAPACITY);
+        while (new_capacity < stream->token_len + n + 1) {
+            new_capacity *= 2;
+        }
+        new_buf = (char*)parson_malloc(new_capacity);
+        if (new_buf == NULL) {
+            return JSONFailure;
+        }
+        if (stream->token_len > 0) {
+            memcpy_s(new_buf, new_capacity, stream->token_buf, stream->token_len); /* SAFEC */
+        }
+        parson_free(stream->token_buf);
+        stream->token_buf = new_buf;
+        stream->token_capacity = new_capacity;
+    }
+    if (n > 0) {
+        memcpy_s(stream->token_buf + stream->token_len, stream->token_capacity - stream->token_len, chars, n); /* SAFEC */
+        stream->token_len += n;
+    }
+    stream->token_buf[stream->token_len] = '\0';
+    return JSONSuccess;
+}
+
+static JSON_Status stream_start_token(JSON_Stream *stream, int token, int is_key) {
+    stream->token = token;
+    stream->token_is_key = is_key;
+    stream->escaped = 0;
+    stream->token_len = 0;
+    return stream_token_append(stream, NULL, 0);
+}
+
+static JSON_Status stream_push(JSON_Stream *stream, JSON_Value *value) {
+    JSON_Stream_Frame *new_frames = NULL, *parent = NULL;
+    size_t new_capacity = 0;
+    int diff = 1;
+    if (stream->depth >= MAX_NESTING) {
+        return JSONFailure;
+    }
+    if (stream->depth == stream->frames_capacity) {
+        new_capacity = MAX(stream->frames_capacity * 2, STARTING_CAPACITY);
+        new_frames = (JSON_Stream_Frame*)parson_malloc(new_capacity * sizeof(JSON_Stream_Frame));
+        if (new_frames == NULL) {
+            return JSONFailure;
+        }
+        if (stream->depth > 0) {
+            memcpy_s(new_frames, new_capacity * sizeof(JSON_Stream_Frame),
+                     stream->frames, stream->depth * sizeof(JSON_Stream_Frame)); /* SAFEC */
+        }
+        parson_free(stream->frames);
+        stream->frames = new_frames;
+        stream->frames_capacity = new_capacity;
+    }
+    if (stream->depth > 0) {
+        parent = &stream->frames[stream->depth - 1];
+    }
+    stream->frames[stream->depth].value = value;
+    stream->frames[stream->depth].key = NULL;
+    stream->frames[stream->depth].streamed = 0;
+    if (stream->stream_name && parent && parent->key &&
+        json_value_get_type(value) == JSONArray) {
+        strcmp_s(stream->stream_name, STRING_NAME_MAX, parent->key, &diff); /* SAFEC */
+        stream->frames[stream->depth].streamed = !diff;
+    }
+    stream->depth++;
+    return JSONSuccess;
+}
+
+static JSON_Status stream_pop(JSON_Stream *stream) {
+    JSON_Value *value = stream->frames[stream->depth - 1].value;
+    JSON_Status status = JSONSuccess;
+    stream->depth--;
+    if (json_value_get_type(value) == JSONObject) {
+        if (json_object_get_count(json_value_get_object(value)) > 0) {
+            status = json_object_resize(json_value_get_object(value), json_object_get_count(json_value_get_object(value)));
+        }
+    } else if (json_array_get_count(json_value_get_array(value)) > 0) {
+        status = json_array_resize(json_value_get_array(value), json_array_get_count(json_value_get_array(value)));
+    }
+    if (status == JSONFailure) {
+        json_value_free(value);
+        return JSONFailure;
+    }
+    return stream_add_value(stream, value);
+}
+
+/* Hands a complete value to its container, or to the callback when the
+   container is streamed. Takes ownership of value in all cases. */
+static JSON_Status stream_add_value(JSON_Stream *stream, JSON_Value *value) {
+    JSON_Stream_Frame *parent = NULL;
+    if (stream->depth == 0) {
+        stream->root = value;
+        stream->state = STREAM_DONE;
+        return JSONSuccess;
+    }
+    parent = &stream->frames[stream->depth - 1];
+    if (parent->streamed) {
+        /* streamed arrays are always held by an object one frame down */
+        if (stream->callback(json_value_get_object(stream->frames[stream->depth - 2].value),
+                             value, stream->callback_arg)) {
+            return JSONFailure;
+        }
+    } else if (json_value_get_type(parent->value) == JSONObject) {
+        if (json_object_add(json_value_get_object(parent->value), parent->key, value) == JSONFailure) {
+            json_value_free(value);
+            return JSONFailure;
+        }
+        parson_free(parent->key);
+        parent->key = NULL;
+    } else if (json_array_add(json_value_get_array(parent->value), value) == JSONFailure) {
+        json_value_free(value);
+        return JSONFailure;
+    }
+    stream->state = STREAM_NEXT;
+    return JSONSuccess;
+}
+
+/* Asks the hex callback about the string member just parsed */
+static int stream_wants_hex(JSON_Stream *stream) {
+    JSON_Stream_Frame *parent = NULL;
+    if (stream->hex_callback == NULL || stream->token_is_key || stream->depth == 0) {
+        return 0;
+    }
+    parent = &stream->frames[stream->depth - 1];
+    if (parent->key == NULL || json_value_get_type(parent->value) != JSONObject) {
+        return 0;
+    }
+    return stream->hex_callback(stream, parent->key, stream->hex_callback_arg);
+}
+
+/* Value of a character isxdigit() accepted, without branching on it */
+#define HEX_NIBBLE(c) (((c) & 0xF) + 9 * (((c) >> 6) & 1))
+
+/* Copies a string of hex digits together with the bytes it decodes to (an odd
+   number of digits starts with a lone nibble). Leaves *value NULL if the string
+   is not all hex digits, so it can be parsed as any other string. */
+static JSON_Status stream_hex_value(const char *hex, size_t len, JSON_Value **value) {
+    const unsigned char *in = (const unsigned char*)hex;
+    size_t bin_len = (len + 1) / 2, i = 0, j = 0;
+    unsigned char *bin = NULL;
+    char *string = NULL;
+    int is_hex = 1;
+    *value = NULL;
+    for (i = 0; i < len; i++) {
+        is_hex &= isxdigit(in[i]) != 0;
+    }
+    if (!is_hex) {
+        return JSONSuccess;
+    }
+    bin = (unsigned char*)parson_malloc(HEX_ROUND(bin_len) + len + 1);
+    if (bin == NULL) {
+        return JSONFailure;
+    }
+    i = 0;
+    if (len & 1) {
+        bin[j++] = (unsigned char)HEX_NIBBLE(in[0]);
+        i = 1;
+    }
+    for (; i < len; i += 2) {
+        bin[j++] = (unsigned char)((HEX_NIBBLE(in[i]) << 4) | HEX_NIBBLE(in[i + 1]));
+    }
+    string = (char*)bin + HEX_ROUND(bin_len);
+    if (len > 0) {
+        memcpy_s(string, len + 1, hex, len); /* SAFEC */
+    }
+    string[len] = '\0';
+    *value = json_value_init_string_no_copy(string);
+    if (*value == NULL) {
+        parson_free(bin);
+        return JSONFailure;
+    }
+    (*value)->hex_len = (int)bin_len;
+    return JSONSuccess;
+}
+
+static JSON_Status stream_end_token(JSON_Stream *stream) {
+    JSON_Value *value = NULL;
+    const char *end = stream->token_buf;
+    char *string = NULL;
+    int token = stream->token;
+    stream->token = STREAM_TOKEN_NONE;
+    if (token == STREAM_TOKEN_STRING) {
+        if (stream_wants_hex(stream)) {
+            if (stream_hex_value(stream->token_buf, stream->token_len, &value) == JSONFailure) {
+                return JSONFailure;
+            }
+            if (value != NULL) {
+                return stream_add_value(stream, value);
+            }
+        }
+        string = process_string(stream->token_buf, stream->token_len);
+        if (string == NULL) {
+            return JSONFailure;
+        }
+        if (stream->token_is_key) {
+            stream->frames[stream->depth - 1].key = string;
+            stream->state = STREAM_COLON;
+            return JSONSuccess;
+        }
+        value = json_value_init_string_no_copy(string);
+        if (value == NULL) {
+            parson_free(string);
+            return JSONFailure;
+        }
+        return stream_add_value(stream, value);
+    }
+    switch (stream->token_buf[0]) {
+        case 't': case 'f':
+            value = parse_boolean_value(&end);
+            break;
+        case 'n':
+            value = parse_null_value(&end);
+            break;
+        default:
+            value = parse_number_value(&end);
+            break;
+    }
+    if (value == NULL) {
+        return JSONFailure;
+    }
+    if ((size_t)(end - stream->token_buf) != stream->token_len) {
+        json_value_free(value);
+        return JSONFailure;
+    }
+    return stream_add_value(stream, value);
+}
+
+/* Handles one character outside of any string, number or literal */
+static JSON_Status stream_structural(JSON_Stream *stream, char c) {
+    JSON_Value *value = NULL;
+    JSON_Value_Type top_type = JSONError;
+    if (isspace((unsigned char)c)) {
+        return JSONSuccess;
+    }
+    if (stream->depth > 0) {
+        top_type = json_value_get_type(stream->frames[stream->depth - 1].value);
+    }
+    switch (stream->state) {
+        case STREAM_FIRST_VALUE:
+            if (c == ']') {
+                return stream_pop(stream);
+            }
+            /* fall through */
+        case STREAM_VALUE:
+            switch (c) {
+                case '{':
+                case '[':
+                    value = c == '{' ? json_value_init_object() : json_value_init_array();
+                    if (value == NULL) {
+                        return JSONFailure;
+                    }
+                    if (stream_push(stream, value) == JSONFailure) {
+                        json_value_free(value);
+                        return JSONFailure;
+                    }
+                    stream->state = c == '{' ? STREAM_FIRST_KEY : STREAM_FIRST_VALUE;
+                    return JSONSuccess;
+                case '\"':
+                    return stream_start_token(stream, STREAM_TOKEN_STRING, 0);
+                case 'f': case 't': case 'n': case '-':
+                case '0': case '1': case '2': case '3': case '4':
+                case '5': case '6': case '7': case '8': case '9':
+                    if (stream_start_token(stream, STREAM_TOKEN_SCALAR, 0) == JSONFailure) {
+                        return JSONFailure;
+                    }
+                    return stream_token_append(stream, &c, 1);
+                default:
+                    return JSONFailure;
+            }
+        case STREAM_FIRST_KEY:
+            if (c == '}') {
+                return stream_pop(stream);
+            }
+            /* fall through */
+        case STREAM_KEY:
+            if (c != '\"') {
+                return JSONFailure;
+            }
+            return stream_start_token(stream, STREAM_TOKEN_STRING, 1);
+        case STREAM_COLON:
+            if (c != ':') {
+                return JSONFailure;
+            }
+            stream->state = STREAM_VALUE;
+            return JSONSuccess;
+        case STREAM_NEXT:
+            if (c == ',') {
+                stream->state = top_type == JSONObject ? STREAM_KEY : STREAM_VALUE;
+                return JSONSuccess;
+            }
+            if ((c == '}' && top_type == JSONObject) || (c == ']' && top_type == JSONArray)) {
+                return stream_pop(stream);
+            }
+            return JSONFailure;
+        case STREAM_DONE:
+            /* Like json_parse_string, anything after the first value is ignored */
+            return JSONSuccess;
+        default:
+            return JSONFailure;
+    }
+}
+
 /* Serialization */
-#define APPEND_STRING(str) do { written = append_string(buf, (str));\
-                                if (written < 0) { return -1; }\
-                                if (buf != NULL) { buf += written; }\
-                                written_total += written; } while(0)
+#define APPEND_STRING(str) do { if (json_writer_append(writer, (str), SIZEOF_TOKEN(str)) != JSONSuccess) {\
+                                    return JSONFailure; } } while(0)
 
-#define APPEND_INDENT(level) do { written = append_indent(buf, (level));\
-                                  if (written < 0) { return -1; }\
-                                  if (buf != NULL) { buf += written; }\
-                                  written_total += written; } while(0)
+#define APPEND_INDENT(level) do { if (append_indent(writer, (level)) != JSONSuccess) {\
+                                      return JSONFailure; } } while(0)
 
-static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int level, int is_pretty, char *num_buf)
+/* Characters json_serialize_string has to escape */
+#define NEEDS_ESCAPE(c) ((unsigned char)(c) < 0x20 || (c) == '\"' || (c) == '\\' || (c) == '/')
+
+static JSON_Status json_writer_append(JSON_Writer *writer, const char *chars, size_t n) {
+    char *new_buf = NULL;
+    size_t new_capacity = 0;
+    if (writer->buf == NULL && !writer->growable) {
+        writer->len += n;
+        return JSONSuccess;
+    }
+    /* one byte is always kept free for the terminating NULL */
+    if (writer->len + n + 1 > writer->capacity) {
+        if (!writer->growable) {
+            return JSONFailure;
+        }
+        new_capacity = MAX(writer->capacity * 2, SERIALIZATION_STARTING_CAPACITY);
+        while (new_capacity < writer->len + n + 1) {
+            new_capacity *= 2;
+        }
+        new_buf = (char*)parson_malloc(new_capacity);
+        if (new_buf == NULL) {
+            return JSONFailure;
+        }
+        if (writer->len > 0) {
+            memcpy_s(new_buf, new_capacity, writer->buf, writer->len); /* SAFEC */
+        }
+        parson_free(writer->buf);
+        writer->buf = new_buf;
+        writer->capacity = new_capacity;
+    }
+    if (n > 0) {
+        memcpy_s(writer->buf + writer->len, writer->capacity - writer->len, chars, n); /* SAFEC */
+        writer->len += n;
+    }
+    return JSONSuccess;
+}
+
+static JSON_Status json_serialize_to_writer_r(const JSON_Value *value, JSON_Writer *writer, int level, int is_pretty, char *num_buf)
 {
     const char *key = NULL, *string = NULL;
     JSON_Value *temp_value = NULL;
@@ -924,7 +1485,7 @@ static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int le
     JSON_Object *object = NULL;
     size_t i = 0, count = 0;
     double num = 0.0;
-    int written = -1, written_total = 0;
+    int written = -1;
 
     switch (json_value_get_type(value)) {
         case JSONArray:
@@ -939,14 +1500,9 @@ static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int le
                     APPEND_INDENT(level+1);
                 }
                 temp_value = json_array_get_value(array, i);
-                written = json_serialize_to_buffer_r(temp_value, buf, level+1, is_pretty, num_buf);
-                if (written < 0) {
-                    return -1;
-                }
-                if (buf != NULL) {
-                    buf += written;
+                if (json_serialize_to_writer_r(temp_value, writer, level+1, is_pretty, num_buf) != JSONSuccess) {
+                    return JSONFailure;
                 }
-                written_total += written;
                 if (i < (count - 1)) {
                     APPEND_STRING(",");
                 }
@@ -958,7 +1514,7 @@ static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int le
                 APPEND_INDENT(level);
             }
             APPEND_STRING("]");
-            return written_total;
+            return JSONSuccess;
         case JSONObject:
             object = json_value_get_object(value);
             count  = json_object_get_count(object);
@@ -969,32 +1525,23 @@ static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int le
             for (i = 0; i < count; i++) {
                 key = json_object_get_name(object, i);
                 if (key == NULL) {
-                    return -1;
+                    return JSONFailure;
                 }
                 if (is_pretty) {
                     APPEND_INDENT(level+1);
                 }
-                written = json_serialize_string(key, buf);
-                if (written < 0) {
-                    return -1;
-                }
-                if (buf != NULL) {
-                    buf += written;
+                if (json_serialize_string(key, writer) != JSONSuccess) {
+                    return JSONFailure;
                 }
-                written_total += written;
                 APPEND_STRING(":");
                 if (is_pretty) {
                     APPEND_STRING(" ");
                 }
-                temp_value = json_object_get_value(object, key);
-                written = json_serialize_to_buffer_r(temp_value, buf, level+1, is_pretty, num_buf);
-                if (written < 0) {
-                    return -1;
-                }
-                if (buf != NULL) {
-                    buf += written;
+                /* by position, a lookup by name would hash the key again */
+                temp_value = object->values[i];
+                if (json_serialize_to_writer_r(temp_value, writer, level+1, is_pretty, num_buf) != JSONSuccess) {
+                    return JSONFailure;
                 }
-                written_total += written;
                 if (i < (count - 1)) {
                     APPEND_STRING(",");
                 }
@@ -1006,63 +1553,57 @@ static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int le
                 APPEND_INDENT(level);
             }
             APPEND_STRING("}");
-            return written_total;
+            return JSONSuccess;
         case JSONString:
             string = json_value_get_string(value);
             if (string == NULL) {
-                return -1;
-            }
-            written = json_serialize_string(string, buf);
-            if (written < 0) {
-                return -1;
-            }
-            if (buf != NULL) {
-                buf += written;
+                return JSONFailure;
             }
-            written_total += written;
-            return written_total;
+            return json_serialize_string(string, writer);
         case JSONBoolean:
             if (json_value_get_boolean(value)) {
                 APPEND_STRING("true");
             } else {
                 APPEND_STRING("false");
             }
-            return written_total;
+            return JSONSuccess;
         case JSONNumber:
             num = json_value_get_number(value);
-            if (buf != NULL) {
-                num_buf = buf;
-            }
             written = sprintf(num_buf, FLOAT_FORMAT, num);
             if (written < 0) {
-                return -1;
-            }
-            if (buf != NULL) {
-                buf += written;
+                return JSONFailure;
             }
-            written_total += written;
-            return written_total;
+            return json_writer_append(writer, num_buf, (size_t)written);
         case JSONNull:
             APPEND_STRING("null");
-            return written_total;
+            return JSONSuccess;
         case JSONError:
-            return -1;
+            return JSONFailure;
         default:
-            return -1;
+            return JSONFailure;
     }
 }
 
-static int json_serialize_string(const char *string, char *buf) {
-    size_t i = 0, len = 0;
-    char c = '\0';
-    int written = -1, written_total = 0;
+static JSON_Status json_serialize_string(const char *string, JSON_Writer *writer) {
+    size_t i = 0, len = 0, run_start = 0;
 
     len = strnlen_s(string, STRING_VALUE_MAX); /* SAFEC */
 
     APPEND_STRING("\"");
-    for (i = 0; i < len; i++) {
-        c = string[i];
-        switch (c) {
+    while (i < len) {
+        /* hex strings make up most of a response, copy plain runs at once */
+        run_start = i;
+        while (i < len && !NEEDS_ESCAPE(string[i])) {
+            i++;
+        }
+        if (i > run_start &&
+            json_writer_append(writer, string + run_start, i - run_start) != JSONSuccess) {
+            return JSONFailure;
+        }
+        if (i == len) {
+            break;
+        }
+        switch (string[i]) {
             case '\"': APPEND_STRING("\\\""); break;
             case '\\': APPEND_STRING("\\\\"); break;
             case '/':  APPEND_STRING("\\/"); break; /* to make json embeddable in xml\/html */
@@ -1104,36 +1645,43 @@ static int json_serialize_string(const char *string, char *buf) {
             case '\x1e': APPEND_STRING("\\u001e"); break;
             case '\x1f': APPEND_STRING("\\u001f"); break;
             default:
-                if (buf != NULL) {
-                    buf[0] = c;
-                    buf += 1;
-                }
-                written_total += 1;
-                break;
+                return JSONFailure;
         }
+        i++;
     }
     APPEND_STRING("\"");
-    return written_total;
+    return JSONSuccess;
 }
 
-static int append_indent(char *buf, int level) {
+static JSON_Status append_indent(JSON_Writer *writer, int level) {
     int i;
-    int written = -1, written_total = 0;
     for (i = 0; i < level; i++) {
         APPEND_STRING("    ");
     }
-    return written_total;
-}
-
-static int append_string(char *buf, const char *string) {
-    if (buf == NULL) {
-        return (int)strnlen_s(string, STRING_VALUE_MAX); /* SAFEC */
-    }
-    return sprintf(buf, "%s", string);
+    return JSONSuccess;
 }
 
 #undef APPEND_STRING
 #undef APPEND_INDENT
+#undef NEEDS_ESCAPE
+
+/* Serializes in a single pass, growing the output as needed instead of
+ * sizing it with a separate walk first */
+static char * json_serialize_to_string_internal(const JSON_Value *value, int *len, int is_pretty) {
+    char num_buf[NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
+    JSON_Writer writer = { NULL, 0, 0, 1 };
+    if (json_serialize_to_writer_r(value, &writer, 0, is_pretty, num_buf) != JSONSuccess ||
+        json_writer_append(&writer, NULL, 0) != JSONSuccess) {
+        parson_free(writer.buf);
+        return NULL;
+    }
+    writer.buf[writer.len] = '\0';
+    if (len != NULL) {
+        /* The user wants to be provided with the string length (ommitting the NULL byte) */
+        *len = (int)writer.len;
+    }
+    return writer.buf;
+}
 
 /* Parser API */
 JSON_Value * json_parse_file(const char *filename) {
@@ -1187,6 +1735,144 @@ JSON_Value * json_parse_string_with_comments(const char *string) {
 }
 #endif
 
+JSON_Stream * json_stream_init(const char *stream_name, JSON_Stream_Callback callback, void *arg) {
+    JSON_Stream *stream = NULL;
+    if (stream_name && callback == NULL) {
+        return NULL;
+    }
+    stream = (JSON_Stream*)parson_malloc(sizeof(JSON_Stream));
+    if (stream == NULL) {
+        return NULL;
+    }
+    memzero_s(stream, sizeof(JSON_Stream)); /* SAFEC */
+    if (stream_name) {
+        stream->stream_name = parson_strndup(stream_name, strnlen_s(stream_name, STRING_NAME_MAX));
+        if (stream->stream_name == NULL) {
+            parson_free(stream);
+            return NULL;
+        }
+    }
+    stream->callback = callback;
+    stream->callback_arg = arg;
+    stream->state = STREAM_VALUE;
+    stream->token = STREAM_TOKEN_NONE;
+    return stream;
+}
+
+void json_stream_set_hex_callback(JSON_Stream *stream, JSON_Hex_Callback callback, void *arg) {
+    if (stream == NULL) {
+        return;
+    }
+    stream->hex_callback = callback;
+    stream->hex_callback_arg = arg;
+}
+
+const char * json_stream_get_outer_string(const JSON_Stream *stream, const char *name) {
+    const char *string = NULL;
+    size_t i;
+    if (stream == NULL || stream->depth < 2) {
+        return NULL;
+    }
+    for (i = stream->depth - 1; i-- > 0;) {
+        string = json_object_get_string(json_value_get_object(stream->frames[i].value), name);
+        if (string != NULL) {
+            return string;
+        }
+    }
+    return NULL;
+}
+
+JSON_Status json_stream_feed(JSON_Stream *stream, const char *chunk, size_t len) {
+    size_t i = 0, run = 0;
+    char c;
+    if (stream == NULL || stream->failed || (chunk == NULL && len > 0)) {
+        return JSONFailure;
+    }
+    while (i < len) {
+        c = chunk[i];
+        if (stream->token == STREAM_TOKEN_STRING) {
+            run = 1;
+            if (stream->escaped) {
+                stream->escaped = 0;
+            } else if (c == '\\') {
+                stream->escaped = 1;
+            } else if (c == '\"') {
+                i++;
+                if (stream_end_token(stream) == JSONFailure) {
+                    goto fail;
+                }
+                continue;
+            } else {
+                /* copy the whole run of plain characters at once */
+                while (i + run < len && chunk[i + run] != '\"' && chunk[i + run] != '\\') {
+                    run++;
+                }
+            }
+            if (stream_token_append(stream, chunk + i, run) == JSONFailure) {
+                goto fail;
+            }
+            i += run;
+            continue;
+        }
+        if (stream->token == STREAM_TOKEN_SCALAR) {
+            if (isalnum((unsigned char)c) || c == '-' || c == '+' || c == '.') {
+                if (stream_token_append(stream, &c, 1) == JSONFailure) {
+                    goto fail;
+                }
+                i++;
+                continue;
+            }
+            if (stream_end_token(stream) == JSONFailure) {
+                goto fail;
+            }
+        }
+        if (stream_structural(stream, c) == JSONFailure) {
+            goto fail;
+        }
+        i++;
+    }
+    return JSONSuccess;
+fail:
+    stream->failed = 1;
+    return JSONFailure;
+}
+
+JSON_Value * json_stream_finish(JSON_Stream *stream) {
+    JSON_Value *root = NULL;
+    if (stream == NULL || stream->failed) {
+        return NULL;
+    }
+    /* a number at the very end of the input has nothing after it to end it */
+    if (stream->token == STREAM_TOKEN_SCALAR && stream_end_token(stream) == JSONFailure) {
+        stream->failed = 1;
+        return NULL;
+    }
+    if (stream->state != STREAM_DONE) {
+        return NULL;
+    }
+    root = stream->root;
+    stream->root = NULL;
+    return root;
+}
+
+void json_stream_free(JSON_Stream *stream) {
+    size_t i;
+    if (stream == NULL) {
+        return;
+    }
+    for (i = 0; i < stream->depth; i++) {
+        json_value_free(stream->frames[i].value);
+        parson_free(stream->frames[i].key);
+    }
+    if (stream->root) {
+        json_value_free(stream->root);
+    }
+    parson_free(stream->frames);
+    parson_free(stream->token_buf);
+    parson_free(stream->stream_name);
+    parson_free(stream);
+}
+
 /* JSON Object API */
 
 JSON_Value * json_object_get_value(const JSON_Object *object, const char *name) {
@@ -1200,6 +1886,10 @@ const char * json_object_get_string(const JSON_Object *object, const char *name)
     return json_value_get_string(json_object_get_value(object, name));
 }
 
+const unsigned char * json_object_get_hex(const JSON_Object *object, const char *name, size_t *len) {
+    return json_value_get_hex(json_object_get_value(object, name), len);
+}
+
 double json_object_get_number(const JSON_Object *object, const char *name) {
     return json_value_get_number(json_object_get_value(object, name));
 }
@@ -1344,6 +2034,16 @@ const char * json_value_get_string(const JSON_Value *value) {
     return json_value_get_type(value) == JSONString ? value->value.string : NULL;
 }
 
+const unsigned char * json_value_get_hex(const JSON_Value *value, size_t *len) {
+    if (json_value_get_type(value) != JSONString || value->hex_len < 0) {
+        return NULL;
+    }
+    if (len != NULL) {
+        *len = (size_t)value->hex_len;
+    }
+    return HEX_BYTES(value);
+}
+
 double json_value_get_number(const JSON_Value *value) {
     return json_value_get_type(value) == JSONNumber ? value->value.number : 0;
 }
@@ -1362,7 +2062,11 @@ void json_value_free(JSON_Value *value) {
             json_object_free(value->value.object);
             break;
         case JSONString:
-            parson_free(value->value.string);
+            if (value->hex_len >= 0) {
+                parson_free(HEX_BYTES(value));
+            } else {
+                parson_free(value->value.string);
+            }
             break;
         case JSONArray:
             json_array_free(value->value.array);
@@ -1544,20 +2248,20 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value) {
 
 size_t json_serialization_size(const JSON_Value *value) {
     char num_buf[NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
-    int res = json_serialize_to_buffer_r(value, NULL, 0, 0, num_buf);
-    return res < 0 ? 0 : (size_t)(res + 1);
+    JSON_Writer writer = { NULL, 0, 0, 0 };
+    if (json_serialize_to_writer_r(value, &writer, 0, 0, num_buf) != JSONSuccess) {
+        return 0;
+    }
+    return writer.len + 1;
 }
 
 JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size(value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
-        return JSONFailure;
-    }
-    written = json_serialize_to_buffer_r(value, buf, 0, 0, NULL);
-    if (written < 0) {
+    char num_buf[NUM_BUF_SIZE];
+    JSON_Writer writer = { buf, 0, buf_size_in_bytes, 0 };
+    if (buf == NULL || json_serialize_to_writer_r(value, &writer, 0, 0, num_buf) != JSONSuccess) {
         return JSONFailure;
     }
+    buf[writer.len] = '\0';
     return JSONSuccess;
 }
 
@@ -1584,47 +2288,25 @@ JSON_Status json_serialize_to_file(const JSON_Value *value, const char *filename
 }
 
 char * json_serialize_to_string(const JSON_Value *value, int *len) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size(value);
-    char *buf = NULL;
-    if (buf_size_bytes == 0) {
-        return NULL;
-    }
-    if (len != NULL) {
-        /*
-         * The user wants to be provided with the string length
-         * Subtract by 1 to get string length (ommitting the added NULL byte).
-         */
-        *len = buf_size_bytes - 1;
-    }
-    buf = (char*)parson_malloc(buf_size_bytes);
-    if (buf == NULL) {
-        return NULL;
-    }
-    serialization_result = json_serialize_to_buffer(value, buf, buf_size_bytes);
-    if (serialization_result == JSONFailure) {
-        json_free_serialized_string(buf);
-        return NULL;
-    }
-    return buf;
+    return json_serialize_to_string_internal(value, len, 0);
 }
 
 size_t json_serialization_size_pretty(const JSON_Value *value) {
     char num_buf[NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
-    int res = json_serialize_to_buffer_r(value, NULL, 0, 1, num_buf);
-    return res < 0 ? 0 : (size_t)(res + 1);
+    JSON_Writer writer = { NULL, 0, 0, 0 };
+    if (json_serialize_to_writer_r(value, &writer, 0, 1, num_buf) != JSONSuccess) {
+        return 0;
+    }
+    return writer.len + 1;
 }
 
 JSON_Status json_serialize_to_buffer_pretty(const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size_pretty(value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
-        return JSONFailure;
-    }
-    written = json_serialize_to_buffer_r(value, buf, 0, 1, NULL);
-    if (written < 0) {
+    char num_buf[NUM_BUF_SIZE];
+    JSON_Writer writer = { buf, 0, buf_size_in_bytes, 0 };
+    if (buf == NULL || json_serialize_to_writer_r(value, &writer, 0, 1, num_buf) != JSONSuccess) {
         return JSONFailure;
     }
+    buf[writer.len] = '\0';
     return JSONSuccess;
 }
 
@@ -1651,33 +2333,332 @@ JSON_Status json_serialize_to_file_pretty(const JSON_Value *value, const char *f
 }
 
 char * json_serialize_to_string_pretty(const JSON_Value *value, int *len) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size_pretty(value);
-    char *buf = NULL;
-    if (buf_size_bytes == 0) {
-        return NULL;
+    return json_serialize_to_string_internal(value, len, 1);
+}
+
+void json_free_serialized_string(char *string) {
+    parson_free(string);
+}
+
+/* Binary serialization */
+#define BINARY_LENGTH_MAX 0xFFFFFFFFUL /* lengths and counts take four bytes */
+
+static JSON_Status binary_append_length(JSON_Writer *writer, size_t len) {
+    unsigned int n = (unsigned int)len;
+    if (len > BINARY_LENGTH_MAX) {
+        return JSONFailure;
     }
-    if (len != NULL) {
-        /*
-         * The user wants to be provided with the string length
-         * Subtract by 1 to get string length (ommitting the added NULL byte).
-         */
-        *len = buf_size_bytes - 1;
+    return json_writer_append(writer, (const char*)&n, sizeof(n));
+}
+
+/* BINARY_HEX_UPPER or BINARY_HEX_LOWER if string is all hex digits of one case, so
+   that its bytes are all it takes to write it again, 0 if it has to be kept as is */
+static int binary_hex_case(const char *string, size_t len) {
+    const unsigned char *in = (const unsigned char*)string;
+    int is_hex = len > 0, upper = 0, lower = 0;
+    size_t i;
+    for (i = 0; i < len; i++) {
+        is_hex &= isxdigit(in[i]) != 0;
+        upper |= in[i] >= 'A' && in[i] <= 'F';
+        lower |= in[i] >= 'a' && in[i] <= 'f';
+    }
+    if (!is_hex || (upper && lower)) {
+        return 0;
     }
-    buf = (char*)parson_malloc(buf_size_bytes);
+    return lower ? BINARY_HEX_LOWER : BINARY_HEX_UPPER;
+}
+
+/* Writes the bytes of a string binary_hex_case accepted */
+static JSON_Status binary_append_hex(JSON_Writer *writer, const JSON_Value *value, size_t len) {
+    const unsigned char *in = (const unsigned char*)value->value.string;
+    unsigned char bin[64];
+    size_t i = 0, j = 0;
+    if (value->hex_len >= 0) {
+        return json_writer_append(writer, (const char*)HEX_BYTES(value), (size_t)value->hex_len);
+    }
+    if (len & 1) {
+        bin[j++] = (unsigned char)HEX_NIBBLE(in[0]);
+        i = 1;
+    }
+    for (; i < len; i += 2) {
+        bin[j++] = (unsigned char)((HEX_NIBBLE(in[i]) << 4) | HEX_NIBBLE(in[i + 1]));
+        if (j == sizeof(bin)) {
+            if (json_writer_append(writer, (const char*)bin, j) != JSONSuccess) {
+                return JSONFailure;
+            }
+            j = 0;
+        }
+    }
+    return json_writer_append(writer, (const char*)bin, j);
+}
+
+static JSON_Status json_serialize_to_binary_r(const JSON_Value *value, JSON_Writer *writer) {
+    const char *string = NULL;
+    JSON_Array *array = NULL;
+    JSON_Object *object = NULL;
+    size_t i = 0, count = 0, len = 0;
+    double num = 0.0;
+    char tag = 0;
+
+    switch (json_value_get_type(value)) {
+        case JSONArray:
+            array = json_value_get_array(value);
+            count = json_array_get_count(array);
+            tag = BINARY_ARRAY;
+            if (json_writer_append(writer, &tag, 1) != JSONSuccess ||
+                binary_append_length(writer, count) != JSONSuccess) {
+                return JSONFailure;
+            }
+            for (i = 0; i < count; i++) {
+                if (json_serialize_to_binary_r(array->items[i], writer) != JSONSuccess) {
+                    return JSONFailure;
+                }
+            }
+            return JSONSuccess;
+        case JSONObject:
+            object = json_value_get_object(value);
+            count = json_object_get_count(object);
+            tag = BINARY_OBJECT;
+            if (json_writer_append(writer, &tag, 1) != JSONSuccess ||
+                binary_append_length(writer, count) != JSONSuccess) {
+                return JSONFailure;
+            }
+            for (i = 0; i < count; i++) {
+                len = strnlen_s(object->names[i], STRING_NAME_MAX); /* SAFEC */
+                if (binary_append_length(writer, len) != JSONSuccess ||
+                    json_writer_append(writer, object->names[i], len + 1) != JSONSuccess ||
+                    json_serialize_to_binary_r(object->values[i], writer) != JSONSuccess) {
+                    return JSONFailure;
+                }
+            }
+            return JSONSuccess;
+        case JSONString:
+            string = json_value_get_string(value);
+            if (string == NULL) {
+                return JSONFailure;
+            }
+            len = strnlen_s(string, STRING_VALUE_MAX); /* SAFEC */
+            /* the digits of hex are rebuilt from the bytes when read back */
+            tag = (char)binary_hex_case(string, len);
+            if (!tag) {
+                tag = BINARY_STRING;
+            }
+            if (json_writer_append(writer, &tag, 1) != JSONSuccess ||
+                binary_append_length(writer, len) != JSONSuccess) {
+                return JSONFailure;
+            }
+            if (tag != BINARY_STRING) {
+                return binary_append_hex(writer, value, len);
+            }
+            return json_writer_append(writer, string, len);
+        case JSONBoolean:
+            tag = json_value_get_boolean(value) ? BINARY_TRUE : BINARY_FALSE;
+            return json_writer_append(writer, &tag, 1);
+        case JSONNumber:
+            num = json_value_get_number(value);
+            tag = BINARY_NUMBER;
+            if (json_writer_append(writer, &tag, 1) != JSONSuccess) {
+                return JSONFailure;
+            }
+            return json_writer_append(writer, (const char*)&num, sizeof(num));
+        case JSONNull:
+            tag = BINARY_NULL;
+            return json_writer_append(writer, &tag, 1);
+        default:
+            return JSONFailure;
+    }
+}
+
+size_t json_binary_size(const JSON_Value *value) {
+    JSON_Writer writer = { NULL, 0, 0, 0 };
+    if (json_serialize_to_binary_r(value, &writer) != JSONSuccess) {
+        return 0;
+    }
+    return writer.len;
+}
+
+JSON_Status json_serialize_to_binary(const JSON_Value *value, unsigned char *buf, size_t buf_size_in_bytes) {
+    /* the writer keeps a byte free for a terminator the binary form doesn't have */
+    JSON_Writer writer = { (char*)buf, 0, buf_size_in_bytes + 1, 0 };
     if (buf == NULL) {
+        return JSONFailure;
+    }
+    return json_serialize_to_binary_r(value, &writer);
+}
+
+static JSON_Status binary_read(JSON_Binary_Reader *reader, void *out, size_t n) {
+    if (reader->len - reader->pos < n) {
+        return JSONFailure;
+    }
+    memcpy_s(out, n, reader->buf + reader->pos, n); /* SAFEC */
+    reader->pos += n;
+    return JSONSuccess;
+}
+
+static JSON_Status binary_read_length(JSON_Binary_Reader *reader, size_t *len) {
+    unsigned int n = 0;
+    if (binary_read(reader, &n, sizeof(n)) != JSONSuccess) {
+        return JSONFailure;
+    }
+    *len = n;
+    return JSONSuccess;
+}
+
+/* Lays a string out the way stream_hex_value does, from its bytes */
+static JSON_Value * parse_binary_hex(JSON_Binary_Reader *reader, int lower) {
+    const char *digits = lower ? "0123456789abcdef" : "0123456789ABCDEF";
+    JSON_Value *value = NULL;
+    unsigned char *bin = NULL;
+    char *string = NULL;
+    size_t len = 0, bin_len = 0, i = 0, j = 0;
+    if (binary_read_length(reader, &len) != JSONSuccess || len > STRING_VALUE_MAX) {
+        return NULL;
+    }
+    bin_len = (len + 1) / 2;
+    if (reader->len - reader->pos < bin_len) {
         return NULL;
     }
-    serialization_result = json_serialize_to_buffer_pretty(value, buf, buf_size_bytes);
-    if (serialization_result == JSONFailure) {
-        json_free_serialized_string(buf);
+    bin = (unsigned char*)parson_malloc(HEX_ROUND(bin_len) + len + 1);
+    if (bin == NULL) {
         return NULL;
     }
-    return buf;
+    binary_read(reader, bin, bin_len);
+    string = (char*)bin + HEX_ROUND(bin_len);
+    if (len & 1) {
+        string[i++] = digits[bin[j++] & 0xF];
+    }
+    for (; i < len; i += 2, j++) {
+        string[i] = digits[bin[j] >> 4];
+        string[i + 1] = digits[bin[j] & 0xF];
+    }
+    string[len] = '\0';
+    value = json_value_init_string_no_copy(string);
+    if (value == NULL) {
+        parson_free(bin);
+        return NULL;
+    }
+    value->hex_len = (int)bin_len;
+    return value;
 }
 
-void json_free_serialized_string(char *string) {
-    parson_free(string);
+static JSON_Value * parse_binary_value(JSON_Binary_Reader *reader, size_t nesting) {
+    JSON_Value *value = NULL, *member = NULL;
+    const char *name = NULL;
+    char *string = NULL;
+    size_t len = 0, count = 0, i = 0;
+    double num = 0.0;
+    char tag = 0;
+
+    if (nesting > MAX_NESTING || binary_read(reader, &tag, 1) != JSONSuccess) {
+        return NULL;
+    }
+    switch (tag) {
+        case BINARY_NULL:
+            return json_value_init_null();
+        case BINARY_FALSE:
+        case BINARY_TRUE:
+            return json_value_init_boolean(tag == BINARY_TRUE);
+        case BINARY_NUMBER:
+            if (binary_read(reader, &num, sizeof(num)) != JSONSuccess) {
+                return NULL;
+            }
+            return json_value_init_number(num);
+        case BINARY_STRING:
+            if (binary_read_length(reader, &len) != JSONSuccess || len > STRING_VALUE_MAX) {
+                return NULL;
+            }
+            string = (char*)parson_malloc(len + 1);
+            if (string == NULL) {
+                return NULL;
+            }
+            if (binary_read(reader, string, len) != JSONSuccess) {
+                parson_free(string);
+                return NULL;
+            }
+            string[len] = '\0';
+            value = json_value_init_string_no_copy(string);
+            if (value == NULL) {
+                parson_free(string);
+            }
+            return value;
+        case BINARY_HEX_UPPER:
+        case BINARY_HEX_LOWER:
+            return parse_binary_hex(reader, tag == BINARY_HEX_LOWER);
+        case BINARY_ARRAY:
+            if (binary_read_length(reader, &count) != JSONSuccess) {
+                return NULL;
+            }
+            value = json_value_init_array();
+            if (value == NULL) {
+                return NULL;
+            }
+            /* every element takes at least its tag */
+            if (count > reader->len - reader->pos ||
+                (count > 0 && json_array_resize(json_value_get_array(value), count) != JSONSuccess)) {
+                json_value_free(value);
+                return NULL;
+            }
+            for (i = 0; i < count; i++) {
+                member = parse_binary_value(reader, nesting + 1);
+                if (member == NULL) {
+                    json_value_free(value);
+                    return NULL;
+                }
+                json_array_add(json_value_get_array(value), member);
+            }
+            return value;
+        case BINARY_OBJECT:
+            if (binary_read_length(reader, &count) != JSONSuccess) {
+                return NULL;
+            }
+            value = json_value_init_object();
+            if (value == NULL) {
+                return NULL;
+            }
+            if (count > reader->len - reader->pos ||
+                (count > 0 && json_object_resize(json_value_get_object(value), count) != JSONSuccess)) {
+                json_value_free(value);
+                return NULL;
+            }
+            for (i = 0; i < count; i++) {
+                if (binary_read_length(reader, &len) != JSONSuccess || len >= STRING_NAME_MAX ||
+                    reader->len - reader->pos <= len || reader->buf[reader->pos + len] != '\0') {
+                    json_value_free(value);
+                    return NULL;
+                }
+                name = (const char*)reader->buf + reader->pos;
+                reader->pos += len + 1;
+                member = parse_binary_value(reader, nesting + 1);
+                if (member == NULL) {
+                    json_value_free(value);
+                    return NULL;
+                }
+                if (json_object_addn(json_value_get_object(value), name, len, member) != JSONSuccess) {
+                    json_value_free(member);
+                    json_value_free(value);
+                    return NULL;
+                }
+            }
+            return value;
+        default:
+            return NULL;
+    }
+}
+
+JSON_Value * json_parse_binary(const unsigned char *buf, size_t buf_size_in_bytes, size_t *used) {
+    JSON_Binary_Reader reader;
+    JSON_Value *value = NULL;
+    if (buf == NULL) {
+        return NULL;
+    }
+    reader.buf = buf;
+    reader.len = buf_size_in_bytes;
+    reader.pos = 0;
+    value = parse_binary_value(&reader, 0);
+    if (value != NULL && used != NULL) {
+        *used = reader.pos;
+    }
+    return value;
 }
 
 #if 0 /* Removed, does not currently comply with SAFEC */
@@ -1771,6 +2752,22 @@ JSON_Status json_array_append_value(JSON_Array *array, JSON_Value *value) {
     return json_array_add(array, value);
 }
 
+JSON_Status json_array_append_array_values(JSON_Array *array, JSON_Array *src) {
+    size_t i;
+    if (array == NULL || src == NULL || array == src) {
+        return JSONFailure;
+    }
+    if (array->count + src->count > array->capacity &&
+        json_array_resize(array, MAX(array->capacity * 2, array->count + src->count)) == JSONFailure) {
+        return JSONFailure;
+    }
+    for (i = 0; i < src->count; i++) {
+        json_array_add(array, src->items[i]); /* cannot fail, capacity is already there */
+    }
+    src->count = 0;
+    return JSONSuccess;
+}
+
 JSON_Status json_array_append_string(JSON_Array *array, const char *string) {
     JSON_Value *value = json_value_init_string(string);
     if (value == NULL) {
@@ -1820,23 +2817,17 @@ JSON_Status json_array_append_null(JSON_Array *array) {
 }
 
 JSON_Status json_object_set_value(JSON_Object *object, const char *name, JSON_Value *value) {
-    size_t i = 0;
-    JSON_Value *old_value;
+    size_t i = 0, name_len = 0;
     if (object == NULL || name == NULL || value == NULL || value->parent != NULL) {
         return JSONFailure;
     }
-    old_value = json_object_get_value(object, name);
-    if (old_value != NULL) { /* free and overwrite old value */
-        json_value_free(old_value);
-        for (i = 0; i < json_object_get_count(object); i++) {
-            int diff = 1;
-            strcmp_s(object->names[i], STRING_NAME_MAX, name, &diff); /* SAFEC */
-            if (!diff) {
-                value->parent = json_object_get_wrapping_value(object);
-                object->values[i] = value;
-                return JSONSuccess;
-            }
-        }
+    name_len = strnlen_s(name, STRING_NAME_MAX);
+    i = json_object_find(object, name, name_len, hash_string(name, name_len));
+    if (i < object->count) { /* free and overwrite old value */
+        json_value_free(object->values[i]);
+        value->parent = json_object_get_wrapping_value(object);
+        object->values[i] = value;
+        return JSONSuccess;
     }
     /* add new key value pair */
     return json_object_add(object, name, value);
@@ -1970,6 +2961,9 @@ JSON_Status json_object_clear(JSON_Object *object) {
         json_value_free(object->values[i]);
     }
     object->count = 0;
+    parson_free(object->cells);
+    object->cells = NULL;
+    object->cell_count = 0;
     return JSONSuccess;
 }
 